@@ -0,0 +1,624 @@
+/**
+ * @file tcp_server_bench.cpp
+ * @brief Load generator and latency benchmark for TcpServer
+ *
+ * Drives a TcpServer over loopback TCP, or a Unix domain socket with --unix,
+ * with a multi-threaded asynchronous client.
+ * Requests and responses use a u32 big-endian length prefix; the in-process
+ * server echoes every frame. A human-readable summary is written to stderr and
+ * machine-readable JSON to stdout.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "tcp_server/asio.h"
+#include "tcp_server/framer.h"
+#include "tcp_server/latency_histogram.h"
+#include "tcp_server/tcp_server.h"
+#include "tcp_server/version.h"
+
+namespace {
+
+using boost::asio::ip::tcp;
+using StreamProtocol = boost::asio::generic::stream_protocol;
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief One benchmark configuration
+ */
+struct Scenario {
+  std::string name = "custom";     ///< Scenario label
+  bool open_loop = false;          ///< Send at a fixed rate instead of on each response
+  double rate = 10000.0;           ///< Total requests per second in open-loop mode
+  unsigned int connections = 16;   ///< Client connections
+  unsigned int pipeline = 1;       ///< Outstanding requests per connection (closed loop)
+  std::size_t message_size = 64;   ///< Request and response payload size in bytes
+  unsigned int client_threads = 2; ///< Client io_context threads
+  double warmup_seconds = 1.0;     ///< Time before measurement starts
+  double duration_seconds = 5.0;   ///< Measured time
+};
+
+/**
+ * @brief Server and run-wide settings
+ */
+struct Settings {
+  std::string host = "127.0.0.1";  ///< Server address
+  unsigned short port = 19876;     ///< Server port
+  std::string unix_path;           ///< Unix domain socket to connect to instead of the port
+  bool start_server = true;        ///< Run an in-process echo server
+  unsigned int server_threads = 2; ///< Worker threads of the in-process server
+  bool context_per_thread = false; ///< Use ExecutionMode::kContextPerThread
+  std::string label;               ///< Free-form label, e.g. a commit hash
+  bool suite = false;              ///< Run the standard scenario matrix
+};
+
+/**
+ * @brief Counters of one client thread
+ */
+struct ThreadStats {
+  tcp_server::LatencyHistogram latency;  ///< Latency in nanoseconds
+  std::uint64_t requests = 0;            ///< Responses received in the window
+  std::uint64_t bytes = 0;               ///< Payload bytes received in the window
+  std::uint64_t errors = 0;              ///< Connection errors
+  std::uint64_t dropped = 0;             ///< Open-loop sends skipped at the backlog limit
+};
+
+/**
+ * @brief Measurement window shared by every connection
+ */
+struct Window {
+  Clock::time_point start;  ///< Requests sent from here on are measured
+  Clock::time_point end;    ///< Responses after this are not counted
+};
+
+/**
+ * @brief One pipelined client connection
+ */
+class BenchConnection : public std::enable_shared_from_this<BenchConnection> {
+ public:
+  static constexpr std::size_t kMaxBacklog = 100000;  ///< Outstanding open-loop requests before dropping
+  static constexpr std::size_t kMaxBatch = 64;        ///< Requests gathered into one write
+
+  BenchConnection(boost::asio::io_context& io_context, const Scenario& scenario,
+                  const std::string& frame, const tcp_server::Framer& framer,
+                  const Window& window, ThreadStats& stats, std::atomic<bool>& stopping)
+      : socket_(io_context),
+        timer_(io_context),
+        scenario_(scenario),
+        frame_(frame),
+        framer_(framer),
+        window_(window),
+        stats_(stats),
+        stopping_(stopping),
+        read_buffer_(std::max<std::size_t>(frame.size() * 2, 64 * 1024)) {}
+
+  void Connect(const StreamProtocol::endpoint& endpoint) {
+    socket_.connect(endpoint);
+    if (endpoint.protocol().family() != AF_UNIX) {
+      socket_.set_option(tcp::no_delay(true));
+    }
+  }
+
+  void Start(Clock::time_point first_send, Clock::duration interval) {
+    StartRead();
+    if (scenario_.open_loop) {
+      next_send_ = first_send;
+      interval_ = interval;
+      ScheduleTick();
+    } else {
+      const auto now = Clock::now();
+      for (unsigned int i = 0; i < scenario_.pipeline; ++i) {
+        QueueRequest(now);
+      }
+      Flush();
+    }
+  }
+
+  void Close() {
+    boost::system::error_code ec;
+    timer_.cancel();
+    socket_.close(ec);
+  }
+
+ private:
+  void QueueRequest(Clock::time_point intended) {
+    send_times_.push_back(intended);
+    ++unsent_;
+  }
+
+  void Flush() {
+    if (writing_ || unsent_ == 0 || stopping_) {
+      return;
+    }
+
+    // Gather several copies of the request frame into one vectored write
+    const std::size_t batch = std::min(unsent_, kMaxBatch);
+    buffers_.assign(batch, boost::asio::buffer(frame_));
+    unsent_ -= batch;
+    writing_ = true;
+
+    auto self = shared_from_this();
+    boost::asio::async_write(socket_, buffers_,
+                             [self](const boost::system::error_code& error, std::size_t) {
+                               self->writing_ = false;
+                               if (error) {
+                                 self->Fail(error);
+                                 return;
+                               }
+                               self->Flush();
+                             });
+  }
+
+  void StartRead() {
+    if (read_size_ == read_buffer_.size()) {
+      read_buffer_.resize(read_buffer_.size() * 2);
+    }
+
+    auto self = shared_from_this();
+    socket_.async_read_some(
+        boost::asio::buffer(read_buffer_.data() + read_size_, read_buffer_.size() - read_size_),
+        [self](const boost::system::error_code& error, std::size_t bytes_transferred) {
+          self->HandleRead(error, bytes_transferred);
+        });
+  }
+
+  void HandleRead(const boost::system::error_code& error, std::size_t bytes_transferred) {
+    if (error) {
+      Fail(error);
+      return;
+    }
+    read_size_ += bytes_transferred;
+
+    // Match every complete response with the oldest outstanding request
+    const auto now = Clock::now();
+    std::size_t offset = 0;
+    while (true) {
+      std::string_view payload;
+      const std::size_t consumed = framer_.Extract(
+          std::string_view(read_buffer_.data() + offset, read_size_ - offset), &payload);
+      if (consumed == 0) {
+        break;
+      }
+      offset += consumed;
+
+      if (send_times_.empty()) {
+        ++stats_.errors;
+        continue;
+      }
+      const auto intended = send_times_.front();
+      send_times_.pop_front();
+      if (intended >= window_.start && now <= window_.end) {
+        stats_.latency.Record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - intended).count()));
+        ++stats_.requests;
+        stats_.bytes += payload.size();
+      }
+      if (!scenario_.open_loop) {
+        QueueRequest(now);
+      }
+    }
+
+    std::copy(read_buffer_.begin() + offset, read_buffer_.begin() + read_size_,
+              read_buffer_.begin());
+    read_size_ -= offset;
+
+    Flush();
+    if (!stopping_) {
+      StartRead();
+    }
+  }
+
+  void ScheduleTick() {
+    timer_.expires_at(next_send_);
+    auto self = shared_from_this();
+    timer_.async_wait([self](const boost::system::error_code& error) {
+      if (error || self->stopping_) {
+        return;
+      }
+
+      // Send everything that is due, timed from its intended start to avoid
+      // coordinated omission
+      const auto now = Clock::now();
+      while (self->next_send_ <= now) {
+        if (self->send_times_.size() < kMaxBacklog) {
+          self->QueueRequest(self->next_send_);
+        } else {
+          ++self->stats_.dropped;
+        }
+        self->next_send_ += self->interval_;
+      }
+      self->Flush();
+      self->ScheduleTick();
+    });
+  }
+
+  void Fail(const boost::system::error_code& error) {
+    if (!stopping_ && error != boost::asio::error::operation_aborted) {
+      ++stats_.errors;
+      spdlog::debug("Client connection error: {}", error.message());
+    }
+    Close();
+  }
+
+  StreamProtocol::socket socket_;
+  boost::asio::steady_timer timer_;
+  const Scenario& scenario_;
+  const std::string& frame_;
+  const tcp_server::Framer& framer_;
+  const Window& window_;
+  ThreadStats& stats_;
+  std::atomic<bool>& stopping_;
+  std::vector<char> read_buffer_;
+  std::size_t read_size_ = 0;
+  std::deque<Clock::time_point> send_times_;
+  std::size_t unsent_ = 0;
+  bool writing_ = false;
+  std::vector<boost::asio::const_buffer> buffers_;
+  Clock::time_point next_send_;
+  Clock::duration interval_{};
+};
+
+/**
+ * @brief Aggregated result of one scenario
+ */
+struct Result {
+  Scenario scenario;
+  tcp_server::LatencyHistogram latency;
+  std::uint64_t requests = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t errors = 0;
+  std::uint64_t dropped = 0;
+};
+
+Result RunScenario(const Settings& settings, const Scenario& scenario) {
+  tcp_server::LengthPrefixFramer framer(tcp_server::LengthPrefixFramer::Width::kUint32,
+                                        tcp_server::ByteOrder::kBigEndian,
+                                        std::max(scenario.message_size,
+                                                 tcp_server::LengthPrefixFramer::kDefaultMaxPayloadSize));
+  std::string frame;
+  framer.Encode(std::string(scenario.message_size, 'x'), &frame);
+
+  const StreamProtocol::endpoint endpoint =
+      settings.unix_path.empty()
+          ? StreamProtocol::endpoint(
+                tcp::endpoint(boost::asio::ip::make_address(settings.host), settings.port))
+          : StreamProtocol::endpoint(boost::asio::local::stream_protocol::endpoint(
+                settings.unix_path.front() == '@' ? '\0' + settings.unix_path.substr(1)
+                                                  : settings.unix_path));
+  const unsigned int thread_count = std::max(1u, scenario.client_threads);
+
+  std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+  std::vector<ThreadStats> stats(thread_count);
+  std::vector<std::shared_ptr<BenchConnection>> connections;
+  std::atomic<bool> stopping(false);
+  Window window;
+
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    contexts.push_back(std::make_unique<boost::asio::io_context>(1));
+  }
+  for (unsigned int i = 0; i < scenario.connections; ++i) {
+    auto connection = std::make_shared<BenchConnection>(*contexts[i % thread_count], scenario,
+                                                        frame, framer, window,
+                                                        stats[i % thread_count], stopping);
+    connection->Connect(endpoint);
+    connections.push_back(std::move(connection));
+  }
+
+  // Spread open-loop senders evenly over one interval
+  const auto start = Clock::now();
+  window.start = start + std::chrono::duration_cast<Clock::duration>(
+                             std::chrono::duration<double>(scenario.warmup_seconds));
+  window.end = window.start + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(scenario.duration_seconds));
+  const auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(scenario.connections / std::max(scenario.rate, 1.0)));
+  for (std::size_t i = 0; i < connections.size(); ++i) {
+    auto connection = connections[i];
+    const auto first_send = start + interval * static_cast<long>(i) /
+                                        static_cast<long>(connections.size());
+    boost::asio::post(*contexts[i % thread_count], [connection, first_send, interval] {
+      connection->Start(first_send, interval);
+    });
+  }
+
+  std::vector<std::thread> threads;
+  for (auto& context : contexts) {
+    threads.emplace_back([&context] { context->run(); });
+  }
+
+  std::this_thread::sleep_until(window.end);
+  stopping = true;
+  for (std::size_t i = 0; i < connections.size(); ++i) {
+    auto connection = connections[i];
+    boost::asio::post(*contexts[i % thread_count], [connection] { connection->Close(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  connections.clear();
+
+  Result result;
+  result.scenario = scenario;
+  for (const auto& thread_stats : stats) {
+    result.latency.Merge(thread_stats.latency);
+    result.requests += thread_stats.requests;
+    result.bytes += thread_stats.bytes;
+    result.errors += thread_stats.errors;
+    result.dropped += thread_stats.dropped;
+  }
+  return result;
+}
+
+double Microseconds(std::uint64_t nanoseconds) {
+  return static_cast<double>(nanoseconds) / 1000.0;
+}
+
+void PrintSummary(const Result& result) {
+  const double seconds = result.scenario.duration_seconds;
+  std::fprintf(stderr,
+               "%-28s size=%-8zu conns=%-4u pipeline=%-3u %10.0f req/s %9.2f MB/s  "
+               "p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus errors=%llu\n",
+               result.scenario.name.c_str(), result.scenario.message_size,
+               result.scenario.connections, result.scenario.pipeline,
+               static_cast<double>(result.requests) / seconds,
+               static_cast<double>(result.bytes) / seconds / (1024.0 * 1024.0),
+               Microseconds(result.latency.Percentile(50.0)),
+               Microseconds(result.latency.Percentile(99.0)),
+               Microseconds(result.latency.Percentile(99.9)), Microseconds(result.latency.Max()),
+               static_cast<unsigned long long>(result.errors));
+}
+
+std::string EscapeJson(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string ToJson(const Settings& settings, const std::vector<Result>& results) {
+  std::ostringstream out;
+  out << "{\n"
+      << "  \"version\": \"" << tcp_server::Version::kMajor << '.' << tcp_server::Version::kMinor
+      << '.' << tcp_server::Version::kPatch << "\",\n"
+      << "  \"label\": \"" << EscapeJson(settings.label) << "\",\n"
+      << "  \"server\": {\"in_process\": " << (settings.start_server ? "true" : "false")
+      << ", \"threads\": " << settings.server_threads << ", \"execution_mode\": \""
+      << (settings.context_per_thread ? "context_per_thread" : "shared_context")
+      << "\", \"transport\": \"" << (settings.unix_path.empty() ? "tcp" : "unix") << "\"},\n"
+      << "  \"results\": [\n";
+
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    const double seconds = r.scenario.duration_seconds;
+    out << "    {\"name\": \"" << EscapeJson(r.scenario.name) << "\""
+        << ", \"mode\": \"" << (r.scenario.open_loop ? "open" : "closed") << "\""
+        << ", \"target_rate\": " << (r.scenario.open_loop ? r.scenario.rate : 0.0)
+        << ", \"connections\": " << r.scenario.connections
+        << ", \"pipeline\": " << r.scenario.pipeline
+        << ", \"message_size\": " << r.scenario.message_size
+        << ", \"client_threads\": " << r.scenario.client_threads
+        << ", \"duration_s\": " << seconds
+        << ", \"requests\": " << r.requests
+        << ", \"requests_per_s\": " << static_cast<double>(r.requests) / seconds
+        << ", \"mb_per_s\": " << static_cast<double>(r.bytes) / seconds / (1024.0 * 1024.0)
+        << ", \"errors\": " << r.errors
+        << ", \"dropped\": " << r.dropped
+        << ", \"latency_us\": {\"min\": " << Microseconds(r.latency.Min())
+        << ", \"mean\": " << r.latency.Mean() / 1000.0
+        << ", \"p50\": " << Microseconds(r.latency.Percentile(50.0))
+        << ", \"p90\": " << Microseconds(r.latency.Percentile(90.0))
+        << ", \"p99\": " << Microseconds(r.latency.Percentile(99.0))
+        << ", \"p99_9\": " << Microseconds(r.latency.Percentile(99.9))
+        << ", \"max\": " << Microseconds(r.latency.Max()) << "}}"
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+  return out.str();
+}
+
+/**
+ * @brief Standard matrix: many vs. few pipelined connections, closed vs. open loop, 16 B to 1 MB
+ */
+std::vector<Scenario> SuiteScenarios(const Scenario& base) {
+  std::vector<Scenario> scenarios;
+  for (std::size_t size : {16u, 256u, 4096u, 65536u, 1048576u}) {
+    Scenario many = base;
+    many.name = "closed_many_connections";
+    many.connections = 64;
+    many.pipeline = 1;
+    many.message_size = size;
+    scenarios.push_back(many);
+
+    Scenario pipelined = base;
+    pipelined.name = "closed_pipelined";
+    pipelined.connections = 4;
+    pipelined.pipeline = size >= 65536 ? 4 : 32;
+    pipelined.message_size = size;
+    scenarios.push_back(pipelined);
+  }
+  for (std::size_t size : {16u, 4096u}) {
+    Scenario open = base;
+    open.name = "open_fixed_rate";
+    open.open_loop = true;
+    open.connections = 64;
+    open.message_size = size;
+    scenarios.push_back(open);
+  }
+  return scenarios;
+}
+
+void PrintUsage(const char* program) {
+  std::fprintf(stderr,
+               "Usage: %s [options]\n"
+               "  --suite                 Run the standard scenario matrix\n"
+               "  --mode closed|open      Closed loop or fixed arrival rate (default closed)\n"
+               "  --rate N                Total requests/s in open-loop mode (default 10000)\n"
+               "  --connections N         Client connections (default 16)\n"
+               "  --pipeline N            Outstanding requests per connection (default 1)\n"
+               "  --size BYTES            Message size (default 64)\n"
+               "  --client-threads N      Client threads (default 2)\n"
+               "  --duration SECONDS      Measured time per scenario (default 5)\n"
+               "  --warmup SECONDS        Warm-up time per scenario (default 1)\n"
+               "  --server-threads N      In-process server threads (default 2)\n"
+               "  --context-per-thread    Run the server with one io_context per thread\n"
+               "  --external              Benchmark a running server instead of starting one\n"
+               "  --host ADDRESS          Server address (default 127.0.0.1)\n"
+               "  --port N                Server port (default 19876)\n"
+               "  --unix PATH             Connect over a Unix domain socket (@name: abstract)\n"
+               "  --label TEXT            Label stored in the JSON output (e.g. commit hash)\n",
+               program);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Settings settings;
+  Scenario scenario;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+        if (i + 1 >= argc) {
+          throw std::invalid_argument("Missing value for " + arg);
+        }
+        return argv[++i];
+      };
+
+      if (arg == "--suite") {
+        settings.suite = true;
+      } else if (arg == "--mode") {
+        const std::string mode = value();
+        if (mode != "open" && mode != "closed") {
+          throw std::invalid_argument("Unknown mode: " + mode);
+        }
+        scenario.open_loop = mode == "open";
+      } else if (arg == "--rate") {
+        scenario.rate = std::stod(value());
+      } else if (arg == "--connections") {
+        scenario.connections = static_cast<unsigned int>(std::stoul(value()));
+      } else if (arg == "--pipeline") {
+        scenario.pipeline = static_cast<unsigned int>(std::stoul(value()));
+      } else if (arg == "--size") {
+        scenario.message_size = std::stoul(value());
+      } else if (arg == "--client-threads") {
+        scenario.client_threads = static_cast<unsigned int>(std::stoul(value()));
+      } else if (arg == "--duration") {
+        scenario.duration_seconds = std::stod(value());
+      } else if (arg == "--warmup") {
+        scenario.warmup_seconds = std::stod(value());
+      } else if (arg == "--server-threads") {
+        settings.server_threads = static_cast<unsigned int>(std::stoul(value()));
+      } else if (arg == "--context-per-thread") {
+        settings.context_per_thread = true;
+      } else if (arg == "--external") {
+        settings.start_server = false;
+      } else if (arg == "--host") {
+        settings.host = value();
+      } else if (arg == "--port") {
+        settings.port = static_cast<unsigned short>(std::stoul(value()));
+      } else if (arg == "--unix") {
+        settings.unix_path = value();
+      } else if (arg == "--label") {
+        settings.label = value();
+      } else if (arg == "--help" || arg == "-h") {
+        PrintUsage(argv[0]);
+        return 0;
+      } else {
+        throw std::invalid_argument("Unknown option: " + arg);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    PrintUsage(argv[0]);
+    return 2;
+  }
+
+  if (scenario.duration_seconds <= 0.0 || scenario.connections == 0 || scenario.pipeline == 0) {
+    std::fprintf(stderr, "duration, connections and pipeline must be positive\n");
+    return 2;
+  }
+
+  // Clients disconnecting at the end of each scenario would otherwise flood stderr
+  spdlog::set_level(spdlog::level::critical);
+
+  try {
+    std::vector<Scenario> scenarios =
+        settings.suite ? SuiteScenarios(scenario) : std::vector<Scenario>{scenario};
+    std::size_t max_message_size = 0;
+    unsigned int max_connections = 0;
+    for (const auto& s : scenarios) {
+      max_message_size = std::max(max_message_size, s.message_size);
+      max_connections = std::max(max_connections, s.connections);
+    }
+
+    // In-process echo server speaking the same framing as the client
+    std::unique_ptr<tcp_server::TcpServer> server;
+    if (settings.start_server) {
+      tcp_server::ServerOptions options;
+      options.max_connections = max_connections + 16;
+      options.connection_pool_size = max_connections;
+      options.execution_mode = settings.context_per_thread
+                                   ? tcp_server::ExecutionMode::kContextPerThread
+                                   : tcp_server::ExecutionMode::kSharedContext;
+      options.framer = std::make_shared<tcp_server::LengthPrefixFramer>(
+          tcp_server::LengthPrefixFramer::Width::kUint32, tcp_server::ByteOrder::kBigEndian,
+          std::max(max_message_size, tcp_server::LengthPrefixFramer::kDefaultMaxPayloadSize));
+      options.write_high_watermark = std::max(options.write_high_watermark, 4 * max_message_size);
+      options.write_low_watermark = options.write_high_watermark / 4;
+      if (!settings.unix_path.empty()) {
+        options.socket.unix_socket_paths = {settings.unix_path};
+      }
+
+      server = std::make_unique<tcp_server::TcpServer>(
+          settings.port,
+          [](std::string_view request, tcp_server::ResponseWriter& response) {
+            response.Write(request);
+          },
+          options);
+      server->Start(settings.server_threads);
+    }
+
+    std::vector<Result> results;
+    for (const auto& s : scenarios) {
+      results.push_back(RunScenario(settings, s));
+      PrintSummary(results.back());
+    }
+
+    if (server) {
+      server->Stop();
+    }
+
+    std::cout << ToJson(settings, results);
+    return 0;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "Benchmark failed: %s\n", e.what());
+    return 1;
+  }
+}
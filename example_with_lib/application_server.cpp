@@ -1,12 +1,15 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <atomic>
 #include <thread>
 #include <functional>
 #include <unordered_map>
 #include <algorithm>
+#include <mutex>
 
-#include <boost/asio.hpp>
+#include <tcp_server/asio.h>
+#include <tcp_server/router.h>
 #include <tcp_server/tcp_server.h>
 #include <spdlog/spdlog.h>
 
@@ -35,31 +38,40 @@ public:
         responsePatterns["help"] = "Available commands: hello, help, info, exit, time, date, weather";
         responsePatterns["info"] = "Application Server using TcpServer library";
         responsePatterns["exit"] = "Connection will be closed. Goodbye!";
+        router.Update(buildRoutes());
     }
 
-    // Add a new response pattern
+    // Add a new response pattern; safe while the server is dispatching requests
     void addPattern(const std::string& request, const std::string& response) {
+        std::lock_guard<std::mutex> lock(mutex);
         responsePatterns[trim(request)] = response;
+        router.Update(buildRoutes());
     }
 
-    // Get response for a request
-    std::string getResponse(const std::string& request) {
-        // Remove whitespace from request
-        std::string trimmed_request = trim(request);
-        spdlog::debug("Trimmed request: '{}'", trimmed_request);
-        
-        auto it = responsePatterns.find(trimmed_request);
-        if (it != responsePatterns.end()) {
-            // Pattern found
-            return it->second;
-        } else {
-            // Pattern not found
-            return "Command not recognized. Type 'help' to see available commands.";
-        }
+    // Message handler that looks up the command without copying the request
+    std::function<void(std::string_view, tcp_server::ResponseWriter&)> handler() {
+        return router.AsMessageHandler();
     }
 
 private:
+    // Build a route per pattern; unknown commands get the help hint
+    tcp_server::RouteTable buildRoutes() const {
+        tcp_server::RouteTable routes;
+        for (const auto& [request, response] : responsePatterns) {
+            routes.Add(request, [response](std::string_view, tcp_server::ResponseWriter& writer) {
+                writer.Write(response);
+            });
+        }
+        routes.SetFallback([](std::string_view request, tcp_server::ResponseWriter& writer) {
+            spdlog::debug("Unknown command: '{}'", request);
+            writer.Write("Command not recognized. Type 'help' to see available commands.");
+        });
+        return routes;
+    }
+
+    std::mutex mutex;
     std::unordered_map<std::string, std::string> responsePatterns;
+    tcp_server::Router router;
 };
 
 std::atomic<bool> running(true);
@@ -100,17 +112,20 @@ int main(int argc, char* argv[]) {
         responseProvider.addPattern("date", "Today's date information");
         responseProvider.addPattern("weather", "Weather is sunny");
         
-        // Message handler function
-        auto message_handler = [&responseProvider](const std::string& message) -> std::string {
-            spdlog::info("Request received: {}", message);
-            std::string response = responseProvider.getResponse(message);
-            spdlog::info("Sending response: {}", response);
-            return response;
-        };
-        
         // Create and start TCP server
         spdlog::info("Starting application server on port {}", port);
-        tcp_server::TcpServer server(port, message_handler);
+        // Responses depend only on the trimmed request, so repeats are served from the cache
+        tcp_server::ServerOptions options;
+        options.response_cache.max_bytes = 1024 * 1024;
+        options.response_cache.key = [](std::string_view request) {
+            const auto begin = request.find_first_not_of(" \t\r\n");
+            if (begin == std::string_view::npos) {
+                return std::string_view();
+            }
+            const auto end = request.find_last_not_of(" \t\r\n");
+            return request.substr(begin, end - begin + 1);
+        };
+        tcp_server::TcpServer server(port, responseProvider.handler(), options);
         server.Start();
         
         spdlog::info("Application server running. Press Ctrl+C to stop.");
@@ -1,9 +1,11 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <atomic>
+#include <chrono>
 #include <thread>
 
-#include <boost/asio.hpp>
+#include "tcp_server/asio.h"
 #include "tcp_server/tcp_server.h"
 #include <spdlog/spdlog.h>
 
@@ -21,6 +23,16 @@ int main(int argc, char* argv[]) {
     if (argc > 1) {
       port = static_cast<unsigned short>(std::stoi(argv[1]));
     }
+
+    // Optional Unix socket path to take over from / hand off to another instance
+    tcp_server::ServerOptions options;
+    if (argc > 2) {
+      options.listener_handoff_path = argv[2];
+      options.on_listener_handoff = [] {
+        spdlog::info("Listening socket handed off, shutting down...");
+        running = false;
+      };
+    }
     
     // Create Boost.Asio io_context
     boost::asio::io_context io_context;
@@ -38,15 +50,15 @@ int main(int argc, char* argv[]) {
       io_context.run();
     });
     
-    // Message handler function (echo back received message)
-    auto message_handler = [](const std::string& message) -> std::string {
+    // Message handler function (echo back received message without copying it)
+    auto message_handler = [](std::string_view message, tcp_server::ResponseWriter& response) {
       spdlog::debug("Echoing message: {}", message);
-      return message;
+      response.Write(message);
     };
     
     // Create and start TCP server
     spdlog::info("Starting echo server on port {}", port);
-    tcp_server::TcpServer server(port, message_handler);
+    tcp_server::TcpServer server(port, message_handler, options);
     server.Start();
     
     // Main loop: run while server is active and no shutdown signal received
@@ -55,9 +67,9 @@ int main(int argc, char* argv[]) {
       std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
-    // Stop server
+    // Finish the requests in progress, then stop
     spdlog::info("Stopping echo server...");
-    server.Stop();
+    server.Drain(std::chrono::seconds(5));
     spdlog::info("Echo server stopped.");
     
     // Stop io_context and wait for io_thread to finish
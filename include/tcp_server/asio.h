@@ -0,0 +1,16 @@
+/**
+ * @file asio.h
+ * @brief Boost.Asioを読み込むためのヘッダ
+ *
+ * Boost.Asioは直接インクルードせず、このヘッダを経由して読み込む。
+ */
+
+#ifndef TCP_SERVER_ASIO_H_
+#define TCP_SERVER_ASIO_H_
+
+// Boost 1.74以前のawaitable.hppは<utility>をインクルードせずにstd::exchangeを使うため、先に読み込む
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#endif  // TCP_SERVER_ASIO_H_
@@ -0,0 +1,219 @@
+/**
+ * @file framer.h
+ * @brief 受信データをメッセージ単位に分割するフレーミング層の定義
+ */
+
+#ifndef TCP_SERVER_FRAMER_H_
+#define TCP_SERVER_FRAMER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace tcp_server {
+
+/**
+ * @brief フレームが不正な場合に送出される例外
+ */
+class FramingError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief フレーミングの基底クラス
+ *
+ * 受信バイト列から完全なフレームを取り出し、送信するペイロードをフレームに包む。
+ * 実装はステートレスでなければならず、1つのインスタンスが全接続・全スレッドから
+ * 同時に使用される。
+ */
+class Framer {
+ public:
+  virtual ~Framer() = default;
+
+  /**
+   * @brief 受信データの先頭から完全なフレームを1つ取り出す
+   * @param data 未処理の受信データ
+   * @param payload 取り出したフレームのペイロード（dataを指すビュー）
+   * @return 消費したバイト数（完全なフレームがまだ揃っていない場合は0）
+   * @throws FramingError フレームが不正、または最大サイズを超える場合
+   */
+  virtual std::size_t Extract(std::string_view data, std::string_view* payload) const = 0;
+
+  /**
+   * @brief 前回の走査位置から再開して、受信データの先頭から完全なフレームを1つ取り出す
+   *
+   * 未完成のフレームに受信データが追加されるたびに先頭から走査し直さないよう、
+   * 走査済みのバイト数を呼び出し側が保持して渡す。既定の実装はExtract()を呼び出す。
+   * @param data 未処理の受信データ
+   * @param payload 取り出したフレームのペイロード（dataを指すビュー）
+   * @param scanned 入力: 前回の呼び出しで走査済みのバイト数（新しいフレームでは0）。
+   *                出力: 次回の呼び出しに渡す値（フレームを取り出した場合は0）
+   * @return 消費したバイト数（完全なフレームがまだ揃っていない場合は0）
+   * @throws FramingError フレームが不正、または最大サイズを超える場合
+   */
+  virtual std::size_t ExtractFrom(std::string_view data, std::string_view* payload,
+                                  std::size_t* scanned) const;
+
+  /**
+   * @brief 出力バッファにフレームの開始部分を書き込む
+   * @param out 出力バッファ
+   * @return フレームの開始位置（EndFrame()に渡す）
+   */
+  virtual std::size_t BeginFrame(std::string* out) const;
+
+  /**
+   * @brief BeginFrame()以降に書き込まれたペイロードでフレームを完成させる
+   * @param out 出力バッファ
+   * @param start BeginFrame()が返した開始位置
+   * @throws FramingError ペイロードがフレームに収まらない場合
+   */
+  virtual void EndFrame(std::string* out, std::size_t start) const;
+
+  /**
+   * @brief ペイロードと、その後に送信される応答本体を合わせて1つのフレームを完成させる
+   *
+   * ResponseWriter::WriteFile()、WritePinned()の本体はoutの後、trailerの前に送信される。
+   * 長さフィールドは本体を含めた長さを表し、終端は最後の本体の後に置く。既定の実装は
+   * EndFrame()を呼び出すため、送信データをフレームに包む独自のフレーマーで本体を
+   * 使う場合はオーバーライドすること。
+   * @param out 出力バッファ
+   * @param start BeginFrame()が返した開始位置
+   * @param body_size outの後に送信される本体の合計バイト数
+   * @param trailer 本体の後に送信するバイト列の書き込み先
+   * @throws FramingError ペイロードと本体がフレームに収まらない場合
+   */
+  virtual void EndFrameWithBodies(std::string* out, std::size_t start, std::uint64_t body_size,
+                                  std::string* trailer) const;
+
+  /**
+   * @brief 1フレームとして扱える最大バイト数（ヘッダ・区切りを含む）
+   * @return 最大バイト数。受信バッファはこのサイズまで拡張される
+   */
+  virtual std::size_t MaxFrameSize() const = 0;
+
+  /**
+   * @brief ペイロードをフレームに包んで出力バッファに追加する
+   * @param payload 送信するペイロード
+   * @param out 出力バッファ
+   * @throws FramingError ペイロードがフレームに収まらない場合
+   */
+  void Encode(std::string_view payload, std::string* out) const;
+};
+
+/**
+ * @brief 1回の読み込みで受信したデータをそのまま1メッセージとして扱うフレーマー
+ *
+ * フレーマーを指定しない場合の既定の動作（従来の動作）。
+ */
+class RawFramer : public Framer {
+ public:
+  std::size_t Extract(std::string_view data, std::string_view* payload) const override;
+  std::size_t MaxFrameSize() const override;
+};
+
+/**
+ * @brief バイトオーダー
+ */
+enum class ByteOrder {
+  kBigEndian,     ///< ビッグエンディアン（ネットワークバイトオーダー）
+  kLittleEndian,  ///< リトルエンディアン
+};
+
+/**
+ * @brief 長さプレフィックス付きフレーマー
+ *
+ * 各フレームは符号なし整数のペイロード長とペイロードで構成される。
+ */
+class LengthPrefixFramer : public Framer {
+ public:
+  /**
+   * @brief 長さフィールドの幅
+   */
+  enum class Width {
+    kUint16 = 2,  ///< 16ビット
+    kUint32 = 4,  ///< 32ビット
+  };
+
+  static constexpr std::size_t kDefaultMaxPayloadSize = 4 * 1024 * 1024;  ///< 既定の最大ペイロード長
+
+  /**
+   * @brief コンストラクタ
+   * @param width 長さフィールドの幅
+   * @param byte_order 長さフィールドのバイトオーダー
+   * @param max_payload_size 受け付ける最大ペイロード長
+   */
+  explicit LengthPrefixFramer(Width width = Width::kUint32,
+                              ByteOrder byte_order = ByteOrder::kBigEndian,
+                              std::size_t max_payload_size = kDefaultMaxPayloadSize);
+
+  std::size_t Extract(std::string_view data, std::string_view* payload) const override;
+  std::size_t BeginFrame(std::string* out) const override;
+  void EndFrame(std::string* out, std::size_t start) const override;
+  void EndFrameWithBodies(std::string* out, std::size_t start, std::uint64_t body_size,
+                          std::string* trailer) const override;
+  std::size_t MaxFrameSize() const override;
+
+ private:
+  std::size_t header_size_;       ///< 長さフィールドのバイト数
+  ByteOrder byte_order_;          ///< バイトオーダー
+  std::size_t max_payload_size_;  ///< 最大ペイロード長
+};
+
+/**
+ * @brief 区切り文字列で終端されるフレーマー（改行区切りなど）
+ *
+ * 取り出したペイロードに区切り文字列は含まれない。
+ */
+class DelimiterFramer : public Framer {
+ public:
+  static constexpr std::size_t kDefaultMaxPayloadSize = 64 * 1024;  ///< 既定の最大ペイロード長
+
+  /**
+   * @brief コンストラクタ
+   * @param delimiter 区切り文字列（空文字列は不可）
+   * @param max_payload_size 受け付ける最大ペイロード長
+   * @throws std::invalid_argument 区切り文字列が空の場合
+   */
+  explicit DelimiterFramer(std::string delimiter = "\n",
+                           std::size_t max_payload_size = kDefaultMaxPayloadSize);
+
+  std::size_t Extract(std::string_view data, std::string_view* payload) const override;
+  std::size_t ExtractFrom(std::string_view data, std::string_view* payload,
+                          std::size_t* scanned) const override;
+  void EndFrame(std::string* out, std::size_t start) const override;
+  void EndFrameWithBodies(std::string* out, std::size_t start, std::uint64_t body_size,
+                          std::string* trailer) const override;
+  std::size_t MaxFrameSize() const override;
+
+ private:
+  std::string delimiter_;         ///< 区切り文字列
+  std::size_t max_payload_size_;  ///< 最大ペイロード長
+};
+
+/**
+ * @brief 固定長フレーマー
+ *
+ * 受信データを指定サイズごとに区切る。送信データはそのまま送られる。
+ */
+class FixedSizeFramer : public Framer {
+ public:
+  /**
+   * @brief コンストラクタ
+   * @param frame_size 1フレームのバイト数（0は不可）
+   * @throws std::invalid_argument frame_sizeが0の場合
+   */
+  explicit FixedSizeFramer(std::size_t frame_size);
+
+  std::size_t Extract(std::string_view data, std::string_view* payload) const override;
+  std::size_t MaxFrameSize() const override;
+
+ private:
+  std::size_t frame_size_;  ///< 1フレームのバイト数
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_FRAMER_H_
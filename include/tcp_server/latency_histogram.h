@@ -0,0 +1,148 @@
+/**
+ * @file latency_histogram.h
+ * @brief HdrHistogram形式の対数線形ヒストグラムの定義
+ */
+
+#ifndef TCP_SERVER_LATENCY_HISTOGRAM_H_
+#define TCP_SERVER_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tcp_server {
+
+/**
+ * @brief 固定メモリの対数線形ヒストグラム
+ *
+ * 2のべき乗ごとの区間を64分割したバケットで値を数えるため、相対誤差は約1.6%以内。
+ * 0から2^63までの値を動的確保なしで記録できる。
+ * Record()は単一スレッドからのみ呼び出すこと。読み取り（Count()、Percentile()など）と
+ * Merge()の引数としての使用は、記録中の別スレッドから行ってもよい。
+ */
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 6;                       ///< 2のべき乗区間あたりの分割数（2^6）
+  static constexpr std::size_t kSubBucketCount = 1u << kSubBucketBits;  ///< 区間あたりのバケット数
+  static constexpr std::size_t kBucketCount =
+      (64 - kSubBucketBits + 1) * kSubBucketCount;                ///< バケット総数
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram& other);
+  LatencyHistogram& operator=(const LatencyHistogram& other);
+
+  /**
+   * @brief 値を1つ記録する
+   * @param value 記録する値（単位は呼び出し側で統一する。通常はナノ秒）
+   */
+  void Record(std::uint64_t value) {
+    std::atomic<std::uint64_t>& bucket = counts_[BucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total_.store(total_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+    if (value < min_.load(std::memory_order_relaxed)) {
+      min_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief 他のヒストグラムの内容を加算する
+   * @param other 加算するヒストグラム
+   */
+  void Merge(const LatencyHistogram& other);
+
+  /**
+   * @brief 記録をすべて消去する
+   */
+  void Reset();
+
+  /**
+   * @brief 記録された値の数を返す
+   * @return 記録数
+   */
+  std::uint64_t Count() const;
+
+  /**
+   * @brief 記録された値の合計を返す
+   * @return 合計値
+   */
+  std::uint64_t Sum() const;
+
+  /**
+   * @brief 最小値を返す
+   * @return 最小値（記録がない場合は0）
+   */
+  std::uint64_t Min() const;
+
+  /**
+   * @brief 最大値を返す
+   * @return 最大値（記録がない場合は0）
+   */
+  std::uint64_t Max() const;
+
+  /**
+   * @brief 平均値を返す
+   * @return 平均値（記録がない場合は0）
+   */
+  double Mean() const;
+
+  /**
+   * @brief 指定したパーセンタイルの値を返す
+   * @param percentile パーセンタイル（0〜100、例：99.9）
+   * @return その順位の値が属するバケットの上限値（最大値を超えない）
+   */
+  std::uint64_t Percentile(double percentile) const;
+
+  /**
+   * @brief 値が属するバケットの番号を返す
+   * @param value 値
+   * @return バケット番号
+   */
+  static std::size_t BucketIndex(std::uint64_t value) {
+    if (value < 2 * kSubBucketCount) {
+      return static_cast<std::size_t>(value);
+    }
+    const int exponent = HighestBit(value) - kSubBucketBits;
+    return static_cast<std::size_t>(exponent) * kSubBucketCount +
+           static_cast<std::size_t>(value >> exponent);
+  }
+
+  /**
+   * @brief バケットに含まれる最大の値を返す
+   * @param index バケット番号
+   * @return バケットの上限値
+   */
+  static std::uint64_t BucketUpperBound(std::size_t index);
+
+ private:
+  /**
+   * @brief 最上位の1ビットの位置を返す
+   * @param value 0以外の値
+   * @return ビット位置（0始まり）
+   */
+  static int HighestBit(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+  std::array<std::atomic<std::uint64_t>, kBucketCount> counts_{};  ///< バケットごとの記録数
+  std::atomic<std::uint64_t> total_{0};                            ///< 記録数
+  std::atomic<std::uint64_t> sum_{0};                              ///< 値の合計
+  std::atomic<std::uint64_t> min_{~std::uint64_t{0}};              ///< 最小値
+  std::atomic<std::uint64_t> max_{0};                              ///< 最大値
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_LATENCY_HISTOGRAM_H_
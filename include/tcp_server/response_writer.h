@@ -0,0 +1,180 @@
+/**
+ * @file response_writer.h
+ * @brief 接続の送信バッファへ応答を直接書き込むクラスの定義
+ */
+
+#ifndef TCP_SERVER_RESPONSE_WRITER_H_
+#define TCP_SERVER_RESPONSE_WRITER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tcp_server {
+
+namespace internal {
+class Connection;
+}  // namespace internal
+
+/// 接続を識別するID（切断後に同じ値が再利用されることはない）
+using ConnectionId = std::uint64_t;
+
+/// どの接続も表さないID
+constexpr ConnectionId kInvalidConnectionId = ~ConnectionId{0};
+
+/**
+ * @brief 送信バッファにコピーせずに送信する応答本体
+ *
+ * ファイルの範囲（fdが0以上）またはメモリ上のバッファ（dataが指す領域）を表す。
+ */
+struct ResponseBody {
+  const char* data = nullptr;  ///< メモリ上の本体の先頭（ファイルの場合はnullptr）
+  int fd = -1;                 ///< 本体を読み出すファイル記述子（メモリの場合は-1）
+  std::uint64_t offset = 0;    ///< ファイル内の開始位置
+  std::uint64_t size = 0;      ///< バイト数
+  /// 送信が完了するまで保持され、その後解放される所有者
+  std::shared_ptr<const void> owner;
+};
+
+/**
+ * @brief 応答書き込みクラス
+ *
+ * ハンドラの呼び出し中だけ有効で、書き込んだデータは接続が所有する送信バッファに
+ * 直接追加される。フレーミングはハンドラの呼び出し後に接続側で行われる。
+ * スレッドセーフではない。ハンドラの外へ持ち出してはならない。
+ */
+class ResponseWriter {
+ public:
+  /**
+   * @brief コンストラクタ
+   * @param buffer 書き込み先の送信バッファ
+   * @param connection_id リクエストを受信した接続のID
+   * @param bodies WriteFile()、WritePinned()で追加した本体の格納先（nullptrの場合は使用不可）
+   */
+  explicit ResponseWriter(std::string* buffer,
+                          ConnectionId connection_id = kInvalidConnectionId,
+                          std::vector<ResponseBody>* bodies = nullptr)
+      : buffer_(buffer), start_(buffer->size()), connection_id_(connection_id), bodies_(bodies) {}
+
+  ResponseWriter(const ResponseWriter&) = delete;
+  ResponseWriter& operator=(const ResponseWriter&) = delete;
+
+  /**
+   * @brief 応答データを追加する
+   * @param data 追加するデータ
+   */
+  void Write(std::string_view data) { buffer_->append(data.data(), data.size()); }
+
+  /**
+   * @brief 応答データを追加する
+   * @param data 追加するデータの先頭
+   * @param size 追加するバイト数
+   */
+  void Write(const char* data, std::size_t size) { buffer_->append(data, size); }
+
+  /**
+   * @brief ファイルの範囲を応答本体として追加する
+   *
+   * 本体はWrite()で書き込んだデータの後に追加した順に送信され、同じフレームに含まれる
+   * （長さプレフィックスは本体を含めた長さになり、区切り文字列は最後の本体の後に置かれる。
+   * 本体に区切り文字列を含めてはならない）。Linuxではsendfile()でカーネル内から直接送信し、
+   * ユーザー空間にはコピーしない。ファイル記述子はownerが解放されるまで開いたままに
+   * しておくこと（ファイルを閉じるデリーターを持つownerを渡すとよい）。
+   * @param fd 読み出すファイル記述子
+   * @param offset ファイル内の開始位置
+   * @param size 送信するバイト数
+   * @param owner 送信が完了するまで保持される所有者
+   * @throws std::logic_error 本体を追加できないResponseWriterの場合
+   */
+  void WriteFile(int fd, std::uint64_t offset, std::uint64_t size,
+                 std::shared_ptr<const void> owner = nullptr) {
+    AddBody(ResponseBody{nullptr, fd, offset, size, std::move(owner)});
+  }
+
+  /**
+   * @brief メモリ上のバッファを応答本体として追加する
+   *
+   * WriteFile()と同様にWrite()で書き込んだデータの後に同じフレームの一部として送信され、
+   * 送信バッファにはコピーされない。ServerOptions::zero_copy_threshold以上の本体はLinuxでは
+   * MSG_ZEROCOPYで送信され、カーネルがページを使い終えたという通知を受けてから
+   * ownerを解放する。それまでバッファの内容を変更してはならない。
+   * @param data 本体の先頭
+   * @param size バイト数
+   * @param owner dataの領域を所有し、送信が完了するまで保持される所有者
+   * @throws std::logic_error 本体を追加できないResponseWriterの場合
+   */
+  void WritePinned(const void* data, std::size_t size, std::shared_ptr<const void> owner) {
+    AddBody(ResponseBody{static_cast<const char*>(data), -1, 0, size, std::move(owner)});
+  }
+
+  /**
+   * @brief 応答用の領域をあらかじめ確保する
+   * @param size これから書き込む予定のバイト数
+   */
+  void Reserve(std::size_t size) { buffer_->reserve(buffer_->size() + size); }
+
+  /**
+   * @brief これまでに書き込んだバイト数を返す
+   * @return この応答に書き込まれたバイト数
+   */
+  std::size_t Size() const { return buffer_->size() - start_; }
+
+  /**
+   * @brief リクエストを受信した接続のIDを返す
+   *
+   * TcpServer::Subscribe()に渡して、この接続をトピックの購読者にするために使う。
+   * @return 接続のID
+   */
+  ConnectionId GetConnectionId() const { return connection_id_; }
+
+  /**
+   * @brief この応答を応答キャッシュに保存しないようにする
+   *
+   * エラー応答など、同じリクエストに次回は別の応答を返す場合に呼び出す。
+   * ServerOptions::response_cacheを使用しない場合は何もしない。
+   */
+  void DisableCache() { cacheable_ = false; }
+
+  /**
+   * @brief この応答を応答キャッシュで使用できる期間を設定する
+   *
+   * ResponseCacheOptions::ttlの代わりに使われる。
+   * @param ttl 保存してから使用できる期間（0の場合は無期限）
+   */
+  void SetCacheTtl(std::chrono::milliseconds ttl) { cache_ttl_ = ttl; }
+
+ private:
+  friend class internal::Connection;
+
+  /**
+   * @brief 本体を追加する（空の本体は無視する）
+   * @param body 追加する本体
+   * @throws std::logic_error 本体の格納先がない場合
+   */
+  void AddBody(ResponseBody body) {
+    if (bodies_ == nullptr) {
+      throw std::logic_error("This response does not accept zero-copy bodies");
+    }
+    if (body.size > 0) {
+      bodies_->push_back(std::move(body));
+    }
+  }
+
+  std::string* buffer_;         ///< 送信バッファ
+  std::size_t start_;           ///< この応答の開始位置
+  ConnectionId connection_id_;  ///< リクエストを受信した接続
+  std::vector<ResponseBody>* bodies_;  ///< 本体の格納先
+  bool cacheable_ = true;              ///< 応答キャッシュに保存してよいか
+  std::optional<std::chrono::milliseconds> cache_ttl_;  ///< 応答キャッシュでの期間（未設定なら既定値）
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_RESPONSE_WRITER_H_
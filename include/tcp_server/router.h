@@ -0,0 +1,153 @@
+/**
+ * @file router.h
+ * @brief コマンド名でリクエストをハンドラへ振り分けるルーターの定義
+ */
+
+#ifndef TCP_SERVER_ROUTER_H_
+#define TCP_SERVER_ROUTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tcp_server/response_writer.h"
+
+namespace tcp_server {
+
+namespace internal {
+class RcuDomain;
+}  // namespace internal
+
+/**
+ * @brief ルーターに登録するコマンドと処理の一覧
+ *
+ * 組み立てた後でRouterのコンストラクタかRouter::Update()に渡すと、照合用の表に変換される。
+ */
+class RouteTable {
+ public:
+  /**
+   * @brief コマンドの処理
+   *
+   * 第1引数はコマンド名の後の引数（前後の空白を除いたもの）で、リクエストを受信した
+   * バッファを直接指すビュー。呼び出し中のみ有効。
+   */
+  using Handler = std::function<void(std::string_view arguments, ResponseWriter& response)>;
+
+  /**
+   * @brief コマンドを追加する
+   * @param command コマンド名（リクエストの最初の空白までと照合する）
+   * @param handler コマンドの処理
+   * @return このオブジェクト
+   * @throws std::invalid_argument コマンド名が空か、空白（0x20以下のバイト）を含む場合
+   */
+  RouteTable& Add(std::string command, Handler handler);
+
+  /**
+   * @brief どのコマンドにも一致しないリクエストの処理を設定する
+   * @param handler 処理（引数には前後の空白を除いたリクエスト全体が渡される）
+   * @return このオブジェクト
+   */
+  RouteTable& SetFallback(Handler handler);
+
+  /**
+   * @brief 追加したコマンドの数を返す
+   * @return コマンドの数
+   */
+  std::size_t Size() const;
+
+ private:
+  friend class Router;
+
+  std::vector<std::pair<std::string, Handler>> routes_;  ///< コマンドと処理
+  Handler fallback_;                                      ///< 一致しない場合の処理
+};
+
+/**
+ * @brief リクエストの先頭のコマンド名で処理を選ぶルーター
+ *
+ * コマンド名はリクエストをコピーせずにその場で切り出し（空白の検索は8バイト単位）、
+ * 登録時に構築した完全ハッシュ表で照合する。照合はコマンド数によらずハッシュ1回と
+ * 比較1回で済み、メモリ確保もロックも行わない。
+ *
+ * Update()で表を実行中に入れ替えられる（RCU方式）。振り分け中のスレッドは入れ替えを
+ * 待たずに古い表か新しい表のどちらかを使い、古い表はそれを使う振り分けがすべて
+ * 終わってから解放される。Dispatch()は任意のスレッドから同時に呼び出してよい。
+ */
+class Router {
+ public:
+  /**
+   * @brief コマンドを1つも持たないルーターを作成する
+   */
+  Router();
+
+  /**
+   * @brief ルーターを作成する
+   * @param routes コマンドと処理の一覧
+   * @throws std::invalid_argument 同じコマンドが複数回追加されている場合
+   */
+  explicit Router(RouteTable routes);
+
+  /**
+   * @brief デストラクタ
+   *
+   * Dispatch()の実行中に破棄してはならない（ルーターを使うサーバーを先に停止すること）。
+   */
+  ~Router();
+
+  Router(const Router&) = delete;
+  Router& operator=(const Router&) = delete;
+
+  /**
+   * @brief 表を入れ替える
+   *
+   * 新しい表は呼び出し元のスレッドで構築し、入れ替え後は古い表で実行中の処理が
+   * すべて終わるまで待ってから戻る。振り分けは入れ替えの間も止まらない。
+   * 複数のスレッドから呼び出してよい（入れ替えは1つずつ行われる）。
+   * @param routes 新しいコマンドと処理の一覧
+   * @throws std::invalid_argument 同じコマンドが複数回追加されている場合（表は変わらない）
+   * @throws std::logic_error 処理の中から呼び出された場合（自身の終了を待ち続けるため）
+   */
+  void Update(RouteTable routes);
+
+  /**
+   * @brief リクエストをコマンドの処理に振り分ける
+   * @param request リクエスト
+   * @param response 応答の書き込み先
+   * @return 処理を呼び出した場合はtrue、一致するコマンドも代替の処理もない場合はfalse
+   */
+  bool Dispatch(std::string_view request, ResponseWriter& response) const;
+
+  /**
+   * @brief TcpServerのメッセージハンドラとして使う関数を返す
+   *
+   * 返す関数はこのルーターを参照するため、ルーターはサーバーより長く存続させること。
+   * 一致するコマンドも代替の処理もないリクエストには空の応答を返す。
+   * @return Dispatch()を呼び出すハンドラ
+   */
+  std::function<void(std::string_view, ResponseWriter&)> AsMessageHandler();
+
+ private:
+  struct Table;
+
+  /**
+   * @brief 一覧を照合用の表に変換する
+   * @param routes コマンドと処理の一覧
+   * @return 表
+   * @throws std::invalid_argument 同じコマンドが複数回追加されている場合
+   */
+  static std::unique_ptr<const Table> Compile(RouteTable routes);
+
+  std::unique_ptr<internal::RcuDomain> rcu_;  ///< 振り分け中のスレッドの追跡
+  std::atomic<const Table*> table_;           ///< 現在の表
+  std::mutex update_mutex_;                   ///< 入れ替えを1つずつ行うためのミューテックス
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_ROUTER_H_
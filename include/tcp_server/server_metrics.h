@@ -0,0 +1,74 @@
+/**
+ * @file server_metrics.h
+ * @brief サーバーの実行時メトリクスのスナップショットの定義
+ */
+
+#ifndef TCP_SERVER_SERVER_METRICS_H_
+#define TCP_SERVER_SERVER_METRICS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "tcp_server/latency_histogram.h"
+
+namespace tcp_server {
+
+/**
+ * @brief ある時点のサーバーメトリクス
+ *
+ * カウンタはサーバー起動時からの累計値。各スレッドのカウンタを取得時に集計したもので、
+ * 取得中に発生したイベントは含まれない場合がある。client_で始まる項目はTcpClientの
+ * メトリクスで、TcpServer::CreateClient()で作成したクライアントの分はサーバーのメトリクスに、
+ * 単独で作成したクライアントの分はTcpClient::GetMetrics()に含まれる。
+ */
+struct MetricsSnapshot {
+  std::uint64_t connections_accepted = 0;  ///< 受け付けた接続数
+  std::uint64_t connections_rejected = 0;  ///< 接続数の上限（全体または送信元ごと）により拒否した接続数
+  std::uint64_t connections_timed_out = 0; ///< タイムアウトにより閉じた接続数
+  std::uint64_t accept_pauses = 0;         ///< 過負荷またはレート制限により受け付けを一時停止した回数
+  std::uint64_t connection_pool_grown = 0; ///< 事前確保した数を超えて接続プールに追加した接続オブジェクトの数
+  std::uint64_t messages_published = 0;    ///< Publish()で接続の送信キューに追加したメッセージ数（宛先ごとに数える）
+  std::uint64_t messages_dropped = 0;      ///< 送信が追いつかない購読者宛てに破棄または置き換えたメッセージ数
+  std::uint64_t slow_subscribers_disconnected = 0;  ///< 送信が追いつかないために閉じた購読者の数
+  std::size_t connections_active = 0;      ///< 現在の接続数
+  std::uint64_t bytes_received = 0;        ///< 受信バイト数
+  std::uint64_t bytes_sent = 0;            ///< 送信バイト数
+  std::uint64_t read_operations = 0;       ///< 完了した読み込み操作の数
+  std::uint64_t write_operations = 0;      ///< 完了した書き込み操作の数（1回のベクタ書き込みを1と数える）
+  std::uint64_t handler_invocations = 0;   ///< メッセージハンドラの呼び出し回数
+  std::uint64_t tls_handshakes = 0;        ///< 完了したTLSハンドシェイクの数
+  std::uint64_t tls_sessions_resumed = 0;  ///< そのうちセッションを再開した（フルハンドシェイクを省略した）数
+  std::uint64_t tls_kernel_offloads = 0;   ///< そのうち送信の暗号化をカーネル（kTLS）に任せた数
+  std::uint64_t response_cache_hits = 0;   ///< 応答キャッシュから応答した（ハンドラを呼び出さなかった）リクエスト数
+  std::uint64_t response_cache_misses = 0; ///< キャッシュできるがキャッシュになく、ハンドラを呼び出したリクエスト数
+  std::uint64_t response_cache_evictions = 0;  ///< 容量を空けるために応答キャッシュから追い出した応答の数
+  std::size_t response_cache_entries = 0;  ///< 現在応答キャッシュにある応答の数
+  std::size_t response_cache_bytes = 0;    ///< 現在応答キャッシュが使用しているバイト数（管理領域を含む）
+  std::uint64_t client_connections_opened = 0;  ///< クライアントが確立した接続数（再接続を含む）
+  std::uint64_t client_requests = 0;        ///< クライアントが応答を受け取ったリクエスト数
+  std::uint64_t client_requests_failed = 0; ///< クライアントがエラーで完了したリクエスト数
+  std::uint64_t client_bytes_sent = 0;      ///< クライアントの送信バイト数
+  std::uint64_t client_bytes_received = 0;  ///< クライアントの受信バイト数
+  /// ハンドラの実行時間（ナノ秒）。ServerOptions::measure_handler_timeがfalseの場合は空
+  LatencyHistogram handler_time_ns;
+  /// クライアントのリクエストから応答までの時間（ナノ秒）。ClientOptions::measure_request_timeが
+  /// falseの場合は空
+  LatencyHistogram client_request_time_ns;
+  /// エラーの発生数（キーはboost::system::error_categoryの名前、"framing"、"handler"、"tls"）
+  ///
+  /// 正常な切断（EOF）と、サーバー自身による切断で中断された操作は含まない。
+  /// クライアントの接続・送受信のエラーも同じカテゴリで数える。
+  std::map<std::string, std::uint64_t> errors;
+
+  /**
+   * @brief Prometheusのテキスト形式（version 0.0.4）に変換する
+   * @return メトリクスのテキスト表現
+   */
+  std::string ToPrometheusText() const;
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_SERVER_METRICS_H_
@@ -0,0 +1,326 @@
+/**
+ * @file server_options.h
+ * @brief TCPサーバーの設定項目の定義
+ */
+
+#ifndef TCP_SERVER_SERVER_OPTIONS_H_
+#define TCP_SERVER_SERVER_OPTIONS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tcp_server/framer.h"
+
+namespace tcp_server {
+
+/**
+ * @brief ワーカースレッドの実行モデル
+ */
+enum class ExecutionMode {
+  /// 全ワーカースレッドで1つのio_contextとacceptorを共有する（従来の動作）
+  kSharedContext,
+  /// ワーカースレッドごとにio_contextとacceptorを持ち、SO_REUSEPORTで同一ポートを共有する
+  ///
+  /// 接続は受け付けたスレッド上で最後まで処理される。
+  /// SO_REUSEPORTによる負荷分散が使えないプラットフォームではkSharedContextで動作する。
+  kContextPerThread,
+};
+
+/**
+ * @brief メッセージハンドラを実行するスレッド
+ */
+enum class HandlerExecution {
+  /// 受信したI/Oスレッド上でハンドラを実行する（従来の動作）
+  kInline,
+  /// ワークスティーリング方式の計算用スレッドプールでハンドラを実行する
+  ///
+  /// 重いハンドラがI/Oスレッドを占有しないため、同じスレッドの他の接続の受け付けや
+  /// 読み込みが遅れない。1つの接続のリクエストは受信順に1つずつ処理され、
+  /// 応答も受信順に送信される。
+  kOffload,
+};
+
+/**
+ * @brief 送信が追いつかない購読者への配信方法
+ */
+enum class SlowSubscriberPolicy {
+  /// 新しいメッセージを破棄する
+  kDrop,
+  /// 送信待ちの同じトピックのメッセージを最新のものに置き換える（なければ追加する）
+  kConflate,
+  /// 接続を閉じる
+  kDisconnect,
+};
+
+/**
+ * @brief 待ち受けソケットと受け付けた接続のソケットオプション
+ *
+ * カーネルが受け付けた接続に引き継ぐオプション（Linuxでは送受信バッファとTCP_NODELAY）は
+ * 待ち受けソケットに1回だけ設定し、接続ごとのシステムコールは発生しない。
+ * 引き継がれないプラットフォームでは接続ごとに設定する。
+ */
+struct SocketOptions {
+  /// 待ち受けるアドレス（空の場合は0.0.0.0）
+  ///
+  /// "::"を指定するとIPv6で待ち受け、ipv6_onlyがfalseならIPv4の接続も受け付ける
+  /// （デュアルスタック。IPv4の送信元は::ffff:で始まるアドレスになる）。
+  std::string bind_address;
+  /// IPv6のアドレスで待ち受けるとき、IPv4の接続を受け付けない（IPV6_V6ONLY）
+  bool ipv6_only = false;
+  /// TCPのポートで待ち受ける（falseの場合はunix_socket_pathsのみで待ち受ける）
+  bool listen_tcp = true;
+  /// TCPのポートと同時に待ち受けるUnixドメインソケットのパス（POSIXのみ）
+  ///
+  /// 同じホストのプロセスからの接続はループバックのTCPを経由せずに届く。ハンドラ、
+  /// フレーミング、タイムアウトなどはTCPの接続と同じように動作する。"@"で始まる名前は
+  /// Linuxの抽象名前空間のソケットになり、ファイルを作らない。ファイルのパスは、
+  /// 受け付けるプロセスのいない古いソケットファイルを置き換え、サーバーの破棄時に削除する。
+  /// TCP専用の設定（no_delay、defer_accept、fast_open_queue、quick_ack）は適用しない。
+  std::vector<std::string> unix_socket_paths;
+  /// listenのバックログの長さ（0の場合はSOMAXCONN）
+  int backlog = 0;
+  /// SO_REUSEADDRを設定する（再起動直後にTIME_WAITの接続が残っていてもbindできる）
+  bool reuse_address = true;
+  /// TCP_NODELAYを設定してNagleアルゴリズムを無効にする
+  ///
+  /// 応答は1回の書き込みにまとめて送信されるため、小さなリクエストとレスポンスの往復が
+  /// 遅延ACKとの組み合わせで最大40ミリ秒ほど待たされるのを防ぐ。
+  bool no_delay = true;
+  /// SO_RCVBUFの値（バイト。0の場合はカーネルの既定値と自動調整を使用）
+  ///
+  /// TCPのウィンドウスケールは接続の確立時に決まるため、待ち受けソケットに設定する。
+  int receive_buffer_size = 0;
+  /// SO_SNDBUFの値（バイト。0の場合はカーネルの既定値と自動調整を使用）
+  int send_buffer_size = 0;
+  /// クライアントが最初のデータを送信するまでacceptを遅らせる時間（TCP_DEFER_ACCEPT。Linuxのみ）
+  ///
+  /// 接続しただけで何も送らないクライアントにワーカーを使わない。0の場合は無効。
+  std::chrono::seconds defer_accept{0};
+  /// TCP Fast Openで受け付けるSYNのキューの長さ（TCP_FASTOPEN。0の場合は無効）
+  ///
+  /// 再接続するクライアントはSYNにリクエストを載せて1往復を省略できる。
+  /// Linuxではsysctlのnet.ipv4.tcp_fastopenでサーバー側が有効になっている必要がある。
+  int fast_open_queue = 0;
+  /// 受け付けた接続にTCP_QUICKACKを設定する（Linuxのみ）
+  ///
+  /// 遅延ACKを無効にする。カーネルが自動的に遅延ACKへ戻すことがあるため、効果は
+  /// 主に接続の始めに限られる。接続ごとにシステムコールが1回増える。
+  bool quick_ack = false;
+};
+
+/**
+ * @brief TLSの設定
+ *
+ * certificate_chain_fileを指定するとすべての接続でTLSを終端する。
+ * CMakeのTCP_SERVER_ENABLE_TLSを有効にしてOpenSSLとリンクした場合のみ使用できる。
+ */
+struct TlsOptions {
+  /// PEM形式の証明書チェーンのファイル（サーバー証明書が先頭。空の場合はTLSを使用しない）
+  std::string certificate_chain_file;
+  /// PEM形式の秘密鍵のファイル
+  std::string private_key_file;
+  /// セッションチケットを発行し、再接続したクライアントがフルハンドシェイクを省略できるようにする
+  ///
+  /// チケットの暗号鍵はプロセスごとに生成されるため、再起動後のチケットは使用できない
+  /// （その場合はフルハンドシェイクになる）。
+  bool session_tickets = true;
+  /// サーバー側のセッションキャッシュに保持するセッションの数（0の場合はキャッシュしない）
+  ///
+  /// チケットを使用しないクライアントのセッションIDによる再開に使う。
+  std::size_t session_cache_size = 20 * 1024;
+  /// セッションを再開できる期間
+  std::chrono::seconds session_timeout{2 * 60 * 60};
+  /// ハンドシェイク後の暗号化と復号をカーネルに任せる（kTLS。Linux、OpenSSL 3.0以上）
+  ///
+  /// 送信側がカーネルに移ると、ResponseWriter::WriteFile()の本体はTLSでもsendfile()で
+  /// 送信される。カーネルや暗号スイートが対応していない場合は、OpenSSLで暗号化する。
+  bool kernel_tls = true;
+};
+
+/**
+ * @brief 応答キャッシュの設定
+ *
+ * max_bytesを指定すると、ハンドラの応答をリクエストごとに保存し、同じリクエストには
+ * ハンドラを呼び出さずに保存した応答を送信する。同じリクエストに常に同じ応答を返す
+ * （冪等な）ハンドラでのみ使用すること。保存した応答は参照カウント付きの不変バッファで、
+ * 送信キューにはコピーせずに追加される。キャッシュはキーのハッシュで分割され、
+ * 分割ごとのロックで保護される。容量を超えるとCLOCK方式（LRUの近似）で追い出す。
+ * ResponseWriter::WriteFile()、WritePinned()で本体を追加した応答と、コルーチンの
+ * セッションハンドラには使用しない。
+ */
+struct ResponseCacheOptions {
+  /// 保存する応答の合計バイト数の上限（0の場合はキャッシュを使用しない）
+  ///
+  /// 応答とキーのバイト数に、1件あたりの管理領域として128バイトを加えて数える。
+  /// 上限は分割ごとに均等に割り当てられる。
+  std::size_t max_bytes = 0;
+  /// 応答を保存してから使用できる期間（0の場合は無期限）
+  ///
+  /// ハンドラはResponseWriter::SetCacheTtl()で応答ごとに変更できる。
+  std::chrono::milliseconds ttl{0};
+  /// キャッシュの分割数（2のべき乗に切り上げる。0の場合はハードウェア並列数の4倍を、
+  /// 1つあたり64KiB以上になる範囲で使用）
+  std::size_t shards = 0;
+  /// リクエストからキャッシュのキーを求める関数（nullptrの場合はリクエスト全体をキーにする）
+  ///
+  /// 返すビューはリクエストの一部か、呼び出し後も有効な領域を指すこと。空のビューを返した
+  /// リクエストはキャッシュせず、常にハンドラを呼び出す。I/Oスレッドと計算用スレッドから
+  /// 同時に呼び出される。
+  std::function<std::string_view(std::string_view request)> key;
+};
+
+/**
+ * @brief TCPサーバーの設定
+ */
+struct ServerOptions {
+  /// 最大接続数
+  ///
+  /// この数に達している間は受け付けを一時停止し、新しい接続はカーネルのlistenバックログで
+  /// 待たせる（受け付けてすぐに閉じることはしない）。
+  unsigned int max_connections = 8;
+  ExecutionMode execution_mode = ExecutionMode::kSharedContext;  ///< 実行モデル
+  SocketOptions socket;  ///< 待ち受けるアドレスとソケットオプション
+  TlsOptions tls;        ///< TLSの設定（既定ではTLSを使用しない）
+  ResponseCacheOptions response_cache;  ///< 応答キャッシュの設定（既定では使用しない）
+  /// 受信データをメッセージに分割するフレーマー（nullptrの場合は読み込み単位をそのまま渡す）
+  ///
+  /// 1回の読み込みに含まれる完全なフレームはすべてまとめてハンドラに渡され、
+  /// 応答も同じフレーマーで符号化されて1回の書き込みで送信される。
+  std::shared_ptr<const Framer> framer;
+  /// 接続ごとの受信バッファの初期サイズ（バイト）
+  ///
+  /// 受信バッファは読み込みを待つ間だけワーカーごとのプールから借り、データがなくなると返却する。
+  /// サイズは2のべき乗に切り上げられ、読み込みでいっぱいになると倍に、小さな読み込みが続くと
+  /// 半分になる。
+  std::size_t read_buffer_size = 1024;
+  /// 受信バッファを縮小するときの下限（バイト）
+  ///
+  /// read_buffer_sizeがこれより小さい場合はread_buffer_sizeが下限になる。
+  std::size_t min_read_buffer_size = 256;
+  /// 受信バッファを拡大するときの上限（バイト）
+  ///
+  /// read_buffer_sizeがこれより大きい場合はread_buffer_sizeが上限になる。1つのフレームが
+  /// バッファに収まらない場合は、この上限を超えてフレーマーの最大フレームサイズまで拡大する。
+  std::size_t max_read_buffer_size = 64 * 1024;
+  /// ワーカーごとに事前確保して再利用する接続オブジェクトの数
+  ///
+  /// 接続オブジェクトはソケットとバッファごと再利用されるため、この数までの接続は
+  /// accept時にメモリ確保を行わない。同時接続数がこれを超えるとプールは複数の接続を
+  /// まとめて追加して拡張し、追加した接続も停止まで保持する（MetricsSnapshot::
+  /// connection_pool_grownに数える）。
+  std::size_t connection_pool_size = 64;
+  /// 接続ごとの送信キューがこのバイト数以上になると、そのクライアントからの読み込みを停止する
+  std::size_t write_high_watermark = 1024 * 1024;
+  /// 停止した読み込みは送信キューがこのバイト数以下になったときに再開する
+  std::size_t write_low_watermark = 256 * 1024;
+  /// メッセージハンドラの実行時間を計測してメトリクスに記録する
+  ///
+  /// 計測のたびに時刻を2回取得するため、非常に短いハンドラでは無効化してもよい。
+  bool measure_handler_time = true;
+  /// メッセージハンドラの実行方法
+  HandlerExecution handler_execution = HandlerExecution::kInline;
+  /// kOffloadで使用する計算用スレッドの数（0の場合はハードウェア並列数を使用）
+  unsigned int handler_threads = 0;
+  /// kOffloadで接続ごとに処理待ちにできるリクエストの数
+  ///
+  /// この数に達するとその接続からの読み込みを停止し、処理が進むと再開する。
+  std::size_t max_pending_requests = 64;
+  /// 1秒あたりに受け付ける接続数の上限（0の場合は制限しない）
+  ///
+  /// トークンバケットで判定し、トークンがない間は受け付けを一時停止する。
+  unsigned int accept_rate_limit = 0;
+  /// accept_rate_limitで連続して受け付けられる接続数（0の場合はaccept_rate_limitと同じ）
+  unsigned int accept_burst = 0;
+  /// 1つの送信元IPアドレスからの同時接続数の上限（0の場合は制限しない）
+  ///
+  /// 送信元はaccept後にしか分からないため、上限を超えた接続は受け付けてすぐに閉じる。
+  /// Unixドメインソケットの接続は数えない。
+  unsigned int max_connections_per_ip = 0;
+  /// kOffloadで計算用スレッドプールの処理待ちリクエストがこの数以上の間、受け付けを一時停止する
+  /// （0の場合は判定しない）
+  std::size_t max_queued_requests = 0;
+  /// 最近のハンドラ実行時間の移動平均がこの時間を超えている間、受け付けを一時停止する
+  /// （0の場合は判定しない）
+  ///
+  /// 有効にするとmeasure_handler_timeも有効になる。直近1秒間にハンドラを実行したスレッドの
+  /// 移動平均だけを使うため、遅いリクエストの後にアイドルになったスレッドの平均で
+  /// 停止し続けることはない。接続が1つもない間は判定しない。
+  std::chrono::microseconds max_handler_latency{0};
+  /// 送信待ちのバイト数がこの値以上の接続を、Publish()で送信が追いつかない購読者とみなす
+  std::size_t slow_subscriber_limit = 1024 * 1024;
+  /// 送信が追いつかない購読者への配信方法
+  SlowSubscriberPolicy slow_subscriber_policy = SlowSubscriberPolicy::kDrop;
+  /// ResponseWriter::WritePinned()の本体がこのバイト数以上の場合はMSG_ZEROCOPYで送信する
+  /// （Linuxのみ。0の場合は使用しない）
+  ///
+  /// 小さな書き込みではページの固定と完了通知の処理がコピーより高くつくため、
+  /// 既定値は16KiB。
+  std::size_t zero_copy_threshold = 16 * 1024;
+  /// ワーカースレッドを固定するCPUの集合（空の場合は固定しない）
+  ///
+  /// i番目のワーカースレッドはworker_cpu_sets[i % worker_cpu_sets.size()]のCPUに固定される。
+  /// kContextPerThreadでは各ワーカーの接続オブジェクトを固定後のスレッド上で確保するため、
+  /// 受信バッファと合わせてそのCPUのNUMAノードのメモリに配置される（カーネルの
+  /// ファーストタッチ方式による）。固定できなかった場合は警告を出力して続行する。
+  std::vector<std::vector<int>> worker_cpu_sets;
+  /// 0より大きい場合、ワーカースレッドは処理するイベントがなくなってもこの時間は
+  /// io_contextをポーリングし続け、その後でブロックする（低レイテンシーモード）
+  ///
+  /// スピンしている間はスレッドごとにCPUを1コア使い切る。Linuxでは待ち受けソケットに
+  /// 同じ時間のSO_BUSY_POLLも設定する（net.core.busy_readより大きい値にはCAP_NET_ADMINが
+  /// 必要で、設定できない場合はスピンだけを行う）。
+  std::chrono::microseconds busy_poll{0};
+  /// メトリクスをPrometheusのテキスト形式で公開する管理用ポート（0の場合は公開しない）
+  ///
+  /// "GET /metrics"にTcpServer::GetMetrics()の内容を返し、ほかのパスには404を返す。
+  /// リクエストヘッダを5秒以内に送らない接続は閉じる。Stop()で閉じる。
+  unsigned short metrics_port = 0;
+  /// 管理用ポートで待ち受けるアドレス（既定ではループバックのみ）
+  std::string metrics_address = "127.0.0.1";
+  /// 送受信のない状態がこの時間続いた接続を閉じる（0の場合は無効）
+  ///
+  /// タイムアウトはI/Oスレッドごとのタイミングホイールで管理され、
+  /// 最も短いタイムアウトの1/16程度（1〜100ミリ秒）の精度で判定される。
+  /// コルーチンのセッションハンドラには適用されない。
+  std::chrono::milliseconds idle_timeout{0};
+  /// リクエストの途中まで受信してから、そのフレームが揃うまでの制限時間（0の場合は無効）
+  ///
+  /// 少しずつしか送信しないクライアントが接続を占有し続けることを防ぐ。
+  std::chrono::milliseconds read_timeout{0};
+  /// 1回の書き込みが完了するまでの制限時間（0の場合は無効）
+  std::chrono::milliseconds write_timeout{0};
+  /// サーバーのログを専用スレッドから非同期に出力する
+  ///
+  /// I/Oスレッドはメッセージをロックフリーの有界キューに積むだけで、ファイルやコンソールへの
+  /// 書き込みを待たない。キューが一杯の場合はメッセージを破棄し、破棄した数を後で出力する。
+  /// 出力先とログレベルは、サーバー生成時のspdlogの既定ロガーから引き継ぐ。
+  bool async_logging = true;
+  /// 非同期ログのキューに保持できるメッセージの数（2のべき乗に切り上げる）
+  std::size_t log_queue_size = 4096;
+  /// 繰り返し発生するイベント（acceptエラー、最大接続数による拒否）を1秒あたりにログ出力する最大数
+  ///
+  /// 超えた分は出力せずに数え、次に出力するメッセージに省略した数を付記する。0の場合は制限しない。
+  unsigned int log_rate_limit = 10;
+
+  /// 待ち受けソケットの引き継ぎに使うUnixドメインソケットのパス（空の場合は引き継ぎを行わない）
+  ///
+  /// 構築時にこのパスで動作中のサーバーがあれば、その待ち受けソケットを受け取って使用し、
+  /// bindは行わない。その後は自身がこのパスで待ち受け、次に起動したプロセスへ引き継ぐ。
+  /// 引き継ぎ中も両方のプロセスが同じソケットから受け付けるため、接続は拒否されない。
+  /// 新旧のプロセスは同じexecution_modeで動作させること。POSIXのみ対応。
+  std::string listener_handoff_path;
+  /// 待ち受けソケットを後継プロセスへ引き継ぎ、受け付けを停止した後に呼び出される関数
+  ///
+  /// I/Oスレッド上で呼び出されるため、ここでTcpServer::Drain()を呼び出してはならない。
+  /// 別のスレッドに通知し、そこでDrain()を呼び出して処理中の接続を終えること。
+  std::function<void()> on_listener_handoff;
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_SERVER_OPTIONS_H_
@@ -0,0 +1,129 @@
+/**
+ * @file session.h
+ * @brief コルーチンで1つの接続を処理するセッションクラスの定義
+ *
+ * CMakeオプションTCP_SERVER_ENABLE_COROUTINESを有効にした場合（C++20）のみ使用できる。
+ */
+
+#ifndef TCP_SERVER_SESSION_H_
+#define TCP_SERVER_SESSION_H_
+
+#if defined(TCP_SERVER_HAS_COROUTINES)
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+#include "tcp_server/asio.h"
+
+#if !defined(BOOST_ASIO_HAS_CO_AWAIT)
+#error "TCP_SERVER_HAS_COROUTINES requires a compiler with C++20 coroutine support"
+#endif
+
+namespace tcp_server {
+namespace internal {
+class Connection;
+}  // namespace internal
+
+/**
+ * @brief 1つの接続をコルーチンから操作するためのクラス
+ *
+ * セッションハンドラの引数として渡され、ハンドラのコルーチンが終了すると接続は閉じられる。
+ * すべての操作は接続のエグゼキュータ上で実行され、同時に複数の操作をco_awaitしてはならない。
+ * 入出力でエラーが発生した場合はboost::system::system_errorを送出する。
+ */
+class Session {
+ public:
+  using Executor = boost::asio::any_io_executor;
+
+  /**
+   * @brief コンストラクタ（ライブラリ内部で使用する）
+   * @param connection 操作対象の接続
+   */
+  explicit Session(internal::Connection& connection);
+
+  /**
+   * @brief デストラクタ（Sleep()用タイマーを接続から外す）
+   */
+  ~Session();
+
+  Session(const Session&) = delete;
+  Session& operator=(const Session&) = delete;
+
+  /**
+   * @brief 次のフレームを受信する
+   *
+   * ServerOptions::framerで区切られたフレームのペイロードを返す。
+   * @return ペイロード（次のReadFrame()呼び出しまで有効）。相手が送信を終えた場合はstd::nullopt
+   * @throws FramingError 受信データが不正なフレームの場合
+   * @throws boost::system::system_error 読み込みに失敗した場合
+   */
+  boost::asio::awaitable<std::optional<std::string_view>> ReadFrame();
+
+  /**
+   * @brief ペイロードをフレーム化して送信する
+   * @param payload 送信するペイロード
+   * @throws FramingError ペイロードがフレームの最大長を超える場合
+   * @throws boost::system::system_error 書き込みに失敗した場合
+   */
+  boost::asio::awaitable<void> WriteFrame(std::string_view payload);
+
+  /**
+   * @brief データをフレーム化せずにそのまま送信する
+   *
+   * 大きな応答を分割して送信する場合などに使用する。全データが送信されると完了する。
+   * @param data 送信するデータ（完了まで有効であること）
+   * @throws boost::system::system_error 書き込みに失敗した場合
+   */
+  boost::asio::awaitable<void> Write(std::string_view data);
+
+  /**
+   * @brief 指定時間待機する
+   *
+   * 接続が閉じられると（サーバーの停止などセッションの外からでも）待機を中断する。
+   * @param duration 待機時間
+   * @throws boost::system::system_error 接続が閉じられた場合
+   */
+  boost::asio::awaitable<void> Sleep(std::chrono::steady_clock::duration duration);
+
+  /**
+   * @brief 接続を閉じる
+   *
+   * 実行中の操作はboost::asio::error::operation_abortedで終了する。
+   */
+  void Close();
+
+  /**
+   * @brief 接続のエグゼキュータを返す
+   *
+   * 他の非同期操作をこのエグゼキュータ上で実行すれば、セッションと同じ直列化の下で動作する。
+   * @return エグゼキュータ
+   */
+  Executor GetExecutor() const;
+
+  /**
+   * @brief 接続相手のアドレスを返す
+   * @return 接続相手のエンドポイント（Unixドメインソケットの接続では既定値のエンドポイント）
+   */
+  boost::asio::ip::tcp::endpoint GetRemoteEndpoint() const;
+
+ private:
+  internal::Connection& connection_;    ///< 操作対象の接続
+  std::size_t consumed_ = 0;            ///< 前回返したフレームが受信バッファで占めるバイト数
+  boost::asio::steady_timer timer_;     ///< Sleep()用タイマー
+};
+
+/**
+ * @brief セッションハンドラ
+ *
+ * 接続ごとに1回呼び出されるコルーチン。返したawaitableが完了すると接続は閉じられる。
+ */
+using SessionHandler = std::function<boost::asio::awaitable<void>(Session&)>;
+
+}  // namespace tcp_server
+
+#endif  // defined(TCP_SERVER_HAS_COROUTINES)
+
+#endif  // TCP_SERVER_SESSION_H_
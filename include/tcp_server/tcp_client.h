@@ -0,0 +1,265 @@
+/**
+ * @file tcp_client.h
+ * @brief 持続接続のプールとパイプライン化を行う非同期クライアントの定義
+ */
+
+#ifndef TCP_SERVER_TCP_CLIENT_H_
+#define TCP_SERVER_TCP_CLIENT_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "tcp_server/asio.h"
+#include "tcp_server/framer.h"
+#include "tcp_server/server_metrics.h"
+
+// 前方宣言
+namespace spdlog {
+class logger;
+}  // namespace spdlog
+
+namespace tcp_server {
+namespace internal {
+class BufferPool;
+class ServerMetrics;
+struct ClientIoContext;
+struct ClientSettings;
+}  // namespace internal
+
+class TcpServer;
+
+/**
+ * @brief クライアントの設定
+ */
+struct ClientOptions {
+  /// リクエストをフレームに包み、応答を分割するフレーマー（nullptrの場合はRawFramer）
+  ///
+  /// サーバーのServerOptions::framerと同じ形式を指定する。RawFramerでは応答の区切りが
+  /// 分からないため、接続ごとに同時に1つのリクエストしか送信しない。
+  std::shared_ptr<const Framer> framer;
+  /// 宛先ごとに保持する持続接続の最大数
+  ///
+  /// すべての接続が応答待ちのリクエストを抱えている場合に限り、この数まで新しい接続を開く。
+  /// それ以降のリクエストは、応答待ちが最も少ない接続でパイプライン化する。
+  std::size_t connections_per_endpoint = 4;
+  /// 1つの接続で応答を待たずに送信できるリクエストの数
+  ///
+  /// 超えた分は接続ごとのキューで待ち、応答が届くと送信する。
+  std::size_t max_pipeline_depth = 128;
+  /// 単独で作成したクライアントのI/Oスレッドの数（0の場合は1）
+  unsigned int threads = 1;
+  /// リクエストから応答までの制限時間（0の場合は無効）
+  ///
+  /// 最も古い応答待ちのリクエストが制限時間を超えると、その接続を閉じ、
+  /// 応答待ちのリクエストをすべてboost::asio::error::timed_outで完了する
+  /// （後続の応答を対応付けられなくなるため）。接続の確立を待つ時間も含む。
+  std::chrono::milliseconds request_timeout{0};
+  /// TCPの接続にTCP_NODELAYを設定する
+  bool no_delay = true;
+  /// 応答を受信するときに借りる受信バッファのサイズ（バイト）
+  ///
+  /// 受信バッファは受信したデータを処理する間だけバッファプールから借りる。
+  /// 応答がバッファに収まらない場合はフレーマーの最大フレームサイズまで拡大する。
+  std::size_t read_buffer_size = 4096;
+  /// リクエストから応答までの時間を計測してメトリクスに記録する
+  bool measure_request_time = true;
+};
+
+/**
+ * @brief 非同期クライアント
+ *
+ * 宛先ごとに持続接続のプールを保持し、1つの接続に複数のリクエストをパイプライン化して
+ * 送信する。リクエストごとにTCPのハンドシェイクを行わず、応答を待つ間も同じ接続で
+ * 次のリクエストを送信できる。サーバーは接続ごとに受信順で応答するため、応答は送信順に
+ * リクエストへ対応付けられる（サーバー側のメッセージハンドラはHandlerExecutionに
+ * 関係なく順序を保つ）。Publish()などサーバーから一方的に送信されるメッセージは扱えない。
+ *
+ * 宛先は"アドレス:ポート"（IPv6は"[アドレス]:ポート"）、または"unix:パス"（"unix:@名前"は
+ * Linuxの抽象名前空間）の文字列で指定する。ホスト名は最初のリクエスト時に1回だけ
+ * 同期的に名前解決する。接続はリクエストの送信時に確立し、切断された接続は次の
+ * リクエストで再接続する。接続でエラーが発生すると、その接続で応答待ちのリクエストは
+ * すべてそのエラーで完了する。
+ *
+ * 単独で作成したクライアントは自身のI/Oスレッド、受信バッファのプール、メトリクスを持つ。
+ * TcpServer::CreateClient()で作成したクライアントはサーバーのI/Oスレッド上で動作し、
+ * サーバーのワーカーの受信バッファのプールを使い、メトリクスをサーバーに記録する。
+ * すべてのメンバー関数は任意のスレッドから呼び出してよい。
+ */
+class TcpClient {
+ public:
+  /// 完了ハンドラのシグネチャ（エラー、応答のペイロード）
+  using Signature = void(boost::system::error_code, std::string);
+
+  /**
+   * @brief 自身のI/Oスレッドで動作するクライアントのコンストラクタ
+   * @param options クライアントの設定
+   * @throws std::invalid_argument 設定が不正な場合
+   */
+  explicit TcpClient(const ClientOptions& options = ClientOptions());
+
+  /**
+   * @brief デストラクタ
+   *
+   * すべての接続を閉じ、完了していないリクエストはboost::asio::error::operation_abortedで
+   * 完了する。単独で作成したクライアントはI/Oスレッドの終了を待つため、そのI/Oスレッド
+   * （完了ハンドラ内など）で破棄してはならない。
+   */
+  ~TcpClient();
+
+  TcpClient(const TcpClient&) = delete;
+  TcpClient& operator=(const TcpClient&) = delete;
+
+  /**
+   * @brief リクエストを送信し、応答を非同期に受け取る
+   *
+   * 完了トークンにはコールバック、boost::asio::use_future、boost::asio::use_awaitable
+   * （C++20のコルーチン）などを指定できる。コールバックはハンドラに関連付けられた
+   * エグゼキュータで呼び出され、関連付けがなければクライアントのI/Oスレッドで呼び出される。
+   * 応答のペイロードはフレーマーで取り出したもので、エラーの場合は空文字列。
+   * @param endpoint 宛先
+   * @param request リクエストのペイロード（呼び出し中にコピーされる）
+   * @param token 完了トークン
+   * @return 完了トークンが決める値（use_futureならstd::future<std::string>）
+   * @throws std::invalid_argument 宛先の形式が不正な場合
+   * @throws boost::system::system_error 宛先の名前解決に失敗した場合
+   * @throws FramingError リクエストをフレームに符号化できない場合
+   */
+  template <typename CompletionToken>
+  auto AsyncRequest(std::string_view endpoint, std::string_view request,
+                    CompletionToken&& token) {
+    return boost::asio::async_initiate<CompletionToken, Signature>(
+        [this](auto handler, std::string_view endpoint, std::string_view request) {
+          // The handler may be move-only, while the callback must be copyable
+          using Handler = decltype(handler);
+          auto work = boost::asio::make_work_guard(boost::asio::get_associated_executor(handler));
+          auto shared = std::make_shared<Handler>(std::move(handler));
+          StartRequest(endpoint, request,
+                       [shared, work](const boost::system::error_code& error,
+                                      std::string response) mutable {
+                         boost::asio::dispatch(
+                             work.get_executor(),
+                             [shared, error, response = std::move(response)]() mutable {
+                               (*shared)(error, std::move(response));
+                             });
+                         work.reset();
+                       });
+        },
+        token, endpoint, request);
+  }
+
+  /**
+   * @brief リクエストを送信し、応答を待つ
+   *
+   * 応答はクライアントのI/Oスレッドで処理されるため、そのスレッド（完了ハンドラ内や、
+   * TcpServer::CreateClient()で作成した場合はサーバーのメッセージハンドラ内）からは
+   * 呼び出せない。代わりにAsyncRequest()を使う。
+   * @param endpoint 宛先
+   * @param request リクエストのペイロード
+   * @return 応答のペイロード
+   * @throws boost::system::system_error 接続、送受信に失敗した場合、タイムアウトした場合、
+   *         または作成したサーバーが停止した場合（boost::asio::error::operation_aborted）
+   * @throws std::logic_error クライアントのI/Oスレッドから呼び出した場合
+   * @throws std::invalid_argument 宛先の形式が不正な場合
+   * @throws FramingError リクエストをフレームに符号化できない場合
+   */
+  std::string Request(std::string_view endpoint, std::string_view request);
+
+  /**
+   * @brief すべての接続を閉じる
+   *
+   * 応答待ちのリクエストはboost::asio::error::operation_abortedで完了する。
+   * 接続はプールに残り、次のリクエストで再接続する。
+   */
+  void Close();
+
+  /**
+   * @brief 確立している接続の数を返す
+   * @return すべての宛先の接続数の合計
+   */
+  std::size_t GetConnectionCount() const;
+
+  /**
+   * @brief 実行時メトリクスを取得する
+   *
+   * client_で始まる項目とerrorsが記録される。TcpServer::CreateClient()で作成した
+   * クライアントでは、サーバーと共有するカウンタを集計したものになる
+   * （connections_activeと応答キャッシュの項目はTcpServer::GetMetrics()で得る）。
+   * @return 現在のメトリクス
+   */
+  MetricsSnapshot GetMetrics() const;
+
+ private:
+  friend class TcpServer;
+
+  /**
+   * @brief 宛先ごとの接続のプール
+   */
+  struct EndpointPool;
+
+  /**
+   * @brief 既存のI/Oスレッドで動作するクライアントのコンストラクタ（TcpServerが使用する）
+   * @param options クライアントの設定
+   * @param contexts 接続を割り当てるio_contextと受信バッファのプール
+   * @param metrics メトリクスの記録先
+   * @param logger ロガー
+   * @throws std::invalid_argument 設定が不正な場合
+   */
+  TcpClient(const ClientOptions& options, std::vector<internal::ClientIoContext> contexts,
+            internal::ServerMetrics* metrics, std::shared_ptr<spdlog::logger> logger);
+
+  /**
+   * @brief 設定を検証し、全接続で共有する設定を作成する
+   * @throws std::invalid_argument 設定が不正な場合
+   */
+  void Initialize();
+
+  /**
+   * @brief 作成したサーバーのI/Oスレッドが停止した後、すべてのリクエストを失敗させる
+   *
+   * 応答待ちのリクエストと以降のリクエストは、呼び出したスレッドで
+   * boost::asio::error::operation_abortedで完了する。TcpServer::Stop()が使用する。
+   */
+  void Abort();
+
+  /**
+   * @brief 接続を選んでリクエストを送信する
+   *
+   * 応答待ちのリクエストがない接続を優先し、なければ上限まで接続を追加し、
+   * それ以上は応答待ちが最も少ない接続を使う。
+   * @param endpoint 宛先
+   * @param request リクエストのペイロード
+   * @param callback 接続のストランド上で呼び出される完了コールバック
+   */
+  void StartRequest(std::string_view endpoint, std::string_view request,
+                    std::function<void(const boost::system::error_code&, std::string)> callback);
+
+  ClientOptions options_;  ///< クライアントの設定
+  std::shared_ptr<spdlog::logger> logger_;  ///< ロガー
+  // 単独で作成した場合のみ使用する。接続より後に破棄するため先に宣言する
+  std::unique_ptr<internal::ServerMetrics> own_metrics_;  ///< メトリクス
+  std::unique_ptr<internal::BufferPool> own_buffer_pool_;  ///< 受信バッファのプール
+  std::unique_ptr<boost::asio::io_context> own_io_context_;  ///< I/Oコンテキスト
+  std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>
+      work_guard_;                     ///< 接続がない間もI/Oスレッドを終了させない
+  std::vector<std::thread> threads_;  ///< I/Oスレッド
+  internal::ServerMetrics* metrics_;  ///< メトリクスの記録先
+  std::vector<internal::ClientIoContext> contexts_;  ///< 接続を割り当てるio_context
+  std::shared_ptr<const internal::ClientSettings> settings_;  ///< 全接続で共有する設定
+  mutable std::mutex mutex_;  ///< pools_、その接続の一覧、next_context_、aborted_を保護する
+  std::size_t next_context_ = 0;  ///< 次の接続を割り当てるcontexts_の位置
+  bool aborted_ = false;          ///< Abort()後はリクエストを直ちに失敗させる
+  TcpServer* server_ = nullptr;   ///< 作成したサーバー（単独で作成した場合はnullptr）
+  std::map<std::string, std::unique_ptr<EndpointPool>, std::less<>> pools_;  ///< 宛先ごとのプール
+};
+
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_TCP_CLIENT_H_
@@ -6,29 +6,63 @@
 #ifndef TCP_SERVER_TCP_SERVER_H_
 #define TCP_SERVER_TCP_SERVER_H_
 
-#include <boost/asio.hpp>
-#include <boost/asio/executor_work_guard.hpp>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
 
+#include "tcp_server/asio.h"
+#include "tcp_server/response_writer.h"
+#include "tcp_server/server_metrics.h"
+#include "tcp_server/server_options.h"
+#include "tcp_server/session.h"
+#include "tcp_server/tcp_client.h"
+
 // 前方宣言
+namespace spdlog {
+class logger;
+}  // namespace spdlog
+
 namespace tcp_server {
 namespace internal {
 class Connection;
+class AcceptRateLimiter;
+class ConnectionRegistry;
+class ListenerHandoff;
+class LogLimiter;
+class MetricsEndpoint;
+class PeerLimiter;
+class ResponseCache;
+class ServerMetrics;
+class TlsContext;
+class TopicRegistry;
+class Worker;
+class WorkStealingPool;
+struct ConnectionSettings;
 }  // namespace internal
 
 /**
  * @brief TCPサーバークラス
  *
- * 複数のクライアント接続を受け付け、メッセージを処理するTCPサーバー
+ * 複数のクライアント接続を受け付け、メッセージを処理するTCPサーバー。
+ * SocketOptions::unix_socket_pathsを指定すると、同じハンドラでUnixドメインソケットでも待ち受ける。
  */
 class TcpServer {
  public:
   using MessageHandler = std::function<std::string(const std::string&)>;
 
+  /**
+   * @brief コピーを行わないメッセージハンドラ
+   *
+   * 第1引数は接続の受信バッファを直接指すビューで、ハンドラの呼び出し中のみ有効。
+   * 応答は第2引数のResponseWriterを通して接続の送信バッファへ直接書き込む。
+   */
+  using MessageViewHandler = std::function<void(std::string_view, ResponseWriter&)>;
+
   /**
    * @brief TCPサーバーのコンストラクタ
    * @param port 待ち受けるポート番号
@@ -39,6 +73,42 @@ class TcpServer {
   TcpServer(unsigned short port, MessageHandler message_handler,
            unsigned int max_connections = 8);
 
+  /**
+   * @brief 設定を指定するTCPサーバーのコンストラクタ
+   * @param port 待ち受けるポート番号
+   * @param message_handler クライアントからのメッセージを処理するハンドラ
+   * @param options サーバーの設定
+   * @throws std::runtime_error サーバーの初期化に失敗した場合
+   */
+  TcpServer(unsigned short port, MessageHandler message_handler,
+           const ServerOptions& options);
+
+  /**
+   * @brief コピーを行わないハンドラを使用するTCPサーバーのコンストラクタ
+   * @param port 待ち受けるポート番号
+   * @param message_handler 受信バッファのビューを受け取り、応答を直接書き込むハンドラ
+   * @param options サーバーの設定
+   * @throws std::runtime_error サーバーの初期化に失敗した場合
+   */
+  TcpServer(unsigned short port, MessageViewHandler message_handler,
+           const ServerOptions& options = ServerOptions());
+
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  /**
+   * @brief コルーチンのセッションハンドラを使用するTCPサーバーのコンストラクタ
+   *
+   * 接続ごとにセッションハンドラのコルーチンを起動する。ハンドラはフレームの受信、
+   * 応答の送信、タイマーなどをco_awaitでき、I/Oスレッドをブロックせずに待機できる。
+   * ServerOptions::handler_executionとmeasure_handler_timeは使用しない。
+   * @param port 待ち受けるポート番号
+   * @param session_handler 接続ごとに呼び出されるコルーチン
+   * @param options サーバーの設定
+   * @throws std::runtime_error サーバーの初期化に失敗した場合
+   */
+  TcpServer(unsigned short port, SessionHandler session_handler,
+           const ServerOptions& options = ServerOptions());
+#endif
+
   /**
    * @brief デストラクタ
    */
@@ -56,49 +126,237 @@ class TcpServer {
    */
   void Stop();
 
+  /**
+   * @brief すべての接続へメッセージを送信する
+   *
+   * メッセージはフレーマーで1回だけ符号化し、参照カウント付きの不変バッファとして
+   * 各接続の送信キューに追加する（接続ごとにコピーしない）。送信が追いつかない接続には
+   * ServerOptions::slow_subscriber_policyを適用する。任意のスレッドから呼び出してよい。
+   * コルーチンのセッションには送信せず、戻り値の数にも含めない。
+   * @param message 送信するペイロード
+   * @return メッセージを渡した接続の数
+   * @throws FramingError メッセージをフレームに符号化できない場合
+   */
+  std::size_t Publish(std::string_view message);
+
+  /**
+   * @brief トピックの購読者へメッセージを送信する
+   *
+   * 購読者の一覧はロックを取らずに参照するため、購読者が多くても他の操作を妨げない。
+   * 購読の変更後に最初に呼び出したときだけ、変更されたトピックの一覧を作り直す。
+   * コルーチンのセッションには送信せず、戻り値の数にも含めない。
+   * @param topic トピック名
+   * @param message 送信するペイロード
+   * @return メッセージを渡した接続の数
+   * @throws FramingError メッセージをフレームに符号化できない場合
+   */
+  std::size_t Publish(const std::string& topic, std::string_view message);
+
+  /**
+   * @brief 接続をトピックの購読者にする
+   *
+   * 接続のIDはハンドラ内でResponseWriter::GetConnectionId()から得る。
+   * 接続が閉じると、購読はすべて自動的に解除される。任意のスレッドから呼び出してよい。
+   * @param connection 接続のID
+   * @param topic トピック名
+   * @return 接続が存在しない場合はfalse
+   */
+  bool Subscribe(ConnectionId connection, const std::string& topic);
+
+  /**
+   * @brief トピックの購読を解除する
+   * @param connection 接続のID
+   * @param topic トピック名
+   */
+  void Unsubscribe(ConnectionId connection, const std::string& topic);
+
+  /**
+   * @brief 応答キャッシュから1つのキーの応答を削除する
+   *
+   * この呼び出しと同時に計算中だった応答もキャッシュされないため、呼び出しから戻った後に
+   * 受信したリクエストには必ず新しい応答が返る。任意のスレッドから呼び出してよい。
+   * @param key キャッシュのキー（ResponseCacheOptions::keyが返す値。未指定ならリクエスト全体）
+   * @return 応答が削除された場合はtrue（キャッシュを使用しない場合は常にfalse）
+   */
+  bool InvalidateCachedResponse(std::string_view key);
+
+  /**
+   * @brief 応答キャッシュのすべての応答を削除する
+   *
+   * 任意のスレッドから呼び出してよい。キャッシュを使用しない場合は何もしない。
+   */
+  void ClearResponseCache();
+
+  /**
+   * @brief 処理中の接続を終えてからサーバーを停止する
+   *
+   * 新しい接続の受け付けを直ちに停止し、待機中の接続を閉じる。受信途中のフレーム、
+   * 処理中のリクエスト、未送信の応答がある接続は、それらを終えた時点で閉じる。
+   * タイムアウトまでに終わらなかった接続はStop()で強制的に閉じる。
+   * コルーチンのセッションはタイムアウトまで実行を続ける。
+   * I/Oスレッド（ハンドラ内など）から呼び出してはならない。
+   * @param timeout 接続の終了を待つ最大時間
+   * @return すべての接続がタイムアウト前に閉じた場合はtrue
+   */
+  bool Drain(std::chrono::milliseconds timeout);
+
   /**
    * @brief サーバーが実行中かどうかを返す
    * @return サーバーが実行中ならtrue、そうでなければfalse
    */
   bool IsRunning() const;
 
+  /**
+   * @brief 待ち受けているポート番号を返す
+   *
+   * ポート0を指定した場合や、待ち受けソケットを引き継いだ場合の実際のポート番号を得るために使う。
+   * @return 待ち受けポート番号（TCPで待ち受けない場合は0）
+   */
+  unsigned short GetPort() const;
+
+  /**
+   * @brief 現在の接続数を返す
+   *
+   * ロックを取らずに読み取るため、他スレッドでの接続・切断と同時に呼び出してもよい。
+   * @return 登録されているアクティブな接続の数
+   */
+  std::size_t GetConnectionCount() const;
+
+  /**
+   * @brief 実行時メトリクスを取得する
+   *
+   * 各スレッドが個別に記録しているカウンタをこの呼び出し時に集計する。
+   * 記録側はロックを取らないため、任意のスレッドからいつ呼び出してもよい。
+   * @return 現在のメトリクス
+   */
+  MetricsSnapshot GetMetrics() const;
+
+  /**
+   * @brief サーバーのI/Oスレッドで動作するクライアントを作成する
+   *
+   * クライアントの接続はワーカーのio_contextに順に割り当てられ、そのワーカーの受信バッファの
+   * プールを使い、メトリクスはGetMetrics()のclient_で始まる項目に記録される。
+   * ハンドラから他のサーバーへリクエストを転送する場合などに、スレッドを追加せずに使える。
+   * クライアントの接続はDrain()の対象にならない。クライアントはサーバーより先に破棄すること。
+   * Stop()はI/Oスレッドの終了後、完了していないリクエストとそれ以降のリクエストを
+   * boost::asio::error::operation_abortedで完了する。このとき完了ハンドラはStop()を
+   * 呼び出したスレッドで実行され、その中でクライアントを破棄してはならない
+   * （サーバーのエグゼキュータを関連付けたハンドラは実行されない）。
+   * サーバーのメッセージハンドラからは、同期のTcpClient::Request()ではなくAsyncRequest()を使う。
+   * @param options クライアントの設定（threadsは使用しない）
+   * @return クライアント
+   * @throws std::logic_error サーバーが実行中でない場合
+   * @throws std::invalid_argument 設定が不正な場合
+   */
+  std::unique_ptr<TcpClient> CreateClient(const ClientOptions& options = ClientOptions());
+
  private:
+  friend class TcpClient;
+
+  /**
+   * @brief 全コンストラクタ共通の初期化
+   * @param port 待ち受けるポート番号
+   * @param options サーバーの設定
+   * @param settings ハンドラを設定済みの接続設定（残りの項目はここで設定する）
+   * @throws std::runtime_error サーバーの初期化に失敗した場合
+   */
+  TcpServer(unsigned short port, const ServerOptions& options,
+           std::shared_ptr<internal::ConnectionSettings> settings);
+
   /**
    * @brief 新しい接続の受け入れを開始
+   *
+   * 過負荷またはレート制限の間は受け付けずに待機し、後で再試行する。
+   * @param worker 受け入れを行うワーカー
+   * @param listener ワーカーの待ち受けソケットの番号
+   * @param resuming 一時停止からの再試行ならtrue
+   */
+  void StartAccept(internal::Worker& worker, std::size_t listener, bool resuming = false);
+
+  /**
+   * @brief 次の接続を受け付けるまでに待つ時間を返す
+   *
+   * 接続数、計算用スレッドプールの処理待ち、ハンドラの実行時間、受け付けレートを判定する。
+   * @return 0ならすぐに受け付けてよい
    */
-  void StartAccept();
+  std::chrono::steady_clock::duration AcceptDelay();
 
   /**
    * @brief 接続受け入れ完了時のハンドラ
+   * @param worker 受け入れを行ったワーカー
+   * @param listener ワーカーの待ち受けソケットの番号
    * @param connection 確立した接続
    * @param error エラー情報
    */
-  void HandleAccept(std::shared_ptr<internal::Connection> connection,
+  void HandleAccept(internal::Worker& worker, std::size_t listener,
+                   std::shared_ptr<internal::Connection> connection,
                    const boost::system::error_code& error);
 
   /**
-   * @brief 接続を管理対象に追加
-   * @param connection 追加する接続
-   * @return 追加に成功した場合はtrue、失敗した場合はfalse
+   * @brief スレッドごとのio_contextを使用するかどうかを返す
+   * @return kContextPerThreadで動作する場合はtrue
+   */
+  bool UsesContextPerThread() const;
+
+  /**
+   * @brief メッセージを1回だけフレームに符号化する
+   * @param message ペイロード
+   * @return 全宛先で共有する符号化済みのバッファ
+   */
+  std::shared_ptr<const std::string> FramePublished(std::string_view message) const;
+
+  /**
+   * @brief 引き継いだがワーカーに割り当てなかった待ち受けソケットを閉じる
+   */
+  void CloseInheritedListeners();
+
+  /**
+   * @brief 破棄されるクライアントをStop()の対象から外す（TcpClientのデストラクタが使用する）
+   * @param client CreateClient()で作成したクライアント
+   */
+  void RemoveClient(TcpClient* client);
+
+  /**
+   * @brief 最初のワーカーでunix_socket_pathsの各パスを待ち受ける
+   * @param inherited 引き継いだUnixドメインソケット（アドレスが一致するものを使い、残りは閉じる）
+   * @throws std::invalid_argument パスが不正な場合
+   * @throws boost::system::system_error bindできない場合
    */
-  bool AddConnection(std::shared_ptr<internal::Connection> connection);
+  void ListenLocal(std::vector<int> inherited);
 
   /**
-   * @brief 接続を管理対象から削除
-   * @param connection 削除する接続
+   * @brief ワーカーのうちTCPの待ち受けソケットの数を返す
+   * @return 0か1（Unixドメインソケットはその後ろに並ぶ）
    */
-  void RemoveConnection(std::shared_ptr<internal::Connection> connection);
+  std::size_t TcpListenerCount() const;
 
   unsigned short port_;                 ///< 待ち受けポート
-  unsigned int max_connections_;        ///< 最大接続数
-  MessageHandler message_handler_;      ///< メッセージハンドラ
-  std::unique_ptr<boost::asio::io_context> io_context_;  ///< I/Oコンテキスト
-  std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;  ///< 接続受付オブジェクト
+  boost::asio::ip::address listen_address_;  ///< 待ち受けアドレス
+  ServerOptions options_;               ///< サーバー設定
+  std::shared_ptr<spdlog::logger> logger_;  ///< サーバーのロガー（他のすべてのメンバーより後に破棄する）
+  std::unique_ptr<internal::LogLimiter> accept_error_log_;  ///< acceptエラーのログの頻度制限
+  std::unique_ptr<internal::LogLimiter> rejection_log_;     ///< 接続拒否のログの頻度制限
+  std::unique_ptr<internal::ConnectionRegistry> connections_;  ///< アクティブな接続（接続は切断時に自身を削除する）
+  std::unique_ptr<internal::ServerMetrics> metrics_;  ///< スレッドごとに分割したカウンタ
+  std::unique_ptr<internal::AcceptRateLimiter> accept_rate_;  ///< 受け付けレートのトークンバケット
+  std::unique_ptr<internal::PeerLimiter> peer_limiter_;  ///< 送信元ごとの接続数の上限
+  std::unique_ptr<internal::TopicRegistry> topics_;  ///< Publish/Subscribeのトピック
+  std::unique_ptr<internal::ResponseCache> response_cache_;  ///< 応答キャッシュ（使用しない場合はnullptr）
+#if defined(TCP_SERVER_HAS_TLS)
+  std::unique_ptr<internal::TlsContext> tls_context_;  ///< 全接続で共有するTLSの設定（TLSを使用しない場合はnullptr）
+#endif
+  std::shared_ptr<const internal::ConnectionSettings> connection_settings_;  ///< 全接続で共有する設定
+  std::vector<std::unique_ptr<internal::Worker>> workers_;  ///< I/Oワーカー（io_contextとacceptor）
+  std::unique_ptr<internal::WorkStealingPool> handler_pool_;  ///< ハンドラ用スレッドプール（kOffloadのみ）
+  std::unique_ptr<internal::MetricsEndpoint> metrics_endpoint_;  ///< Prometheus形式の管理用ポート
+  std::unique_ptr<internal::ListenerHandoff> listener_handoff_;  ///< 後継プロセスへの待ち受けソケットの引き継ぎ
+  std::vector<int> inherited_listeners_;  ///< 引き継いだがまだワーカーに割り当てていない待ち受けソケット
+  std::vector<std::string> socket_files_;  ///< 破棄時に削除するUnixドメインソケットのファイル
   std::vector<std::thread> threads_;   ///< ワーカースレッド
-  std::unordered_set<std::shared_ptr<internal::Connection>> connections_;  ///< アクティブな接続
-  std::mutex connections_mutex_;       ///< 接続リスト用ミューテックス
+  std::mutex clients_mutex_;           ///< clients_を保護する
+  std::vector<TcpClient*> clients_;    ///< CreateClient()で作成し、まだ破棄されていないクライアント
   volatile bool running_;              ///< サーバー実行中フラグ
-  boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard_;  ///< I/Oコンテキスト終了防止ガード
+  std::atomic<bool> draining_;         ///< Drain()中フラグ（新しい接続もすぐに終了させる）
 };
 
 }  // namespace tcp_server
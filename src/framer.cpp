@@ -0,0 +1,182 @@
+#include "tcp_server/framer.h"
+
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace tcp_server {
+
+std::size_t Framer::BeginFrame(std::string* out) const {
+  return out->size();
+}
+
+std::size_t Framer::ExtractFrom(std::string_view data, std::string_view* payload,
+                                std::size_t* scanned) const {
+  const std::size_t consumed = Extract(data, payload);
+  *scanned = consumed > 0 ? 0 : data.size();
+  return consumed;
+}
+
+void Framer::EndFrame(std::string* /*out*/, std::size_t /*start*/) const {}
+
+void Framer::EndFrameWithBodies(std::string* out, std::size_t start,
+                                std::uint64_t /*body_size*/, std::string* /*trailer*/) const {
+  EndFrame(out, start);
+}
+
+void Framer::Encode(std::string_view payload, std::string* out) const {
+  const std::size_t start = BeginFrame(out);
+  out->append(payload.data(), payload.size());
+  EndFrame(out, start);
+}
+
+std::size_t RawFramer::Extract(std::string_view data, std::string_view* payload) const {
+  *payload = data;
+  return data.size();
+}
+
+std::size_t RawFramer::MaxFrameSize() const {
+  return std::numeric_limits<std::size_t>::max();
+}
+
+LengthPrefixFramer::LengthPrefixFramer(Width width, ByteOrder byte_order,
+                                       std::size_t max_payload_size)
+    : header_size_(static_cast<std::size_t>(width)),
+      byte_order_(byte_order),
+      max_payload_size_(max_payload_size) {
+  // The length field cannot describe more than its own range
+  const std::size_t field_max = header_size_ == 2 ? 0xFFFFu : 0xFFFFFFFFu;
+  if (max_payload_size_ > field_max) {
+    max_payload_size_ = field_max;
+  }
+}
+
+std::size_t LengthPrefixFramer::Extract(std::string_view data,
+                                        std::string_view* payload) const {
+  if (data.size() < header_size_) {
+    return 0;
+  }
+
+  // Decode the length field
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < header_size_; ++i) {
+    const std::size_t index =
+        byte_order_ == ByteOrder::kBigEndian ? i : header_size_ - 1 - i;
+    length = (length << 8) | static_cast<unsigned char>(data[index]);
+  }
+
+  if (length > max_payload_size_) {
+    throw FramingError("Frame length " + std::to_string(length) +
+                       " exceeds maximum payload size " +
+                       std::to_string(max_payload_size_));
+  }
+  if (data.size() - header_size_ < length) {
+    return 0;
+  }
+
+  *payload = data.substr(header_size_, length);
+  return header_size_ + length;
+}
+
+std::size_t LengthPrefixFramer::BeginFrame(std::string* out) const {
+  const std::size_t start = out->size();
+  out->append(header_size_, '\0');
+  return start;
+}
+
+void LengthPrefixFramer::EndFrame(std::string* out, std::size_t start) const {
+  EndFrameWithBodies(out, start, 0, nullptr);
+}
+
+void LengthPrefixFramer::EndFrameWithBodies(std::string* out, std::size_t start,
+                                            std::uint64_t body_size,
+                                            std::string* /*trailer*/) const {
+  // The length covers the bodies sent after the buffered payload
+  const std::uint64_t length = out->size() - start - header_size_ + body_size;
+  if (length > max_payload_size_) {
+    throw FramingError("Payload size " + std::to_string(length) +
+                       " exceeds maximum payload size " +
+                       std::to_string(max_payload_size_));
+  }
+
+  // Encode the length field in place
+  for (std::size_t i = 0; i < header_size_; ++i) {
+    const std::size_t index =
+        byte_order_ == ByteOrder::kBigEndian ? header_size_ - 1 - i : i;
+    (*out)[start + index] = static_cast<char>((length >> (8 * i)) & 0xFF);
+  }
+}
+
+std::size_t LengthPrefixFramer::MaxFrameSize() const {
+  return header_size_ + max_payload_size_;
+}
+
+DelimiterFramer::DelimiterFramer(std::string delimiter, std::size_t max_payload_size)
+    : delimiter_(std::move(delimiter)), max_payload_size_(max_payload_size) {
+  if (delimiter_.empty()) {
+    throw std::invalid_argument("Delimiter must not be empty");
+  }
+}
+
+std::size_t DelimiterFramer::Extract(std::string_view data,
+                                     std::string_view* payload) const {
+  std::size_t scanned = 0;
+  return ExtractFrom(data, payload, &scanned);
+}
+
+std::size_t DelimiterFramer::ExtractFrom(std::string_view data, std::string_view* payload,
+                                         std::size_t* scanned) const {
+  // Only scan as far as a frame of the maximum size could reach. Scanned bytes hold no
+  // delimiter, but their last delimiter_.size() - 1 may start one completed by new data
+  const std::string_view window = data.substr(0, MaxFrameSize());
+  const std::size_t overlap = delimiter_.size() - 1;
+  const std::size_t from = *scanned > overlap ? *scanned - overlap : 0;
+  const std::size_t position = window.find(delimiter_, from);
+  if (position == std::string_view::npos) {
+    if (data.size() >= MaxFrameSize()) {
+      throw FramingError("Delimiter not found within maximum payload size " +
+                         std::to_string(max_payload_size_));
+    }
+    *scanned = data.size();
+    return 0;
+  }
+
+  *payload = data.substr(0, position);
+  *scanned = 0;
+  return position + delimiter_.size();
+}
+
+void DelimiterFramer::EndFrame(std::string* out, std::size_t /*start*/) const {
+  out->append(delimiter_);
+}
+
+void DelimiterFramer::EndFrameWithBodies(std::string* out, std::size_t /*start*/,
+                                         std::uint64_t body_size, std::string* trailer) const {
+  // The delimiter ends the frame after its last body
+  (body_size > 0 ? trailer : out)->append(delimiter_);
+}
+
+std::size_t DelimiterFramer::MaxFrameSize() const {
+  return max_payload_size_ + delimiter_.size();
+}
+
+FixedSizeFramer::FixedSizeFramer(std::size_t frame_size) : frame_size_(frame_size) {
+  if (frame_size_ == 0) {
+    throw std::invalid_argument("Frame size must not be zero");
+  }
+}
+
+std::size_t FixedSizeFramer::Extract(std::string_view data,
+                                     std::string_view* payload) const {
+  if (data.size() < frame_size_) {
+    return 0;
+  }
+  *payload = data.substr(0, frame_size_);
+  return frame_size_;
+}
+
+std::size_t FixedSizeFramer::MaxFrameSize() const {
+  return frame_size_;
+}
+
+}  // namespace tcp_server
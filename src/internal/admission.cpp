@@ -0,0 +1,77 @@
+#include "src/internal/admission.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+
+namespace tcp_server {
+namespace internal {
+
+AcceptRateLimiter::AcceptRateLimiter(unsigned int rate, unsigned int burst)
+    : interval_(std::max<std::int64_t>(
+          std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)).count() / rate,
+          1)),
+      tolerance_(interval_ * (static_cast<std::int64_t>(burst == 0 ? rate : burst) - 1)),
+      tat_(Clock::now().time_since_epoch().count()) {}
+
+AcceptRateLimiter::Clock::duration AcceptRateLimiter::TryAcquire() {
+  const std::int64_t now = Clock::now().time_since_epoch().count();
+  std::int64_t tat = tat_.load(std::memory_order_relaxed);
+  while (true) {
+    // Too early: the bucket is empty until tat - tolerance
+    const std::int64_t earliest = tat - tolerance_;
+    if (now < earliest) {
+      return Clock::duration(earliest - now);
+    }
+    if (tat_.compare_exchange_weak(tat, std::max(tat, now) + interval_,
+                                   std::memory_order_relaxed)) {
+      return Clock::duration::zero();
+    }
+  }
+}
+
+PeerLimiter::PeerLimiter(unsigned int limit)
+    : limit_(limit), shards_(new Shard[kShardCount]) {}
+
+bool PeerLimiter::Acquire(const boost::asio::ip::address& address) {
+  const Key key = ToKey(address);
+  Shard& shard = shards_[KeyHash()(key) % kShardCount];
+  std::lock_guard<SpinLock> lock(shard.lock);
+  unsigned int& count = shard.counts[key];
+  if (count >= limit_) {
+    return false;
+  }
+  ++count;
+  return true;
+}
+
+void PeerLimiter::Release(const boost::asio::ip::address& address) {
+  const Key key = ToKey(address);
+  Shard& shard = shards_[KeyHash()(key) % kShardCount];
+  std::lock_guard<SpinLock> lock(shard.lock);
+  auto it = shard.counts.find(key);
+  if (it != shard.counts.end() && --it->second == 0) {
+    // Forget peers without connections so the map does not grow with every address seen
+    shard.counts.erase(it);
+  }
+}
+
+std::size_t PeerLimiter::KeyHash::operator()(const Key& key) const {
+  return std::hash<std::string_view>()(
+      std::string_view(reinterpret_cast<const char*>(key.data()), key.size()));
+}
+
+PeerLimiter::Key PeerLimiter::ToKey(const boost::asio::ip::address& address) {
+  const boost::asio::ip::address_v6 v6 =
+      address.is_v4()
+          ? boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4())
+          : address.to_v6();
+  const auto bytes = v6.to_bytes();
+  Key key;
+  std::memcpy(key.data(), bytes.data(), key.size());
+  return key;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
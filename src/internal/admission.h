@@ -0,0 +1,112 @@
+/**
+ * @file admission.h
+ * @brief Accept rate limiting and per-source connection limits
+ */
+
+#ifndef TCP_SERVER_INTERNAL_ADMISSION_H_
+#define TCP_SERVER_INTERNAL_ADMISSION_H_
+
+#include <array>
+#include <atomic>
+#include <boost/asio/ip/address.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "src/internal/connection_registry.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Token bucket limiting how fast connections are accepted
+ *
+ * Implemented as a generic cell rate algorithm: the whole bucket is one
+ * atomic "theoretical arrival time", so taking a token is a single
+ * compare-and-swap and the limiter can be shared by every acceptor.
+ */
+class AcceptRateLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Constructor
+   * @param rate Tokens added per second; must not be zero
+   * @param burst Tokens the bucket holds when full; 0 means one second's worth
+   */
+  AcceptRateLimiter(unsigned int rate, unsigned int burst);
+
+  /**
+   * @brief Take one token
+   * @return Zero if a token was taken, otherwise how long until the next one
+   */
+  Clock::duration TryAcquire();
+
+ private:
+  std::int64_t interval_;           ///< Clock ticks between two tokens
+  std::int64_t tolerance_;          ///< Clock ticks of tokens a full bucket holds, minus one
+  std::atomic<std::int64_t> tat_;   ///< Theoretical arrival time of the next token
+};
+
+/**
+ * @brief Counts open connections per peer address and enforces a limit
+ *
+ * Addresses are hashed into shards with a spin lock each, so connections
+ * from different peers rarely contend.
+ */
+class PeerLimiter {
+ public:
+  /**
+   * @brief Constructor
+   * @param limit Maximum concurrent connections from one address; must not be zero
+   */
+  explicit PeerLimiter(unsigned int limit);
+
+  PeerLimiter(const PeerLimiter&) = delete;
+  PeerLimiter& operator=(const PeerLimiter&) = delete;
+
+  /**
+   * @brief Count a new connection from the address unless it is at the limit
+   * @param address Peer address
+   * @return true if counted; the caller must call Release() once it closes
+   */
+  bool Acquire(const boost::asio::ip::address& address);
+
+  /**
+   * @brief Uncount a connection counted by Acquire()
+   * @param address Peer address
+   */
+  void Release(const boost::asio::ip::address& address);
+
+ private:
+  using Key = std::array<unsigned char, 16>;  ///< IPv6 or IPv4-mapped address bytes
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  /**
+   * @brief Counters of the addresses hashing to one shard
+   */
+  struct alignas(64) Shard {
+    SpinLock lock;                                      ///< Guards counts
+    std::unordered_map<Key, unsigned int, KeyHash> counts;  ///< Open connections per address
+  };
+
+  static constexpr std::size_t kShardCount = 64;
+
+  /**
+   * @brief Convert an address to its map key
+   */
+  static Key ToKey(const boost::asio::ip::address& address);
+
+  unsigned int limit_;                      ///< Connections allowed per address
+  std::unique_ptr<Shard[]> shards_;         ///< Address shards
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_ADMISSION_H_
@@ -0,0 +1,66 @@
+#include "src/internal/affinity.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+bool PinCurrentThread(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+  DWORD_PTR mask = 0;
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+      return false;
+    }
+    mask |= DWORD_PTR{1} << cpu;
+  }
+  return ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+#else
+  return false;
+#endif
+}
+
+int CurrentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu = 0;
+  unsigned int node = 0;
+  if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return static_cast<int>(node);
+  }
+#endif
+  return -1;
+}
+
+std::string FormatCpuSet(const std::vector<int>& cpus) {
+  std::string result;
+  for (int cpu : cpus) {
+    if (!result.empty()) {
+      result += ',';
+    }
+    result += std::to_string(cpu);
+  }
+  return result;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,42 @@
+/**
+ * @file affinity.h
+ * @brief Pinning threads to CPUs
+ */
+
+#ifndef TCP_SERVER_INTERNAL_AFFINITY_H_
+#define TCP_SERVER_INTERNAL_AFFINITY_H_
+
+#include <string>
+#include <vector>
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Restrict the calling thread to a set of CPUs
+ *
+ * Memory the thread touches first afterwards is placed on the NUMA node of
+ * those CPUs by the kernel's default (first-touch) policy, so pools created
+ * on the thread after pinning are node-local without a NUMA library.
+ * @param cpus CPU numbers
+ * @return false if the platform does not support it or the set is rejected
+ */
+bool PinCurrentThread(const std::vector<int>& cpus);
+
+/**
+ * @brief NUMA node of the CPU the calling thread is running on
+ * @return Node number, or -1 if unknown
+ */
+int CurrentNumaNode();
+
+/**
+ * @brief Format a CPU set for logging
+ * @param cpus CPU numbers
+ * @return Comma-separated list
+ */
+std::string FormatCpuSet(const std::vector<int>& cpus);
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_AFFINITY_H_
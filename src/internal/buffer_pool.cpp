@@ -0,0 +1,93 @@
+#include "src/internal/buffer_pool.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+std::size_t RoundUpToPowerOfTwo(std::size_t size) {
+  std::size_t result = 1;
+  while (result < size) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+BufferPool::BufferPool(std::size_t min_size, std::size_t max_size)
+    : min_size_(RoundUpToPowerOfTwo(std::max<std::size_t>(min_size, 1))),
+      max_size_(std::max(min_size_, RoundUpToPowerOfTwo(max_size))) {
+  for (std::size_t size = min_size_; size <= max_size_; size <<= 1) {
+    free_lists_.emplace_back();
+    free_lists_.back().reserve(std::max(kMinIdlePerClass, kIdleBytesPerClass / size));
+  }
+}
+
+std::size_t BufferPool::ClassSize(std::size_t size) const {
+  return std::max(min_size_, RoundUpToPowerOfTwo(size));
+}
+
+std::size_t BufferPool::ClassIndex(std::size_t class_size) const {
+  if (class_size > max_size_) {
+    return free_lists_.size();
+  }
+  std::size_t index = 0;
+  for (std::size_t size = min_size_; size < class_size; size <<= 1) {
+    ++index;
+  }
+  return index;
+}
+
+PooledBuffer BufferPool::Acquire(std::size_t size) {
+  PooledBuffer buffer;
+  buffer.size = ClassSize(size);
+
+  const std::size_t index = ClassIndex(buffer.size);
+  if (index < free_lists_.size()) {
+    std::lock_guard<SpinLock> lock(lock_);
+    auto& free_list = free_lists_[index];
+    if (!free_list.empty()) {
+      buffer.data = std::move(free_list.back());
+      free_list.pop_back();
+      return buffer;
+    }
+  }
+
+  // Allocated outside the lock; the buffer joins its class when released
+  buffer.data.reset(new char[buffer.size]);
+  return buffer;
+}
+
+void BufferPool::Release(PooledBuffer& buffer) {
+  if (!buffer) {
+    return;
+  }
+
+  const std::size_t index = ClassIndex(buffer.size);
+  if (index < free_lists_.size() && buffer.size == min_size_ << index) {
+    std::lock_guard<SpinLock> lock(lock_);
+    auto& free_list = free_lists_[index];
+    // Never grow past the reserved capacity, so releasing does not allocate
+    if (free_list.size() < free_list.capacity()) {
+      free_list.push_back(std::move(buffer.data));
+    }
+  }
+  buffer.data.reset();
+  buffer.size = 0;
+}
+
+std::size_t BufferPool::IdleCount() {
+  std::lock_guard<SpinLock> lock(lock_);
+  std::size_t count = 0;
+  for (const auto& free_list : free_lists_) {
+    count += free_list.size();
+  }
+  return count;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
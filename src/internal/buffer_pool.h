@@ -0,0 +1,97 @@
+/**
+ * @file buffer_pool.h
+ * @brief Per-worker pool of read buffers in power-of-two size classes
+ */
+
+#ifndef TCP_SERVER_INTERNAL_BUFFER_POOL_H_
+#define TCP_SERVER_INTERNAL_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "src/internal/connection_registry.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Heap buffer handed out by a BufferPool
+ */
+struct PooledBuffer {
+  std::unique_ptr<char[]> data;  ///< Storage, or nullptr if no buffer is held
+  std::size_t size = 0;          ///< Capacity in bytes
+
+  explicit operator bool() const { return data != nullptr; }
+};
+
+/**
+ * @brief Free lists of buffers, one per power-of-two size class
+ *
+ * Connections borrow a buffer only while they have data to read, so growing,
+ * shrinking and idling do not hit malloc once the pool is warm. Requests
+ * above the largest class (frames that outgrow the adaptive limit) are
+ * allocated and freed directly. Thread-safe; a spin lock guards the free
+ * lists, which is uncontended when the owning worker runs on one thread.
+ */
+class BufferPool {
+ public:
+  /**
+   * @brief Constructor
+   * @param min_size Smallest buffer handed out, rounded up to a power of two
+   * @param max_size Largest pooled buffer, rounded up to a power of two
+   */
+  BufferPool(std::size_t min_size, std::size_t max_size);
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  /**
+   * @brief Take a buffer of at least the given size
+   * @param size Requested size in bytes
+   * @return Buffer whose size is the requested size rounded up to its class
+   */
+  PooledBuffer Acquire(std::size_t size);
+
+  /**
+   * @brief Return a buffer to its free list
+   * @param buffer Buffer obtained from Acquire(); left empty
+   */
+  void Release(PooledBuffer& buffer);
+
+  /**
+   * @brief Size class a request is served from
+   * @param size Requested size in bytes
+   * @return Smallest power of two that is at least size and the minimum size
+   */
+  std::size_t ClassSize(std::size_t size) const;
+
+  /**
+   * @brief Number of buffers kept in the free lists
+   * @return Idle buffer count
+   */
+  std::size_t IdleCount();
+
+ private:
+  /// Bytes each size class may keep idle; small classes keep more buffers
+  static constexpr std::size_t kIdleBytesPerClass = 1024 * 1024;
+  /// Buffers each size class may keep idle regardless of their size
+  static constexpr std::size_t kMinIdlePerClass = 16;
+
+  /**
+   * @brief Free list index of a size class
+   * @param class_size Value returned by ClassSize()
+   * @return Index into free_lists_, or free_lists_.size() if the size is not pooled
+   */
+  std::size_t ClassIndex(std::size_t class_size) const;
+
+  std::size_t min_size_;  ///< Size of the smallest class
+  std::size_t max_size_;  ///< Size of the largest class
+  SpinLock lock_;         ///< Guards free_lists_
+  std::vector<std::vector<std::unique_ptr<char[]>>> free_lists_;  ///< Idle buffers per class
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_BUFFER_POOL_H_
@@ -0,0 +1,364 @@
+#include "src/internal/client_connection.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+#include "src/internal/metrics.h"
+
+namespace tcp_server {
+namespace internal {
+
+ClientConnection::ClientConnection(const ClientIoContext& context,
+                                   std::shared_ptr<const ClientSettings> settings,
+                                   StreamProtocol::endpoint endpoint)
+    : strand_(boost::asio::make_strand(*context.io_context)),
+      settings_(std::move(settings)),
+      buffer_pool_(context.buffer_pool),
+      endpoint_(std::move(endpoint)),
+      socket_(strand_),
+      timer_(strand_) {}
+
+ClientConnection::~ClientConnection() {
+  if (read_buffer_) {
+    buffer_pool_->Release(read_buffer_);
+  }
+}
+
+void ClientConnection::Send(std::string frame, Callback callback) {
+  Request request{std::move(frame), std::move(callback), {}};
+  if (settings_->measure_request_time || settings_->request_timeout.count() > 0) {
+    request.start = std::chrono::steady_clock::now();
+  }
+  {
+    std::lock_guard<std::mutex> lock(inbox_mutex_);
+    if (!aborted_) {
+      outstanding_.fetch_add(1, std::memory_order_relaxed);
+      inbox_.push_back(std::move(request));
+      // One hand-over carries every request sent before it runs
+      if (inbox_.size() == 1) {
+        boost::asio::post(strand_, [self = shared_from_this()] { self->TakeInbox(); });
+      }
+      return;
+    }
+  }
+  settings_->metrics->Add(ServerMetrics::kClientRequestsFailed);
+  request.callback(boost::asio::error::operation_aborted, std::string());
+}
+
+void ClientConnection::Close() {
+  boost::asio::post(strand_, [self = shared_from_this()] {
+    self->Fail(boost::asio::error::operation_aborted);
+  });
+}
+
+void ClientConnection::Abort() {
+  std::vector<Request> queued;
+  {
+    std::lock_guard<std::mutex> lock(inbox_mutex_);
+    aborted_ = true;
+    queued.swap(inbox_);
+  }
+  for (Request& request : queued) {
+    requests_.push_back(std::move(request));
+  }
+  Fail(boost::asio::error::operation_aborted);
+}
+
+std::size_t ClientConnection::GetOutstanding() const {
+  return outstanding_.load(std::memory_order_relaxed);
+}
+
+bool ClientConnection::IsOpen() const {
+  return open_.load(std::memory_order_relaxed);
+}
+
+void ClientConnection::TakeInbox() {
+  std::vector<Request> queued;
+  {
+    std::lock_guard<std::mutex> lock(inbox_mutex_);
+    queued.swap(inbox_);
+  }
+  for (Request& request : queued) {
+    Enqueue(std::move(request));
+  }
+}
+
+void ClientConnection::Enqueue(Request request) {
+  requests_.push_back(std::move(request));
+  if (requests_.size() == 1) {
+    ScheduleTimeout();
+  }
+  if (state_ == State::kClosed) {
+    Connect();
+  } else if (state_ == State::kOpen) {
+    StartWrite();
+  }
+}
+
+void ClientConnection::Connect() {
+  state_ = State::kConnecting;
+  // Connecting opens the socket with the endpoint's address family
+  socket_.async_connect(endpoint_, [self = shared_from_this(), generation = generation_](
+                                       const boost::system::error_code& error) {
+    self->HandleConnect(generation, error);
+  });
+}
+
+void ClientConnection::HandleConnect(std::uint64_t generation,
+                                     const boost::system::error_code& error) {
+  if (generation != generation_) {
+    return;
+  }
+  if (error) {
+    settings_->logger->debug("Failed to connect to {}: {}", DescribeEndpoint(endpoint_),
+                             error.message());
+    settings_->metrics->AddError(error);
+    Fail(error);
+    return;
+  }
+
+  // Reads are attempted only once the socket is readable, like the server's
+  boost::system::error_code option_error;
+  socket_.non_blocking(true, option_error);
+  if (settings_->no_delay && !IsLocal(endpoint_)) {
+    socket_.set_option(boost::asio::ip::tcp::no_delay(true), option_error);
+  }
+  state_ = State::kOpen;
+  open_.store(true, std::memory_order_relaxed);
+  settings_->metrics->Add(ServerMetrics::kClientConnectionsOpened);
+
+  StartRead();
+  StartWrite();
+}
+
+void ClientConnection::StartRead() {
+  socket_.async_wait(Socket::wait_read, [self = shared_from_this(), generation = generation_](
+                                            const boost::system::error_code& error) {
+    self->HandleReadable(generation, error);
+  });
+}
+
+void ClientConnection::HandleReadable(std::uint64_t generation,
+                                      const boost::system::error_code& error) {
+  if (generation != generation_) {
+    return;
+  }
+  if (error) {
+    settings_->metrics->AddError(error);
+    Fail(error);
+    return;
+  }
+
+  if (!read_buffer_) {
+    read_buffer_ = buffer_pool_->Acquire(settings_->read_buffer_size);
+  } else if (read_size_ == read_buffer_.size) {
+    // A partial response fills the buffer: grow it up to the framer's limit
+    const std::size_t max_size = settings_->framer->MaxFrameSize();
+    if (read_buffer_.size >= max_size) {
+      settings_->logger->error("Response from {} exceeds maximum frame size of {} bytes",
+                               DescribeEndpoint(endpoint_), max_size);
+      settings_->metrics->AddError(ServerMetrics::kFramingError);
+      Fail(boost::system::errc::make_error_code(boost::system::errc::bad_message));
+      return;
+    }
+    PooledBuffer larger = buffer_pool_->Acquire(std::min(read_buffer_.size * 2, max_size));
+    std::copy(read_buffer_.data.get(), read_buffer_.data.get() + read_size_, larger.data.get());
+    buffer_pool_->Release(read_buffer_);
+    read_buffer_ = std::move(larger);
+  }
+
+  boost::system::error_code read_error;
+  const std::size_t bytes_transferred = socket_.read_some(
+      boost::asio::buffer(read_buffer_.data.get() + read_size_, read_buffer_.size - read_size_),
+      read_error);
+  if (read_error == boost::asio::error::would_block ||
+      read_error == boost::asio::error::try_again) {
+    StartRead();
+    return;
+  }
+  if (read_error) {
+    // Servers may close idle pooled connections; the next request reconnects
+    settings_->logger->debug("Connection to {} closed: {}", DescribeEndpoint(endpoint_),
+                             read_error.message());
+    settings_->metrics->AddError(read_error);
+    Fail(read_error);
+    return;
+  }
+
+  read_size_ += bytes_transferred;
+  settings_->metrics->Add(ServerMetrics::kClientBytesReceived, bytes_transferred);
+  if (!ProcessResponses()) {
+    Fail(boost::system::errc::make_error_code(boost::system::errc::bad_message));
+    return;
+  }
+  if (read_size_ == 0) {
+    buffer_pool_->Release(read_buffer_);
+  }
+  StartRead();
+}
+
+bool ClientConnection::ProcessResponses() {
+  char* data = read_buffer_.data.get();
+  std::size_t offset = 0;
+  try {
+    while (offset < read_size_) {
+      std::string_view payload;
+      const std::size_t consumed =
+          settings_->framer->ExtractFrom(std::string_view(data + offset, read_size_ - offset),
+                                         &payload, &frame_scanned_);
+      if (consumed == 0) {
+        break;
+      }
+      if (written_ == 0) {
+        settings_->logger->error("Response from {} matches no request",
+                                 DescribeEndpoint(endpoint_));
+        settings_->metrics->AddError(ServerMetrics::kFramingError);
+        return false;
+      }
+      offset += consumed;
+      Complete(boost::system::error_code(), std::string(payload));
+    }
+  } catch (const FramingError& ex) {
+    settings_->logger->error("Framing error in response from {}: {}",
+                             DescribeEndpoint(endpoint_), ex.what());
+    settings_->metrics->AddError(ServerMetrics::kFramingError);
+    return false;
+  }
+
+  if (offset == 0) {
+    return true;
+  }
+  // Keep the partial response at the start of the buffer
+  std::copy(data + offset, data + read_size_, data);
+  read_size_ -= offset;
+  ScheduleTimeout();
+  // Responses free room under the in-flight limit
+  StartWrite();
+  return true;
+}
+
+void ClientConnection::StartWrite() {
+  if (state_ != State::kOpen || writing_) {
+    return;
+  }
+
+  // Everything queued since the last write goes out in one
+  while (written_ < requests_.size() && written_ < settings_->max_in_flight) {
+    std::string& frame = requests_[written_].frame;
+    if (output_.empty()) {
+      output_.swap(frame);
+    } else {
+      output_.append(frame);
+      std::string().swap(frame);
+    }
+    ++written_;
+  }
+  if (output_.empty()) {
+    return;
+  }
+
+  writing_ = true;
+  boost::asio::async_write(
+      socket_, boost::asio::buffer(output_),
+      [self = shared_from_this(), generation = generation_](
+          const boost::system::error_code& error, std::size_t bytes_transferred) {
+        self->HandleWrite(generation, error, bytes_transferred);
+      });
+}
+
+void ClientConnection::HandleWrite(std::uint64_t generation,
+                                   const boost::system::error_code& error,
+                                   std::size_t bytes_transferred) {
+  writing_ = false;
+  output_.clear();
+  if (generation != generation_) {
+    // The connection closed under this write; a reconnect may be waiting to write
+    StartWrite();
+    return;
+  }
+  if (error) {
+    settings_->metrics->AddError(error);
+    Fail(error);
+    return;
+  }
+
+  settings_->metrics->Add(ServerMetrics::kClientBytesSent, bytes_transferred);
+  StartWrite();
+}
+
+void ClientConnection::ScheduleTimeout() {
+  if (settings_->request_timeout.count() <= 0) {
+    return;
+  }
+  if (requests_.empty()) {
+    timer_.cancel();
+    return;
+  }
+  timer_.expires_at(requests_.front().start + settings_->request_timeout);
+  timer_.async_wait([self = shared_from_this()](const boost::system::error_code& error) {
+    self->HandleTimeout(error);
+  });
+}
+
+void ClientConnection::HandleTimeout(const boost::system::error_code& error) {
+  // A handler already queued when the timer was re-armed sees the later expiry
+  if (error == boost::asio::error::operation_aborted || requests_.empty() ||
+      timer_.expiry() > std::chrono::steady_clock::now()) {
+    return;
+  }
+  settings_->logger->warn("Request to {} timed out", DescribeEndpoint(endpoint_));
+  Fail(boost::asio::error::timed_out);
+}
+
+void ClientConnection::Complete(const boost::system::error_code& error, std::string response) {
+  Request request = std::move(requests_.front());
+  requests_.pop_front();
+  if (written_ > 0) {
+    --written_;
+  }
+  outstanding_.fetch_sub(1, std::memory_order_relaxed);
+
+  if (error) {
+    settings_->metrics->Add(ServerMetrics::kClientRequestsFailed);
+  } else {
+    settings_->metrics->Add(ServerMetrics::kClientRequests);
+    if (settings_->measure_request_time) {
+      settings_->metrics->RecordRequestTime(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - request.start)
+              .count()));
+    }
+  }
+
+  try {
+    request.callback(error, std::move(response));
+  } catch (const std::exception& ex) {
+    settings_->logger->error("Exception in response callback: {}", ex.what());
+  }
+}
+
+void ClientConnection::Fail(const boost::system::error_code& error) {
+  // Handlers of the closed socket see a newer generation and leave the state alone
+  ++generation_;
+  state_ = State::kClosed;
+  open_.store(false, std::memory_order_relaxed);
+  boost::system::error_code ignored;
+  socket_.close(ignored);
+  timer_.cancel();
+  if (read_buffer_) {
+    buffer_pool_->Release(read_buffer_);
+  }
+  read_size_ = 0;
+  frame_scanned_ = 0;
+
+  while (!requests_.empty()) {
+    Complete(error, std::string());
+  }
+  written_ = 0;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,249 @@
+/**
+ * @file client_connection.h
+ * @brief Persistent, pipelined connection of a TcpClient
+ */
+
+#ifndef TCP_SERVER_INTERNAL_CLIENT_CONNECTION_H_
+#define TCP_SERVER_INTERNAL_CLIENT_CONNECTION_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/internal/buffer_pool.h"
+#include "src/internal/transport.h"
+#include "tcp_server/asio.h"
+#include "tcp_server/framer.h"
+
+// Forward declaration
+namespace spdlog {
+class logger;
+}  // namespace spdlog
+
+namespace tcp_server {
+namespace internal {
+
+class ServerMetrics;
+
+/**
+ * @brief io_context a client connection runs on and the pool its read buffers come from
+ */
+struct ClientIoContext {
+  boost::asio::io_context* io_context;  ///< Runs the connection's handlers
+  BufferPool* buffer_pool;              ///< Lends the connection its read buffer
+};
+
+/**
+ * @brief Settings shared by every connection of a client
+ */
+struct ClientSettings {
+  std::shared_ptr<const Framer> framer;  ///< Frames requests and splits responses
+  ServerMetrics* metrics = nullptr;      ///< Counters (the server's when attached to one)
+  std::shared_ptr<spdlog::logger> logger;  ///< Logger
+  std::size_t read_buffer_size = 0;      ///< Size of the buffer borrowed for each read
+  std::size_t max_in_flight = 0;         ///< Requests written ahead of their responses
+  std::chrono::steady_clock::duration request_timeout{};  ///< 0 disables the timeout
+  bool no_delay = true;                  ///< Set TCP_NODELAY on TCP connections
+  bool measure_request_time = false;     ///< Record round trips in the metrics
+};
+
+/**
+ * @brief One persistent connection to a server, shared by many outstanding requests
+ *
+ * Requests are framed by the caller and written in order; several requests
+ * written while a write is in flight go out together in the next write.
+ * The server answers each connection's requests in the order it received
+ * them, so every complete response frame belongs to the oldest request still
+ * waiting and no request identifier is needed on the wire.
+ *
+ * Send() hands requests over through a small locked inbox, so that Abort()
+ * can still fail requests whose hand-over never ran on a stopped io_context.
+ * All other state lives on a strand. The connection connects on its first request
+ * and again on the first request after it closed, so a pool entry survives
+ * server restarts. Any error fails every waiting request, because the
+ * responses of the remaining ones can no longer be matched.
+ */
+class ClientConnection : public std::enable_shared_from_this<ClientConnection> {
+ public:
+  using Socket = StreamProtocol::socket;
+  using Callback = std::function<void(const boost::system::error_code&, std::string)>;
+
+  /**
+   * @brief Constructor
+   * @param context io_context and buffer pool to use
+   * @param settings Settings shared by the client's connections
+   * @param endpoint Server to connect to
+   */
+  ClientConnection(const ClientIoContext& context, std::shared_ptr<const ClientSettings> settings,
+                   StreamProtocol::endpoint endpoint);
+
+  /**
+   * @brief Destructor; returns the read buffer to the pool
+   */
+  ~ClientConnection();
+
+  ClientConnection(const ClientConnection&) = delete;
+  ClientConnection& operator=(const ClientConnection&) = delete;
+
+  /**
+   * @brief Queue a request; thread-safe
+   *
+   * The callback runs on the connection's strand with the response payload,
+   * or with an error and an empty string. After Abort() it runs at once on
+   * the calling thread with operation_aborted.
+   * @param frame Request already encoded by the framer
+   * @param callback Completion callback
+   */
+  void Send(std::string frame, Callback callback);
+
+  /**
+   * @brief Close the connection and fail waiting requests with operation_aborted; thread-safe
+   */
+  void Close();
+
+  /**
+   * @brief Fail every request with operation_aborted and refuse later ones
+   *
+   * For a connection whose io_context has stopped: the callbacks run on the
+   * calling thread. Must not run concurrently with the io_context's handlers.
+   */
+  void Abort();
+
+  /**
+   * @brief Requests queued or waiting for their response
+   * @return Count read without synchronization, for picking the least loaded connection
+   */
+  std::size_t GetOutstanding() const;
+
+  /**
+   * @brief Whether the connection is established
+   * @return true between a completed connect and the next close
+   */
+  bool IsOpen() const;
+
+ private:
+  /**
+   * @brief Connection lifecycle
+   */
+  enum class State {
+    kClosed,
+    kConnecting,
+    kOpen,
+  };
+
+  /**
+   * @brief A request and the callback waiting for its response
+   */
+  struct Request {
+    std::string frame;                            ///< Encoded request, emptied once written
+    Callback callback;                            ///< Completion callback
+    std::chrono::steady_clock::time_point start;  ///< Time the request was made
+  };
+
+  /**
+   * @brief Move the requests handed over by Send() to the strand
+   */
+  void TakeInbox();
+
+  /**
+   * @brief Queue a request on the strand and connect or write as needed
+   */
+  void Enqueue(Request request);
+
+  /**
+   * @brief Start connecting to the endpoint
+   */
+  void Connect();
+
+  /**
+   * @brief Handle connect completion
+   * @param generation Generation the connect was started in
+   */
+  void HandleConnect(std::uint64_t generation, const boost::system::error_code& error);
+
+  /**
+   * @brief Wait until the socket is readable
+   *
+   * A read buffer is borrowed only once data arrives, so idle pooled
+   * connections hold no buffer.
+   */
+  void StartRead();
+
+  /**
+   * @brief Read what is available and complete the requests whose responses arrived
+   */
+  void HandleReadable(std::uint64_t generation, const boost::system::error_code& error);
+
+  /**
+   * @brief Hand every complete response frame to its request
+   * @return false if a frame was malformed or matched no request
+   */
+  bool ProcessResponses();
+
+  /**
+   * @brief Write the queued requests if no write is in flight
+   */
+  void StartWrite();
+
+  /**
+   * @brief Handle write completion
+   */
+  void HandleWrite(std::uint64_t generation, const boost::system::error_code& error,
+                   std::size_t bytes_transferred);
+
+  /**
+   * @brief Arm the timer for the oldest waiting request, or cancel it if none waits
+   */
+  void ScheduleTimeout();
+
+  /**
+   * @brief Fail the oldest request's connection if it has waited too long
+   */
+  void HandleTimeout(const boost::system::error_code& error);
+
+  /**
+   * @brief Complete the oldest request
+   * @param error Error, or success with the response
+   * @param response Response payload
+   */
+  void Complete(const boost::system::error_code& error, std::string response);
+
+  /**
+   * @brief Close the socket and fail every waiting request
+   * @param error Error handed to the callbacks
+   */
+  void Fail(const boost::system::error_code& error);
+
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_;  ///< Serializes all state
+  std::shared_ptr<const ClientSettings> settings_;  ///< Shared settings
+  BufferPool* buffer_pool_;                 ///< Source of read_buffer_
+  StreamProtocol::endpoint endpoint_;       ///< Server address
+  Socket socket_;                           ///< Socket, reopened on reconnect
+  boost::asio::steady_timer timer_;         ///< Request timeout of the oldest request
+  State state_ = State::kClosed;            ///< Lifecycle state
+  std::uint64_t generation_ = 0;            ///< Bumped on every close; stale handlers compare it
+  std::deque<Request> requests_;            ///< Oldest first; the first written_ are on the wire
+  std::size_t written_ = 0;                 ///< Requests written and waiting for their response
+  std::string output_;                      ///< Frames of the write in flight
+  bool writing_ = false;                    ///< A write is in flight (possibly on a closed socket)
+  PooledBuffer read_buffer_;                ///< Borrowed while a partial response is buffered
+  std::size_t read_size_ = 0;               ///< Bytes held in read_buffer_
+  std::size_t frame_scanned_ = 0;           ///< Bytes of the partial response already scanned
+  std::atomic<std::size_t> outstanding_{0}; ///< Requests handed to Send() and not completed
+  std::atomic<bool> open_{false};           ///< Mirrors state_ == kOpen for other threads
+  std::mutex inbox_mutex_;                  ///< Guards inbox_ and aborted_
+  std::vector<Request> inbox_;              ///< Requests sent but not yet taken by the strand
+  bool aborted_ = false;                    ///< Abort() was called; Send() fails at once
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_CLIENT_CONNECTION_H_
@@ -0,0 +1,248 @@
+#include "src/internal/command_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_set>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+// Bytes up to this value separate the command from its arguments
+constexpr unsigned char kMaxWhitespace = 0x20;
+
+// Displacements tried per bucket before the build starts over with another seed
+constexpr std::size_t kMaxDisplacementAttempts = 1 << 16;
+
+// Failed seeds before the table doubles in size
+constexpr std::uint64_t kSeedsPerTableSize = 8;
+
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+constexpr bool kLittleEndian = true;
+#else
+constexpr bool kLittleEndian = false;
+#endif
+
+bool IsWhitespace(char c) {
+  return static_cast<unsigned char>(c) <= kMaxWhitespace;
+}
+
+unsigned CountTrailingZeros(std::uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+// Position of the first whitespace byte at or after from, or data.size()
+std::size_t FindWhitespace(std::string_view data, std::size_t from) {
+  std::size_t i = from;
+  if (kLittleEndian) {
+    constexpr std::uint64_t kOnes = 0x0101010101010101ull;
+    constexpr std::uint64_t kHighBits = 0x8080808080808080ull;
+    for (; i + 8 <= data.size(); i += 8) {
+      std::uint64_t word;
+      std::memcpy(&word, data.data() + i, sizeof(word));
+      // Sets the high bit of bytes below 0x21; a borrow can only mark bytes
+      // after a real match, so the lowest mark is exact
+      const std::uint64_t marks = (word - kOnes * (kMaxWhitespace + 1)) & ~word & kHighBits;
+      if (marks != 0) {
+        return i + CountTrailingZeros(marks) / 8;
+      }
+    }
+  }
+  while (i < data.size() && !IsWhitespace(data[i])) {
+    ++i;
+  }
+  return i;
+}
+
+std::string_view TrimWhitespace(std::string_view data) {
+  std::size_t begin = 0;
+  while (begin < data.size() && IsWhitespace(data[begin])) {
+    ++begin;
+  }
+  std::size_t end = data.size();
+  while (end > begin && IsWhitespace(data[end - 1])) {
+    --end;
+  }
+  return data.substr(begin, end - begin);
+}
+
+std::size_t NextPowerOfTwo(std::size_t value) {
+  std::size_t result = 1;
+  while (result < value) {
+    result *= 2;
+  }
+  return result;
+}
+
+}  // namespace
+
+CommandLine SplitCommand(std::string_view request) {
+  CommandLine line;
+  line.trimmed = TrimWhitespace(request);
+  const std::size_t end = FindWhitespace(line.trimmed, 0);
+  line.command = line.trimmed.substr(0, end);
+  line.arguments = TrimWhitespace(line.trimmed.substr(end));
+  return line;
+}
+
+std::uint64_t HashCommand(std::string_view key, std::uint64_t seed) {
+  constexpr std::uint64_t kMultiplier = 0xff51afd7ed558ccdull;
+  std::uint64_t hash = seed ^ (key.size() * 0x9e3779b97f4a7c15ull);
+  const char* data = key.data();
+  std::size_t remaining = key.size();
+  for (; remaining >= 8; data += 8, remaining -= 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 32;
+  }
+  // The tail is read with fixed-size loads, which compile to plain moves
+  if (remaining >= 4) {
+    std::uint32_t low;
+    std::uint32_t high;
+    std::memcpy(&low, data, sizeof(low));
+    std::memcpy(&high, data + remaining - 4, sizeof(high));
+    hash = (hash ^ (low | (std::uint64_t{high} << 32))) * kMultiplier;
+  } else if (remaining > 0) {
+    const std::uint64_t word = static_cast<unsigned char>(data[0]) |
+                               static_cast<unsigned char>(data[remaining / 2]) << 8 |
+                               static_cast<std::uint64_t>(static_cast<unsigned char>(
+                                   data[remaining - 1])) << 16;
+    hash = (hash ^ word) * kMultiplier;
+  }
+  // MurmurHash3 finalizer
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+CommandIndex::CommandIndex(const std::vector<std::string_view>& keys) : size_(keys.size()) {
+  std::unordered_set<std::string_view> unique;
+  for (std::string_view key : keys) {
+    if (!unique.insert(key).second) {
+      throw std::invalid_argument("Duplicate command: " + std::string(key));
+    }
+  }
+  if (keys.empty()) {
+    return;
+  }
+
+  std::size_t slot_count = NextPowerOfTwo(2 * keys.size());
+  for (std::uint64_t attempt = 0;; ++attempt) {
+    if (attempt > 0 && attempt % kSeedsPerTableSize == 0) {
+      slot_count *= 2;
+    }
+    seed_ = HashCommand(std::string_view(), attempt);
+    if (TryBuild(keys, slot_count)) {
+      break;
+    }
+  }
+
+  names_.clear();
+  for (Slot& slot : slots_) {
+    if (slot.value != kEmptySlot) {
+      const std::string_view key = keys[slot.value];
+      slot.offset = static_cast<std::uint32_t>(names_.size());
+      slot.size = static_cast<std::uint32_t>(key.size());
+      names_.append(key.data(), key.size());
+    }
+  }
+}
+
+bool CommandIndex::TryBuild(const std::vector<std::string_view>& keys, std::size_t slot_count) {
+  const std::size_t bucket_count = std::max<std::size_t>(1, slot_count / 2);
+  bucket_mask_ = bucket_count - 1;
+  slot_mask_ = slot_count - 1;
+  slots_.assign(slot_count, Slot());
+  displacements_.assign(bucket_count, Displacement());
+
+  std::vector<std::uint64_t> hashes(keys.size());
+  std::vector<std::vector<std::uint32_t>> buckets(bucket_count);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    hashes[i] = HashCommand(keys[i], seed_);
+    buckets[hashes[i] & bucket_mask_].push_back(static_cast<std::uint32_t>(i));
+  }
+
+  // Crowded buckets are placed first, while the table still has room
+  std::vector<std::size_t> order(bucket_count);
+  for (std::size_t i = 0; i < bucket_count; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&buckets](std::size_t a, std::size_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  std::vector<std::size_t> placed;
+  for (std::size_t bucket : order) {
+    const std::vector<std::uint32_t>& members = buckets[bucket];
+    if (members.empty()) {
+      break;
+    }
+    bool found = false;
+    for (std::size_t attempt = 0; attempt < kMaxDisplacementAttempts && !found; ++attempt) {
+      const Displacement displacement{static_cast<std::uint32_t>(attempt % slot_count),
+                                      static_cast<std::uint32_t>(attempt / slot_count)};
+      placed.clear();
+      found = true;
+      for (std::uint32_t member : members) {
+        const std::size_t slot = SlotOf(hashes[member], displacement);
+        if (slots_[slot].value != kEmptySlot ||
+            std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+          found = false;
+          break;
+        }
+        placed.push_back(slot);
+      }
+      if (found) {
+        displacements_[bucket] = displacement;
+        for (std::size_t i = 0; i < members.size(); ++i) {
+          slots_[placed[i]].value = members[i];
+        }
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t CommandIndex::Find(std::string_view key) const {
+  if (size_ == 0) {
+    return kNotFound;
+  }
+  const std::uint64_t hash = HashCommand(key, seed_);
+  const Slot& slot = slots_[SlotOf(hash, displacements_[hash & bucket_mask_])];
+  if (slot.value == kEmptySlot || slot.size != key.size() ||
+      (slot.size > 0 && std::memcmp(names_.data() + slot.offset, key.data(), key.size()) != 0)) {
+    return kNotFound;
+  }
+  return slot.value;
+}
+
+std::size_t CommandIndex::Size() const {
+  return size_;
+}
+
+std::size_t CommandIndex::SlotOf(std::uint64_t hash, Displacement displacement) const {
+  const std::uint64_t f1 = hash >> 32;
+  const std::uint64_t f2 = ((hash >> 16) & 0xffffffffull) | 1;
+  return static_cast<std::size_t>((f1 + displacement.offset + displacement.step * f2) &
+                                  slot_mask_);
+}
+
+}  // namespace internal
+}  // namespace tcp_server
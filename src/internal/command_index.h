@@ -0,0 +1,134 @@
+/**
+ * @file command_index.h
+ * @brief In-place command token scanning and a perfect-hash command index
+ */
+
+#ifndef TCP_SERVER_INTERNAL_COMMAND_INDEX_H_
+#define TCP_SERVER_INTERNAL_COMMAND_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief A request split into its command token and arguments
+ *
+ * Both are views of the request; nothing is copied.
+ */
+struct CommandLine {
+  std::string_view command;    ///< First token, empty for a blank request
+  std::string_view arguments;  ///< Rest of the request without surrounding whitespace
+  std::string_view trimmed;    ///< Whole request without surrounding whitespace
+};
+
+/**
+ * @brief Split a request at the first whitespace
+ *
+ * Whitespace is any byte up to 0x20 (space, tab, CR, LF and other control
+ * characters). The end of the command token is searched eight bytes at a
+ * time (SWAR) on little-endian targets.
+ * @param request Request payload
+ * @return Views of the command and the arguments
+ */
+CommandLine SplitCommand(std::string_view request);
+
+/**
+ * @brief Hash a command
+ * @param key Command
+ * @param seed Seed selecting the hash function
+ * @return 64-bit hash
+ */
+std::uint64_t HashCommand(std::string_view key, std::uint64_t seed);
+
+/**
+ * @brief Immutable perfect-hash map from commands to their indexes
+ *
+ * Built with hash-and-displace (CHD): keys are grouped into buckets by one
+ * hash, and each bucket gets a displacement that places its keys in free
+ * slots of a table twice the size of the key set. A lookup therefore costs
+ * one hash of the key, two array reads and one comparison, whatever the
+ * number of keys, and never allocates.
+ */
+class CommandIndex {
+ public:
+  static constexpr std::size_t kNotFound = ~std::size_t{0};  ///< Result for unknown keys
+
+  /**
+   * @brief Create an index that contains no key
+   */
+  CommandIndex() = default;
+
+  /**
+   * @brief Build the index
+   * @param keys Keys; the index of each key is its position
+   * @throws std::invalid_argument If a key is duplicated
+   */
+  explicit CommandIndex(const std::vector<std::string_view>& keys);
+
+  /**
+   * @brief Look up a key
+   * @param key Key
+   * @return Position of the key given to the constructor, or kNotFound
+   */
+  std::size_t Find(std::string_view key) const;
+
+  /**
+   * @brief Number of keys
+   * @return Key count
+   */
+  std::size_t Size() const;
+
+ private:
+  static constexpr std::uint32_t kEmptySlot = ~std::uint32_t{0};
+
+  /**
+   * @brief Position of a key in the table
+   */
+  struct Slot {
+    std::uint32_t offset = 0;          ///< Start of the key in names_
+    std::uint32_t size = 0;            ///< Length of the key
+    std::uint32_t value = kEmptySlot;  ///< Index of the key, or kEmptySlot
+  };
+
+  /**
+   * @brief Displacement of one bucket: slot = (f1 + offset + step * f2) & slot_mask_
+   */
+  struct Displacement {
+    std::uint32_t offset = 0;
+    std::uint32_t step = 0;
+  };
+
+  /**
+   * @brief Try to place every key with one hash seed
+   * @param keys Keys
+   * @param slot_count Table size (a power of two)
+   * @return true if every bucket found a displacement
+   */
+  bool TryBuild(const std::vector<std::string_view>& keys, std::size_t slot_count);
+
+  /**
+   * @brief Slot of a hash under a displacement
+   * @param hash Hash of the key
+   * @param displacement Displacement of the key's bucket
+   * @return Slot index
+   */
+  std::size_t SlotOf(std::uint64_t hash, Displacement displacement) const;
+
+  std::string names_;                        ///< Keys, concatenated
+  std::vector<Displacement> displacements_;  ///< Displacement per bucket
+  std::vector<Slot> slots_;                  ///< Table
+  std::uint64_t seed_ = 0;                   ///< Hash seed that placed every key
+  std::uint64_t bucket_mask_ = 0;            ///< Bucket count minus one
+  std::uint64_t slot_mask_ = 0;              ///< Slot count minus one
+  std::size_t size_ = 0;                     ///< Number of keys
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_COMMAND_INDEX_H_
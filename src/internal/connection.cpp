@@ -2,104 +2,1145 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+
+#include "src/internal/socket_tuning.h"
+#include "src/internal/zero_copy.h"
+
 namespace tcp_server {
 namespace internal {
 
 using tcp = boost::asio::ip::tcp;
 
-std::shared_ptr<Connection> Connection::Create(
-    boost::asio::io_context& io_context,
-    MessageHandler message_handler) {
-  return std::shared_ptr<Connection>(
-      new Connection(io_context, std::move(message_handler)));
+namespace {
+
+// Consecutive reads using at most a quarter of the buffer before it shrinks
+constexpr unsigned int kSmallReadsBeforeShrink = 8;
+
+// Bytes of a file read per write where sendfile() cannot be used
+constexpr std::size_t kFileChunkSize = 256 * 1024;
+
+// Cached responses up to this size are copied rather than queued by reference
+constexpr std::size_t kCachedCopyLimit = 512;
+
+// Tag of queued cached responses; topic tags start at 1, so publishing never replaces them
+constexpr std::uint64_t kCachedResponseTag = 0;
+
+}  // namespace
+
+std::unique_ptr<Connection> Connection::Create(
+    const boost::asio::any_io_executor& executor,
+    std::shared_ptr<const ConnectionSettings> settings, TimingWheel* timing_wheel,
+    BufferPool* buffer_pool) {
+  return std::unique_ptr<Connection>(
+      new Connection(executor, std::move(settings), timing_wheel, buffer_pool));
 }
 
-Connection::Connection(boost::asio::io_context& io_context,
-                       MessageHandler message_handler)
-    : socket_(io_context),
-      message_handler_(std::move(message_handler)),
-      read_buffer_(kBufferSize) {}
+Connection::Connection(const boost::asio::any_io_executor& executor,
+                       std::shared_ptr<const ConnectionSettings> settings,
+                       TimingWheel* timing_wheel, BufferPool* buffer_pool)
+    : socket_(executor),
+      settings_(std::move(settings)),
+      buffer_pool_(buffer_pool),
+      read_buffer_target_(buffer_pool_->ClassSize(settings_->read_buffer_size)),
+      timing_wheel_(timing_wheel) {
+  timer_node_.on_expire = &Connection::OnTimerExpired;
+  timer_node_.context = this;
+}
 
-tcp::socket& Connection::GetSocket() {
+Connection::Socket& Connection::GetSocket() {
   return socket_;
 }
 
+Connection::Endpoint& Connection::GetPeerEndpoint() {
+  return peer_endpoint_;
+}
+
+tcp::endpoint Connection::GetRemoteEndpoint() const {
+  return ToTcpEndpoint(peer_endpoint_);
+}
+
+bool Connection::AdmitPeer() {
+  if (settings_->peer_limiter == nullptr || IsLocal(peer_endpoint_)) {
+    return true;
+  }
+  peer_admitted_ = settings_->peer_limiter->Acquire(GetRemoteEndpoint().address());
+  return peer_admitted_;
+}
+
+void Connection::ReleasePeer() {
+  if (peer_admitted_) {
+    peer_admitted_ = false;
+    settings_->peer_limiter->Release(GetRemoteEndpoint().address());
+  }
+}
+
+bool Connection::Register() {
+  id_ = settings_->registry->Add(shared_from_this());
+  return id_ != ConnectionRegistry::kInvalidId;
+}
+
+ConnectionRegistry::Id Connection::GetId() const {
+  return id_;
+}
+
 void Connection::Start() {
-  spdlog::debug("Starting connection from {}:{}",
-                socket_.remote_endpoint().address().to_string(),
-                socket_.remote_endpoint().port());
+  if (settings_->logger->should_log(spdlog::level::debug)) {
+    settings_->logger->debug("Starting connection from {}", DescribeEndpoint(peer_endpoint_));
+  }
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  if (settings_->session_handler) {
+    StartSession();
+    return;
+  }
+#endif
+  if (settings_->idle_timeout_ticks > 0) {
+    idle_deadline_ = timing_wheel_->Now() + settings_->idle_timeout_ticks;
+    ArmTimer();
+  }
+
+  // HandleReadable() reads without blocking after a readiness wait
+  boost::system::error_code ec;
+  socket_.non_blocking(true, ec);
+  if (ec) {
+    settings_->logger->error("Error setting non-blocking mode: {}", ec.message());
+    Stop();
+    return;
+  }
+  ConfigureAccepted(socket_, peer_endpoint_.protocol(), settings_->socket_options, ec);
+  if (ec) {
+    settings_->logger->debug("Error setting socket options: {}", ec.message());
+  }
+#if defined(TCP_SERVER_HAS_TLS)
+  if (settings_->tls != nullptr) {
+    StartHandshake();
+    return;
+  }
+#endif
   StartRead();
 }
 
 void Connection::Stop() {
+  timing_wheel_->Cancel(&timer_node_);
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  if (session_timer_ != nullptr) {
+    session_timer_->cancel();
+  }
+#endif
+
   boost::system::error_code ec;
   socket_.close(ec);
   if (ec) {
-    spdlog::error("Error closing socket: {}", ec.message());
+    settings_->logger->error("Error closing socket: {}", ec.message());
+  }
+
+  // Give the slots back as soon as the socket is closed
+  ReleasePeer();
+  if (id_ != ConnectionRegistry::kInvalidId) {
+    const ConnectionRegistry::Id id = id_;
+    id_ = ConnectionRegistry::kInvalidId;
+    settings_->topics->UnsubscribeAll(id);
+    settings_->registry->Remove(id);
+  }
+}
+
+void Connection::Deliver(std::shared_ptr<const std::string> payload, std::uint64_t tag) {
+  if (!socket_.is_open()) {
+    return;
+  }
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  if (settings_->session_handler) {
+    return;
+  }
+#endif
+
+  if (write_queue_.Size() >= settings_->slow_subscriber_limit) {
+    switch (settings_->slow_subscriber_policy) {
+      case SlowSubscriberPolicy::kDrop:
+        settings_->metrics->Add(ServerMetrics::kMessagesDropped);
+        return;
+      case SlowSubscriberPolicy::kConflate:
+        // Only the newest message of the topic is worth sending
+        if (write_queue_.ReplaceShared(payload, tag)) {
+          settings_->metrics->Add(ServerMetrics::kMessagesDropped);
+          return;
+        }
+        break;
+      case SlowSubscriberPolicy::kDisconnect:
+        settings_->logger->info("Closing slow subscriber with {} bytes queued",
+                                write_queue_.Size());
+        settings_->metrics->Add(ServerMetrics::kSlowSubscribersDisconnected);
+        Stop();
+        return;
+    }
+  }
+
+  write_queue_.AppendShared(std::move(payload), tag);
+  settings_->metrics->Add(ServerMetrics::kMessagesPublished);
+  StartWrite();
+}
+
+void Connection::Drain() {
+  if (!socket_.is_open()) {
+    return;
+  }
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  if (settings_->session_handler) {
+    return;
+  }
+#endif
+  draining_ = true;
+  CloseIfDrained();
+}
+
+void Connection::Reset() {
+  timing_wheel_->Cancel(&timer_node_);
+  idle_deadline_ = 0;
+  read_deadline_ = 0;
+  write_deadline_ = 0;
+
+  boost::system::error_code ec;
+  socket_.close(ec);
+
+  buffer_pool_->Release(read_buffer_);
+  read_size_ = 0;
+  frame_scanned_ = 0;
+  read_buffer_target_ = buffer_pool_->ClassSize(settings_->read_buffer_size);
+  small_reads_ = 0;
+  read_buffer_filled_ = false;
+  write_queue_.Clear();
+  bodies_.clear();
+  write_offset_ = 0;
+  copy_file_ = false;
+  std::string().swap(file_chunk_);
+  file_chunk_offset_ = 0;
+  zero_copy_enabled_ = false;
+  zero_copy_unavailable_ = false;
+  zero_copy_sequence_ = 0;
+  zero_copy_first_ = 0;
+  zero_copy_waiting_ = false;
+#if defined(TCP_SERVER_HAS_TLS)
+  tls_.Reset();
+  tls_handshaking_ = false;
+  tls_kernel_send_ = false;
+  tls_kernel_receive_ = false;
+#endif
+  pending_requests_.clear();
+  handler_running_ = false;
+  read_paused_ = false;
+  close_after_write_ = false;
+  draining_ = false;
+  id_ = ConnectionRegistry::kInvalidId;
+  ReleasePeer();
+  peer_endpoint_ = Endpoint();
+}
+
+#if defined(TCP_SERVER_HAS_COROUTINES)
+void Connection::StartSession() {
+  auto self = shared_from_this();
+  boost::asio::co_spawn(
+      socket_.get_executor(),
+      [self]() -> boost::asio::awaitable<void> {
+        Session session(*self);
+        co_await self->settings_->session_handler(session);
+      },
+      [self](std::exception_ptr exception) {
+        if (exception) {
+          try {
+            std::rethrow_exception(exception);
+          } catch (const boost::system::system_error& ex) {
+            if (ex.code() != boost::asio::error::operation_aborted) {
+              self->settings_->logger->error("Session error: {}", ex.what());
+            }
+            self->settings_->metrics->AddError(ex.code());
+          } catch (const FramingError& ex) {
+            self->settings_->logger->error("Framing error: {}", ex.what());
+            self->settings_->metrics->AddError(ServerMetrics::kFramingError);
+          } catch (const std::exception& ex) {
+            self->settings_->logger->error("Error in session handler: {}", ex.what());
+            self->settings_->metrics->AddError(ServerMetrics::kHandlerError);
+          }
+        }
+        self->Stop();
+      });
+}
+#endif
+
+#if defined(TCP_SERVER_HAS_TLS)
+void Connection::StartHandshake() {
+  try {
+    tls_.Start(*settings_->tls, socket_.native_handle());
+  } catch (const std::exception& ex) {
+    settings_->logger->error("TLS error: {}", ex.what());
+    Stop();
+    return;
+  }
+  tls_handshaking_ = true;
+  if (settings_->read_timeout_ticks > 0) {
+    read_deadline_ = timing_wheel_->Now() + settings_->read_timeout_ticks;
+    ArmTimer();
+  }
+  HandleHandshake(boost::system::error_code());
+}
+
+void Connection::HandleHandshake(const boost::system::error_code& error) {
+  boost::system::error_code handshake_error = error;
+  if (!handshake_error && !tls_.Handshake(handshake_error) &&
+      handshake_error == boost::asio::error::would_block) {
+    auto self = shared_from_this();
+    socket_.async_wait(tls_.WaitType(), [self](const boost::system::error_code& wait_error) {
+      self->HandleHandshake(wait_error);
+    });
+    return;
+  }
+  if (handshake_error == boost::asio::error::operation_aborted && !socket_.is_open()) {
+    // Closed locally by Stop(): timeout, drain or shutdown
+    return;
+  }
+  if (handshake_error) {
+    settings_->logger->info("TLS handshake failed: {}", handshake_error.message());
+    settings_->metrics->AddError(handshake_error);
+    Stop();
+    return;
+  }
+
+  tls_handshaking_ = false;
+  tls_kernel_send_ = tls_.KernelSend();
+  tls_kernel_receive_ = tls_.KernelReceive();
+  settings_->metrics->Add(ServerMetrics::kTlsHandshakes);
+  if (tls_.Resumed()) {
+    settings_->metrics->Add(ServerMetrics::kTlsSessionsResumed);
+  }
+  if (tls_kernel_send_) {
+    settings_->metrics->Add(ServerMetrics::kTlsKernelOffloads);
+  }
+  settings_->logger->debug("TLS handshake complete (resumed: {}, kTLS send: {}, receive: {})",
+                           tls_.Resumed(), tls_kernel_send_, tls_kernel_receive_);
+  if (settings_->read_timeout_ticks > 0) {
+    read_deadline_ = 0;
+    ArmTimer();
+  }
+
+  StartRead();
+  // Send anything published while the handshake was running
+  StartWrite();
+}
+#endif
+
+bool Connection::UsesTls() const {
+#if defined(TCP_SERVER_HAS_TLS)
+  return tls_.IsActive();
+#else
+  return false;
+#endif
+}
+
+bool Connection::ReadsThroughTls() const {
+#if defined(TCP_SERVER_HAS_TLS)
+  // Even with kTLS, records OpenSSL read during the handshake are still in its buffer
+  return tls_.IsActive() && (!tls_kernel_receive_ || tls_.HasPending());
+#else
+  return false;
+#endif
+}
+
+bool Connection::WritesThroughTls() const {
+#if defined(TCP_SERVER_HAS_TLS)
+  return tls_.IsActive() && !tls_kernel_send_;
+#else
+  return false;
+#endif
+}
+
+std::size_t Connection::ReadSome(const boost::asio::mutable_buffer& buffer,
+                                 boost::system::error_code& error) {
+#if defined(TCP_SERVER_HAS_TLS)
+  if (ReadsThroughTls()) {
+    return tls_.Read(buffer.data(), buffer.size(), error);
   }
+#endif
+  return socket_.read_some(buffer, error);
 }
 
 void Connection::StartRead() {
+  // A draining connection only reads to complete a partial frame
+  if (draining_ && read_size_ == 0) {
+    CloseIfDrained();
+    return;
+  }
+
   auto self = shared_from_this();
+#if defined(TCP_SERVER_HAS_TLS)
+  if (ReadsThroughTls()) {
+    // Records OpenSSL already took off the socket do not make it readable again
+    if (tls_.HasPending()) {
+      boost::asio::post(socket_.get_executor(),
+                        [self] { self->HandleReadable(boost::system::error_code()); });
+      return;
+    }
+    if (read_size_ == 0) {
+      buffer_pool_->Release(read_buffer_);
+    }
+    socket_.async_wait(tls_.WaitType(), [self](const boost::system::error_code& error) {
+      self->HandleReadable(error);
+    });
+    return;
+  }
+#endif
+#if defined(TCP_SERVER_HAS_IO_URING)
+  // io_uring completes the read itself, so even a drained socket reads into a
+  // borrowed buffer; waiting for readiness first would add a second completion
+#else
+  if (read_size_ == 0 && !read_buffer_filled_) {
+    // The socket is drained: hold no buffer until more data arrives
+    buffer_pool_->Release(read_buffer_);
+    socket_.async_wait(Socket::wait_read, [self](const boost::system::error_code& error) {
+      self->HandleReadable(error);
+    });
+    return;
+  }
+#endif
+
+  try {
+    PrepareReadBuffer();
+  } catch (const FramingError& ex) {
+    settings_->logger->error("Framing error: {}", ex.what());
+    settings_->metrics->AddError(ServerMetrics::kFramingError);
+    Stop();
+    return;
+  }
   socket_.async_read_some(
-      boost::asio::buffer(read_buffer_),
+      boost::asio::buffer(read_buffer_.data.get() + read_size_, read_buffer_.size - read_size_),
       [self](const boost::system::error_code& error, std::size_t bytes_transferred) {
         self->HandleRead(error, bytes_transferred);
       });
 }
 
+void Connection::HandleReadable(const boost::system::error_code& error) {
+  if (error || !socket_.is_open()) {
+    HandleRead(error ? error : boost::asio::error::operation_aborted, 0);
+    return;
+  }
+
+  // Plain reads only get here with nothing buffered, so this only borrows a
+  // buffer of the adaptive size; TLS reads also wait here with a partial frame
+  try {
+    PrepareReadBuffer();
+  } catch (const FramingError& ex) {
+    settings_->logger->error("Framing error: {}", ex.what());
+    settings_->metrics->AddError(ServerMetrics::kFramingError);
+    Stop();
+    return;
+  }
+  boost::system::error_code read_error;
+  const std::size_t bytes_transferred =
+      ReadSome(boost::asio::buffer(read_buffer_.data.get() + read_size_,
+                                   read_buffer_.size - read_size_),
+               read_error);
+  if (read_error == boost::asio::error::would_block ||
+      read_error == boost::asio::error::try_again) {
+    StartRead();
+    return;
+  }
+  HandleRead(read_error, bytes_transferred);
+}
+
 void Connection::HandleRead(const boost::system::error_code& error,
                             std::size_t bytes_transferred) {
   if (!error) {
-    // Convert data to string
-    std::string received_data(read_buffer_.data(), bytes_transferred);
-    spdlog::debug("Received: {}", received_data);
+    AdaptReadBufferSize(read_buffer_.size - read_size_, bytes_transferred);
+    read_size_ += bytes_transferred;
+    settings_->metrics->Add(ServerMetrics::kReadOperations);
+    settings_->metrics->Add(ServerMetrics::kBytesReceived, bytes_transferred);
 
     try {
-      // Call message handler
-      std::string response = message_handler_(received_data);
-      // Send response
-      StartWrite(response);
+      // Handle every complete frame received so far and queue the responses
+      ProcessFrames();
+      DispatchRequest();
+      StartWrite();
+    } catch (const FramingError& ex) {
+      settings_->logger->error("Framing error: {}", ex.what());
+      settings_->metrics->AddError(ServerMetrics::kFramingError);
+      Stop();
+      return;
     } catch (const std::exception& ex) {
-      spdlog::error("Error processing message: {}", ex.what());
+      settings_->logger->error("Error processing message: {}", ex.what());
+      settings_->metrics->AddError(ServerMetrics::kHandlerError);
       Stop();
       return;
     }
 
+    // Traffic restarts the idle clock; a buffered partial frame starts the read clock
+    if (settings_->idle_timeout_ticks > 0 || settings_->read_timeout_ticks > 0) {
+      const std::uint64_t now = timing_wheel_->Now();
+      if (settings_->idle_timeout_ticks > 0) {
+        idle_deadline_ = now + settings_->idle_timeout_ticks;
+      }
+      if (settings_->read_timeout_ticks > 0) {
+        if (read_size_ == 0) {
+          read_deadline_ = 0;
+        } else if (read_deadline_ == 0) {
+          read_deadline_ = now + settings_->read_timeout_ticks;
+        }
+      }
+      ArmTimer();
+    }
+
+    // Push back on the client while too much output or work is queued
+    if (ShouldPauseRead()) {
+      settings_->logger->debug("Write queue or pending requests above limit, pausing reads");
+      read_paused_ = true;
+      return;
+    }
+
     // Start next read
     StartRead();
+  } else if (error == boost::asio::error::eof &&
+             (write_queue_.Size() > 0 || write_queue_.HasParked() || HasPendingRequests())) {
+    // Peer finished sending; flush the remaining responses before closing
+    close_after_write_ = true;
+  } else if (error == boost::asio::error::operation_aborted && !socket_.is_open()) {
+    // Closed locally by Stop(): timeout, drain or shutdown
   } else if (error == boost::asio::error::eof ||
              error == boost::asio::error::connection_reset) {
     // Connection closed by peer
-    spdlog::info("Connection closed by peer");
+    settings_->logger->info("Connection closed by peer");
+    settings_->metrics->AddError(error);
     Stop();
   } else {
     // Other error
-    spdlog::error("Read error: {}", error.message());
+    settings_->logger->error("Read error: {}", error.message());
+    settings_->metrics->AddError(error);
     Stop();
   }
 }
 
-void Connection::StartWrite(const std::string& data) {
+void Connection::ProcessFrames() {
+  const Framer& framer = *settings_->framer;
+  std::size_t offset = 0;
+  while (offset < read_size_) {
+    std::string_view payload;
+    const std::size_t consumed = framer.ExtractFrom(
+        std::string_view(read_buffer_.data.get() + offset, read_size_ - offset), &payload,
+        &frame_scanned_);
+    if (consumed == 0) {
+      break;
+    }
+    offset += consumed;
+
+#if defined(TCP_SERVER_LOG_PAYLOADS)
+    settings_->logger->debug("Received: {}", payload);
+#endif
+
+    // The payload only lives in the read buffer, so offloaded requests are copied.
+    // A cached response can skip the pool while no earlier response is outstanding;
+    // a miss is counted when the pool thread looks the request up again
+    if (settings_->handler_pool) {
+      if (settings_->response_cache != nullptr && !HasPendingRequests()) {
+        ResponseCache::Lookup cached = settings_->response_cache->Find(payload);
+        if (cached.response) {
+          settings_->metrics->Add(ServerMetrics::kResponseCacheHits);
+          QueueCached(std::move(cached.response));
+          continue;
+        }
+      }
+      pending_requests_.emplace_back(payload);
+      continue;
+    }
+
+    // Repeated requests are answered from the response cache without the handler
+    ResponseCache::Lookup cached = FindCached(payload);
+    if (cached.response) {
+      QueueCached(std::move(cached.response));
+      continue;
+    }
+
+    // Call message handler, which writes its response straight into the write queue
+    InvokeHandler(payload, cached, write_queue_.Tail(), &bodies_, id_);
+    for (auto& body : bodies_) {
+      write_queue_.AppendBody(std::move(body));
+    }
+    bodies_.clear();
+  }
+
+  // Keep the incomplete tail at the front of the buffer
+  if (offset > 0) {
+    std::copy(read_buffer_.data.get() + offset, read_buffer_.data.get() + read_size_,
+              read_buffer_.data.get());
+    read_size_ -= offset;
+  }
+}
+
+ResponseCache::Lookup Connection::FindCached(std::string_view request) const {
+  if (settings_->response_cache == nullptr) {
+    return {};
+  }
+  ResponseCache::Lookup cached = settings_->response_cache->Find(request);
+  if (cached.response) {
+    settings_->metrics->Add(ServerMetrics::kResponseCacheHits);
+  } else if (!cached.key.empty()) {
+    settings_->metrics->Add(ServerMetrics::kResponseCacheMisses);
+  }
+  return cached;
+}
+
+void Connection::QueueCached(std::shared_ptr<const std::string> response) {
+  if (response->size() <= kCachedCopyLimit) {
+    write_queue_.Tail()->append(*response);
+  } else {
+    write_queue_.AppendShared(std::move(response), kCachedResponseTag);
+  }
+}
+
+void Connection::InvokeHandler(std::string_view request, const ResponseCache::Lookup& cached,
+                               std::string* output, std::vector<ResponseBody>* bodies,
+                               ConnectionRegistry::Id id) const {
+  const Framer& framer = *settings_->framer;
+  const std::size_t start = framer.BeginFrame(output);
+  const std::size_t body_count = bodies->size();
+  ResponseWriter writer(output, id, bodies);
+  if (settings_->measure_handler_time) {
+    const auto handler_start = std::chrono::steady_clock::now();
+    settings_->message_handler(request, writer);
+    const auto handler_end = std::chrono::steady_clock::now();
+    settings_->metrics->RecordHandlerTime(
+        static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       handler_end - handler_start).count()),
+        handler_end);
+  } else {
+    settings_->message_handler(request, writer);
+  }
+  settings_->metrics->Add(ServerMetrics::kHandlerInvocations);
+  if (bodies->size() == body_count) {
+    framer.EndFrame(output, start);
+  } else {
+    // The frame spans the bodies, so anything the framer puts after them is sent as one more
+    std::uint64_t body_size = 0;
+    for (auto it = bodies->begin() + body_count; it != bodies->end(); ++it) {
+      body_size += it->size;
+    }
+    auto trailer = std::make_shared<std::string>();
+    framer.EndFrameWithBodies(output, start, body_size, trailer.get());
+    if (!trailer->empty()) {
+      bodies->push_back(ResponseBody{trailer->data(), -1, 0, trailer->size(), trailer});
+    }
+  }
+
+  // Bodies refer to memory and files the cache cannot keep
+  if (!cached.key.empty() && writer.cacheable_ && bodies->size() == body_count) {
+    settings_->response_cache->Insert(
+        cached, std::string_view(*output).substr(start),
+        writer.cache_ttl_.value_or(settings_->response_cache->DefaultTtl()));
+  }
+}
+
+void Connection::DispatchRequest() {
+  if (handler_running_ || pending_requests_.empty()) {
+    return;
+  }
+  handler_running_ = true;
+
   auto self = shared_from_this();
-  write_buffer_ = data;
-  spdlog::debug("Sending: {}", write_buffer_);
+  settings_->handler_pool->Submit(
+      [self, request = std::move(pending_requests_.front()), id = id_] {
+        std::string response;
+        std::vector<ResponseBody> bodies;
+        bool failed = false;
+        try {
+          const ResponseCache::Lookup cached = self->FindCached(request);
+          if (cached.response) {
+            response = *cached.response;
+          } else {
+            self->InvokeHandler(request, cached, &response, &bodies, id);
+          }
+        } catch (const FramingError& ex) {
+          self->settings_->logger->error("Framing error: {}", ex.what());
+          self->settings_->metrics->AddError(ServerMetrics::kFramingError);
+          failed = true;
+        } catch (const std::exception& ex) {
+          self->settings_->logger->error("Error processing message: {}", ex.what());
+          self->settings_->metrics->AddError(ServerMetrics::kHandlerError);
+          failed = true;
+        }
+
+        // Back to the connection's executor to queue the response
+        boost::asio::post(self->socket_.get_executor(),
+                          [self, response = std::move(response), bodies = std::move(bodies),
+                           failed]() mutable {
+                            self->HandleResponse(std::move(response), std::move(bodies), failed);
+                          });
+      });
+  pending_requests_.pop_front();
+}
+
+void Connection::HandleResponse(std::string response, std::vector<ResponseBody> bodies,
+                                bool failed) {
+  handler_running_ = false;
+  if (!socket_.is_open()) {
+    return;
+  }
+  if (failed) {
+    Stop();
+    return;
+  }
+
+  write_queue_.Tail()->append(response);
+  for (auto& body : bodies) {
+    write_queue_.AppendBody(std::move(body));
+  }
+  DispatchRequest();
+  StartWrite();
+  CheckFlowControl();
+}
+
+bool Connection::HasPendingRequests() const {
+  return handler_running_ || !pending_requests_.empty();
+}
+
+bool Connection::ShouldPauseRead() const {
+  return write_queue_.Size() >= settings_->write_high_watermark ||
+         (settings_->handler_pool &&
+          pending_requests_.size() >= settings_->max_pending_requests);
+}
+
+void Connection::CheckFlowControl() {
+  if (CloseIfDrained()) {
+    return;
+  }
+  if (close_after_write_) {
+    // Parked zero-copy pages may not have been sent yet; closing would release them
+    if (!write_queue_.IsWriting() && !write_queue_.HasParked() && !HasPendingRequests()) {
+      settings_->logger->info("Connection closed by peer");
+      Stop();
+    }
+  } else if (read_paused_ && write_queue_.Size() <= settings_->write_low_watermark &&
+             !(settings_->handler_pool &&
+               pending_requests_.size() >= settings_->max_pending_requests)) {
+    settings_->logger->debug("Write queue and pending requests below limit, resuming reads");
+    read_paused_ = false;
+    StartRead();
+  }
+}
+
+bool Connection::CloseIfDrained() {
+  if (!draining_ || read_size_ > 0 || write_queue_.IsWriting() || write_queue_.HasQueued() ||
+      write_queue_.HasParked() || HasPendingRequests()) {
+    return false;
+  }
+  settings_->logger->debug("Closing drained connection");
+  Stop();
+  return true;
+}
 
+void Connection::ArmTimer() {
+  std::uint64_t deadline = 0;
+  for (std::uint64_t candidate : {idle_deadline_, read_deadline_, write_deadline_}) {
+    if (candidate != 0 && (deadline == 0 || candidate < deadline)) {
+      deadline = candidate;
+    }
+  }
+
+  if (deadline == 0) {
+    timing_wheel_->Cancel(&timer_node_);
+  } else {
+    timing_wheel_->Schedule(&timer_node_, deadline);
+  }
+}
+
+void Connection::OnTimerExpired(void* context) {
+  // Runs on the wheel's thread with the wheel locked
+  auto self = static_cast<Connection*>(context)->weak_from_this().lock();
+  if (self) {
+    boost::asio::post(self->socket_.get_executor(), [self] { self->HandleTimeout(); });
+  }
+}
+
+void Connection::HandleTimeout() {
+  if (!socket_.is_open()) {
+    return;
+  }
+
+  const std::uint64_t now = timing_wheel_->Now();
+  const char* expired = nullptr;
+  if (write_deadline_ != 0 && now >= write_deadline_) {
+    expired = "write";
+  } else if (read_deadline_ != 0 && now >= read_deadline_) {
+    expired = "read";
+  } else if (idle_deadline_ != 0 && now >= idle_deadline_) {
+    // Not idle while a response is still being produced or sent
+    if (write_queue_.IsWriting() || HasPendingRequests()) {
+      idle_deadline_ = now + settings_->idle_timeout_ticks;
+    } else {
+      expired = "idle";
+    }
+  }
+
+  if (expired == nullptr) {
+    ArmTimer();
+    return;
+  }
+
+  settings_->logger->info("Closing connection after {} timeout", expired);
+  settings_->metrics->Add(ServerMetrics::kConnectionsTimedOut);
+  Stop();
+}
+
+void Connection::PrepareReadBuffer() {
+  if (read_size_ == 0) {
+    // Nothing buffered: switch to the adaptive size for free
+    if (read_buffer_ && read_buffer_.size != read_buffer_target_) {
+      buffer_pool_->Release(read_buffer_);
+    }
+    if (!read_buffer_) {
+      read_buffer_ = buffer_pool_->Acquire(read_buffer_target_);
+    }
+    return;
+  }
+  if (read_size_ < read_buffer_.size) {
+    return;
+  }
+
+  // A partial frame fills the buffer: grow it up to the framer's limit
+  const std::size_t max_size = settings_->framer->MaxFrameSize();
+  if (read_buffer_.size >= max_size) {
+    throw FramingError("Frame exceeds maximum size of " + std::to_string(max_size) + " bytes");
+  }
+  PooledBuffer larger = buffer_pool_->Acquire(std::min(read_buffer_.size * 2, max_size));
+  std::copy(read_buffer_.data.get(), read_buffer_.data.get() + read_size_, larger.data.get());
+  buffer_pool_->Release(read_buffer_);
+  read_buffer_ = std::move(larger);
+}
+
+void Connection::AdaptReadBufferSize(std::size_t available, std::size_t bytes_transferred) {
+  read_buffer_filled_ = bytes_transferred == available;
+  if (read_buffer_filled_) {
+    small_reads_ = 0;
+    read_buffer_target_ = std::min(read_buffer_target_ * 2,
+                                   buffer_pool_->ClassSize(settings_->max_read_buffer_size));
+  } else if (bytes_transferred <= read_buffer_target_ / 4) {
+    if (++small_reads_ >= kSmallReadsBeforeShrink) {
+      small_reads_ = 0;
+      read_buffer_target_ = std::max(read_buffer_target_ / 2,
+                                     buffer_pool_->ClassSize(settings_->min_read_buffer_size));
+    }
+  } else {
+    small_reads_ = 0;
+  }
+}
+
+void Connection::StartWrite() {
+  if (write_queue_.IsWriting() || !write_queue_.HasQueued() || !socket_.is_open()) {
+    return;
+  }
+#if defined(TCP_SERVER_HAS_TLS)
+  if (tls_handshaking_) {
+    return;
+  }
+#endif
+
+  if (settings_->write_timeout_ticks > 0) {
+    write_deadline_ = timing_wheel_->Now() + settings_->write_timeout_ticks;
+    ArmTimer();
+  }
+
+  const BufferSequence buffers = write_queue_.BeginWrite();
+  write_offset_ = 0;
+  if (write_queue_.WritingFile() != nullptr) {
+    // Without kTLS, file bytes have to pass through OpenSSL
+    copy_file_ = WritesThroughTls();
+    file_chunk_.clear();
+    ContinueFileWrite();
+    return;
+  }
+  if (WritesThroughTls()) {
+#if defined(TCP_SERVER_HAS_TLS)
+    ContinueTlsWrite();
+#endif
+    return;
+  }
+  // MSG_ZEROCOPY completions are not reported for kTLS sockets
+  if (settings_->zero_copy_threshold > 0 && !UsesTls() &&
+      write_queue_.LargestWritingPinned() >= settings_->zero_copy_threshold && EnableZeroCopy()) {
+    zero_copy_first_ = zero_copy_sequence_;
+    ContinueZeroCopyWrite();
+    return;
+  }
+
+  auto self = shared_from_this();
   boost::asio::async_write(
       socket_,
-      boost::asio::buffer(write_buffer_),
+      buffers,
       [self](const boost::system::error_code& error, std::size_t bytes_transferred) {
         self->HandleWrite(error, bytes_transferred);
       });
 }
 
+void Connection::ContinueFileWrite() {
+  const ResponseBody& body = *write_queue_.WritingFile();
+  auto self = shared_from_this();
+  boost::system::error_code error;
+  while (write_offset_ < body.size) {
+    const std::uint64_t offset = body.offset + write_offset_;
+    const std::size_t remaining =
+        static_cast<std::size_t>(std::min<std::uint64_t>(body.size - write_offset_, SIZE_MAX));
+
+    if (!copy_file_) {
+      write_offset_ += SendFileRange(socket_.native_handle(), body.fd, offset, remaining, error);
+      if (!error) {
+        continue;
+      }
+      if (error == boost::asio::error::would_block) {
+        socket_.async_wait(Socket::wait_write,
+                           [self](const boost::system::error_code& wait_error) {
+                             if (wait_error) {
+                               self->HandleWrite(wait_error, self->write_offset_);
+                             } else {
+                               self->ContinueFileWrite();
+                             }
+                           });
+        return;
+      }
+      if (error != boost::asio::error::operation_not_supported) {
+        HandleWrite(error, write_offset_);
+        return;
+      }
+      copy_file_ = true;
+      continue;
+    }
+
+    // sendfile() is unavailable: copy the file through user space one chunk at a time
+    if (offset < file_chunk_offset_ || offset - file_chunk_offset_ >= file_chunk_.size()) {
+      file_chunk_.resize(std::min(remaining, kFileChunkSize));
+      const std::size_t read =
+          ReadFileAt(body.fd, offset, &file_chunk_[0], file_chunk_.size(), error);
+      if (!error && read == 0) {
+        error = boost::asio::error::eof;
+      }
+      if (error) {
+        HandleWrite(error, write_offset_);
+        return;
+      }
+      file_chunk_.resize(read);
+      file_chunk_offset_ = offset;
+    }
+    const std::size_t skip = static_cast<std::size_t>(offset - file_chunk_offset_);
+    const boost::asio::const_buffer chunk(file_chunk_.data() + skip, file_chunk_.size() - skip);
+#if defined(TCP_SERVER_HAS_TLS)
+    if (WritesThroughTls()) {
+      // OpenSSL sends a record at a time; the rest of the chunk stays for the next call
+      write_offset_ += tls_.Write(chunk.data(), chunk.size(), error);
+      if (!error) {
+        continue;
+      }
+      if (error == boost::asio::error::would_block) {
+        socket_.async_wait(tls_.WaitType(), [self](const boost::system::error_code& wait_error) {
+          if (wait_error) {
+            self->HandleWrite(wait_error, self->write_offset_);
+          } else {
+            self->ContinueFileWrite();
+          }
+        });
+        return;
+      }
+      HandleWrite(error, write_offset_);
+      return;
+    }
+#endif
+    boost::asio::async_write(
+        socket_, chunk,
+        [self](const boost::system::error_code& write_error, std::size_t bytes_transferred) {
+          self->write_offset_ += bytes_transferred;
+          if (write_error) {
+            self->HandleWrite(write_error, self->write_offset_);
+          } else {
+            self->ContinueFileWrite();
+          }
+        });
+    return;
+  }
+  PostWriteCompletion(write_offset_);
+}
+
+void Connection::ContinueZeroCopyWrite() {
+  const BufferSequence buffers = write_queue_.Writing();
+  auto self = shared_from_this();
+  boost::system::error_code error;
+  bool done = false;
+  while (!done) {
+    std::size_t sent = SendBuffers(socket_.native_handle(), buffers.begin(), buffers.end(),
+                                   write_offset_, true, error);
+    if (!error) {
+      ++zero_copy_sequence_;
+    } else if (error == boost::asio::error::no_buffer_space) {
+      // The kernel limits the pages pinned per socket; copy this part instead
+      sent = SendBuffers(socket_.native_handle(), buffers.begin(), buffers.end(), write_offset_,
+                         false, error);
+    }
+    if (error == boost::asio::error::would_block) {
+      socket_.async_wait(Socket::wait_write,
+                         [self](const boost::system::error_code& wait_error) {
+                           if (wait_error) {
+                             self->HandleWrite(wait_error, self->write_offset_);
+                           } else {
+                             self->ContinueZeroCopyWrite();
+                           }
+                         });
+      return;
+    }
+    if (error) {
+      HandleWrite(error, write_offset_);
+      return;
+    }
+
+    write_offset_ += sent;
+    std::size_t total = 0;
+    for (const auto& buffer : buffers) {
+      total += buffer.size();
+    }
+    done = write_offset_ >= total;
+  }
+
+  // Keep the batch until the kernel reports that it is done with the pages
+  if (zero_copy_sequence_ != zero_copy_first_) {
+    write_queue_.ParkWriting(zero_copy_first_, zero_copy_sequence_ - 1);
+    WaitZeroCopy();
+  }
+  PostWriteCompletion(write_offset_);
+}
+
+#if defined(TCP_SERVER_HAS_TLS)
+void Connection::ContinueTlsWrite() {
+  const BufferSequence buffers = write_queue_.Writing();
+  auto self = shared_from_this();
+  boost::system::error_code error;
+  std::uint64_t skip = write_offset_;
+  for (const auto& buffer : buffers) {
+    if (skip >= buffer.size()) {
+      skip -= buffer.size();
+      continue;
+    }
+    while (skip < buffer.size()) {
+      const std::size_t size = buffer.size() - static_cast<std::size_t>(skip);
+      const std::size_t sent =
+          tls_.Write(static_cast<const char*>(buffer.data()) + skip, size, error);
+      if (error == boost::asio::error::would_block) {
+        // Called again with the same bytes, as OpenSSL requires
+        socket_.async_wait(tls_.WaitType(), [self](const boost::system::error_code& wait_error) {
+          if (wait_error) {
+            self->HandleWrite(wait_error, self->write_offset_);
+          } else {
+            self->ContinueTlsWrite();
+          }
+        });
+        return;
+      }
+      if (error) {
+        HandleWrite(error, write_offset_);
+        return;
+      }
+      skip += sent;
+      write_offset_ += sent;
+    }
+    skip = 0;
+  }
+  PostWriteCompletion(write_offset_);
+}
+#endif
+
+bool Connection::EnableZeroCopy() {
+  if (!zero_copy_enabled_ && !zero_copy_unavailable_) {
+    zero_copy_enabled_ = EnableZeroCopySend(socket_.native_handle());
+    zero_copy_unavailable_ = !zero_copy_enabled_;
+    if (zero_copy_unavailable_) {
+      settings_->logger->debug("MSG_ZEROCOPY is unavailable, sending pinned bodies normally");
+    }
+  }
+  return zero_copy_enabled_;
+}
+
+void Connection::WaitZeroCopy() {
+  if (zero_copy_waiting_ || !write_queue_.HasParked()) {
+    return;
+  }
+  zero_copy_waiting_ = true;
+  auto self = shared_from_this();
+  socket_.async_wait(Socket::wait_error, [self](const boost::system::error_code& error) {
+    self->HandleZeroCopyCompletion(error);
+  });
+}
+
+void Connection::HandleZeroCopyCompletion(const boost::system::error_code& error) {
+  zero_copy_waiting_ = false;
+  if (!socket_.is_open()) {
+    // Stop() released the parked batches with the socket
+    return;
+  }
+  if (error) {
+    settings_->logger->error("Zero-copy completion error: {}", error.message());
+    settings_->metrics->AddError(error);
+    Stop();
+    return;
+  }
+
+  boost::system::error_code read_error;
+  const std::size_t ranges = ReadZeroCopyCompletions(
+      socket_.native_handle(),
+      [this](std::uint32_t low, std::uint32_t high) { write_queue_.ReleaseParked(low, high); },
+      read_error);
+  if (read_error) {
+    settings_->logger->error("Zero-copy completion error: {}", read_error.message());
+    settings_->metrics->AddError(read_error);
+    Stop();
+    return;
+  }
+  if (ranges == 0 && HasHungUp(socket_.native_handle())) {
+    // The wait would complete at once forever; nobody is left to send to
+    settings_->logger->info("Connection closed by peer");
+    Stop();
+    return;
+  }
+
+  WaitZeroCopy();
+  CheckFlowControl();
+}
+
+void Connection::PostWriteCompletion(std::size_t bytes_transferred) {
+  auto self = shared_from_this();
+  boost::asio::post(socket_.get_executor(), [self, bytes_transferred] {
+    self->HandleWrite(boost::system::error_code(), bytes_transferred);
+  });
+}
+
 void Connection::HandleWrite(const boost::system::error_code& error,
-                             std::size_t /*bytes_transferred*/) {
+                             std::size_t bytes_transferred) {
+  write_queue_.EndWrite();
+  if (error == boost::asio::error::operation_aborted && !socket_.is_open()) {
+    // Closed locally by Stop()
+    return;
+  }
   if (error) {
-    spdlog::error("Write error: {}", error.message());
+    settings_->logger->error("Write error: {}", error.message());
+    settings_->metrics->AddError(error);
     Stop();
+    return;
   }
+  settings_->metrics->Add(ServerMetrics::kWriteOperations);
+  settings_->metrics->Add(ServerMetrics::kBytesSent, bytes_transferred);
+
+  if (settings_->write_timeout_ticks > 0 || settings_->idle_timeout_ticks > 0) {
+    write_deadline_ = 0;
+    if (settings_->idle_timeout_ticks > 0) {
+      idle_deadline_ = timing_wheel_->Now() + settings_->idle_timeout_ticks;
+    }
+    ArmTimer();
+  }
+
+  // Send whatever was queued while this write was in flight
+  StartWrite();
+  CheckFlowControl();
 }
 
 }  // namespace internal
-}  // namespace tcp_server 
\ No newline at end of file
+}  // namespace tcp_server
\ No newline at end of file
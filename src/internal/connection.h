@@ -6,40 +6,144 @@
 #ifndef TCP_SERVER_INTERNAL_CONNECTION_H_
 #define TCP_SERVER_INTERNAL_CONNECTION_H_
 
-#include <boost/asio.hpp>
+#include <spdlog/fwd.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "src/internal/admission.h"
+#include "src/internal/buffer_pool.h"
+#include "src/internal/connection_registry.h"
+#include "src/internal/metrics.h"
+#include "src/internal/response_cache.h"
+#include "src/internal/timing_wheel.h"
+#include "src/internal/topic_registry.h"
+#include "src/internal/transport.h"
+#if defined(TCP_SERVER_HAS_TLS)
+#include "src/internal/tls.h"
+#endif
+#include "src/internal/work_stealing_pool.h"
+#include "src/internal/write_queue.h"
+#include "tcp_server/asio.h"
+#include "tcp_server/framer.h"
+#include "tcp_server/response_writer.h"
+#include "tcp_server/server_options.h"
+#include "tcp_server/session.h"
+
 namespace tcp_server {
 namespace internal {
 
+/**
+ * @brief Settings shared by every connection of a server
+ */
+struct ConnectionSettings {
+  std::function<void(std::string_view, ResponseWriter&)> message_handler;  ///< Message handler
+  std::shared_ptr<const Framer> framer;  ///< Message framing
+  std::size_t read_buffer_size = 0;      ///< Initial size of the read buffer
+  std::size_t min_read_buffer_size = 0;  ///< Smallest size the read buffer shrinks to
+  std::size_t max_read_buffer_size = 0;  ///< Largest size the read buffer grows to between frames
+  std::size_t write_high_watermark = 0;  ///< Queued bytes at which reading pauses
+  std::size_t write_low_watermark = 0;   ///< Queued bytes at which reading resumes
+  bool measure_handler_time = false;     ///< Record handler run time in the metrics
+  ConnectionRegistry* registry = nullptr;  ///< Registry of live connections (owned by the server)
+  ServerMetrics* metrics = nullptr;        ///< Server counters (owned by the server)
+  spdlog::logger* logger = nullptr;        ///< Server logger (owned by the server)
+  WorkStealingPool* handler_pool = nullptr;  ///< Pool handlers run on, or nullptr to run them inline
+  PeerLimiter* peer_limiter = nullptr;     ///< Per-address connection limit, or nullptr for none
+  TopicRegistry* topics = nullptr;         ///< Publish/subscribe topics (owned by the server)
+  ResponseCache* response_cache = nullptr;  ///< Cache of handler responses, or nullptr for none
+  std::size_t slow_subscriber_limit = 0;   ///< Queued bytes at which a subscriber counts as slow
+  SlowSubscriberPolicy slow_subscriber_policy = SlowSubscriberPolicy::kDrop;  ///< Slow subscriber handling
+  std::size_t zero_copy_threshold = 0;     ///< Pinned body size sent with MSG_ZEROCOPY (0 = never)
+  SocketOptions socket_options;            ///< Applied to accepted sockets that do not inherit them
+#if defined(TCP_SERVER_HAS_TLS)
+  const TlsContext* tls = nullptr;         ///< TLS configuration, or nullptr for plain TCP
+#endif
+  std::size_t max_pending_requests = 0;    ///< Offloaded requests per connection before reading pauses
+  std::uint64_t idle_timeout_ticks = 0;    ///< Wheel ticks without traffic before closing (0 = off)
+  std::uint64_t read_timeout_ticks = 0;    ///< Wheel ticks to complete a started frame (0 = off)
+  std::uint64_t write_timeout_ticks = 0;   ///< Wheel ticks for one write to complete (0 = off)
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  SessionHandler session_handler;  ///< Coroutine run per connection instead of message_handler
+#endif
+};
+
 /**
  * @brief Class for managing TCP connections
  *
- * Manages a single client connection and handles data transmission
+ * Manages a single client connection and handles data transmission. The
+ * socket is a TCP connection or a Unix domain socket connection, depending on
+ * the listener that accepted it; everything above the socket is the same.
+ * All completion handlers run on the socket's executor, which is a strand
+ * when the io_context is run by several threads.
  */
 class Connection : public std::enable_shared_from_this<Connection> {
  public:
-  using tcp = boost::asio::ip::tcp;
-  using MessageHandler = std::function<std::string(const std::string&)>;
+  using Socket = StreamProtocol::socket;
+  using Endpoint = StreamProtocol::endpoint;
 
   /**
    * @brief Create a connection object
-   * @param io_context Boost.Asio io_context
-   * @param message_handler Handler for processing received messages
-   * @return Shared pointer to the connection object
+   *
+   * Connections are normally obtained from a ConnectionPool, which owns them
+   * while idle and recycles them when the last shared_ptr is released.
+   * @param executor Executor the socket and its handlers run on
+   * @param settings Settings shared by all connections
+   * @param timing_wheel Timing wheel driving this connection's timeouts
+   * @param buffer_pool Pool the read buffer is borrowed from
+   * @return Owning pointer to the connection object
+   */
+  static std::unique_ptr<Connection> Create(
+      const boost::asio::any_io_executor& executor,
+      std::shared_ptr<const ConnectionSettings> settings, TimingWheel* timing_wheel,
+      BufferPool* buffer_pool);
+
+  /**
+   * @brief Get reference to the socket
+   * @return Reference to the socket
+   */
+  Socket& GetSocket();
+
+  /**
+   * @brief Get the peer address
+   *
+   * Filled in by the acceptor, so logging it costs no getpeername() call.
+   * @return Reference to the cached peer endpoint
+   */
+  Endpoint& GetPeerEndpoint();
+
+  /**
+   * @brief Get the peer's TCP address
+   * @return Peer endpoint, or a default-constructed one for a Unix domain socket
+   */
+  boost::asio::ip::tcp::endpoint GetRemoteEndpoint() const;
+
+  /**
+   * @brief Count this connection against the per-address limit
+   *
+   * Uses the peer address filled in by the acceptor. The count is released
+   * when the connection closes. Unix domain socket peers have no address and
+   * are not counted.
+   * @return true if admitted (always when no limit is set)
+   */
+  bool AdmitPeer();
+
+  /**
+   * @brief Add this connection to the server's registry
+   * @return true if registered, false if the connection limit is reached
    */
-  static std::shared_ptr<Connection> Create(
-      boost::asio::io_context& io_context,
-      MessageHandler message_handler);
+  bool Register();
 
   /**
-   * @brief Get reference to TCP socket
-   * @return Reference to TCP socket
+   * @brief Get the registry id of this connection
+   * @return Id, or ConnectionRegistry::kInvalidId when not registered
    */
-  tcp::socket& GetSocket();
+  ConnectionRegistry::Id GetId() const;
 
   /**
    * @brief Initialize connection and start reading
@@ -47,23 +151,126 @@ class Connection : public std::enable_shared_from_this<Connection> {
   void Start();
 
   /**
-   * @brief Close the connection
+   * @brief Close the connection, cancel its timeouts and remove it from the registry
    */
   void Stop();
 
+  /**
+   * @brief Queue a published message, applying the slow subscriber policy
+   *
+   * The payload is queued by reference, not copied. Coroutine sessions write
+   * on their own and receive nothing. Must run on the socket's executor.
+   * @param payload Framed message shared by every recipient
+   * @param tag Topic of the message, used for conflation
+   */
+  void Deliver(std::shared_ptr<const std::string> payload, std::uint64_t tag);
+
+  /**
+   * @brief Finish the requests in progress, then close
+   *
+   * Idle connections close at once; a connection with a partial frame,
+   * offloaded requests or unsent output closes as soon as those complete.
+   * Coroutine sessions are left running. Must run on the socket's executor.
+   */
+  void Drain();
+
+  /**
+   * @brief Close the socket and clear all per-connection state for reuse
+   *
+   * The read buffer goes back to the buffer pool; the write queue keeps its
+   * capacity. Must only be called when no operation is pending.
+   */
+  void Reset();
+
  private:
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  friend class tcp_server::Session;
+
+  /**
+   * @brief Run the session handler as a coroutine on the socket's executor
+   *
+   * The connection is stopped when the coroutine finishes or throws.
+   * Stopping the connection from outside cancels the session's Sleep().
+   */
+  void StartSession();
+#endif
+
   /**
    * @brief Constructor
-   * @param io_context Boost.Asio io_context
-   * @param message_handler Handler for processing received messages
+   * @param executor Executor the socket and its handlers run on
+   * @param settings Settings shared by all connections
+   * @param timing_wheel Timing wheel driving this connection's timeouts
+   * @param buffer_pool Pool the read buffer is borrowed from
+   */
+  Connection(const boost::asio::any_io_executor& executor,
+             std::shared_ptr<const ConnectionSettings> settings, TimingWheel* timing_wheel,
+             BufferPool* buffer_pool);
+
+#if defined(TCP_SERVER_HAS_TLS)
+  /**
+   * @brief Start the TLS handshake; reading starts once it completes
+   *
+   * The read timeout, if set, bounds the handshake.
+   */
+  void StartHandshake();
+
+  /**
+   * @brief Advance the handshake after the socket became ready
+   * @param error Error information
+   */
+  void HandleHandshake(const boost::system::error_code& error);
+
+  /**
+   * @brief Encrypt and send the in-flight batch with OpenSSL
+   *
+   * Used when the kernel does not encrypt for this connection.
+   */
+  void ContinueTlsWrite();
+#endif
+
+  /**
+   * @brief Whether this connection is TLS
+   * @return true once the handshake has started
+   */
+  bool UsesTls() const;
+
+  /**
+   * @brief Whether reads go through OpenSSL rather than straight to the socket
+   * @return false for plain TCP and while kTLS decrypts with nothing buffered
+   */
+  bool ReadsThroughTls() const;
+
+  /**
+   * @brief Whether writes go through OpenSSL rather than straight to the socket
+   * @return false for plain TCP and when kTLS encrypts
    */
-  Connection(boost::asio::io_context& io_context, MessageHandler message_handler);
+  bool WritesThroughTls() const;
+
+  /**
+   * @brief Read without blocking, decrypting if needed
+   * @param buffer Destination
+   * @param error Error information (would_block when nothing is available)
+   * @return Bytes read
+   */
+  std::size_t ReadSome(const boost::asio::mutable_buffer& buffer,
+                       boost::system::error_code& error);
 
   /**
    * @brief Start asynchronous read
+   *
+   * When nothing is buffered and the last read drained the socket, the read
+   * buffer goes back to the pool and the connection waits for readability
+   * instead, so idle connections hold no buffer. With io_uring the read is
+   * always submitted into a borrowed buffer, skipping the readiness wait.
    */
   void StartRead();
 
+  /**
+   * @brief Handler for readability; borrows a buffer and reads without blocking
+   * @param error Error information
+   */
+  void HandleReadable(const boost::system::error_code& error);
+
   /**
    * @brief Handler for read completion
    * @param error Error information
@@ -72,10 +279,174 @@ class Connection : public std::enable_shared_from_this<Connection> {
   void HandleRead(const boost::system::error_code& error, std::size_t bytes_transferred);
 
   /**
-   * @brief Start asynchronous write
-   * @param data Data to send
+   * @brief Pass every complete frame in the read buffer to the message handler
+   *
+   * Responses are framed straight into the tail of the write queue.
+   * @throws FramingError If the received data is not a valid frame
+   */
+  void ProcessFrames();
+
+  /**
+   * @brief Look up the cached response to a request and count the hit or miss
+   *
+   * Only reads the shared settings, so it may run on a handler pool thread.
+   * @param request Request payload
+   * @return Lookup result; empty when the server has no response cache
+   */
+  ResponseCache::Lookup FindCached(std::string_view request) const;
+
+  /**
+   * @brief Queue a cached response
+   *
+   * Small responses are copied into the tail segment, where they cost less
+   * than a buffer of their own in the vectored write.
+   * @param response Framed response
+   */
+  void QueueCached(std::shared_ptr<const std::string> response);
+
+  /**
+   * @brief Run the message handler for one request and frame its response
+   *
+   * Only reads the shared settings, so it may run on a handler pool thread.
+   * The response is cached when the lookup of the request missed.
+   * @param request Request payload
+   * @param cached Result of FindCached() for the request
+   * @param output Buffer the framed response is appended to
+   * @param bodies Receives the bodies the handler adds, sent after the response
+   * @param id Registry id of this connection, passed to the handler
+   * @throws FramingError If the response cannot be framed
+   */
+  void InvokeHandler(std::string_view request, const ResponseCache::Lookup& cached,
+                     std::string* output, std::vector<ResponseBody>* bodies,
+                     ConnectionRegistry::Id id) const;
+
+  /**
+   * @brief Hand the oldest pending request to the handler pool
+   *
+   * At most one request per connection is with the pool at a time, which keeps
+   * responses in request order. Does nothing if one is already running.
+   */
+  void DispatchRequest();
+
+  /**
+   * @brief Queue the response of an offloaded request
+   * @param response Framed response
+   * @param bodies Bodies sent after the response
+   * @param failed Whether the handler threw
+   */
+  void HandleResponse(std::string response, std::vector<ResponseBody> bodies, bool failed);
+
+  /**
+   * @brief Whether offloaded requests are queued or running
+   * @return true if a response is still to come
+   */
+  bool HasPendingRequests() const;
+
+  /**
+   * @brief Whether queued output or pending requests require reading to pause
+   * @return true if the high watermark or the pending request limit is reached
+   */
+  bool ShouldPauseRead() const;
+
+  /**
+   * @brief Close a half-closed connection once everything is sent, or resume paused reads
+   */
+  void CheckFlowControl();
+
+  /**
+   * @brief Give back the per-address count taken by AdmitPeer()
+   */
+  void ReleasePeer();
+
+  /**
+   * @brief Close a draining connection once it has nothing left to finish
+   * @return true if the connection was closed
+   */
+  bool CloseIfDrained();
+
+  /**
+   * @brief Schedule the timer for the earliest active deadline, or cancel it
+   */
+  void ArmTimer();
+
+  /**
+   * @brief Timing wheel callback; hands the expiry to the connection's executor
+   * @param context The connection
+   */
+  static void OnTimerExpired(void* context);
+
+  /**
+   * @brief Close the connection if one of its deadlines has passed
+   */
+  void HandleTimeout();
+
+  /**
+   * @brief Make room in the read buffer for the next read
+   *
+   * Borrows a buffer of the adaptive size when none is held and nothing is
+   * buffered, and doubles a buffer that a partial frame fills.
+   * @throws FramingError If a single frame does not fit in the maximum frame size
+   */
+  void PrepareReadBuffer();
+
+  /**
+   * @brief Adjust the adaptive read buffer size after a read
+   *
+   * Reads that fill the buffer double the size for the next read; a run of
+   * reads using at most a quarter of it halves the size.
+   * @param available Free space the read was given
+   * @param bytes_transferred Bytes actually read
+   */
+  void AdaptReadBufferSize(std::size_t available, std::size_t bytes_transferred);
+
+  /**
+   * @brief Write everything queued since the last completion in one vectored write
+   *
+   * Does nothing while a write is in flight or the queue is empty.
+   */
+  void StartWrite();
+
+  /**
+   * @brief Send the file body of the in-flight batch
+   *
+   * Uses sendfile() and waits for writability whenever the socket buffer is
+   * full. Where sendfile() cannot be used, the file is read in chunks and
+   * written normally.
+   */
+  void ContinueFileWrite();
+
+  /**
+   * @brief Send the in-flight batch with MSG_ZEROCOPY
+   *
+   * The batch is parked in the write queue until the kernel reports that it
+   * is done with the pages.
+   */
+  void ContinueZeroCopyWrite();
+
+  /**
+   * @brief Enable MSG_ZEROCOPY on the socket the first time it is needed
+   * @return true if zero-copy sends are available
+   */
+  bool EnableZeroCopy();
+
+  /**
+   * @brief Wait for zero-copy completions while parked batches remain
+   */
+  void WaitZeroCopy();
+
+  /**
+   * @brief Release the parked batches the kernel reported complete
+   * @param error Error information
+   */
+  void HandleZeroCopyCompletion(const boost::system::error_code& error);
+
+  /**
+   * @brief Complete a write that finished without an asynchronous operation
+   *
+   * Posted rather than called, so that a run of small bodies does not recurse.
+   * @param bytes_transferred Number of bytes transferred
    */
-  void StartWrite(const std::string& data);
+  void PostWriteCompletion(std::size_t bytes_transferred);
 
   /**
    * @brief Handler for write completion
@@ -84,14 +455,51 @@ class Connection : public std::enable_shared_from_this<Connection> {
    */
   void HandleWrite(const boost::system::error_code& error, std::size_t bytes_transferred);
 
-  tcp::socket socket_;                  ///< TCP socket
-  MessageHandler message_handler_;      ///< Message handler
-  std::vector<char> read_buffer_;       ///< Read buffer
-  std::string write_buffer_;            ///< Write buffer
-  static constexpr size_t kBufferSize = 1024;  ///< Buffer size
+  Socket socket_;                       ///< TCP or Unix domain socket
+  Endpoint peer_endpoint_;              ///< Peer address, set on accept
+  std::shared_ptr<const ConnectionSettings> settings_;  ///< Shared settings
+  ConnectionRegistry::Id id_ = ConnectionRegistry::kInvalidId;  ///< Registry id
+  bool peer_admitted_ = false;          ///< Counted by settings_->peer_limiter
+  BufferPool* buffer_pool_;             ///< Pool of the owning worker
+  PooledBuffer read_buffer_;            ///< Read buffer, held only while data is pending
+  std::size_t read_size_ = 0;           ///< Bytes in read_buffer_ not yet framed
+  std::size_t frame_scanned_ = 0;       ///< Bytes of the partial frame already scanned
+  std::size_t read_buffer_target_ = 0;  ///< Adaptive size of the next borrowed buffer
+  unsigned int small_reads_ = 0;        ///< Consecutive reads that used little of the buffer
+  bool read_buffer_filled_ = false;     ///< The last read filled the buffer (more data likely)
+  WriteQueue write_queue_;              ///< Outbound responses
+  std::vector<ResponseBody> bodies_;    ///< Bodies added by an inline handler call
+  std::uint64_t write_offset_ = 0;      ///< Bytes of the in-flight file or zero-copy batch sent
+  bool copy_file_ = false;              ///< sendfile() failed for the in-flight file; copy it
+  std::string file_chunk_;              ///< File bytes read when sendfile() cannot be used
+  std::uint64_t file_chunk_offset_ = 0; ///< File position of file_chunk_
+  bool zero_copy_enabled_ = false;      ///< SO_ZEROCOPY is set on the socket
+  bool zero_copy_unavailable_ = false;  ///< SO_ZEROCOPY was refused; send pinned bodies normally
+  std::uint32_t zero_copy_sequence_ = 0;  ///< Kernel sequence number of the next zero-copy send
+  std::uint32_t zero_copy_first_ = 0;   ///< Sequence number of the in-flight batch's first send
+  bool zero_copy_waiting_ = false;      ///< Waiting on the error queue for completions
+#if defined(TCP_SERVER_HAS_TLS)
+  TlsSession tls_;                      ///< TLS state; active when settings_->tls is set
+  bool tls_handshaking_ = false;        ///< Handshake in progress; nothing may be written
+  bool tls_kernel_send_ = false;        ///< kTLS encrypts writes, so sendfile() works too
+  bool tls_kernel_receive_ = false;     ///< kTLS decrypts reads
+#endif
+  std::deque<std::string> pending_requests_;  ///< Requests waiting for the handler pool
+  bool handler_running_ = false;        ///< A request of this connection is with the handler pool
+  bool read_paused_ = false;            ///< Reading paused by ShouldPauseRead()
+  bool close_after_write_ = false;      ///< Close once the write queue drains
+  bool draining_ = false;               ///< Close once the work in progress completes
+  TimingWheel* timing_wheel_;           ///< Wheel of the owning worker
+  TimerNode timer_node_;                ///< Timer for the earliest deadline below
+  std::uint64_t idle_deadline_ = 0;     ///< Tick at which an idle connection closes (0 = none)
+  std::uint64_t read_deadline_ = 0;     ///< Tick by which the buffered partial frame must complete
+  std::uint64_t write_deadline_ = 0;    ///< Tick by which the in-flight write must complete
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  boost::asio::steady_timer* session_timer_ = nullptr;  ///< Sleep() timer of the running session
+#endif
 };
 
 }  // namespace internal
 }  // namespace tcp_server
 
-#endif  // TCP_SERVER_INTERNAL_CONNECTION_H_ 
\ No newline at end of file
+#endif  // TCP_SERVER_INTERNAL_CONNECTION_H_
@@ -0,0 +1,127 @@
+#include "src/internal/connection_pool.h"
+
+#include <utility>
+
+namespace tcp_server {
+namespace internal {
+
+BlockPool::BlockPool(std::size_t block_size, std::size_t blocks_per_chunk)
+    : block_size_(block_size), pool_(block_size, blocks_per_chunk) {}
+
+void* BlockPool::Allocate(std::size_t size) {
+  if (size > block_size_) {
+    return ::operator new(size);
+  }
+
+  void* pointer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pointer = pool_.malloc();
+  }
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void BlockPool::Deallocate(void* pointer, std::size_t size) {
+  if (size > block_size_) {
+    ::operator delete(pointer);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pool_.free(pointer);
+}
+
+ConnectionPool::ConnectionPool(boost::asio::io_context& io_context, bool use_strand,
+                               std::shared_ptr<const ConnectionSettings> settings,
+                               TimingWheel* timing_wheel, BufferPool* buffer_pool,
+                               std::size_t capacity)
+    : io_context_(io_context),
+      use_strand_(use_strand),
+      settings_(std::move(settings)),
+      timing_wheel_(timing_wheel),
+      buffer_pool_(buffer_pool),
+      capacity_(capacity),
+      control_blocks_(kControlBlockSize, capacity > 0 ? capacity : 32) {}
+
+void ConnectionPool::Preallocate() {
+  // Allocate everything up front so that accepting does not hit malloc
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_.reserve(capacity_);
+  while (!shutdown_ && idle_.size() < capacity_) {
+    idle_.push_back(NewConnection());
+  }
+}
+
+std::shared_ptr<Connection> ConnectionPool::Acquire() {
+  std::unique_ptr<Connection> connection;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      connection = std::move(idle_.back());
+      idle_.pop_back();
+    }
+  }
+  if (!connection) {
+    // Grow by a whole slab and keep it, rather than allocating on every accept
+    std::vector<std::unique_ptr<Connection>> slab;
+    slab.reserve(kGrowthSlabSize);
+    for (std::size_t i = 0; i < kGrowthSlabSize; ++i) {
+      slab.push_back(NewConnection());
+    }
+    connection = std::move(slab.back());
+    slab.pop_back();
+    settings_->metrics->Add(ServerMetrics::kConnectionPoolGrown, kGrowthSlabSize);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!shutdown_) {
+      capacity_ += kGrowthSlabSize;
+      for (auto& grown : slab) {
+        idle_.push_back(std::move(grown));
+      }
+    }
+  }
+
+  return std::shared_ptr<Connection>(connection.release(), Recycler{this},
+                                     BlockAllocator<Connection>(&control_blocks_));
+}
+
+void ConnectionPool::Shutdown() {
+  std::vector<std::unique_ptr<Connection>> idle;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+    idle.swap(idle_);
+  }
+}
+
+std::size_t ConnectionPool::IdleCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_.size();
+}
+
+void ConnectionPool::Recycler::operator()(Connection* connection) const {
+  pool->Release(std::unique_ptr<Connection>(connection));
+}
+
+std::unique_ptr<Connection> ConnectionPool::NewConnection() {
+  if (use_strand_) {
+    return Connection::Create(boost::asio::make_strand(io_context_), settings_, timing_wheel_,
+                              buffer_pool_);
+  }
+  return Connection::Create(io_context_.get_executor(), settings_, timing_wheel_, buffer_pool_);
+}
+
+void ConnectionPool::Release(std::unique_ptr<Connection> connection) {
+  connection->Reset();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!shutdown_ && idle_.size() < capacity_) {
+    idle_.push_back(std::move(connection));
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,192 @@
+/**
+ * @file connection_pool.h
+ * @brief Pool that recycles Connection objects and their shared_ptr control blocks
+ */
+
+#ifndef TCP_SERVER_INTERNAL_CONNECTION_POOL_H_
+#define TCP_SERVER_INTERNAL_CONNECTION_POOL_H_
+
+#include <boost/pool/pool.hpp>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "src/internal/connection.h"
+#include "tcp_server/asio.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Thread-safe arena of fixed-size blocks
+ *
+ * Backed by Boost.Pool. Requests larger than the block size fall back to the
+ * global allocator.
+ */
+class BlockPool {
+ public:
+  /**
+   * @brief Constructor
+   * @param block_size Size of each block in bytes
+   * @param blocks_per_chunk Number of blocks allocated at once when the arena grows
+   */
+  BlockPool(std::size_t block_size, std::size_t blocks_per_chunk);
+
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  /**
+   * @brief Allocate a block
+   * @param size Requested size in bytes
+   * @return Pointer to the allocated memory
+   * @throws std::bad_alloc If memory cannot be allocated
+   */
+  void* Allocate(std::size_t size);
+
+  /**
+   * @brief Return a block obtained from Allocate()
+   * @param pointer Block to return
+   * @param size Size passed to Allocate()
+   */
+  void Deallocate(void* pointer, std::size_t size);
+
+ private:
+  std::size_t block_size_;  ///< Size of each block
+  std::mutex mutex_;        ///< Guards pool_
+  boost::pool<> pool_;      ///< Block storage
+};
+
+/**
+ * @brief Standard allocator adaptor over a BlockPool
+ * @tparam T Value type
+ */
+template <typename T>
+class BlockAllocator {
+ public:
+  using value_type = T;
+
+  explicit BlockAllocator(BlockPool* pool) : pool_(pool) {}
+
+  template <typename U>
+  BlockAllocator(const BlockAllocator<U>& other) : pool_(other.GetPool()) {}
+
+  T* allocate(std::size_t n) { return static_cast<T*>(pool_->Allocate(n * sizeof(T))); }
+
+  void deallocate(T* pointer, std::size_t n) { pool_->Deallocate(pointer, n * sizeof(T)); }
+
+  BlockPool* GetPool() const { return pool_; }
+
+  template <typename U>
+  bool operator==(const BlockAllocator<U>& other) const {
+    return pool_ == other.GetPool();
+  }
+
+  template <typename U>
+  bool operator!=(const BlockAllocator<U>& other) const {
+    return pool_ != other.GetPool();
+  }
+
+ private:
+  BlockPool* pool_;  ///< Backing arena
+};
+
+/**
+ * @brief Per-worker pool of reusable connections
+ *
+ * Acquire() hands out a shared_ptr whose control block comes from a block
+ * arena and whose deleter returns the connection, with its socket and buffers,
+ * to the pool instead of freeing it. The deleter may run on any thread.
+ *
+ * When more connections are open than were preallocated, the pool grows by a
+ * slab of connections at a time and keeps them, so a burst pays for allocation
+ * once rather than on every accept. Each growth is counted in the server
+ * metrics.
+ */
+class ConnectionPool {
+ public:
+  /**
+   * @brief Constructor
+   * @param io_context io_context the pooled sockets are bound to
+   * @param use_strand Give each connection its own strand (io_context run by several threads)
+   * @param settings Settings shared by all connections
+   * @param timing_wheel Timing wheel for the connections' timeouts
+   * @param buffer_pool Pool the connections borrow read buffers from
+   * @param capacity Number of connections created by Preallocate()
+   */
+  ConnectionPool(boost::asio::io_context& io_context, bool use_strand,
+                 std::shared_ptr<const ConnectionSettings> settings, TimingWheel* timing_wheel,
+                 BufferPool* buffer_pool, std::size_t capacity);
+
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  /**
+   * @brief Create connections until capacity are idle
+   *
+   * Called on the thread that will serve the connections when it is pinned,
+   * so that their memory is first touched on that thread's NUMA node.
+   */
+  void Preallocate();
+
+  /**
+   * @brief Take an idle connection, growing the pool by a slab if none is idle
+   * @return Connection ready to accept into
+   */
+  std::shared_ptr<Connection> Acquire();
+
+  /**
+   * @brief Destroy idle connections and stop recycling
+   *
+   * Must be called while the io_context is still alive. Connections released
+   * afterwards are destroyed instead of being returned to the pool.
+   */
+  void Shutdown();
+
+  /**
+   * @brief Number of idle connections in the pool
+   * @return Idle connection count
+   */
+  std::size_t IdleCount();
+
+ private:
+  /**
+   * @brief shared_ptr deleter that returns the connection to the pool
+   */
+  struct Recycler {
+    ConnectionPool* pool;  ///< Owning pool
+    void operator()(Connection* connection) const;
+  };
+
+  /**
+   * @brief Create a new connection bound to this pool's io_context
+   * @return New connection
+   */
+  std::unique_ptr<Connection> NewConnection();
+
+  /**
+   * @brief Reset a released connection and keep it for reuse
+   * @param connection Released connection
+   */
+  void Release(std::unique_ptr<Connection> connection);
+
+  static constexpr std::size_t kControlBlockSize = 64;  ///< Block size for shared_ptr control blocks
+  static constexpr std::size_t kGrowthSlabSize = 16;    ///< Connections added when the pool runs dry
+
+  boost::asio::io_context& io_context_;                  ///< io_context of the pooled sockets
+  bool use_strand_;                                      ///< Whether connections get a strand
+  std::shared_ptr<const ConnectionSettings> settings_;   ///< Shared connection settings
+  TimingWheel* timing_wheel_;                            ///< Timing wheel of the connections
+  BufferPool* buffer_pool_;                              ///< Read buffers of the connections
+  std::size_t capacity_;                                 ///< Connections owned by the pool
+  BlockPool control_blocks_;                             ///< Arena for shared_ptr control blocks
+  std::mutex mutex_;                                     ///< Guards idle_ and shutdown_
+  std::vector<std::unique_ptr<Connection>> idle_;        ///< Idle connections
+  bool shutdown_ = false;                                ///< Recycling disabled
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_CONNECTION_POOL_H_
@@ -0,0 +1,136 @@
+#include "src/internal/connection_registry.h"
+
+#include <utility>
+
+#include "src/internal/connection.h"
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+constexpr std::uint64_t kIndexMask = 0xFFFFFFFFu;
+
+}  // namespace
+
+ConnectionRegistry::ConnectionRegistry(std::size_t capacity)
+    : capacity_(capacity),
+      slots_(std::make_unique<Slot[]>(capacity)),
+      next_free_(std::make_unique<std::atomic<std::uint32_t>[]>(capacity)),
+      free_head_(capacity > 0 ? 0 : kNoSlot) {
+  // Chain every slot into the free list in index order
+  for (std::size_t index = 0; index < capacity_; ++index) {
+    next_free_[index].store(index + 1 < capacity_ ? static_cast<std::uint32_t>(index + 1) : kNoSlot,
+                            std::memory_order_relaxed);
+  }
+}
+
+ConnectionRegistry::Id ConnectionRegistry::Add(std::shared_ptr<Connection> connection) {
+  const std::uint32_t index = PopFree();
+  if (index == kNoSlot) {
+    return kInvalidId;
+  }
+
+  std::uint32_t generation = 0;
+  {
+    Slot& slot = slots_[index];
+    std::lock_guard<SpinLock> lock(slot.lock);
+    slot.connection = std::move(connection);
+    generation = slot.generation;
+  }
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return (static_cast<Id>(generation) << 32) | index;
+}
+
+void ConnectionRegistry::Remove(Id id) {
+  const std::uint64_t index = id & kIndexMask;
+  if (id == kInvalidId || index >= capacity_) {
+    return;
+  }
+
+  std::shared_ptr<Connection> removed;
+  {
+    Slot& slot = slots_[index];
+    std::lock_guard<SpinLock> lock(slot.lock);
+    if (slot.generation != static_cast<std::uint32_t>(id >> 32) || !slot.connection) {
+      return;
+    }
+    removed = std::move(slot.connection);
+    ++slot.generation;
+  }
+  PushFree(static_cast<std::uint32_t>(index));
+  // Sequentially consistent with the waiter's increment and size check, so one of them sees
+  // the other
+  if (size_.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+      empty_waiters_.load(std::memory_order_seq_cst) > 0) {
+    std::lock_guard<std::mutex> lock(empty_mutex_);
+    empty_condition_.notify_all();
+  }
+  // The last reference may be dropped here, outside the slot lock
+}
+
+std::shared_ptr<Connection> ConnectionRegistry::Find(Id id) {
+  const std::uint64_t index = id & kIndexMask;
+  if (id == kInvalidId || index >= capacity_) {
+    return nullptr;
+  }
+
+  Slot& slot = slots_[index];
+  std::lock_guard<SpinLock> lock(slot.lock);
+  if (slot.generation != static_cast<std::uint32_t>(id >> 32)) {
+    return nullptr;
+  }
+  return slot.connection;
+}
+
+std::size_t ConnectionRegistry::Size() const {
+  return size_.load(std::memory_order_relaxed);
+}
+
+std::size_t ConnectionRegistry::Capacity() const {
+  return capacity_;
+}
+
+bool ConnectionRegistry::WaitUntilEmpty(std::chrono::steady_clock::time_point deadline) {
+  empty_waiters_.fetch_add(1, std::memory_order_seq_cst);
+  bool empty = false;
+  {
+    std::unique_lock<std::mutex> lock(empty_mutex_);
+    empty = empty_condition_.wait_until(
+        lock, deadline, [this] { return size_.load(std::memory_order_seq_cst) == 0; });
+  }
+  empty_waiters_.fetch_sub(1, std::memory_order_relaxed);
+  return empty;
+}
+
+std::uint32_t ConnectionRegistry::PopFree() {
+  std::uint64_t head = free_head_.load(std::memory_order_acquire);
+  while (true) {
+    const std::uint32_t index = static_cast<std::uint32_t>(head & kIndexMask);
+    if (index == kNoSlot) {
+      return kNoSlot;
+    }
+    const std::uint64_t next = next_free_[index].load(std::memory_order_relaxed);
+    const std::uint64_t tag = (head >> 32) + 1;
+    if (free_head_.compare_exchange_weak(head, (tag << 32) | next, std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+      return index;
+    }
+  }
+}
+
+void ConnectionRegistry::PushFree(std::uint32_t index) {
+  std::uint64_t head = free_head_.load(std::memory_order_relaxed);
+  while (true) {
+    next_free_[index].store(static_cast<std::uint32_t>(head & kIndexMask),
+                            std::memory_order_relaxed);
+    const std::uint64_t tag = (head >> 32) + 1;
+    if (free_head_.compare_exchange_weak(head, (tag << 32) | index, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
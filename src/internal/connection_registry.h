@@ -0,0 +1,170 @@
+/**
+ * @file connection_registry.h
+ * @brief Fixed-capacity table of live connections without a global lock
+ */
+
+#ifndef TCP_SERVER_INTERNAL_CONNECTION_REGISTRY_H_
+#define TCP_SERVER_INTERNAL_CONNECTION_REGISTRY_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace tcp_server {
+namespace internal {
+
+class Connection;
+
+/**
+ * @brief Minimal test-and-set spin lock for very short critical sections
+ */
+class SpinLock {
+ public:
+  void lock() {
+    int spins = 0;
+    while (flag_.test_and_set(std::memory_order_acquire)) {
+      if (++spins > kSpinsBeforeYield) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock() { flag_.clear(std::memory_order_release); }
+
+ private:
+  static constexpr int kSpinsBeforeYield = 64;  ///< Busy iterations before yielding
+  std::atomic_flag flag_ = ATOMIC_FLAG_INIT;    ///< Lock state
+};
+
+/**
+ * @brief Registry of live connections
+ *
+ * Slots are preallocated up to the connection limit and indexed by connection id.
+ * Free slots are kept in a lock-free stack, the live count is an atomic counter,
+ * and each slot has its own spin lock, so adding, removing and iterating never
+ * take a lock shared by all connections.
+ */
+class ConnectionRegistry {
+ public:
+  using Id = std::uint64_t;
+  static constexpr Id kInvalidId = ~Id{0};  ///< Id of an unregistered connection
+
+  /**
+   * @brief Constructor
+   * @param capacity Maximum number of concurrently registered connections
+   */
+  explicit ConnectionRegistry(std::size_t capacity);
+
+  ConnectionRegistry(const ConnectionRegistry&) = delete;
+  ConnectionRegistry& operator=(const ConnectionRegistry&) = delete;
+
+  /**
+   * @brief Register a connection
+   * @param connection Connection to register
+   * @return Id of the connection, or kInvalidId if the registry is full
+   */
+  Id Add(std::shared_ptr<Connection> connection);
+
+  /**
+   * @brief Unregister a connection
+   *
+   * Ids are generation-tagged, so removing a stale id has no effect.
+   * @param id Id returned by Add()
+   */
+  void Remove(Id id);
+
+  /**
+   * @brief Look up a registered connection
+   * @param id Id returned by Add()
+   * @return The connection, or nullptr if the id is not registered
+   */
+  std::shared_ptr<Connection> Find(Id id);
+
+  /**
+   * @brief Number of registered connections
+   * @return Live connection count
+   */
+  std::size_t Size() const;
+
+  /**
+   * @brief Maximum number of registered connections
+   * @return Capacity
+   */
+  std::size_t Capacity() const;
+
+  /**
+   * @brief Block until no connection is registered
+   *
+   * The Remove() that unregisters the last connection wakes the caller;
+   * removals take no lock while nobody waits.
+   * @param deadline Time to give up at
+   * @return true if the registry became empty before the deadline
+   */
+  bool WaitUntilEmpty(std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * @brief Call a function for every registered connection
+   *
+   * Each slot is locked only while its connection pointer is copied, so the
+   * function may remove connections and other threads may add or remove
+   * connections concurrently.
+   * @param function Callable taking const std::shared_ptr<Connection>&
+   */
+  template <typename Function>
+  void ForEach(Function&& function) {
+    for (std::size_t index = 0; index < capacity_; ++index) {
+      std::shared_ptr<Connection> connection;
+      {
+        Slot& slot = slots_[index];
+        std::lock_guard<SpinLock> lock(slot.lock);
+        connection = slot.connection;
+      }
+      if (connection) {
+        function(connection);
+      }
+    }
+  }
+
+ private:
+  /**
+   * @brief Table entry
+   */
+  struct Slot {
+    SpinLock lock;                           ///< Guards the fields below
+    std::uint32_t generation = 0;            ///< Incremented each time the slot is freed
+    std::shared_ptr<Connection> connection;  ///< Registered connection
+  };
+
+  static constexpr std::uint32_t kNoSlot = ~std::uint32_t{0};  ///< End of the free list
+
+  /**
+   * @brief Pop a free slot index
+   * @return Slot index, or kNoSlot if none is free
+   */
+  std::uint32_t PopFree();
+
+  /**
+   * @brief Push a slot index onto the free list
+   * @param index Slot index
+   */
+  void PushFree(std::uint32_t index);
+
+  std::size_t capacity_;                            ///< Number of slots
+  std::unique_ptr<Slot[]> slots_;                   ///< Slot table
+  std::unique_ptr<std::atomic<std::uint32_t>[]> next_free_;  ///< Free-list links
+  std::atomic<std::uint64_t> free_head_;            ///< ABA tag (high) and head index (low)
+  std::atomic<std::size_t> size_{0};                ///< Live connection count
+  std::atomic<int> empty_waiters_{0};               ///< Threads in WaitUntilEmpty()
+  std::mutex empty_mutex_;                          ///< Pairs with empty_condition_
+  std::condition_variable empty_condition_;         ///< Notified when size_ drops to zero
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_CONNECTION_REGISTRY_H_
@@ -0,0 +1,229 @@
+#include "src/internal/listener_handoff.h"
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+constexpr char kRequest = 'R';      // Successor asks for the sockets
+constexpr char kAcknowledge = 'A';  // Successor accepts on them
+constexpr std::size_t kMaxListeners = 253;  // SCM_MAX_FD on Linux
+constexpr int kReceiveTimeoutSeconds = 5;
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+#if defined(MSG_CMSG_CLOEXEC)
+constexpr int kReceiveFlags = MSG_CMSG_CLOEXEC;
+#else
+constexpr int kReceiveFlags = 0;
+#endif
+
+unsigned long long InodeOf(const std::string& path) {
+  struct stat status;
+  return ::stat(path.c_str(), &status) == 0 ? static_cast<unsigned long long>(status.st_ino) : 0;
+}
+
+std::runtime_error HandoffError(const std::string& what) {
+  return std::runtime_error("Listener handoff failed: " + what + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+ListenerHandoff::ListenerHandoff(boost::asio::io_context& io_context, const std::string& path,
+                                 ListenersFunction listeners, CompleteFunction on_complete,
+                                 std::shared_ptr<spdlog::logger> logger)
+    : acceptor_(io_context),
+      path_(path),
+      listeners_(std::move(listeners)),
+      on_complete_(std::move(on_complete)),
+      logger_(std::move(logger)) {
+  // The predecessor keeps its socket open but unreachable once the path is replaced
+  ::unlink(path_.c_str());
+  const stream_protocol::endpoint endpoint(path_);
+  acceptor_.open(endpoint.protocol());
+  acceptor_.bind(endpoint);
+  acceptor_.listen();
+  inode_ = InodeOf(path_);
+}
+
+ListenerHandoff::~ListenerHandoff() {
+  boost::system::error_code ec;
+  acceptor_.close(ec);
+  if (inode_ != 0 && InodeOf(path_) == inode_) {
+    ::unlink(path_.c_str());
+  }
+}
+
+void ListenerHandoff::Start() {
+  StartAccept();
+}
+
+void ListenerHandoff::StartAccept() {
+  auto exchange = std::make_shared<Exchange>(acceptor_.get_executor());
+  acceptor_.async_accept(exchange->socket, [this, exchange](const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted) {
+      return;
+    }
+    if (error) {
+      logger_->warn("Listener handoff accept error: {}", error.message());
+      StartAccept();
+      return;
+    }
+
+    boost::asio::async_read(
+        exchange->socket, boost::asio::buffer(&exchange->byte, 1),
+        [this, exchange](const boost::system::error_code& read_error, std::size_t) {
+          if (!read_error && exchange->byte == kRequest) {
+            SendListeners(exchange);
+          }
+        });
+    StartAccept();
+  });
+}
+
+void ListenerHandoff::SendListeners(const std::shared_ptr<Exchange>& exchange) {
+  std::vector<int> listeners = listeners_();
+  if (listeners.empty() || listeners.size() > kMaxListeners) {
+    logger_->warn("Listener handoff requested with {} listening sockets", listeners.size());
+    return;
+  }
+
+  // One count byte, with the sockets attached as ancillary data
+  char count = static_cast<char>(listeners.size());
+  iovec data{&count, 1};
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * listeners.size()));
+  msghdr message{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  cmsghdr* header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(int) * listeners.size());
+  std::memcpy(CMSG_DATA(header), listeners.data(), sizeof(int) * listeners.size());
+
+  if (::sendmsg(exchange->socket.native_handle(), &message, kSendFlags) != 1) {
+    logger_->warn("Listener handoff send error: {}", std::strerror(errno));
+    return;
+  }
+
+  boost::asio::async_read(
+      exchange->socket, boost::asio::buffer(&exchange->byte, 1),
+      [this, exchange](const boost::system::error_code& error, std::size_t) {
+        if (error || exchange->byte != kAcknowledge) {
+          logger_->warn("Listener handoff was not acknowledged, keeping the listening sockets");
+          return;
+        }
+        logger_->info("Listening sockets handed off to the successor");
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+        on_complete_();
+      });
+}
+
+ListenerHandoffClient::ListenerHandoffClient(const std::string& path) {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::invalid_argument("listener_handoff_path is too long");
+  }
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    throw HandoffError("socket");
+  }
+  if (::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    // Nobody serves handoffs there: this is the first process
+    ::close(fd_);
+    fd_ = -1;
+    return;
+  }
+
+  // Do not hang forever on a predecessor that stopped running its io_context
+  timeval timeout{kReceiveTimeoutSeconds, 0};
+  ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+ListenerHandoffClient::~ListenerHandoffClient() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool ListenerHandoffClient::IsConnected() const {
+  return fd_ >= 0;
+}
+
+std::vector<int> ListenerHandoffClient::Receive() {
+  if (::send(fd_, &kRequest, 1, kSendFlags) != 1) {
+    throw HandoffError("request");
+  }
+
+  char count = 0;
+  iovec data{&count, 1};
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxListeners));
+  msghdr message{};
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  ssize_t received;
+  do {
+    received = ::recvmsg(fd_, &message, kReceiveFlags);
+  } while (received < 0 && errno == EINTR);
+  if (received != 1) {
+    if (received == 0) {
+      errno = ECONNRESET;
+    }
+    throw HandoffError("receive");
+  }
+
+  std::vector<int> listeners;
+  for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+       header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+      const std::size_t n = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const std::size_t offset = listeners.size();
+      listeners.resize(offset + n);
+      std::memcpy(listeners.data() + offset, CMSG_DATA(header), sizeof(int) * n);
+    }
+  }
+  if (listeners.size() != static_cast<unsigned char>(count) ||
+      (message.msg_flags & MSG_CTRUNC) != 0) {
+    for (int listener : listeners) {
+      ::close(listener);
+    }
+    errno = EPROTO;
+    throw HandoffError("unexpected socket count");
+  }
+  return listeners;
+}
+
+void ListenerHandoffClient::Acknowledge() {
+  if (::send(fd_, &kAcknowledge, 1, kSendFlags) != 1) {
+    throw HandoffError("acknowledge");
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
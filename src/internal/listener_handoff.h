@@ -0,0 +1,149 @@
+/**
+ * @file listener_handoff.h
+ * @brief Passing listening sockets to a successor process over a Unix domain socket
+ */
+
+#ifndef TCP_SERVER_INTERNAL_LISTENER_HANDOFF_H_
+#define TCP_SERVER_INTERNAL_LISTENER_HANDOFF_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tcp_server/asio.h"
+
+// Forward declaration
+namespace spdlog {
+class logger;
+}  // namespace spdlog
+
+namespace tcp_server {
+namespace internal {
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+/**
+ * @brief Predecessor side: hands the server's listening sockets to whoever asks
+ *
+ * Protocol, one exchange per connection on the Unix socket:
+ * 1. The successor sends one request byte.
+ * 2. The predecessor replies with one byte holding the socket count, with the
+ *    listening sockets attached as SCM_RIGHTS ancillary data.
+ * 3. The successor sends one acknowledgement byte once it accepts on them.
+ *
+ * Only the acknowledgement completes the handoff, so a successor that dies
+ * half way leaves the predecessor accepting as before. Both processes accept
+ * from the same kernel queues in between, so no connection is refused.
+ */
+class ListenerHandoff {
+ public:
+  using ListenersFunction = std::function<std::vector<int>()>;
+  using CompleteFunction = std::function<void()>;
+
+  /**
+   * @brief Bind the Unix socket, replacing a stale one at the same path
+   * @param io_context io_context the exchanges run on
+   * @param path File system path of the Unix socket
+   * @param listeners Returns the native handles of the listening sockets
+   * @param on_complete Called on the io_context once a successor acknowledged
+   * @param logger Logger for failed and completed handoffs
+   * @throws boost::system::system_error If the socket cannot be bound
+   */
+  ListenerHandoff(boost::asio::io_context& io_context, const std::string& path,
+                  ListenersFunction listeners, CompleteFunction on_complete,
+                  std::shared_ptr<spdlog::logger> logger);
+
+  /**
+   * @brief Close the Unix socket and remove its path unless a successor replaced it
+   */
+  ~ListenerHandoff();
+
+  ListenerHandoff(const ListenerHandoff&) = delete;
+  ListenerHandoff& operator=(const ListenerHandoff&) = delete;
+
+  /**
+   * @brief Start serving handoff requests
+   */
+  void Start();
+
+ private:
+  using stream_protocol = boost::asio::local::stream_protocol;
+
+  /**
+   * @brief One exchange with a successor
+   */
+  struct Exchange {
+    explicit Exchange(const boost::asio::any_io_executor& executor) : socket(executor) {}
+
+    stream_protocol::socket socket;  ///< Connection from the successor
+    char byte = 0;                   ///< Request or acknowledgement byte
+  };
+
+  /**
+   * @brief Accept the next successor
+   */
+  void StartAccept();
+
+  /**
+   * @brief Send the listening sockets and wait for the acknowledgement
+   * @param exchange Exchange whose request byte was received
+   */
+  void SendListeners(const std::shared_ptr<Exchange>& exchange);
+
+  stream_protocol::acceptor acceptor_;  ///< Unix socket successors connect to
+  std::string path_;                    ///< Path of the Unix socket
+  unsigned long long inode_ = 0;        ///< Inode bound at path_, to detect replacement
+  ListenersFunction listeners_;         ///< Source of the sockets to hand off
+  CompleteFunction on_complete_;        ///< Called after a successful handoff
+  std::shared_ptr<spdlog::logger> logger_;  ///< Logger
+};
+
+/**
+ * @brief Successor side: takes over the listening sockets of a running server
+ */
+class ListenerHandoffClient {
+ public:
+  /**
+   * @brief Connect to a predecessor
+   * @param path File system path of the predecessor's Unix socket
+   */
+  explicit ListenerHandoffClient(const std::string& path);
+
+  /**
+   * @brief Close the connection to the predecessor
+   */
+  ~ListenerHandoffClient();
+
+  ListenerHandoffClient(const ListenerHandoffClient&) = delete;
+  ListenerHandoffClient& operator=(const ListenerHandoffClient&) = delete;
+
+  /**
+   * @brief Whether a predecessor is serving handoffs at the path
+   * @return false if nothing listens there, in which case the server binds normally
+   */
+  bool IsConnected() const;
+
+  /**
+   * @brief Request and receive the listening sockets
+   * @return Native handles now owned by the caller
+   * @throws std::runtime_error If the exchange fails
+   */
+  std::vector<int> Receive();
+
+  /**
+   * @brief Tell the predecessor to stop accepting
+   * @throws std::runtime_error If the acknowledgement cannot be sent
+   */
+  void Acknowledge();
+
+ private:
+  int fd_ = -1;  ///< Connected Unix socket, or -1
+};
+
+#endif  // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_LISTENER_HANDOFF_H_
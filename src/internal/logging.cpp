@@ -0,0 +1,223 @@
+#include "src/internal/logging.h"
+
+#include <spdlog/details/os.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+// How long the background thread sleeps when no producer wakes it
+constexpr std::chrono::milliseconds kIdleWait(100);
+
+std::size_t RoundUpToPowerOfTwo(std::size_t size) {
+  std::size_t result = 1;
+  while (result < size) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+AsyncLogSink::AsyncLogSink(std::vector<spdlog::sink_ptr> sinks, std::size_t capacity)
+    : sinks_(std::move(sinks)),
+      slots_(new Slot[RoundUpToPowerOfTwo(std::max<std::size_t>(capacity, 2))]),
+      mask_(RoundUpToPowerOfTwo(std::max<std::size_t>(capacity, 2)) - 1) {
+  for (std::size_t i = 0; i <= mask_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  thread_ = std::thread([this] { Run(); });
+}
+
+AsyncLogSink::~AsyncLogSink() {
+  stop_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_cv_.notify_one();
+  }
+  thread_.join();
+}
+
+void AsyncLogSink::log(const spdlog::details::log_msg& message) {
+  std::uint64_t position = enqueue_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & mask_];
+    const std::uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const auto difference = static_cast<std::int64_t>(sequence - position);
+    if (difference == 0) {
+      if (enqueue_position_.compare_exchange_weak(position, position + 1,
+                                                  std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      // Full: the I/O thread must not wait for the disk
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->level = message.level;
+  slot->time = message.time;
+  slot->thread_id = message.thread_id;
+  slot->source = message.source;
+  slot->logger_name.assign(message.logger_name.data(), message.logger_name.size());
+  slot->payload.assign(message.payload.data(), message.payload.size());
+  slot->sequence.store(position + 1, std::memory_order_release);
+
+  // A wakeup missed in a race with the thread going to sleep only delays output by kIdleWait
+  if (sleeping_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_cv_.notify_one();
+  }
+}
+
+void AsyncLogSink::flush() {
+  const std::uint64_t target = enqueue_position_.load();
+  while (written_.load(std::memory_order_acquire) < target && !stop_.load()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      wake_cv_.notify_one();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (auto& sink : sinks_) {
+    sink->flush();
+  }
+}
+
+void AsyncLogSink::set_pattern(const std::string& pattern) {
+  for (auto& sink : sinks_) {
+    sink->set_pattern(pattern);
+  }
+}
+
+void AsyncLogSink::set_formatter(std::unique_ptr<spdlog::formatter> formatter) {
+  for (auto& sink : sinks_) {
+    sink->set_formatter(formatter->clone());
+  }
+}
+
+void AsyncLogSink::Run() {
+  while (true) {
+    if (WriteNext()) {
+      continue;
+    }
+
+    // Queue drained: report drops and flush once per batch
+    ReportDropped();
+    for (auto& sink : sinks_) {
+      sink->flush();
+    }
+    if (stop_.load()) {
+      // Producers may still have been mid-write when stop was set
+      if (!WriteNext()) {
+        return;
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.store(true);
+    if (!WriteNext() && !stop_.load()) {
+      wake_cv_.wait_for(lock, kIdleWait);
+    }
+    sleeping_.store(false);
+  }
+}
+
+bool AsyncLogSink::WriteNext() {
+  Slot& slot = slots_[dequeue_position_ & mask_];
+  if (slot.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1) {
+    return false;
+  }
+
+  spdlog::details::log_msg message(slot.time, slot.source, slot.logger_name, slot.level,
+                                   slot.payload);
+  message.thread_id = slot.thread_id;
+  for (auto& sink : sinks_) {
+    if (sink->should_log(message.level)) {
+      sink->log(message);
+    }
+  }
+
+  slot.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+  ++dequeue_position_;
+  written_.store(dequeue_position_, std::memory_order_release);
+  return true;
+}
+
+void AsyncLogSink::ReportDropped() {
+  const std::uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped == reported_dropped_) {
+    return;
+  }
+
+  const std::string text =
+      std::to_string(dropped - reported_dropped_) + " log messages dropped, queue full";
+  reported_dropped_ = dropped;
+  spdlog::details::log_msg message(spdlog::source_loc{}, "tcp_server", spdlog::level::warn, text);
+  message.thread_id = spdlog::details::os::thread_id();
+  for (auto& sink : sinks_) {
+    if (sink->should_log(message.level)) {
+      sink->log(message);
+    }
+  }
+}
+
+LogLimiter::LogLimiter(unsigned int burst, std::chrono::steady_clock::duration interval)
+    : burst_(burst),
+      interval_(interval.count()),
+      window_start_(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+
+bool LogLimiter::Allow(std::uint64_t* suppressed) {
+  *suppressed = 0;
+  if (burst_ == 0) {
+    return true;
+  }
+
+  const std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+  std::int64_t start = window_start_.load(std::memory_order_relaxed);
+  if (now - start >= interval_ &&
+      window_start_.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+    count_.store(0, std::memory_order_relaxed);
+  }
+
+  if (count_.fetch_add(1, std::memory_order_relaxed) < burst_) {
+    *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  suppressed_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+std::string SuppressedNote(std::uint64_t suppressed) {
+  if (suppressed == 0) {
+    return std::string();
+  }
+  return " (" + std::to_string(suppressed) + " similar messages suppressed)";
+}
+
+std::shared_ptr<spdlog::logger> CreateServerLogger(bool asynchronous, std::size_t queue_size) {
+  const std::shared_ptr<spdlog::logger> base = spdlog::default_logger();
+  std::shared_ptr<spdlog::logger> logger;
+  if (asynchronous) {
+    logger = std::make_shared<spdlog::logger>(
+        "tcp_server", std::make_shared<AsyncLogSink>(base->sinks(), queue_size));
+  } else {
+    logger = std::make_shared<spdlog::logger>("tcp_server", base->sinks().begin(),
+                                              base->sinks().end());
+  }
+  logger->set_level(base->level());
+  logger->flush_on(base->flush_level());
+  return logger;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
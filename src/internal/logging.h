@@ -0,0 +1,167 @@
+/**
+ * @file logging.h
+ * @brief Asynchronous log sink and rate limiter for the server's own logging
+ */
+
+#ifndef TCP_SERVER_INTERNAL_LOGGING_H_
+#define TCP_SERVER_INTERNAL_LOGGING_H_
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/sink.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Sink that hands messages to a background thread through a bounded lock-free queue
+ *
+ * Logging threads copy the message into a preallocated slot of a ring buffer
+ * (a Vyukov-style bounded queue, one compare-and-swap per message) and return;
+ * the background thread writes the messages to the wrapped sinks in order and
+ * flushes them whenever the queue runs empty. When the queue is full the
+ * message is dropped rather than blocking the I/O thread, and the number of
+ * dropped messages is logged once there is room again.
+ */
+class AsyncLogSink final : public spdlog::sinks::sink {
+ public:
+  /**
+   * @brief Constructor; starts the background thread
+   * @param sinks Sinks the messages are written to
+   * @param capacity Number of queued messages, rounded up to a power of two
+   */
+  AsyncLogSink(std::vector<spdlog::sink_ptr> sinks, std::size_t capacity);
+
+  /**
+   * @brief Destructor; writes every queued message and stops the background thread
+   */
+  ~AsyncLogSink() override;
+
+  AsyncLogSink(const AsyncLogSink&) = delete;
+  AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+  void log(const spdlog::details::log_msg& message) override;
+
+  /**
+   * @brief Wait until every message queued so far is written, then flush the sinks
+   */
+  void flush() override;
+
+  void set_pattern(const std::string& pattern) override;
+  void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override;
+
+  /**
+   * @brief Number of messages dropped because the queue was full
+   * @return Dropped message count
+   */
+  std::uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  /**
+   * @brief Queued message; strings keep their capacity when the slot is reused
+   */
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> sequence{0};  ///< Queue position the slot is ready for
+    spdlog::level::level_enum level = spdlog::level::off;  ///< Message level
+    spdlog::log_clock::time_point time;      ///< Time the message was logged
+    std::size_t thread_id = 0;               ///< Logging thread
+    spdlog::source_loc source;               ///< Source location (file and function are static)
+    std::string logger_name;                 ///< Name of the logger
+    std::string payload;                     ///< Formatted message text
+  };
+
+  /**
+   * @brief Background thread body
+   */
+  void Run();
+
+  /**
+   * @brief Write the next message if one is ready
+   * @return true if a message was written
+   */
+  bool WriteNext();
+
+  /**
+   * @brief Log how many messages were dropped since the last report
+   */
+  void ReportDropped();
+
+  std::vector<spdlog::sink_ptr> sinks_;  ///< Destination sinks
+  std::unique_ptr<Slot[]> slots_;        ///< Ring buffer
+  std::size_t mask_;                     ///< Capacity - 1
+  alignas(64) std::atomic<std::uint64_t> enqueue_position_{0};  ///< Next position to claim
+  alignas(64) std::uint64_t dequeue_position_ = 0;  ///< Next position to write (thread only)
+  std::atomic<std::uint64_t> written_{0};           ///< Messages written so far
+  std::atomic<std::uint64_t> dropped_{0};           ///< Messages dropped so far
+  std::uint64_t reported_dropped_ = 0;              ///< Drops already reported (thread only)
+  std::atomic<bool> sleeping_{false};               ///< The thread waits for messages
+  std::atomic<bool> stop_{false};                   ///< Set by the destructor
+  std::mutex mutex_;                                ///< Used with wake_cv_
+  std::condition_variable wake_cv_;                 ///< Wakes the thread
+  std::thread thread_;                              ///< Background writer
+};
+
+/**
+ * @brief Limits how often a repeated event is logged
+ *
+ * Allows a burst of messages per interval and suppresses the rest, counting
+ * them so the next allowed message can say how many were skipped. Lock-free.
+ */
+class LogLimiter {
+ public:
+  /**
+   * @brief Constructor
+   * @param burst Messages allowed per interval (0 = unlimited)
+   * @param interval Length of an interval
+   */
+  explicit LogLimiter(unsigned int burst,
+                      std::chrono::steady_clock::duration interval = std::chrono::seconds(1));
+
+  /**
+   * @brief Decide whether to log one occurrence of the event
+   * @param suppressed Set to the number of occurrences skipped since the last allowed one
+   * @return true if the occurrence should be logged
+   */
+  bool Allow(std::uint64_t* suppressed);
+
+ private:
+  unsigned int burst_;                             ///< Messages allowed per interval
+  std::int64_t interval_;                          ///< Interval in steady clock ticks
+  std::atomic<std::int64_t> window_start_;         ///< Start of the current interval
+  std::atomic<unsigned int> count_{0};             ///< Occurrences in the current interval
+  std::atomic<std::uint64_t> suppressed_{0};       ///< Occurrences skipped and not yet reported
+};
+
+/**
+ * @brief Note appended to a rate-limited message
+ * @param suppressed Value returned by LogLimiter::Allow()
+ * @return Empty, or a note on how many messages were skipped
+ */
+std::string SuppressedNote(std::uint64_t suppressed);
+
+/**
+ * @brief Create the logger used by a server
+ *
+ * The logger writes to the sinks of spdlog's default logger and copies its
+ * level, so configuring spdlog before constructing the server configures the
+ * server's logging too.
+ * @param asynchronous Write through an AsyncLogSink instead of the sinks directly
+ * @param queue_size Capacity of the asynchronous queue
+ * @return New logger
+ */
+std::shared_ptr<spdlog::logger> CreateServerLogger(bool asynchronous, std::size_t queue_size);
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_LOGGING_H_
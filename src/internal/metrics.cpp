@@ -0,0 +1,201 @@
+#include "src/internal/metrics.h"
+
+#include <boost/asio/error.hpp>
+#if defined(TCP_SERVER_HAS_TLS)
+#include <boost/asio/ssl/error.hpp>
+#endif
+
+#include <algorithm>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+/**
+ * @brief Shard bound to the current thread and the metrics object it belongs to
+ */
+struct ThreadBinding {
+  const ServerMetrics* owner = nullptr;
+  void* shard = nullptr;
+};
+
+thread_local ThreadBinding thread_binding;
+
+const char* const kErrorCategoryNames[] = {
+    "system", "asio.misc", "asio.netdb", "asio.addrinfo", "framing", "handler", "tls", "other",
+};
+
+}  // namespace
+
+ServerMetrics::ServerMetrics() : shared_shard_(std::make_unique<Shard>()) {}
+
+ServerMetrics::~ServerMetrics() = default;
+
+void ServerMetrics::BindThread() {
+  auto shard = std::make_unique<Shard>();
+  thread_binding.owner = this;
+  thread_binding.shard = shard.get();
+
+  std::lock_guard<std::mutex> lock(shards_mutex_);
+  shards_.push_back(std::move(shard));
+}
+
+ServerMetrics::Shard* ServerMetrics::LocalShard() const {
+  const ThreadBinding& binding = thread_binding;
+  return binding.owner == this ? static_cast<Shard*>(binding.shard) : nullptr;
+}
+
+void ServerMetrics::Add(Counter counter, std::uint64_t value) {
+  if (Shard* shard = LocalShard()) {
+    Increment(shard->counters[counter], value);
+    return;
+  }
+  std::lock_guard<SpinLock> lock(shared_lock_);
+  Increment(shared_shard_->counters[counter], value);
+}
+
+void ServerMetrics::AddError(const boost::system::error_code& error) {
+  if (!error || error == boost::asio::error::eof ||
+      error == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  const boost::system::error_category& category = error.category();
+  if (category == boost::system::system_category()) {
+    AddError(kSystemError);
+  } else if (category == boost::asio::error::get_misc_category()) {
+    AddError(kMiscError);
+  } else if (category == boost::asio::error::get_netdb_category()) {
+    AddError(kNetdbError);
+  } else if (category == boost::asio::error::get_addrinfo_category()) {
+    AddError(kAddrinfoError);
+#if defined(TCP_SERVER_HAS_TLS)
+  } else if (category == boost::asio::error::get_ssl_category()) {
+    AddError(kTlsError);
+#endif
+  } else {
+    AddError(kOtherError);
+  }
+}
+
+void ServerMetrics::AddError(ErrorCategory category) {
+  if (Shard* shard = LocalShard()) {
+    Increment(shard->errors[category], 1);
+    return;
+  }
+  std::lock_guard<SpinLock> lock(shared_lock_);
+  Increment(shared_shard_->errors[category], 1);
+}
+
+void ServerMetrics::RecordHandlerTime(std::uint64_t nanoseconds,
+                                      std::chrono::steady_clock::time_point end) {
+  if (Shard* shard = LocalShard()) {
+    shard->handler_time.Record(nanoseconds);
+    UpdateAverage(*shard, nanoseconds, end);
+    return;
+  }
+  std::lock_guard<SpinLock> lock(shared_lock_);
+  shared_shard_->handler_time.Record(nanoseconds);
+  UpdateAverage(*shared_shard_, nanoseconds, end);
+}
+
+void ServerMetrics::UpdateAverage(Shard& shard, std::uint64_t nanoseconds,
+                                  std::chrono::steady_clock::time_point end) {
+  // Weight 1/8 for the newest sample; single writer, so load and store suffice
+  std::atomic<std::uint64_t>& average = shard.handler_time_average;
+  const std::uint64_t previous = average.load(std::memory_order_relaxed);
+  average.store(previous == 0 ? nanoseconds : previous - previous / 8 + nanoseconds / 8,
+                std::memory_order_relaxed);
+  shard.handler_time_updated.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count(),
+      std::memory_order_relaxed);
+}
+
+void ServerMetrics::RecordRequestTime(std::uint64_t nanoseconds) {
+  if (Shard* shard = LocalShard()) {
+    shard->request_time.Record(nanoseconds);
+    return;
+  }
+  std::lock_guard<SpinLock> lock(shared_lock_);
+  shared_shard_->request_time.Record(nanoseconds);
+}
+
+std::uint64_t ServerMetrics::RecentHandlerTime(std::chrono::steady_clock::duration window) const {
+  const std::int64_t oldest = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  (std::chrono::steady_clock::now() - window).time_since_epoch())
+                                  .count();
+
+  // Shards without a sample in the window hold a stale average and are skipped
+  auto recent = [oldest](const Shard& shard) -> std::uint64_t {
+    if (shard.handler_time_updated.load(std::memory_order_relaxed) < oldest) {
+      return 0;
+    }
+    return shard.handler_time_average.load(std::memory_order_relaxed);
+  };
+
+  std::uint64_t result = recent(*shared_shard_);
+  std::lock_guard<std::mutex> lock(shards_mutex_);
+  for (const auto& shard : shards_) {
+    result = std::max(result, recent(*shard));
+  }
+  return result;
+}
+
+MetricsSnapshot ServerMetrics::Snapshot() const {
+  std::uint64_t counters[kCounterCount] = {};
+  std::uint64_t errors[kErrorCategoryCount] = {};
+  MetricsSnapshot snapshot;
+
+  auto accumulate = [&](const Shard& shard) {
+    for (std::size_t i = 0; i < kCounterCount; ++i) {
+      counters[i] += shard.counters[i].load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < kErrorCategoryCount; ++i) {
+      errors[i] += shard.errors[i].load(std::memory_order_relaxed);
+    }
+    snapshot.handler_time_ns.Merge(shard.handler_time);
+    snapshot.client_request_time_ns.Merge(shard.request_time);
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(shards_mutex_);
+    for (const auto& shard : shards_) {
+      accumulate(*shard);
+    }
+  }
+  accumulate(*shared_shard_);
+
+  snapshot.connections_accepted = counters[kConnectionsAccepted];
+  snapshot.connections_rejected = counters[kConnectionsRejected];
+  snapshot.connections_timed_out = counters[kConnectionsTimedOut];
+  snapshot.accept_pauses = counters[kAcceptPauses];
+  snapshot.connection_pool_grown = counters[kConnectionPoolGrown];
+  snapshot.messages_published = counters[kMessagesPublished];
+  snapshot.messages_dropped = counters[kMessagesDropped];
+  snapshot.slow_subscribers_disconnected = counters[kSlowSubscribersDisconnected];
+  snapshot.bytes_received = counters[kBytesReceived];
+  snapshot.bytes_sent = counters[kBytesSent];
+  snapshot.read_operations = counters[kReadOperations];
+  snapshot.write_operations = counters[kWriteOperations];
+  snapshot.handler_invocations = counters[kHandlerInvocations];
+  snapshot.tls_handshakes = counters[kTlsHandshakes];
+  snapshot.tls_sessions_resumed = counters[kTlsSessionsResumed];
+  snapshot.tls_kernel_offloads = counters[kTlsKernelOffloads];
+  snapshot.response_cache_hits = counters[kResponseCacheHits];
+  snapshot.response_cache_misses = counters[kResponseCacheMisses];
+  snapshot.client_connections_opened = counters[kClientConnectionsOpened];
+  snapshot.client_requests = counters[kClientRequests];
+  snapshot.client_requests_failed = counters[kClientRequestsFailed];
+  snapshot.client_bytes_sent = counters[kClientBytesSent];
+  snapshot.client_bytes_received = counters[kClientBytesReceived];
+  for (std::size_t i = 0; i < kErrorCategoryCount; ++i) {
+    if (errors[i] != 0) {
+      snapshot.errors[kErrorCategoryNames[i]] = errors[i];
+    }
+  }
+  return snapshot;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
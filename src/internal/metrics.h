@@ -0,0 +1,189 @@
+/**
+ * @file metrics.h
+ * @brief Per-thread sharded server counters
+ */
+
+#ifndef TCP_SERVER_INTERNAL_METRICS_H_
+#define TCP_SERVER_INTERNAL_METRICS_H_
+
+#include <atomic>
+#include <boost/system/error_code.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "src/internal/connection_registry.h"
+#include "tcp_server/latency_histogram.h"
+#include "tcp_server/server_metrics.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Server-wide counters, written without locks and aggregated on read
+ *
+ * Every server thread binds one shard at startup and is the only writer of
+ * that shard, so recording an event is a relaxed load and store on a cache
+ * line no other thread writes. Events recorded on threads that are not bound
+ * (for example while the server is being constructed) go to a shared shard
+ * guarded by a spin lock.
+ */
+class ServerMetrics {
+ public:
+  /**
+   * @brief Monotonic counters
+   */
+  enum Counter : std::size_t {
+    kConnectionsAccepted,
+    kConnectionsRejected,
+    kConnectionsTimedOut,
+    kAcceptPauses,
+    kConnectionPoolGrown,
+    kMessagesPublished,
+    kMessagesDropped,
+    kSlowSubscribersDisconnected,
+    kBytesReceived,
+    kBytesSent,
+    kReadOperations,
+    kWriteOperations,
+    kHandlerInvocations,
+    kTlsHandshakes,
+    kTlsSessionsResumed,
+    kTlsKernelOffloads,
+    kResponseCacheHits,
+    kResponseCacheMisses,
+    kClientConnectionsOpened,
+    kClientRequests,
+    kClientRequestsFailed,
+    kClientBytesSent,
+    kClientBytesReceived,
+    kCounterCount,
+  };
+
+  /**
+   * @brief Error categories tracked separately
+   */
+  enum ErrorCategory : std::size_t {
+    kSystemError,    ///< boost::system::system_category
+    kMiscError,      ///< boost::asio::error::misc_category
+    kNetdbError,     ///< boost::asio::error::netdb_category
+    kAddrinfoError,  ///< boost::asio::error::addrinfo_category
+    kFramingError,   ///< FramingError thrown by the framer
+    kHandlerError,   ///< Exception thrown by the message handler
+    kTlsError,       ///< boost::asio::error::get_ssl_category (OpenSSL errors)
+    kOtherError,     ///< Any other error category
+    kErrorCategoryCount,
+  };
+
+  ServerMetrics();
+  ~ServerMetrics();
+
+  ServerMetrics(const ServerMetrics&) = delete;
+  ServerMetrics& operator=(const ServerMetrics&) = delete;
+
+  /**
+   * @brief Make the calling thread the writer of a shard of its own
+   *
+   * Must be called before the thread records anything. Each thread must bind
+   * at most once per server.
+   */
+  void BindThread();
+
+  /**
+   * @brief Add to a counter
+   * @param counter Counter to increment
+   * @param value Amount to add
+   */
+  void Add(Counter counter, std::uint64_t value = 1);
+
+  /**
+   * @brief Count an I/O error by its category
+   *
+   * End of file and operations aborted by closing the socket are not errors
+   * and are ignored.
+   * @param error Error reported by an asynchronous operation
+   */
+  void AddError(const boost::system::error_code& error);
+
+  /**
+   * @brief Count an error that has no error_code
+   * @param category kFramingError, kHandlerError or kOtherError
+   */
+  void AddError(ErrorCategory category);
+
+  /**
+   * @brief Record the duration of one handler call
+   * @param nanoseconds Handler run time
+   * @param end When the handler returned
+   */
+  void RecordHandlerTime(std::uint64_t nanoseconds, std::chrono::steady_clock::time_point end);
+
+  /**
+   * @brief Record the round trip of one TcpClient request
+   * @param nanoseconds Time from the request call to its response
+   */
+  void RecordRequestTime(std::uint64_t nanoseconds);
+
+  /**
+   * @brief Recent handler run time, as the highest moving average of any thread
+   *
+   * Only threads that recorded a handler time within the window count, so the
+   * average of a thread that has gone idle since a slow request expires
+   * instead of standing forever. Takes the shard mutex, so it is meant for
+   * occasional checks such as admission decisions rather than per-request use.
+   * @param window How recent the last sample of a thread must be
+   * @return Exponentially weighted average in nanoseconds (0 if nothing was recorded recently)
+   */
+  std::uint64_t RecentHandlerTime(std::chrono::steady_clock::duration window) const;
+
+  /**
+   * @brief Aggregate every shard
+   * @return Current totals; gauges such as the active connection count are left to the caller
+   */
+  MetricsSnapshot Snapshot() const;
+
+ private:
+  /**
+   * @brief Counters written by a single thread, on cache lines of their own
+   */
+  struct alignas(64) Shard {
+    std::atomic<std::uint64_t> counters[kCounterCount] = {};       ///< Counter values
+    std::atomic<std::uint64_t> errors[kErrorCategoryCount] = {};   ///< Error counts
+    LatencyHistogram handler_time;                                 ///< Handler time (ns)
+    LatencyHistogram request_time;                                 ///< Client round trips (ns)
+    std::atomic<std::uint64_t> handler_time_average{0};            ///< Moving average (ns)
+    std::atomic<std::int64_t> handler_time_updated{0};             ///< Last sample (steady_clock ns)
+  };
+
+  /**
+   * @brief Fold one handler time into a shard's moving average
+   */
+  static void UpdateAverage(Shard& shard, std::uint64_t nanoseconds,
+                            std::chrono::steady_clock::time_point end);
+
+  /**
+   * @brief Add to a value owned by a single writer
+   */
+  static void Increment(std::atomic<std::uint64_t>& value, std::uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Shard of the calling thread
+   * @return The bound shard, or nullptr if the thread is not bound to this server
+   */
+  Shard* LocalShard() const;
+
+  mutable std::mutex shards_mutex_;             ///< Guards shards_ (taken when binding and reading)
+  std::vector<std::unique_ptr<Shard>> shards_;  ///< One shard per bound thread
+  std::unique_ptr<Shard> shared_shard_;         ///< Shard for unbound threads
+  mutable SpinLock shared_lock_;                ///< Guards shared_shard_ writes
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_METRICS_H_
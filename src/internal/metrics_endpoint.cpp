@@ -0,0 +1,144 @@
+#include "src/internal/metrics_endpoint.h"
+
+#include <spdlog/spdlog.h>
+
+#include <memory>
+#include <string_view>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+constexpr std::size_t kMaxRequestSize = 8 * 1024;  // Request line and headers
+constexpr std::string_view kMetricsPath = "/metrics";
+
+/**
+ * @brief State of one scrape connection
+ */
+struct Scrape {
+  explicit Scrape(const boost::asio::any_io_executor& executor)
+      : socket(executor), timer(executor), request(kMaxRequestSize) {}
+
+  boost::asio::ip::tcp::socket socket;
+  boost::asio::steady_timer timer;
+  boost::asio::streambuf request;
+  std::string response;
+};
+
+// Build an HTTP/1.0 response that closes the connection
+std::string MakeResponse(std::string_view status, std::string_view content_type,
+                         std::string_view body) {
+  std::string response = "HTTP/1.0 ";
+  response.append(status);
+  response.append("\r\nContent-Type: ");
+  response.append(content_type);
+  response.append("\r\nContent-Length: " + std::to_string(body.size()) +
+                  "\r\nConnection: close\r\n\r\n");
+  response.append(body);
+  return response;
+}
+
+}  // namespace
+
+MetricsEndpoint::MetricsEndpoint(boost::asio::io_context& io_context,
+                                 const tcp::endpoint& endpoint,
+                                 std::function<std::string()> render,
+                                 std::shared_ptr<spdlog::logger> logger,
+                                 std::chrono::steady_clock::duration request_timeout)
+    : acceptor_(io_context),
+      endpoint_(endpoint),
+      render_(std::move(render)),
+      logger_(std::move(logger)),
+      request_timeout_(request_timeout) {
+  Open();
+}
+
+void MetricsEndpoint::Open() {
+  acceptor_.open(endpoint_.protocol());
+  acceptor_.set_option(tcp::acceptor::reuse_address(true));
+  acceptor_.bind(endpoint_);
+  acceptor_.listen();
+}
+
+void MetricsEndpoint::Start() {
+  if (!acceptor_.is_open()) {
+    Open();
+  }
+  StartAccept();
+}
+
+void MetricsEndpoint::Stop() {
+  boost::system::error_code ec;
+  acceptor_.close(ec);
+}
+
+unsigned short MetricsEndpoint::GetPort() const {
+  return acceptor_.local_endpoint().port();
+}
+
+void MetricsEndpoint::StartAccept() {
+  auto scrape = std::make_shared<Scrape>(acceptor_.get_executor());
+  acceptor_.async_accept(scrape->socket, [this, scrape](const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted || !acceptor_.is_open()) {
+      return;
+    }
+    if (error) {
+      logger_->warn("Metrics endpoint accept error: {}", error.message());
+      StartAccept();
+      return;
+    }
+
+    // Idle and slow clients are cut off instead of holding the socket
+    scrape->timer.expires_after(request_timeout_);
+    scrape->timer.async_wait([scrape](const boost::system::error_code& timer_error) {
+      if (!timer_error) {
+        boost::system::error_code ec;
+        scrape->socket.close(ec);
+      }
+    });
+
+    boost::asio::async_read_until(
+        scrape->socket, scrape->request, "\r\n\r\n",
+        [this, scrape](const boost::system::error_code& read_error, std::size_t) {
+          if (read_error) {
+            scrape->timer.cancel();
+            return;
+          }
+
+          // Request line: method, target and version separated by single spaces
+          const auto data = scrape->request.data();
+          const std::string_view request(static_cast<const char*>(data.data()), data.size());
+          const std::string_view line = request.substr(0, request.find("\r\n"));
+          const std::size_t method_end = line.find(' ');
+          const std::string_view method = line.substr(0, method_end);
+          std::string_view path = method_end == std::string_view::npos
+                                      ? std::string_view()
+                                      : line.substr(method_end + 1);
+          path = path.substr(0, path.find(' '));
+          path = path.substr(0, path.find('?'));
+
+          if (method != "GET") {
+            scrape->response = MakeResponse("405 Method Not Allowed", "text/plain", "");
+          } else if (path != kMetricsPath) {
+            scrape->response = MakeResponse("404 Not Found", "text/plain", "");
+          } else {
+            scrape->response =
+                MakeResponse("200 OK", "text/plain; version=0.0.4", render_());
+          }
+          boost::asio::async_write(
+              scrape->socket, boost::asio::buffer(scrape->response),
+              [scrape](const boost::system::error_code&, std::size_t) {
+                scrape->timer.cancel();
+                boost::system::error_code ec;
+                scrape->socket.shutdown(tcp::socket::shutdown_both, ec);
+                scrape->socket.close(ec);
+              });
+        });
+
+    StartAccept();
+  });
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,93 @@
+/**
+ * @file metrics_endpoint.h
+ * @brief Minimal HTTP endpoint serving metrics in the Prometheus text format
+ */
+
+#ifndef TCP_SERVER_INTERNAL_METRICS_ENDPOINT_H_
+#define TCP_SERVER_INTERNAL_METRICS_ENDPOINT_H_
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "tcp_server/asio.h"
+
+// Forward declaration
+namespace spdlog {
+class logger;
+}  // namespace spdlog
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Admin listener answering "GET /metrics" with the current metrics
+ *
+ * Each scrape is served on its own short-lived connection: the request line
+ * and headers are read, one HTTP/1.0 response is written and the socket is
+ * closed. Other paths get 404 and other methods 405. A client that has not
+ * been answered within the request timeout is disconnected. Runs on the
+ * io_context passed to the constructor.
+ */
+class MetricsEndpoint {
+ public:
+  using tcp = boost::asio::ip::tcp;
+
+  /**
+   * @brief Constructor
+   * @param io_context I/O context the listener runs on
+   * @param endpoint Address and port to listen on
+   * @param render Produces the response body for each request
+   * @param logger Logger for accept errors
+   * @param request_timeout Time a client has to send its request and read the response
+   * @throws boost::system::system_error If the port cannot be bound
+   */
+  MetricsEndpoint(boost::asio::io_context& io_context, const tcp::endpoint& endpoint,
+                  std::function<std::string()> render, std::shared_ptr<spdlog::logger> logger,
+                  std::chrono::steady_clock::duration request_timeout = std::chrono::seconds(5));
+
+  MetricsEndpoint(const MetricsEndpoint&) = delete;
+  MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+  /**
+   * @brief Start accepting scrape requests, binding the port again after Stop()
+   * @throws boost::system::system_error If the port cannot be bound
+   */
+  void Start();
+
+  /**
+   * @brief Close the listener and release the port
+   *
+   * Must not run concurrently with the io_context's handlers.
+   */
+  void Stop();
+
+  /**
+   * @brief Port the listener is bound to
+   * @return Local port
+   */
+  unsigned short GetPort() const;
+
+ private:
+  /**
+   * @brief Open, bind and listen on endpoint_
+   */
+  void Open();
+
+  /**
+   * @brief Accept the next scrape connection
+   */
+  void StartAccept();
+
+  tcp::acceptor acceptor_;               ///< Admin listening socket
+  tcp::endpoint endpoint_;               ///< Address the listener binds
+  std::function<std::string()> render_;  ///< Body of each response
+  std::shared_ptr<spdlog::logger> logger_;  ///< Logger
+  std::chrono::steady_clock::duration request_timeout_;  ///< Deadline of each scrape
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_METRICS_ENDPOINT_H_
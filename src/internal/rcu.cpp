@@ -0,0 +1,74 @@
+#include "src/internal/rcu.h"
+
+#include <stdexcept>
+#include <thread>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+// Per-thread state, trivially initialized so that accessing it needs no guard
+struct ThreadState {
+  std::size_t stripe = RcuDomain::kStripes;  ///< Counter stripe, kStripes until assigned
+  unsigned int read_depth = 0;               ///< Read sections entered, in any domain
+};
+
+thread_local ThreadState thread_state;
+
+// State of the calling thread, with its stripe assigned round robin on first use
+ThreadState& CurrentThread() {
+  static std::atomic<std::size_t> next_stripe{0};
+  ThreadState& state = thread_state;
+  if (state.stripe == RcuDomain::kStripes) {
+    state.stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % RcuDomain::kStripes;
+  }
+  return state;
+}
+
+}  // namespace
+
+RcuDomain::ReadGuard::ReadGuard(RcuDomain& domain) {
+  ThreadState& state = CurrentThread();
+  const std::size_t epoch = domain.epoch_.load(std::memory_order_acquire);
+  counter_ = &domain.stripes_[state.stripe].readers[epoch];
+  // Sequentially consistent, so the count is visible before the reader loads
+  // the published pointer
+  counter_->fetch_add(1, std::memory_order_seq_cst);
+  read_depth_ = &state.read_depth;
+  ++*read_depth_;
+}
+
+RcuDomain::ReadGuard::~ReadGuard() {
+  --*read_depth_;
+  counter_->fetch_sub(1, std::memory_order_release);
+}
+
+void RcuDomain::Synchronize() {
+  if (InReadSection()) {
+    throw std::logic_error("RCU grace period requested inside a read section");
+  }
+  // A reader may have loaded the epoch just before a flip and counted itself
+  // in either one, so both epochs are drained
+  for (int flip = 0; flip < 2; ++flip) {
+    const std::size_t old_epoch = epoch_.load(std::memory_order_relaxed);
+    epoch_.store(old_epoch ^ 1, std::memory_order_seq_cst);
+    WaitForReaders(old_epoch);
+  }
+}
+
+bool RcuDomain::InReadSection() {
+  return thread_state.read_depth > 0;
+}
+
+void RcuDomain::WaitForReaders(std::size_t epoch) const {
+  // Sequentially consistent: a reader whose increment this misses loads the new pointer
+  for (const Stripe& stripe : stripes_) {
+    while (stripe.readers[epoch].load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,98 @@
+/**
+ * @file rcu.h
+ * @brief Read-copy-update grace periods for lock-free readers
+ */
+
+#ifndef TCP_SERVER_INTERNAL_RCU_H_
+#define TCP_SERVER_INTERNAL_RCU_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Tracks readers of RCU-protected data so that writers can retire old versions
+ *
+ * Readers enter and leave a read section with two atomic increments on a
+ * counter striped by thread, so readers on different threads do not share
+ * cache lines and never wait. A writer publishes a new version, then calls
+ * Synchronize(), which returns once every read section that might still use
+ * the old version has ended; the old version can then be freed.
+ *
+ * Counters come in two epochs. Synchronize() flips the epoch twice and waits
+ * for each epoch's readers to drain, so new readers never hold it up
+ * indefinitely.
+ */
+class RcuDomain {
+ public:
+  static constexpr std::size_t kStripes = 16;  ///< Reader counter stripes
+
+  /**
+   * @brief RAII read section
+   */
+  class ReadGuard {
+   public:
+    /**
+     * @brief Enter a read section
+     * @param domain Domain of the data about to be read
+     */
+    explicit ReadGuard(RcuDomain& domain);
+
+    /**
+     * @brief Leave the read section
+     */
+    ~ReadGuard();
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+   private:
+    std::atomic<std::uint64_t>* counter_;  ///< Counter incremented on entry
+    unsigned int* read_depth_;             ///< Read sections of the calling thread
+  };
+
+  RcuDomain() = default;
+  RcuDomain(const RcuDomain&) = delete;
+  RcuDomain& operator=(const RcuDomain&) = delete;
+
+  /**
+   * @brief Wait for every read section that began before the call to end
+   *
+   * Spins and yields; call after publishing a new version and before freeing
+   * the old one. Concurrent callers must be serialized.
+   * @throws std::logic_error If the calling thread is inside a read section,
+   *         which would wait for itself forever
+   */
+  void Synchronize();
+
+  /**
+   * @brief Whether the calling thread is inside any read section
+   * @return true between a ReadGuard's construction and destruction
+   */
+  static bool InReadSection();
+
+ private:
+  /**
+   * @brief Reader counts of one stripe in both epochs, on a cache line of its own
+   */
+  struct alignas(64) Stripe {
+    std::atomic<std::uint64_t> readers[2] = {};
+  };
+
+  /**
+   * @brief Wait until no reader of an epoch remains
+   * @param epoch Epoch index
+   */
+  void WaitForReaders(std::size_t epoch) const;
+
+  std::atomic<std::size_t> epoch_{0};  ///< Epoch new readers count themselves in
+  Stripe stripes_[kStripes];           ///< Reader counters
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_RCU_H_
@@ -0,0 +1,188 @@
+#include "src/internal/response_cache.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+// Shards per hardware thread when the count is chosen automatically
+constexpr std::size_t kShardsPerThread = 4;
+
+// Automatically chosen shards are merged until each holds at least this many bytes
+constexpr std::size_t kMinShardBytes = 64 * 1024;
+
+std::size_t ShardCountFor(const ResponseCacheOptions& options) {
+  std::size_t requested = options.shards;
+  if (requested == 0) {
+    requested = kShardsPerThread * std::max(1u, std::thread::hardware_concurrency());
+    requested = std::min(requested, std::max<std::size_t>(1, options.max_bytes / kMinShardBytes));
+  }
+  std::size_t count = 1;
+  while (count < requested) {
+    count *= 2;
+  }
+  return count;
+}
+
+}  // namespace
+
+ResponseCache::ResponseCache(const ResponseCacheOptions& options)
+    : key_(options.key), ttl_(options.ttl) {
+  const std::size_t count = ShardCountFor(options);
+  shard_budget_ = options.max_bytes / count;
+  shard_mask_ = count - 1;
+  shards_ = std::make_unique<Shard[]>(count);
+}
+
+ResponseCache::Lookup ResponseCache::Find(std::string_view request) {
+  Lookup lookup;
+  lookup.key = key_ ? key_(request) : request;
+  if (lookup.key.empty()) {
+    return lookup;
+  }
+
+  Shard& shard = ShardOf(lookup.key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  lookup.generation = shard.generation;
+  const auto it = shard.index.find(lookup.key);
+  if (it == shard.index.end()) {
+    return lookup;
+  }
+  Entry& entry = shard.slots[it->second];
+  if (entry.expires != Clock::time_point::max() && entry.expires <= Clock::now()) {
+    RemoveLocked(shard, it->second);
+    return lookup;
+  }
+  entry.referenced = true;
+  lookup.response = entry.response;
+  return lookup;
+}
+
+bool ResponseCache::Insert(const Lookup& miss, std::string_view response,
+                           std::chrono::milliseconds ttl) {
+  const std::size_t charge = miss.key.size() + response.size() + kEntryOverhead;
+  if (miss.key.empty() || charge > shard_budget_) {
+    return false;
+  }
+  // Allocate before taking the lock
+  auto shared = std::make_shared<const std::string>(response);
+  std::string key(miss.key);
+  const Clock::time_point now = Clock::now();
+
+  Shard& shard = ShardOf(miss.key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.generation != miss.generation) {
+    return false;
+  }
+  const auto it = shard.index.find(miss.key);
+  if (it != shard.index.end()) {
+    RemoveLocked(shard, it->second);
+  }
+  MakeRoomLocked(shard, charge, now);
+
+  std::size_t slot;
+  if (!shard.free_slots.empty()) {
+    slot = shard.free_slots.back();
+    shard.free_slots.pop_back();
+  } else {
+    slot = shard.slots.size();
+    shard.slots.emplace_back();
+  }
+  Entry& entry = shard.slots[slot];
+  entry.key = std::move(key);
+  entry.response = std::move(shared);
+  entry.expires = ttl.count() > 0 ? now + ttl : Clock::time_point::max();
+  entry.charge = charge;
+  entry.referenced = false;
+  shard.index.emplace(entry.key, slot);
+  shard.bytes += charge;
+  return true;
+}
+
+bool ResponseCache::Erase(std::string_view key) {
+  Shard& shard = ShardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // Even without an entry, a handler may be computing the response right now
+  ++shard.generation;
+  const auto it = shard.index.find(key);
+  if (it == shard.index.end()) {
+    return false;
+  }
+  RemoveLocked(shard, it->second);
+  return true;
+}
+
+void ResponseCache::Clear() {
+  for (std::size_t i = 0; i <= shard_mask_; ++i) {
+    Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.generation;
+    shard.index.clear();
+    shard.slots.clear();
+    shard.free_slots.clear();
+    shard.hand = 0;
+    shard.bytes = 0;
+  }
+}
+
+std::chrono::milliseconds ResponseCache::DefaultTtl() const {
+  return ttl_;
+}
+
+std::size_t ResponseCache::ShardCount() const {
+  return shard_mask_ + 1;
+}
+
+ResponseCache::Stats ResponseCache::GetStats() const {
+  Stats stats;
+  for (std::size_t i = 0; i <= shard_mask_; ++i) {
+    const Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.entries += shard.index.size();
+    stats.bytes += shard.bytes;
+    stats.evictions += shard.evictions;
+  }
+  return stats;
+}
+
+ResponseCache::Shard& ResponseCache::ShardOf(std::string_view key) const {
+  return shards_[std::hash<std::string_view>()(key) & shard_mask_];
+}
+
+void ResponseCache::RemoveLocked(Shard& shard, std::size_t slot) {
+  Entry& entry = shard.slots[slot];
+  // The index refers to the key, so it goes first
+  shard.index.erase(entry.key);
+  shard.bytes -= entry.charge;
+  entry.key.clear();
+  entry.response.reset();
+  shard.free_slots.push_back(slot);
+}
+
+void ResponseCache::MakeRoomLocked(Shard& shard, std::size_t charge, Clock::time_point now) {
+  // Terminates because every pass clears reference flags and charge fits the budget
+  while (shard.bytes + charge > shard_budget_) {
+    if (shard.hand >= shard.slots.size()) {
+      shard.hand = 0;
+    }
+    Entry& entry = shard.slots[shard.hand];
+    if (!entry.key.empty()) {
+      if (entry.expires <= now) {
+        RemoveLocked(shard, shard.hand);
+      } else if (entry.referenced) {
+        entry.referenced = false;
+      } else {
+        RemoveLocked(shard, shard.hand);
+        ++shard.evictions;
+      }
+    }
+    ++shard.hand;
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,182 @@
+/**
+ * @file response_cache.h
+ * @brief Sharded cache of framed responses to idempotent requests
+ */
+
+#ifndef TCP_SERVER_INTERNAL_RESPONSE_CACHE_H_
+#define TCP_SERVER_INTERNAL_RESPONSE_CACHE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tcp_server/server_options.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Cache of framed responses, keyed by request
+ *
+ * Keys are split over power-of-two shards by hash, each with its own mutex,
+ * so I/O threads looking up different keys rarely contend. Responses are
+ * shared immutable strings: a hit only copies a shared_ptr, and the
+ * connection queues the bytes without copying them. Each shard evicts with
+ * the CLOCK algorithm, which approximates LRU but only sets a flag on a hit
+ * instead of relinking a list. Entries may expire after a TTL, checked when
+ * they are looked up or passed by the clock hand.
+ *
+ * A response computed while its key was invalidated must not be cached, so
+ * every lookup returns the shard's generation, which Erase() and Clear()
+ * advance, and Insert() drops responses computed under an older one.
+ */
+class ResponseCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Bytes charged per entry on top of its key and response
+  static constexpr std::size_t kEntryOverhead = 128;
+
+  /**
+   * @brief Result of a lookup
+   */
+  struct Lookup {
+    std::string_view key;  ///< Cache key (empty if the request is not cacheable)
+    std::shared_ptr<const std::string> response;  ///< Cached framed response, or nullptr on a miss
+    std::uint64_t generation = 0;                 ///< Shard generation to pass to Insert()
+  };
+
+  /**
+   * @brief Totals over all shards
+   */
+  struct Stats {
+    std::size_t entries = 0;     ///< Cached responses
+    std::size_t bytes = 0;       ///< Bytes charged against the budget
+    std::uint64_t evictions = 0; ///< Entries evicted to make room
+  };
+
+  /**
+   * @brief Create an empty cache
+   * @param options Cache options; max_bytes must be nonzero
+   */
+  explicit ResponseCache(const ResponseCacheOptions& options);
+
+  ResponseCache(const ResponseCache&) = delete;
+  ResponseCache& operator=(const ResponseCache&) = delete;
+
+  /**
+   * @brief Look up the response to a request
+   * @param request Request payload
+   * @return Key and cached response; the key is empty if the request is not cacheable
+   */
+  Lookup Find(std::string_view request);
+
+  /**
+   * @brief Cache the response to a request that missed
+   *
+   * Replaces an entry with the same key. Nothing is cached if the key was
+   * invalidated since the lookup, or if the response exceeds a shard's budget.
+   * @param miss Lookup that missed
+   * @param response Framed response
+   * @param ttl Time until the entry expires (0 = never)
+   * @return true if cached
+   */
+  bool Insert(const Lookup& miss, std::string_view response, std::chrono::milliseconds ttl);
+
+  /**
+   * @brief Remove the response cached under a key
+   * @param key Cache key
+   * @return true if an entry was removed
+   */
+  bool Erase(std::string_view key);
+
+  /**
+   * @brief Remove every cached response
+   */
+  void Clear();
+
+  /**
+   * @brief Get the configured TTL of responses
+   * @return TTL applied when the handler does not set one (0 = never expire)
+   */
+  std::chrono::milliseconds DefaultTtl() const;
+
+  /**
+   * @brief Number of shards
+   * @return Shard count, a power of two
+   */
+  std::size_t ShardCount() const;
+
+  /**
+   * @brief Sum the shards' entry counts, bytes and evictions
+   * @return Totals
+   */
+  Stats GetStats() const;
+
+ private:
+  /**
+   * @brief One cached response, or a free slot when key is empty
+   */
+  struct Entry {
+    std::string key;                              ///< Owned key (indexed by view)
+    std::shared_ptr<const std::string> response;  ///< Framed response
+    Clock::time_point expires = Clock::time_point::max();  ///< Expiry, or max() for none
+    std::size_t charge = 0;                       ///< Bytes charged against the budget
+    bool referenced = false;                      ///< Used since the clock hand last passed
+  };
+
+  /**
+   * @brief Independently locked part of the cache, on cache lines of its own
+   */
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string_view, std::size_t> index;  ///< Key to slot
+    std::deque<Entry> slots;               ///< Entries; a deque so keys never move
+    std::vector<std::size_t> free_slots;   ///< Empty slots to reuse
+    std::size_t hand = 0;                  ///< CLOCK hand
+    std::size_t bytes = 0;                 ///< Bytes charged
+    std::uint64_t generation = 0;          ///< Advanced by every invalidation
+    std::uint64_t evictions = 0;           ///< Entries evicted to make room
+  };
+
+  /**
+   * @brief Select the shard of a key
+   * @param key Cache key
+   * @return Shard
+   */
+  Shard& ShardOf(std::string_view key) const;
+
+  /**
+   * @brief Remove the entry in a slot (shard locked)
+   * @param shard Shard
+   * @param slot Slot index
+   */
+  static void RemoveLocked(Shard& shard, std::size_t slot);
+
+  /**
+   * @brief Evict entries until a charge fits in the budget (shard locked)
+   * @param shard Shard
+   * @param charge Bytes about to be added
+   * @param now Current time, to drop expired entries first
+   */
+  void MakeRoomLocked(Shard& shard, std::size_t charge, Clock::time_point now);
+
+  std::function<std::string_view(std::string_view)> key_;  ///< Key function, or empty for the whole request
+  std::chrono::milliseconds ttl_;  ///< Default TTL
+  std::size_t shard_budget_;       ///< Bytes each shard may hold
+  std::size_t shard_mask_;         ///< Shard count minus one
+  std::unique_ptr<Shard[]> shards_;  ///< Shards
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_RESPONSE_CACHE_H_
@@ -0,0 +1,98 @@
+#include "src/internal/socket_tuning.h"
+
+#include <spdlog/spdlog.h>
+
+#if !defined(_WIN32)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+using tcp = boost::asio::ip::tcp;
+
+#if defined(__linux__) && defined(TCP_DEFER_ACCEPT)
+using DeferAccept = boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_DEFER_ACCEPT>;
+#endif
+#if defined(TCP_FASTOPEN)
+using FastOpen = boost::asio::detail::socket_option::integer<IPPROTO_TCP, TCP_FASTOPEN>;
+#endif
+#if defined(__linux__) && defined(TCP_QUICKACK)
+using QuickAck = boost::asio::detail::socket_option::boolean<IPPROTO_TCP, TCP_QUICKACK>;
+#endif
+
+// Options that accepted sockets either inherit or need one by one
+template <typename Socket>
+void SetInheritable(Socket& socket, const StreamProtocol& protocol, const SocketOptions& options,
+                    boost::system::error_code& error) {
+  if (options.no_delay && !IsLocal(protocol) && !error) {
+    socket.set_option(tcp::no_delay(true), error);
+  }
+  if (options.receive_buffer_size > 0 && !error) {
+    socket.set_option(boost::asio::socket_base::receive_buffer_size(options.receive_buffer_size),
+                      error);
+  }
+  if (options.send_buffer_size > 0 && !error) {
+    socket.set_option(boost::asio::socket_base::send_buffer_size(options.send_buffer_size),
+                      error);
+  }
+}
+
+}  // namespace
+
+void ConfigureListener(StreamAcceptor& acceptor, const StreamProtocol& protocol,
+                       const SocketOptions& options, spdlog::logger& logger) {
+  if (kAcceptedSocketsInherit) {
+    boost::system::error_code error;
+    SetInheritable(acceptor, protocol, options, error);
+    if (error) {
+      throw boost::system::system_error(error, "setsockopt");
+    }
+  }
+  if (IsLocal(protocol)) {
+    return;
+  }
+
+  if (options.defer_accept.count() > 0) {
+#if defined(__linux__) && defined(TCP_DEFER_ACCEPT)
+    boost::system::error_code error;
+    acceptor.set_option(DeferAccept(static_cast<int>(options.defer_accept.count())), error);
+    if (error) {
+      logger.warn("TCP_DEFER_ACCEPT could not be set: {}", error.message());
+    }
+#else
+    logger.warn("TCP_DEFER_ACCEPT is not supported on this platform");
+#endif
+  }
+
+  if (options.fast_open_queue > 0) {
+#if defined(TCP_FASTOPEN)
+    boost::system::error_code error;
+    acceptor.set_option(FastOpen(options.fast_open_queue), error);
+    if (error) {
+      logger.warn("TCP_FASTOPEN could not be set: {}", error.message());
+    }
+#else
+    logger.warn("TCP_FASTOPEN is not supported on this platform");
+#endif
+  }
+}
+
+void ConfigureAccepted(StreamProtocol::socket& socket, const StreamProtocol& protocol,
+                       const SocketOptions& options, boost::system::error_code& error) {
+  error.clear();
+  if (!kAcceptedSocketsInherit) {
+    SetInheritable(socket, protocol, options, error);
+  }
+#if defined(__linux__) && defined(TCP_QUICKACK)
+  if (options.quick_ack && !IsLocal(protocol) && !error) {
+    socket.set_option(QuickAck(true), error);
+  }
+#endif
+}
+
+}  // namespace internal
+}  // namespace tcp_server
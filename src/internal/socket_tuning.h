@@ -0,0 +1,62 @@
+/**
+ * @file socket_tuning.h
+ * @brief Applying SocketOptions to listening and accepted sockets
+ */
+
+#ifndef TCP_SERVER_INTERNAL_SOCKET_TUNING_H_
+#define TCP_SERVER_INTERNAL_SOCKET_TUNING_H_
+
+#include <spdlog/fwd.h>
+
+#include "src/internal/transport.h"
+#include "tcp_server/asio.h"
+#include "tcp_server/server_options.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Whether accepted sockets inherit buffer sizes and TCP_NODELAY from the listener
+ *
+ * Where they do, ConfigureListener() sets them once and ConfigureAccepted()
+ * skips them, so accepting costs no extra system calls.
+ */
+#if defined(__linux__)
+constexpr bool kAcceptedSocketsInherit = true;
+#else
+constexpr bool kAcceptedSocketsInherit = false;
+#endif
+
+/**
+ * @brief Apply the options that belong on the listening socket
+ *
+ * Call before listen() so that the receive buffer size is in effect when the
+ * window scale of the first connections is chosen. SO_REUSEADDR and
+ * IPV6_V6ONLY are left to the caller because they only matter before bind().
+ * Options the platform or kernel configuration rejects (defer-accept, fast
+ * open) are logged and skipped. Unix domain sockets only get the buffer sizes.
+ * @param acceptor Open acceptor
+ * @param protocol Protocol the acceptor was opened with
+ * @param options Options to apply
+ * @param logger Logger for the skipped options
+ * @throws boost::system::system_error If a buffer size cannot be set
+ */
+void ConfigureListener(StreamAcceptor& acceptor, const StreamProtocol& protocol,
+                       const SocketOptions& options, spdlog::logger& logger);
+
+/**
+ * @brief Apply the options that accepted sockets do not inherit on this platform
+ *
+ * Makes no system call when there is nothing to set.
+ * @param socket Accepted socket
+ * @param protocol Protocol of the listener that accepted it
+ * @param options Options to apply
+ * @param error Error of the first option that could not be set
+ */
+void ConfigureAccepted(StreamProtocol::socket& socket, const StreamProtocol& protocol,
+                       const SocketOptions& options, boost::system::error_code& error);
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_SOCKET_TUNING_H_
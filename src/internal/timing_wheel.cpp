@@ -0,0 +1,115 @@
+#include "src/internal/timing_wheel.h"
+
+#include <mutex>
+
+namespace tcp_server {
+namespace internal {
+
+TimingWheel::TimingWheel() {
+  for (auto& level : slots_) {
+    for (TimerNode& head : level) {
+      head.prev = &head;
+      head.next = &head;
+    }
+  }
+}
+
+void TimingWheel::Schedule(TimerNode* node, std::uint64_t expiry) {
+  std::lock_guard<SpinLock> lock(lock_);
+  if (node->IsLinked()) {
+    Unlink(node);
+  }
+
+  const std::uint64_t now = now_.load(std::memory_order_relaxed);
+  if (expiry <= now) {
+    expiry = now + 1;
+  } else if (expiry - now > kMaxDelay) {
+    expiry = now + kMaxDelay;
+  }
+  node->expiry = expiry;
+  Link(node);
+}
+
+void TimingWheel::Cancel(TimerNode* node) {
+  std::lock_guard<SpinLock> lock(lock_);
+  if (node->IsLinked()) {
+    Unlink(node);
+  }
+}
+
+std::size_t TimingWheel::Advance(std::uint64_t target) {
+  std::lock_guard<SpinLock> lock(lock_);
+  std::size_t fired = 0;
+  std::uint64_t now = now_.load(std::memory_order_relaxed);
+
+  while (now < target) {
+    ++now;
+    now_.store(now, std::memory_order_relaxed);
+
+    // Whenever a level wraps, pull the next slot of the level above down,
+    // coarsest first so its timers can land in the slot cascaded after it
+    int top = 0;
+    while (top + 1 < kLevelCount &&
+           (now & ((std::uint64_t{1} << (kSlotBits * (top + 1))) - 1)) == 0) {
+      ++top;
+    }
+    for (int level = top; level >= 1; --level) {
+      Cascade(level, (now >> (kSlotBits * level)) & (kSlotCount - 1));
+    }
+
+    // Every timer in the current finest slot expires now
+    TimerNode& head = slots_[0][now & (kSlotCount - 1)];
+    while (head.next != &head) {
+      TimerNode* node = head.next;
+      Unlink(node);
+      node->on_expire(node->context);
+      ++fired;
+    }
+  }
+  return fired;
+}
+
+void TimingWheel::Link(TimerNode* node) {
+  const std::uint64_t now = now_.load(std::memory_order_relaxed);
+  const std::uint64_t delta = node->expiry > now ? node->expiry - now : 0;
+
+  int level = 0;
+  while (level + 1 < kLevelCount && delta >= (std::uint64_t{1} << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+
+  TimerNode& head = slots_[level][(node->expiry >> (kSlotBits * level)) & (kSlotCount - 1)];
+  node->prev = head.prev;
+  node->next = &head;
+  head.prev->next = node;
+  head.prev = node;
+}
+
+void TimingWheel::Unlink(TimerNode* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = nullptr;
+  node->next = nullptr;
+}
+
+void TimingWheel::Cascade(int level, std::size_t index) {
+  TimerNode& head = slots_[level][index];
+  if (head.next == &head) {
+    return;
+  }
+
+  // Detach the whole list first, since nodes may be re-linked into this level
+  TimerNode* node = head.next;
+  head.prev->next = nullptr;
+  head.prev = &head;
+  head.next = &head;
+
+  while (node != nullptr) {
+    TimerNode* next = node->next;
+    Link(node);
+    node = next;
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,124 @@
+/**
+ * @file timing_wheel.h
+ * @brief Hierarchical timing wheel with intrusive timer nodes
+ */
+
+#ifndef TCP_SERVER_INTERNAL_TIMING_WHEEL_H_
+#define TCP_SERVER_INTERNAL_TIMING_WHEEL_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/internal/connection_registry.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Timer embedded in the object it belongs to
+ *
+ * A node is linked into at most one wheel slot at a time. The wheel never
+ * allocates; the owner keeps the node alive and must cancel it before the
+ * node is destroyed.
+ */
+struct TimerNode {
+  using Callback = void (*)(void* context);
+
+  TimerNode* prev = nullptr;   ///< Previous node in the slot list
+  TimerNode* next = nullptr;   ///< Next node in the slot list
+  std::uint64_t expiry = 0;    ///< Tick at which the timer fires
+  Callback on_expire = nullptr;  ///< Called when the timer fires
+  void* context = nullptr;     ///< Argument passed to on_expire
+
+  /**
+   * @brief Whether the node is scheduled
+   * @return true if linked into a wheel
+   */
+  bool IsLinked() const { return prev != nullptr; }
+};
+
+/**
+ * @brief Hashed hierarchical timing wheel
+ *
+ * Four levels of 256 slots cover 2^32 ticks. Scheduling, rescheduling and
+ * cancelling unlink and link one node, which is O(1) and allocation-free.
+ * Timers far in the future sit in coarse levels and are cascaded down as
+ * time advances. All methods are thread-safe; a spin lock guards the slots,
+ * which is uncontended when the wheel belongs to a single thread.
+ */
+class TimingWheel {
+ public:
+  static constexpr int kSlotBits = 8;                         ///< log2 of slots per level
+  static constexpr std::size_t kSlotCount = 1u << kSlotBits;  ///< Slots per level
+  static constexpr int kLevelCount = 4;                       ///< Number of levels
+  static constexpr std::uint64_t kMaxDelay =
+      (std::uint64_t{1} << (kSlotBits * kLevelCount)) - 1;    ///< Longest delay in ticks
+
+  TimingWheel();
+
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel& operator=(const TimingWheel&) = delete;
+
+  /**
+   * @brief Current time of the wheel
+   * @return Number of ticks processed so far
+   */
+  std::uint64_t Now() const { return now_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Schedule or reschedule a timer
+   *
+   * Expiry ticks that have already passed fire on the next tick; delays longer
+   * than kMaxDelay are shortened to kMaxDelay.
+   * @param node Timer to schedule (unlinked first if already scheduled)
+   * @param expiry Tick at which the timer fires
+   */
+  void Schedule(TimerNode* node, std::uint64_t expiry);
+
+  /**
+   * @brief Unschedule a timer
+   * @param node Timer to cancel (may be unscheduled)
+   */
+  void Cancel(TimerNode* node);
+
+  /**
+   * @brief Advance the wheel and fire every timer that expired
+   *
+   * Callbacks run with the wheel locked: they must not call back into the
+   * wheel and should only hand the work off (for example with asio::post).
+   * @param now Tick to advance to; ticks already processed are ignored
+   * @return Number of timers fired
+   */
+  std::size_t Advance(std::uint64_t now);
+
+ private:
+  /**
+   * @brief Link a node into the slot for its expiry (lock held)
+   * @param node Unlinked timer
+   */
+  void Link(TimerNode* node);
+
+  /**
+   * @brief Remove a node from its slot (lock held)
+   * @param node Linked timer
+   */
+  static void Unlink(TimerNode* node);
+
+  /**
+   * @brief Re-link every node of a coarse slot into finer levels (lock held)
+   * @param level Level of the slot
+   * @param index Slot index
+   */
+  void Cascade(int level, std::size_t index);
+
+  SpinLock lock_;                                          ///< Guards the slots
+  std::atomic<std::uint64_t> now_{0};                      ///< Last processed tick
+  std::array<std::array<TimerNode, kSlotCount>, kLevelCount> slots_;  ///< Circular list heads
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_TIMING_WHEEL_H_
@@ -0,0 +1,233 @@
+#include "src/internal/tls.h"
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <boost/asio/ssl/error.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <pthread.h>
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+// Identifies sessions of this server in the session cache
+constexpr unsigned char kSessionIdContext[] = "tcp_server";
+
+// Message of the oldest queued OpenSSL error, for exceptions thrown while configuring
+std::string OpenSslError(const std::string& what) {
+  const unsigned long code = ERR_get_error();
+  ERR_clear_error();
+  if (code == 0) {
+    return what;
+  }
+  char buffer[256];
+  ERR_error_string_n(code, buffer, sizeof(buffer));
+  return what + ": " + buffer;
+}
+
+}  // namespace
+
+TlsContext::TlsContext(const TlsOptions& options) : context_(SSL_CTX_new(TLS_server_method())) {
+  if (context_ == nullptr) {
+    throw std::runtime_error(OpenSslError("SSL_CTX_new"));
+  }
+
+  SSL_CTX_set_min_proto_version(context_, TLS1_2_VERSION);
+  std::uint64_t flags = SSL_OP_NO_RENEGOTIATION;
+#if defined(SSL_OP_IGNORE_UNEXPECTED_EOF)
+  // Clients that close without close_notify end the connection like a plain EOF
+  flags |= SSL_OP_IGNORE_UNEXPECTED_EOF;
+#endif
+#if defined(SSL_OP_ENABLE_KTLS)
+  if (options.kernel_tls) {
+    flags |= SSL_OP_ENABLE_KTLS;
+  }
+#endif
+  if (!options.session_tickets) {
+    flags |= SSL_OP_NO_TICKET;
+  }
+  SSL_CTX_set_options(context_, flags);
+  // One record per write, retried from wherever the caller keeps the bytes;
+  // idle connections give their record buffers back
+  SSL_CTX_set_mode(context_, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                                 SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                 SSL_MODE_RELEASE_BUFFERS);
+
+  if (options.session_cache_size > 0) {
+    SSL_CTX_set_session_cache_mode(context_, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(context_, static_cast<long>(options.session_cache_size));
+  } else {
+    SSL_CTX_set_session_cache_mode(context_, SSL_SESS_CACHE_OFF);
+  }
+  SSL_CTX_set_session_id_context(context_, kSessionIdContext, sizeof(kSessionIdContext) - 1);
+  SSL_CTX_set_timeout(context_, static_cast<long>(options.session_timeout.count()));
+
+  if (SSL_CTX_use_certificate_chain_file(context_, options.certificate_chain_file.c_str()) != 1) {
+    const std::string message =
+        OpenSslError("Cannot load certificate chain " + options.certificate_chain_file);
+    SSL_CTX_free(context_);
+    throw std::runtime_error(message);
+  }
+  if (SSL_CTX_use_PrivateKey_file(context_, options.private_key_file.c_str(),
+                                  SSL_FILETYPE_PEM) != 1 ||
+      SSL_CTX_check_private_key(context_) != 1) {
+    const std::string message =
+        OpenSslError("Cannot load private key " + options.private_key_file);
+    SSL_CTX_free(context_);
+    throw std::runtime_error(message);
+  }
+}
+
+TlsContext::~TlsContext() {
+  SSL_CTX_free(context_);
+}
+
+ssl_ctx_st* TlsContext::Get() const {
+  return context_;
+}
+
+TlsSession::~TlsSession() {
+  Reset();
+}
+
+void TlsSession::Start(const TlsContext& context, NativeSocket socket) {
+  Reset();
+  ssl_ = SSL_new(context.Get());
+  if (ssl_ == nullptr || SSL_set_fd(ssl_, static_cast<int>(socket)) != 1) {
+    Reset();
+    throw std::runtime_error(OpenSslError("SSL_new"));
+  }
+  SSL_set_accept_state(ssl_);
+  wait_type_ = boost::asio::socket_base::wait_read;
+}
+
+bool TlsSession::Handshake(boost::system::error_code& error) {
+  error.clear();
+  ERR_clear_error();
+  errno = 0;
+  const int result = SSL_do_handshake(ssl_);
+  if (result == 1) {
+    return true;
+  }
+  SetError(result, error);
+  return false;
+}
+
+std::size_t TlsSession::Read(void* data, std::size_t size, boost::system::error_code& error) {
+  error.clear();
+  ERR_clear_error();
+  errno = 0;
+  std::size_t read = 0;
+  const int result = SSL_read_ex(ssl_, data, size, &read);
+  if (result == 1) {
+    return read;
+  }
+  SetError(result, error);
+  return 0;
+}
+
+std::size_t TlsSession::Write(const void* data, std::size_t size,
+                              boost::system::error_code& error) {
+  error.clear();
+  ERR_clear_error();
+  errno = 0;
+  std::size_t written = 0;
+  const int result = SSL_write_ex(ssl_, data, size, &written);
+  if (result == 1) {
+    return written;
+  }
+  SetError(result, error);
+  return 0;
+}
+
+void TlsSession::SetError(int result, boost::system::error_code& error) {
+  switch (SSL_get_error(ssl_, result)) {
+    case SSL_ERROR_WANT_READ:
+      wait_type_ = boost::asio::socket_base::wait_read;
+      error = boost::asio::error::would_block;
+      break;
+    case SSL_ERROR_WANT_WRITE:
+      wait_type_ = boost::asio::socket_base::wait_write;
+      error = boost::asio::error::would_block;
+      break;
+    case SSL_ERROR_ZERO_RETURN:
+      error = boost::asio::error::eof;
+      break;
+    case SSL_ERROR_SYSCALL:
+      if (ERR_peek_error() == 0) {
+        // errno is cleared before each call, so 0 means the peer closed mid-record
+        error = errno != 0
+                    ? boost::system::error_code(errno, boost::asio::error::get_system_category())
+                    : boost::system::error_code(boost::asio::error::eof);
+        break;
+      }
+      [[fallthrough]];
+    default:
+      error = boost::system::error_code(static_cast<int>(ERR_get_error()),
+                                        boost::asio::error::get_ssl_category());
+      if (!error) {
+        error = boost::asio::error::fault;
+      }
+      ERR_clear_error();
+      break;
+  }
+}
+
+boost::asio::socket_base::wait_type TlsSession::WaitType() const {
+  return wait_type_;
+}
+
+bool TlsSession::HasPending() const {
+  return ssl_ != nullptr && SSL_has_pending(ssl_) == 1;
+}
+
+bool TlsSession::KernelSend() const {
+  return ssl_ != nullptr && BIO_get_ktls_send(SSL_get_wbio(ssl_));
+}
+
+bool TlsSession::KernelReceive() const {
+  return ssl_ != nullptr && BIO_get_ktls_recv(SSL_get_rbio(ssl_));
+}
+
+bool TlsSession::Resumed() const {
+  return ssl_ != nullptr && SSL_session_reused(ssl_) == 1;
+}
+
+bool TlsSession::IsActive() const {
+  return ssl_ != nullptr;
+}
+
+void TlsSession::Reset() {
+  if (ssl_ == nullptr) {
+    return;
+  }
+  // Without this, freeing a session that never exchanged close_notify drops
+  // it from the cache; sessions ended by a fatal alert are already gone
+  if (SSL_is_init_finished(ssl_)) {
+    SSL_set_shutdown(ssl_, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+  SSL_free(ssl_);
+  ssl_ = nullptr;
+}
+
+void BlockSigPipe() {
+#if !defined(_WIN32)
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+#endif
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,172 @@
+/**
+ * @file tls.h
+ * @brief OpenSSL context and per-connection TLS state on non-blocking sockets
+ */
+
+#ifndef TCP_SERVER_INTERNAL_TLS_H_
+#define TCP_SERVER_INTERNAL_TLS_H_
+
+#include <cstddef>
+
+#include "src/internal/zero_copy.h"
+#include "tcp_server/asio.h"
+#include "tcp_server/server_options.h"
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Server-side TLS configuration shared by every connection
+ *
+ * Owns the SSL_CTX, and with it the session cache and the session ticket
+ * keys, so sessions resume on any worker thread.
+ */
+class TlsContext {
+ public:
+  /**
+   * @brief Load the certificate chain and key and configure resumption
+   * @param options TLS options
+   * @throws std::runtime_error If the files cannot be loaded or do not match
+   */
+  explicit TlsContext(const TlsOptions& options);
+
+  ~TlsContext();
+
+  TlsContext(const TlsContext&) = delete;
+  TlsContext& operator=(const TlsContext&) = delete;
+
+  /**
+   * @brief Get the OpenSSL context
+   * @return SSL_CTX pointer
+   */
+  ssl_ctx_st* Get() const;
+
+ private:
+  ssl_ctx_st* context_;  ///< OpenSSL context
+};
+
+/**
+ * @brief TLS state of one connection
+ *
+ * OpenSSL reads and writes the non-blocking socket itself, so that it can
+ * hand the record layer to the kernel after the handshake (kTLS). Every
+ * operation that cannot finish reports would_block, and WaitType() tells
+ * which readiness to wait for before calling it again with the same
+ * arguments.
+ */
+class TlsSession {
+ public:
+  TlsSession() = default;
+  ~TlsSession();
+
+  TlsSession(const TlsSession&) = delete;
+  TlsSession& operator=(const TlsSession&) = delete;
+
+  /**
+   * @brief Start the server side of a handshake on a socket
+   * @param context Shared TLS context
+   * @param socket Connected non-blocking socket
+   * @throws std::runtime_error If OpenSSL cannot allocate the session
+   */
+  void Start(const TlsContext& context, NativeSocket socket);
+
+  /**
+   * @brief Advance the handshake
+   * @param error would_block while it needs the peer, or the failure
+   * @return true once the handshake is complete
+   */
+  bool Handshake(boost::system::error_code& error);
+
+  /**
+   * @brief Read decrypted application data
+   * @param data Destination
+   * @param size Bytes to read at most
+   * @param error would_block, eof after the peer's close_notify, or the failure
+   * @return Bytes read
+   */
+  std::size_t Read(void* data, std::size_t size, boost::system::error_code& error);
+
+  /**
+   * @brief Encrypt and send application data
+   *
+   * Sends at most one record per call. After would_block, call again with
+   * the same bytes.
+   * @param data Source
+   * @param size Bytes to send
+   * @param error would_block or the failure
+   * @return Bytes sent
+   */
+  std::size_t Write(const void* data, std::size_t size, boost::system::error_code& error);
+
+  /**
+   * @brief Readiness the last operation that reported would_block is waiting for
+   * @return wait_read or wait_write
+   */
+  boost::asio::socket_base::wait_type WaitType() const;
+
+  /**
+   * @brief Whether OpenSSL holds received bytes that the socket no longer reports
+   * @return true if Read() may return data without the socket becoming readable
+   */
+  bool HasPending() const;
+
+  /**
+   * @brief Whether the kernel encrypts what is written to the socket
+   * @return true if plain writes and sendfile() can be used
+   */
+  bool KernelSend() const;
+
+  /**
+   * @brief Whether the kernel decrypts what is read from the socket
+   * @return true if plain reads can be used
+   */
+  bool KernelReceive() const;
+
+  /**
+   * @brief Whether the handshake resumed an earlier session
+   * @return true for an abbreviated handshake
+   */
+  bool Resumed() const;
+
+  /**
+   * @brief Whether Start() was called since the last Reset()
+   * @return true for a TLS connection
+   */
+  bool IsActive() const;
+
+  /**
+   * @brief Free the session so that the connection can be reused
+   *
+   * A session that completed its handshake stays resumable even though no
+   * close_notify was exchanged.
+   */
+  void Reset();
+
+ private:
+  /**
+   * @brief Translate the result of an OpenSSL call
+   * @param result Return value of the call
+   * @param error Translated error
+   */
+  void SetError(int result, boost::system::error_code& error);
+
+  ssl_st* ssl_ = nullptr;  ///< OpenSSL session, or nullptr for a plain connection
+  boost::asio::socket_base::wait_type wait_type_ = boost::asio::socket_base::wait_read;
+};
+
+/**
+ * @brief Keep SIGPIPE from the calling thread
+ *
+ * OpenSSL writes to the socket with write(), which raises SIGPIPE when the
+ * peer has reset the connection. Call on every thread that drives TLS
+ * connections; the write then fails with EPIPE instead.
+ */
+void BlockSigPipe();
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_TLS_H_
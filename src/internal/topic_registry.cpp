@@ -0,0 +1,144 @@
+#include "src/internal/topic_registry.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace tcp_server {
+namespace internal {
+
+TopicRegistry::TopicRegistry() : directory_(std::make_shared<const Directory>()) {}
+
+bool TopicRegistry::Subscribe(ConnectionRegistry::Id id, const std::string& topic) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string>& topics = subscriptions_[id];
+  if (std::find(topics.begin(), topics.end(), topic) != topics.end()) {
+    return false;
+  }
+
+  auto it = topics_.find(topic);
+  if (it == topics_.end()) {
+    it = topics_.emplace(topic, Topic()).first;
+    it->second.tag = next_tag_++;
+  }
+  Topic& entry = it->second;
+  entry.positions.emplace(id, entry.subscribers.size());
+  entry.subscribers.push_back(id);
+  topics.push_back(topic);
+  subscribed_.store(subscriptions_.size(), std::memory_order_relaxed);
+  MarkChanged(topic);
+  return true;
+}
+
+bool TopicRegistry::Unsubscribe(ConnectionRegistry::Id id, const std::string& topic) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!RemoveLocked(id, topic)) {
+    return false;
+  }
+  auto it = subscriptions_.find(id);
+  if (it != subscriptions_.end()) {
+    auto& topics = it->second;
+    topics.erase(std::find(topics.begin(), topics.end(), topic));
+    if (topics.empty()) {
+      subscriptions_.erase(it);
+      subscribed_.store(subscriptions_.size(), std::memory_order_relaxed);
+    }
+  }
+  return true;
+}
+
+void TopicRegistry::UnsubscribeAll(ConnectionRegistry::Id id) {
+  if (subscribed_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = subscriptions_.find(id);
+  if (it == subscriptions_.end()) {
+    return;
+  }
+  for (const auto& topic : it->second) {
+    RemoveLocked(id, topic);
+  }
+  subscriptions_.erase(it);
+  subscribed_.store(subscriptions_.size(), std::memory_order_relaxed);
+}
+
+TopicRegistry::Snapshot TopicRegistry::Find(const std::string& topic) {
+  if (stale_.load(std::memory_order_acquire)) {
+    PublishChanges();
+  }
+  const std::shared_ptr<const Directory> directory = LoadDirectory();
+  auto it = directory->find(topic);
+  if (it == directory->end()) {
+    return Snapshot();
+  }
+  return it->second;
+}
+
+bool TopicRegistry::RemoveLocked(ConnectionRegistry::Id id, const std::string& topic) {
+  auto it = topics_.find(topic);
+  if (it == topics_.end()) {
+    return false;
+  }
+  Topic& entry = it->second;
+  auto position = entry.positions.find(id);
+  if (position == entry.positions.end()) {
+    return false;
+  }
+
+  // Move the last subscriber into the gap
+  const std::size_t index = position->second;
+  entry.positions.erase(position);
+  if (index + 1 != entry.subscribers.size()) {
+    entry.subscribers[index] = entry.subscribers.back();
+    entry.positions[entry.subscribers[index]] = index;
+  }
+  entry.subscribers.pop_back();
+  MarkChanged(topic);
+  if (entry.subscribers.empty()) {
+    topics_.erase(it);
+  }
+  return true;
+}
+
+void TopicRegistry::MarkChanged(const std::string& topic) {
+  changed_.insert(topic);
+  stale_.store(true, std::memory_order_release);
+}
+
+void TopicRegistry::PublishChanges() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (changed_.empty()) {
+    return;
+  }
+
+  // Unchanged topics share their lists with the previous directory
+  auto directory = std::make_shared<Directory>(*LoadDirectory());
+  for (const auto& name : changed_) {
+    auto it = topics_.find(name);
+    if (it == topics_.end()) {
+      directory->erase(name);
+    } else {
+      (*directory)[name] = Snapshot{it->second.tag,
+                                    std::make_shared<const SubscriberList>(it->second.subscribers)};
+    }
+  }
+  changed_.clear();
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+  directory_.store(std::move(directory));
+#else
+  std::atomic_store(&directory_, std::shared_ptr<const Directory>(std::move(directory)));
+#endif
+  stale_.store(false, std::memory_order_release);
+}
+
+std::shared_ptr<const TopicRegistry::Directory> TopicRegistry::LoadDirectory() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+  return directory_.load();
+#else
+  return std::atomic_load(&directory_);
+#endif
+}
+
+}  // namespace internal
+}  // namespace tcp_server
@@ -0,0 +1,144 @@
+/**
+ * @file topic_registry.h
+ * @brief Named groups of connections for publish/subscribe fan-out
+ */
+
+#ifndef TCP_SERVER_INTERNAL_TOPIC_REGISTRY_H_
+#define TCP_SERVER_INTERNAL_TOPIC_REGISTRY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "src/internal/connection_registry.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Subscriber lists of every topic
+ *
+ * Subscriptions change a mutable master copy under the registry mutex in
+ * constant time. Publishing reads an immutable directory of per-topic
+ * subscriber lists through an atomic shared_ptr, so fan-out takes no lock
+ * however many subscribers there are. The directory is rebuilt lazily: the
+ * first Find() after a batch of changes copies only the topics that changed,
+ * once, instead of every subscription copying its whole list. Subscribers are
+ * connection ids, so a list never keeps a closed connection alive; stale ids
+ * are pruned when found.
+ */
+class TopicRegistry {
+ public:
+  using SubscriberList = std::vector<ConnectionRegistry::Id>;
+
+  /**
+   * @brief Snapshot of one topic taken for a publish
+   */
+  struct Snapshot {
+    std::uint64_t tag = 0;                              ///< Unique identity of the topic
+    std::shared_ptr<const SubscriberList> subscribers;  ///< Subscribers at the time of the call
+  };
+
+  static constexpr std::uint64_t kBroadcastTag = 1;  ///< Tag of messages sent to every connection
+
+  TopicRegistry();
+  TopicRegistry(const TopicRegistry&) = delete;
+  TopicRegistry& operator=(const TopicRegistry&) = delete;
+
+  /**
+   * @brief Add a connection to a topic, creating the topic if needed
+   * @param id Connection id
+   * @param topic Topic name
+   * @return false if the connection was already subscribed
+   */
+  bool Subscribe(ConnectionRegistry::Id id, const std::string& topic);
+
+  /**
+   * @brief Remove a connection from a topic
+   * @param id Connection id
+   * @param topic Topic name
+   * @return false if the connection was not subscribed
+   */
+  bool Unsubscribe(ConnectionRegistry::Id id, const std::string& topic);
+
+  /**
+   * @brief Remove a connection from every topic it subscribed to
+   *
+   * Returns without locking when no connection has subscriptions, so closing
+   * connections costs nothing on servers that do not use topics.
+   * @param id Connection id
+   */
+  void UnsubscribeAll(ConnectionRegistry::Id id);
+
+  /**
+   * @brief Get the current subscribers of a topic
+   *
+   * Lock-free unless subscriptions changed since the last call, in which case
+   * this call rebuilds the changed topics' lists under the mutex.
+   * @param topic Topic name
+   * @return Snapshot; subscribers is nullptr if the topic has none
+   */
+  Snapshot Find(const std::string& topic);
+
+ private:
+  /**
+   * @brief Master copy of one topic, changed in place under mutex_
+   */
+  struct Topic {
+    std::uint64_t tag = 0;       ///< Never reused, even if the name is
+    SubscriberList subscribers;  ///< Subscribers in no particular order
+    std::unordered_map<ConnectionRegistry::Id, std::size_t> positions;  ///< Index in subscribers
+  };
+
+  /**
+   * @brief Published snapshots by topic name; replaced, never modified
+   */
+  using Directory = std::unordered_map<std::string, Snapshot>;
+
+  /**
+   * @brief Remove a connection from a topic with mutex_ held
+   * @return false if the connection was not subscribed
+   */
+  bool RemoveLocked(ConnectionRegistry::Id id, const std::string& topic);
+
+  /**
+   * @brief Record that a topic's published list is out of date, with mutex_ held
+   * @param topic Topic name
+   */
+  void MarkChanged(const std::string& topic);
+
+  /**
+   * @brief Publish a new directory with the changed topics rebuilt
+   */
+  void PublishChanges();
+
+  /**
+   * @brief Current directory
+   * @return Directory readers may use without the lock
+   */
+  std::shared_ptr<const Directory> LoadDirectory() const;
+
+  std::mutex mutex_;  ///< Guards the members below (never held while writing to sockets)
+  std::uint64_t next_tag_ = kBroadcastTag + 1;     ///< Tag of the next topic created
+  std::unordered_map<std::string, Topic> topics_;  ///< Master copy by name
+  std::unordered_map<ConnectionRegistry::Id, std::vector<std::string>>
+      subscriptions_;                              ///< Topics of each subscribed connection
+  std::unordered_set<std::string> changed_;        ///< Topics not yet published
+  std::atomic<bool> stale_{false};          ///< changed_ is not empty, readable without the lock
+  std::atomic<std::size_t> subscribed_{0};  ///< subscriptions_.size(), readable without the lock
+#if defined(__cpp_lib_atomic_shared_ptr)
+  std::atomic<std::shared_ptr<const Directory>> directory_;  ///< Published snapshots
+#else
+  std::shared_ptr<const Directory> directory_;  ///< Published snapshots (std::atomic_load/store only)
+#endif
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_TOPIC_REGISTRY_H_
@@ -0,0 +1,122 @@
+#include "src/internal/transport.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+bool IsLocal(const StreamProtocol& protocol) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  return protocol.family() == AF_UNIX;
+#else
+  (void)protocol;
+  return false;
+#endif
+}
+
+bool IsLocal(const StreamProtocol::endpoint& endpoint) {
+  return IsLocal(endpoint.protocol());
+}
+
+boost::asio::ip::tcp::endpoint ToTcpEndpoint(const StreamProtocol::endpoint& endpoint) {
+  boost::asio::ip::tcp::endpoint result;
+  const int family = endpoint.protocol().family();
+  if (family == BOOST_ASIO_OS_DEF(AF_INET) || family == BOOST_ASIO_OS_DEF(AF_INET6)) {
+    std::memcpy(result.data(), endpoint.data(), endpoint.size());
+    result.resize(endpoint.size());
+  }
+  return result;
+}
+
+std::string DescribeEndpoint(const StreamProtocol::endpoint& endpoint) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  if (IsLocal(endpoint)) {
+    const std::size_t offset = offsetof(sockaddr_un, sun_path);
+    if (endpoint.size() <= offset) {
+      // Clients rarely bind their socket, so peers are usually unnamed
+      return "unix";
+    }
+    const char* path = reinterpret_cast<const sockaddr_un*>(endpoint.data())->sun_path;
+    std::string name(path, endpoint.size() - offset);
+    if (name.front() == '\0') {
+      return "unix:@" + name.substr(1);
+    }
+    return "unix:" + name.substr(0, name.find('\0'));
+  }
+#endif
+  const boost::asio::ip::tcp::endpoint tcp_endpoint = ToTcpEndpoint(endpoint);
+  return tcp_endpoint.address().to_string() + ":" + std::to_string(tcp_endpoint.port());
+}
+
+StreamProtocol::endpoint BoundEndpoint(int native_handle) {
+  sockaddr_storage address{};
+  socklen_t length = sizeof(address);
+  if (::getsockname(native_handle, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+    throw boost::system::system_error(
+        boost::system::error_code(errno, boost::system::system_category()), "getsockname");
+  }
+  int protocol = IPPROTO_TCP;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  if (address.ss_family == AF_UNIX) {
+    protocol = 0;
+  }
+#endif
+  return StreamProtocol::endpoint(reinterpret_cast<const sockaddr*>(&address), length, protocol);
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+StreamProtocol::endpoint MakeLocalEndpoint(const std::string& path) {
+  if (path.empty()) {
+    throw std::invalid_argument("Unix socket path must not be empty");
+  }
+  std::string name = path;
+  if (name.front() == '@') {
+#if defined(__linux__)
+    // The name is the rest of sun_path after a leading zero byte
+    name.front() = '\0';
+#else
+    throw std::invalid_argument("Abstract socket names are only supported on Linux: " + path);
+#endif
+  }
+  if (name.size() >= sizeof(sockaddr_un::sun_path)) {
+    throw std::invalid_argument("Unix socket path is too long: " + path);
+  }
+  return StreamProtocol::endpoint(boost::asio::local::stream_protocol::endpoint(name));
+}
+
+void RemoveStaleSocketFile(const std::string& path) {
+  struct stat status;
+  if (path.empty() || path.front() == '@' || ::lstat(path.c_str(), &status) != 0 ||
+      !S_ISSOCK(status.st_mode)) {
+    return;
+  }
+
+  const StreamProtocol::endpoint endpoint = MakeLocalEndpoint(path);
+  const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (probe < 0) {
+    return;
+  }
+  // Connecting to a socket file without a listener is refused at once
+  if (::connect(probe, endpoint.data(), static_cast<socklen_t>(endpoint.size())) != 0 &&
+      errno == ECONNREFUSED) {
+    ::unlink(path.c_str());
+  }
+  ::close(probe);
+}
+#endif
+
+}  // namespace internal
+}  // namespace tcp_server
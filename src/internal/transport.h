@@ -0,0 +1,91 @@
+/**
+ * @file transport.h
+ * @brief Stream transports the server listens on: TCP and Unix domain sockets
+ */
+
+#ifndef TCP_SERVER_INTERNAL_TRANSPORT_H_
+#define TCP_SERVER_INTERNAL_TRANSPORT_H_
+
+#include <string>
+
+#include "tcp_server/asio.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Protocol of listening and accepted sockets
+ *
+ * The generic stream protocol carries its address family at run time, so one
+ * acceptor, connection and socket type serve TCP and Unix domain sockets alike.
+ */
+using StreamProtocol = boost::asio::generic::stream_protocol;
+
+/**
+ * @brief Acceptor of the generic stream protocol, which does not define one itself
+ */
+using StreamAcceptor = boost::asio::basic_socket_acceptor<StreamProtocol>;
+
+/**
+ * @brief Whether a protocol is a Unix domain socket
+ * @param protocol Protocol
+ * @return true for AF_UNIX
+ */
+bool IsLocal(const StreamProtocol& protocol);
+
+/**
+ * @brief Whether an endpoint is a Unix domain socket address
+ * @param endpoint Endpoint
+ * @return true for AF_UNIX
+ */
+bool IsLocal(const StreamProtocol::endpoint& endpoint);
+
+/**
+ * @brief Convert an endpoint to a TCP endpoint
+ * @param endpoint IPv4, IPv6 or Unix domain socket endpoint
+ * @return The same address, or a default-constructed endpoint for a Unix domain socket
+ */
+boost::asio::ip::tcp::endpoint ToTcpEndpoint(const StreamProtocol::endpoint& endpoint);
+
+/**
+ * @brief Describe an endpoint for log messages
+ * @param endpoint Endpoint
+ * @return "address:port", "unix:path", "unix:@name" for an abstract name, or
+ *         "unix" for an unnamed peer
+ */
+std::string DescribeEndpoint(const StreamProtocol::endpoint& endpoint);
+
+/**
+ * @brief Get the address a socket is bound to
+ * @param native_handle Socket
+ * @return Endpoint whose protocol() has the socket's address family
+ * @throws boost::system::system_error If getsockname() fails
+ */
+StreamProtocol::endpoint BoundEndpoint(int native_handle);
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+/**
+ * @brief Make the endpoint of a Unix domain socket path
+ * @param path File system path, or on Linux "@name" for a name in the abstract namespace
+ * @return Endpoint
+ * @throws std::invalid_argument If the path is empty or too long, or abstract
+ *         names are not supported on this platform
+ */
+StreamProtocol::endpoint MakeLocalEndpoint(const std::string& path);
+
+/**
+ * @brief Remove a socket file that no process accepts on any more
+ *
+ * A server that exits without cleaning up leaves its socket file behind, and
+ * binding the path again would fail. A file that still accepts connections is
+ * left alone, so that binding reports the path as in use. Abstract names
+ * vanish with their socket and need no cleanup.
+ * @param path Path given to MakeLocalEndpoint()
+ */
+void RemoveStaleSocketFile(const std::string& path);
+#endif
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_TRANSPORT_H_
@@ -0,0 +1,142 @@
+#include "src/internal/work_stealing_pool.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+/**
+ * @brief Pool and queue index of the current thread, if it is a pool thread
+ */
+struct PoolThread {
+  const WorkStealingPool* pool = nullptr;
+  std::size_t index = 0;
+};
+
+thread_local PoolThread pool_thread;
+
+// Idle threads also wake up on their own after this long
+constexpr std::chrono::milliseconds kIdleWakeInterval(100);
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t thread_count, std::function<void()> thread_init,
+                                   std::shared_ptr<spdlog::logger> logger)
+    : thread_init_(std::move(thread_init)), logger_(std::move(logger)) {
+  thread_count = std::max<std::size_t>(thread_count, 1);
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this, i] { Run(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    stopping_ = true;
+  }
+  idle_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::Submit(Task task) {
+  // Pool threads keep follow-up work local; others spread it round-robin
+  const std::size_t index = pool_thread.pool == this
+                                ? pool_thread.index
+                                : next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                                      queues_.size();
+  {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  queued_.fetch_add(1);
+
+  // Only pay for the wake-up when somebody is asleep
+  if (sleeping_.load() > 0) {
+    { std::lock_guard<std::mutex> lock(idle_mutex_); }
+    idle_cv_.notify_one();
+  }
+}
+
+std::size_t WorkStealingPool::ThreadCount() const {
+  return threads_.size();
+}
+
+std::size_t WorkStealingPool::QueuedTasks() const {
+  return queued_.load(std::memory_order_relaxed);
+}
+
+void WorkStealingPool::Run(std::size_t index) {
+  pool_thread.pool = this;
+  pool_thread.index = index;
+  if (thread_init_) {
+    thread_init_();
+  }
+
+  Task task;
+  while (true) {
+    if (TakeTask(index, &task)) {
+      try {
+        task();
+      } catch (const std::exception& e) {
+        logger_->error("Error in handler pool task: {}", e.what());
+      }
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    sleeping_.fetch_add(1);
+    idle_cv_.wait_for(lock, kIdleWakeInterval,
+                      [this] { return stopping_ || queued_.load() > 0; });
+    sleeping_.fetch_sub(1);
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingPool::TakeTask(std::size_t index, Task* task) {
+  if (queued_.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+
+  // Oldest task of the own queue first
+  {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      queued_.fetch_sub(1);
+      return true;
+    }
+  }
+
+  // Then the oldest task of the other queues, so stolen work keeps its order
+  for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+    Queue& queue = *queues_[(index + offset) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      queued_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace internal
+}  // namespace tcp_server
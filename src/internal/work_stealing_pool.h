@@ -0,0 +1,113 @@
+/**
+ * @file work_stealing_pool.h
+ * @brief Thread pool with per-thread queues and work stealing
+ */
+
+#ifndef TCP_SERVER_INTERNAL_WORK_STEALING_POOL_H_
+#define TCP_SERVER_INTERNAL_WORK_STEALING_POOL_H_
+
+#include <spdlog/fwd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Compute pool that message handlers are offloaded to
+ *
+ * Every thread owns a queue. Tasks submitted from outside the pool are spread
+ * round-robin over the queues; tasks submitted from a pool thread go to its own
+ * queue. A thread takes the oldest task of its own queue and, when that is
+ * empty, steals the oldest task of another thread's queue, so one long task
+ * never holds up the tasks queued behind it and stolen work still runs in
+ * arrival order. Idle threads sleep until work arrives.
+ */
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+  /**
+   * @brief Start the pool threads
+   * @param thread_count Number of threads (at least 1)
+   * @param thread_init Called once on each pool thread before it runs tasks (may be empty)
+   * @param logger Logger for exceptions escaping tasks
+   */
+  WorkStealingPool(std::size_t thread_count, std::function<void()> thread_init,
+                   std::shared_ptr<spdlog::logger> logger);
+
+  /**
+   * @brief Stop and join the threads; tasks not yet started are discarded
+   */
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  /**
+   * @brief Queue a task
+   *
+   * Thread-safe. Exceptions escaping the task are logged and swallowed.
+   * @param task Task to run on a pool thread
+   */
+  void Submit(Task task);
+
+  /**
+   * @brief Number of pool threads
+   * @return Thread count
+   */
+  std::size_t ThreadCount() const;
+
+  /**
+   * @brief Number of tasks waiting for a thread
+   * @return Queued task count (a relaxed snapshot)
+   */
+  std::size_t QueuedTasks() const;
+
+ private:
+  /**
+   * @brief Task queue of one thread, on a cache line of its own
+   */
+  struct alignas(64) Queue {
+    std::mutex mutex;         ///< Guards tasks
+    std::deque<Task> tasks;   ///< Queued tasks, oldest first
+  };
+
+  /**
+   * @brief Thread main loop
+   * @param index Index of the thread's own queue
+   */
+  void Run(std::size_t index);
+
+  /**
+   * @brief Take a task from the own queue or steal one
+   * @param index Index of the calling thread's queue
+   * @param task Receives the task
+   * @return true if a task was taken
+   */
+  bool TakeTask(std::size_t index, Task* task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;  ///< One queue per thread
+  std::function<void()> thread_init_;           ///< Per-thread initialisation
+  std::shared_ptr<spdlog::logger> logger_;      ///< Logger for task exceptions
+  std::atomic<std::size_t> next_queue_{0};      ///< Round-robin cursor for external submits
+  std::atomic<std::size_t> queued_{0};          ///< Tasks in all queues
+  std::atomic<std::size_t> sleeping_{0};        ///< Threads waiting for work
+  std::mutex idle_mutex_;                       ///< Guards stopping_ and sleeping
+  std::condition_variable idle_cv_;             ///< Wakes sleeping threads
+  bool stopping_ = false;                       ///< Set by the destructor
+  std::vector<std::thread> threads_;            ///< Pool threads
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_WORK_STEALING_POOL_H_
@@ -0,0 +1,219 @@
+#include "src/internal/worker.h"
+
+#include <spdlog/spdlog.h>
+
+#include "src/internal/socket_tuning.h"
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h>
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+#if defined(__linux__) && defined(SO_REUSEPORT)
+using ReusePort = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+using BusyPoll = boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+#endif
+
+}  // namespace
+
+Worker::Worker(std::size_t index, int concurrency_hint,
+               std::shared_ptr<const ConnectionSettings> settings, std::size_t pool_size)
+    : index_(index),
+      logger_(settings->logger),
+      buffer_pool_(settings->min_read_buffer_size, settings->max_read_buffer_size),
+      io_context_(concurrency_hint),
+      work_guard_(boost::asio::make_work_guard(io_context_)),
+      tick_timer_(io_context_) {
+  // Connections on an io_context run by several threads need a strand
+  connection_pool_ = std::make_unique<ConnectionPool>(io_context_, concurrency_hint != 1,
+                                                      std::move(settings), &timing_wheel_,
+                                                      &buffer_pool_, pool_size);
+}
+
+Worker::~Worker() {
+  connection_pool_->Shutdown();
+}
+
+boost::asio::io_context& Worker::GetIoContext() {
+  return io_context_;
+}
+
+std::size_t Worker::GetListenerCount() const {
+  return listeners_.size();
+}
+
+Worker::Acceptor& Worker::GetAcceptor(std::size_t listener) {
+  return listeners_[listener]->acceptor;
+}
+
+ConnectionPool& Worker::GetConnectionPool() {
+  return *connection_pool_;
+}
+
+BufferPool& Worker::GetBufferPool() {
+  return buffer_pool_;
+}
+
+void Worker::Preallocate() {
+  connection_pool_->Preallocate();
+}
+
+TimingWheel& Worker::GetTimingWheel() {
+  return timing_wheel_;
+}
+
+void Worker::StartTimingWheel(std::chrono::steady_clock::duration tick) {
+  tick_ = tick;
+  wheel_start_ = std::chrono::steady_clock::now() -
+                 tick_ * static_cast<std::int64_t>(timing_wheel_.Now());
+  ScheduleTick();
+}
+
+void Worker::ScheduleTick() {
+  // Tick on a fixed grid so that slow wake-ups do not accumulate drift
+  tick_timer_.expires_at(wheel_start_ +
+                         tick_ * static_cast<std::int64_t>(timing_wheel_.Now() + 1));
+  tick_timer_.async_wait([this](const boost::system::error_code& error) {
+    if (error) {
+      return;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - wheel_start_;
+    timing_wheel_.Advance(static_cast<std::uint64_t>(elapsed / tick_));
+    ScheduleTick();
+  });
+}
+
+std::size_t Worker::GetIndex() const {
+  return index_;
+}
+
+Worker::Listener& Worker::AddListener() {
+  listeners_.push_back(std::make_unique<Listener>(io_context_));
+  return *listeners_.back();
+}
+
+void Worker::Listen(const StreamProtocol::endpoint& endpoint, bool reuse_port,
+                    const SocketOptions& options) {
+  Acceptor& acceptor = AddListener().acceptor;
+  const StreamProtocol protocol = endpoint.protocol();
+  acceptor.open(protocol);
+  if (!IsLocal(protocol)) {
+    acceptor.set_option(Acceptor::reuse_address(options.reuse_address));
+    if (protocol.family() == BOOST_ASIO_OS_DEF(AF_INET6)) {
+      acceptor.set_option(boost::asio::ip::v6_only(options.ipv6_only));
+    }
+    if (reuse_port) {
+#if defined(__linux__) && defined(SO_REUSEPORT)
+      acceptor.set_option(ReusePort(true));
+#else
+      logger_->warn("SO_REUSEPORT is not supported on this platform");
+#endif
+    }
+  }
+  ConfigureListener(acceptor, protocol, options, *logger_);
+  acceptor.bind(endpoint);
+  acceptor.listen(options.backlog > 0 ? options.backlog : Acceptor::max_listen_connections);
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+void Worker::Assign(int native_handle, const SocketOptions& options) {
+  const StreamProtocol protocol = [native_handle] {
+    try {
+      return BoundEndpoint(native_handle).protocol();
+    } catch (...) {
+      ::close(native_handle);
+      throw;
+    }
+  }();
+  Acceptor& acceptor = AddListener().acceptor;
+  acceptor.assign(protocol, native_handle);
+  ConfigureListener(acceptor, protocol, options, *logger_);
+}
+#endif
+
+bool Worker::SetBusyPoll(std::chrono::microseconds busy_poll) {
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+  bool applied = true;
+  for (auto& listener : listeners_) {
+    boost::system::error_code ec;
+    if (!IsLocal(listener->acceptor.local_endpoint(ec))) {
+      listener->acceptor.set_option(BusyPoll(static_cast<int>(busy_poll.count())), ec);
+      applied = applied && !ec;
+    }
+  }
+  return applied;
+#else
+  (void)busy_poll;
+  return false;
+#endif
+}
+
+void Worker::StopAccepting() {
+  for (auto& listener : listeners_) {
+    boost::asio::post(listener->acceptor.get_executor(), [listener = listener.get()] {
+      boost::system::error_code ec;
+      listener->acceptor.close(ec);
+      listener->pause_timer.cancel();
+    });
+  }
+}
+
+void Worker::PauseAccepting(std::size_t listener, std::chrono::steady_clock::duration delay,
+                            std::function<void()> resume) {
+  Listener& paused = *listeners_[listener];
+  paused.pause_timer.expires_after(delay);
+  paused.pause_timer.async_wait(
+      [&paused, resume = std::move(resume)](const boost::system::error_code& error) {
+        if (!error && paused.acceptor.is_open()) {
+          resume();
+        }
+      });
+}
+
+void Worker::Run(std::chrono::microseconds busy_poll) {
+  if (busy_poll.count() <= 0) {
+    io_context_.run();
+    return;
+  }
+
+  // Spin while handlers keep arriving; a wakeup from epoll_wait costs more than the spin
+  using Clock = std::chrono::steady_clock;
+  while (!io_context_.stopped()) {
+    Clock::time_point deadline = Clock::now() + busy_poll;
+    while (!io_context_.stopped()) {
+      if (io_context_.poll() > 0) {
+        deadline = Clock::now() + busy_poll;
+      } else if (Clock::now() >= deadline) {
+        break;
+      }
+    }
+    io_context_.run_one();
+  }
+}
+
+void Worker::Stop() {
+  work_guard_.reset();
+  io_context_.stop();
+}
+
+bool Worker::SupportsReusePort() {
+#if defined(__linux__) && defined(SO_REUSEPORT)
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+}  // namespace tcp_server
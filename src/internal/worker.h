@@ -0,0 +1,235 @@
+/**
+ * @file worker.h
+ * @brief Class that owns an io_context and its listening acceptors
+ */
+
+#ifndef TCP_SERVER_INTERNAL_WORKER_H_
+#define TCP_SERVER_INTERNAL_WORKER_H_
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "src/internal/buffer_pool.h"
+#include "src/internal/connection_pool.h"
+#include "src/internal/timing_wheel.h"
+#include "src/internal/transport.h"
+#include "tcp_server/asio.h"
+#include "tcp_server/server_options.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief I/O worker
+ *
+ * Owns one io_context, the pool of connections bound to it, the timing
+ * wheel that drives their timeouts and, when listening, one acceptor per
+ * listening socket (a TCP port, Unix domain sockets, or both).
+ * In the shared execution mode a single worker is run by every thread;
+ * in the context-per-thread mode each thread runs its own worker.
+ */
+class Worker {
+ public:
+  using Acceptor = StreamAcceptor;
+
+  /**
+   * @brief Constructor
+   * @param index Index of this worker within the server
+   * @param concurrency_hint Number of threads expected to run the io_context
+   * @param settings Settings shared by all connections
+   * @param pool_size Number of connections Preallocate() creates and this worker recycles
+   */
+  Worker(std::size_t index, int concurrency_hint,
+         std::shared_ptr<const ConnectionSettings> settings, std::size_t pool_size);
+
+  /**
+   * @brief Destructor
+   *
+   * Destroys idle pooled connections while the io_context is still alive.
+   */
+  ~Worker();
+
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+
+  /**
+   * @brief Get the io_context owned by this worker
+   * @return Reference to the io_context
+   */
+  boost::asio::io_context& GetIoContext();
+
+  /**
+   * @brief Get the number of listening sockets added by Listen() and Assign()
+   * @return Number of acceptors
+   */
+  std::size_t GetListenerCount() const;
+
+  /**
+   * @brief Get an acceptor owned by this worker
+   * @param listener Index of the acceptor, in the order they were added
+   * @return Reference to the acceptor (closed once StopAccepting() ran)
+   */
+  Acceptor& GetAcceptor(std::size_t listener);
+
+  /**
+   * @brief Get the pool that provides this worker's connections
+   * @return Reference to the connection pool
+   */
+  ConnectionPool& GetConnectionPool();
+
+  /**
+   * @brief Get the pool of read buffers used on this worker's io_context
+   * @return Reference to the buffer pool (also lent to TcpClient connections)
+   */
+  BufferPool& GetBufferPool();
+
+  /**
+   * @brief Create the pooled connections
+   *
+   * Call on the thread that runs this worker after pinning it, so that the
+   * connections are allocated on its NUMA node.
+   */
+  void Preallocate();
+
+  /**
+   * @brief Get the timing wheel of this worker's connections
+   * @return Reference to the timing wheel
+   */
+  TimingWheel& GetTimingWheel();
+
+  /**
+   * @brief Start advancing the timing wheel on this worker's io_context
+   * @param tick Duration of one wheel tick
+   */
+  void StartTimingWheel(std::chrono::steady_clock::duration tick);
+
+  /**
+   * @brief Get the index of this worker
+   * @return Worker index
+   */
+  std::size_t GetIndex() const;
+
+  /**
+   * @brief Add an acceptor that opens, binds and listens on the given endpoint
+   * @param endpoint TCP or Unix domain socket endpoint to bind
+   * @param reuse_port Set SO_REUSEPORT before binding so that several
+   *                   acceptors can share the same port (TCP only)
+   * @param options Socket options for the listener and the connections it accepts
+   * @throws boost::system::system_error If the socket cannot be bound
+   */
+  void Listen(const StreamProtocol::endpoint& endpoint, bool reuse_port,
+              const SocketOptions& options);
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  /**
+   * @brief Add an acceptor for a socket that already listens
+   *
+   * Used for sockets inherited from another process and for Unix domain
+   * sockets shared with other workers.
+   * @param native_handle Listening socket; owned by the acceptor afterwards
+   * @param options Socket options for the connections it accepts (the bind
+   *                address and backlog stay as the other process set them)
+   * @throws boost::system::system_error If the socket cannot be assigned
+   */
+  void Assign(int native_handle, const SocketOptions& options);
+#endif
+
+  /**
+   * @brief Set SO_BUSY_POLL on the TCP listening sockets; accepted sockets inherit it
+   *
+   * Reads on the sockets then poll the device queue for up to the given time
+   * instead of waiting for an interrupt.
+   * @param busy_poll Time to busy-poll per read
+   * @return false if unsupported or not permitted (values above
+   *         net.core.busy_read need CAP_NET_ADMIN)
+   */
+  bool SetBusyPoll(std::chrono::microseconds busy_poll);
+
+  /**
+   * @brief Close the acceptors so that no further connections are accepted
+   *
+   * Thread-safe: each acceptor is closed on its strand, which cancels the
+   * pending accept with operation_aborted.
+   */
+  void StopAccepting();
+
+  /**
+   * @brief Call a function on an acceptor's strand after a delay
+   *
+   * Used to leave connections in the kernel's listen backlog while the server
+   * is saturated. Nothing is called if the acceptor is closed meanwhile.
+   * @param listener Index of the acceptor
+   * @param delay Time to wait
+   * @param resume Function that starts the next accept
+   */
+  void PauseAccepting(std::size_t listener, std::chrono::steady_clock::duration delay,
+                      std::function<void()> resume);
+
+  /**
+   * @brief Run the io_context on the calling thread until Stop() is called
+   *
+   * With a busy-poll period, the thread keeps polling for ready handlers
+   * until none has run for that long, and only then blocks for the next one.
+   * @param busy_poll Time to spin before blocking (0 blocks at once)
+   */
+  void Run(std::chrono::microseconds busy_poll = std::chrono::microseconds(0));
+
+  /**
+   * @brief Release the work guard and stop the io_context
+   */
+  void Stop();
+
+  /**
+   * @brief Whether SO_REUSEPORT load-balances accepts on this platform
+   * @return true if the kernel distributes connections across acceptors
+   */
+  static bool SupportsReusePort();
+
+ private:
+  /**
+   * @brief Listening socket and the timer that pauses it, on a strand of their own
+   */
+  struct Listener {
+    explicit Listener(boost::asio::io_context& io_context)
+        : acceptor(boost::asio::make_strand(io_context)), pause_timer(acceptor.get_executor()) {}
+
+    Acceptor acceptor;                      ///< Listening socket
+    boost::asio::steady_timer pause_timer;  ///< Delays the next accept while paused
+  };
+
+  /**
+   * @brief Add a closed acceptor
+   * @return The new listener
+   */
+  Listener& AddListener();
+
+  /**
+   * @brief Wait for the next tick and advance the timing wheel
+   */
+  void ScheduleTick();
+
+  std::size_t index_;                      ///< Worker index
+  spdlog::logger* logger_;                 ///< Server logger (owned by the server)
+  // Declared first so that they outlive every connection that may use them
+  TimingWheel timing_wheel_;               ///< Connection timeouts
+  BufferPool buffer_pool_;                 ///< Read buffers borrowed by the connections
+  // Declared before io_context_ so that connections released while the
+  // io_context destroys its pending handlers can still return their memory
+  std::unique_ptr<ConnectionPool> connection_pool_;  ///< Recycled connections
+  boost::asio::io_context io_context_;     ///< I/O context
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+      work_guard_;                         ///< Keeps run() alive while idle
+  std::vector<std::unique_ptr<Listener>> listeners_;  ///< Acceptors, added before Run()
+  boost::asio::steady_timer tick_timer_;   ///< Drives timing_wheel_
+  std::chrono::steady_clock::time_point wheel_start_;  ///< Time of wheel tick 0
+  std::chrono::steady_clock::duration tick_{};         ///< Duration of one wheel tick
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_WORKER_H_
@@ -0,0 +1,209 @@
+#include "src/internal/write_queue.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace tcp_server {
+namespace internal {
+
+std::size_t WriteQueue::Segment::Size() const {
+  if (body.size > 0) {
+    return static_cast<std::size_t>(body.size);
+  }
+  return shared ? shared->size() : data.size();
+}
+
+boost::asio::const_buffer WriteQueue::Segment::Buffer() const {
+  if (IsPinned()) {
+    return boost::asio::const_buffer(body.data, static_cast<std::size_t>(body.size));
+  }
+  const std::string& bytes = shared ? *shared : data;
+  return boost::asio::const_buffer(bytes.data(), bytes.size());
+}
+
+std::string* WriteQueue::Tail() {
+  if (queued_.empty() || !queued_.back().IsOwned() ||
+      queued_.back().data.size() >= kSegmentSize) {
+    SealTail();
+    queued_.emplace_back();
+    if (!spare_.empty()) {
+      queued_.back().data = std::move(spare_.back());
+      spare_.pop_back();
+    }
+  }
+  return &queued_.back().data;
+}
+
+void WriteQueue::AppendShared(std::shared_ptr<const std::string> payload, std::uint64_t tag) {
+  SealTail();
+  queued_bytes_ += payload->size();
+  queued_.emplace_back();
+  queued_.back().shared = std::move(payload);
+  queued_.back().tag = tag;
+}
+
+void WriteQueue::AppendBody(ResponseBody body) {
+  SealTail();
+  queued_bytes_ += static_cast<std::size_t>(body.size);
+  queued_.emplace_back();
+  queued_.back().body = std::move(body);
+}
+
+bool WriteQueue::ReplaceShared(std::shared_ptr<const std::string> payload, std::uint64_t tag) {
+  for (auto it = queued_.rbegin(); it != queued_.rend(); ++it) {
+    if (it->shared && it->tag == tag) {
+      queued_bytes_ = queued_bytes_ - it->shared->size() + payload->size();
+      it->shared = std::move(payload);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WriteQueue::HasQueued() const {
+  return queued_bytes_ + TailBytes() > 0;
+}
+
+bool WriteQueue::IsWriting() const {
+  return in_flight_;
+}
+
+std::size_t WriteQueue::Size() const {
+  return writing_bytes_ + queued_bytes_ + TailBytes();
+}
+
+BufferSequence WriteQueue::BeginWrite() {
+  // Memory segments up to the next file body, or the file body alone (with any
+  // empty segments before it, which add nothing to the write)
+  auto end = std::find_if(queued_.begin(), queued_.end(),
+                          [](const Segment& segment) { return segment.Size() > 0; });
+  if (end == queued_.end() || !end->IsFile()) {
+    end = std::find_if(end, queued_.end(), [](const Segment& segment) { return segment.IsFile(); });
+  } else {
+    ++end;
+  }
+  const std::size_t queued_bytes = queued_bytes_ + TailBytes();
+  if (end == queued_.end()) {
+    writing_.swap(queued_);
+  } else {
+    writing_.assign(std::make_move_iterator(queued_.begin()), std::make_move_iterator(end));
+    queued_.erase(queued_.begin(), end);
+  }
+
+  buffers_.clear();
+  writing_bytes_ = 0;
+  for (const auto& segment : writing_) {
+    writing_bytes_ += segment.Size();
+    if (!segment.IsFile() && segment.Size() > 0) {
+      buffers_.push_back(segment.Buffer());
+    }
+  }
+  queued_bytes_ = queued_bytes - writing_bytes_ - TailBytes();
+  in_flight_ = true;
+  return BufferSequence(buffers_.data(), buffers_.data() + buffers_.size());
+}
+
+BufferSequence WriteQueue::Writing() const {
+  return BufferSequence(buffers_.data(), buffers_.data() + buffers_.size());
+}
+
+const ResponseBody* WriteQueue::WritingFile() const {
+  if (!writing_.empty() && writing_.back().IsFile()) {
+    return &writing_.back().body;
+  }
+  return nullptr;
+}
+
+std::size_t WriteQueue::LargestWritingPinned() const {
+  std::size_t largest = 0;
+  for (const auto& segment : writing_) {
+    if (segment.IsPinned()) {
+      largest = std::max(largest, segment.Size());
+    }
+  }
+  return largest;
+}
+
+void WriteQueue::EndWrite() {
+  for (auto& segment : writing_) {
+    Recycle(std::move(segment));
+  }
+  writing_.clear();
+  buffers_.clear();
+  writing_bytes_ = 0;
+  in_flight_ = false;
+}
+
+void WriteQueue::ParkWriting(std::uint32_t first, std::uint32_t last) {
+  parked_.emplace_back();
+  ParkedBatch& batch = parked_.back();
+  batch.first = first;
+  batch.last = last;
+  batch.outstanding = last - first + 1;
+  batch.segments.swap(writing_);
+  EndWrite();
+}
+
+void WriteQueue::ReleaseParked(std::uint32_t low, std::uint32_t high) {
+  // Sequence numbers wrap at 2^32, so ranges are compared modulo 2^32
+  for (auto& batch : parked_) {
+    for (std::uint32_t sequence = batch.first;; ++sequence) {
+      if (batch.outstanding > 0 &&
+          static_cast<std::uint32_t>(sequence - low) <= static_cast<std::uint32_t>(high - low)) {
+        --batch.outstanding;
+      }
+      if (sequence == batch.last) {
+        break;
+      }
+    }
+  }
+  while (!parked_.empty() && parked_.front().outstanding == 0) {
+    for (auto& segment : parked_.front().segments) {
+      Recycle(std::move(segment));
+    }
+    parked_.pop_front();
+  }
+  // Completions out of order are rare; release those batches without recycling
+  parked_.erase(std::remove_if(parked_.begin(), parked_.end(),
+                               [](const ParkedBatch& batch) { return batch.outstanding == 0; }),
+                parked_.end());
+}
+
+bool WriteQueue::HasParked() const {
+  return !parked_.empty();
+}
+
+void WriteQueue::Clear() {
+  for (auto& segment : queued_) {
+    Recycle(std::move(segment));
+  }
+  queued_.clear();
+  queued_bytes_ = 0;
+  parked_.clear();
+  EndWrite();
+}
+
+void WriteQueue::SealTail() {
+  queued_bytes_ += TailBytes();
+}
+
+std::size_t WriteQueue::TailBytes() const {
+  if (queued_.empty() || !queued_.back().IsOwned()) {
+    return 0;
+  }
+  return queued_.back().data.size();
+}
+
+void WriteQueue::Recycle(Segment&& segment) {
+  // Oversized segments are dropped so one large response does not pin memory
+  std::string& data = segment.data;
+  if (spare_.size() < kMaxSpareSegments && data.capacity() > 0 &&
+      data.capacity() <= 2 * kSegmentSize) {
+    data.clear();
+    spare_.push_back(std::move(data));
+  }
+}
+
+}  // namespace internal
+}  // namespace tcp_server
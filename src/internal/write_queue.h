@@ -0,0 +1,232 @@
+/**
+ * @file write_queue.h
+ * @brief Outbound queue that batches responses into vectored writes
+ */
+
+#ifndef TCP_SERVER_INTERNAL_WRITE_QUEUE_H_
+#define TCP_SERVER_INTERNAL_WRITE_QUEUE_H_
+
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tcp_server/response_writer.h"
+
+namespace tcp_server {
+namespace internal {
+
+/**
+ * @brief Non-owning view of a contiguous array of buffers
+ *
+ * Used as the buffer sequence of async_write so that the operation does not
+ * copy the queue's buffer vector.
+ */
+class BufferSequence {
+ public:
+  using value_type = boost::asio::const_buffer;
+  using const_iterator = const boost::asio::const_buffer*;
+
+  BufferSequence(const_iterator begin, const_iterator end) : begin_(begin), end_(end) {}
+
+  const_iterator begin() const { return begin_; }
+  const_iterator end() const { return end_; }
+
+ private:
+  const_iterator begin_;  ///< First buffer
+  const_iterator end_;    ///< One past the last buffer
+};
+
+/**
+ * @brief Per-connection outbound queue
+ *
+ * Responses are appended to the tail segment while a write may be in flight.
+ * Published messages are queued by reference as shared immutable segments,
+ * so one payload fanned out to many connections is never copied; response
+ * bodies (file ranges and pinned buffers) are queued by reference the same way.
+ * BeginWrite() moves everything queued since the last completion into one
+ * batch of buffers for a single vectored write; EndWrite() recycles the
+ * segments so that steady-state traffic does not allocate. A file body is
+ * always a batch of its own, since it is sent with sendfile() rather than
+ * from memory.
+ * Queued bytes are counted as segments are added, so Size() and HasQueued()
+ * are constant time; only the tail segment, which callers append to in place,
+ * is measured when asked.
+ * Not thread-safe; used only from the connection's executor.
+ */
+class WriteQueue {
+ public:
+  static constexpr std::size_t kSegmentSize = 64 * 1024;  ///< Size at which a new segment is started
+  static constexpr std::size_t kMaxSpareSegments = 4;     ///< Recycled segments kept for reuse
+
+  /**
+   * @brief Get the segment that new response bytes are appended to
+   *
+   * The returned pointer is valid until the next call to Tail() or BeginWrite().
+   * @return Buffer to append to
+   */
+  std::string* Tail();
+
+  /**
+   * @brief Queue a shared payload after everything queued so far
+   * @param payload Immutable bytes; kept alive until written
+   * @param tag Identifies the payload's source for ReplaceShared()
+   */
+  void AppendShared(std::shared_ptr<const std::string> payload, std::uint64_t tag);
+
+  /**
+   * @brief Queue a response body after everything queued so far
+   * @param body File range or pinned buffer; its owner is kept until written
+   */
+  void AppendBody(ResponseBody body);
+
+  /**
+   * @brief Replace the newest queued shared payload with the same tag
+   *
+   * Payloads already being written are not replaced.
+   * @param payload Replacement
+   * @param tag Tag given to AppendShared()
+   * @return true if a payload was replaced, false if none with the tag is queued
+   */
+  bool ReplaceShared(std::shared_ptr<const std::string> payload, std::uint64_t tag);
+
+  /**
+   * @brief Whether bytes are queued that are not yet being written
+   * @return true if BeginWrite() would produce a non-empty batch
+   */
+  bool HasQueued() const;
+
+  /**
+   * @brief Whether a write is in flight
+   * @return true between BeginWrite() and EndWrite()
+   */
+  bool IsWriting() const;
+
+  /**
+   * @brief Number of bytes queued or being written
+   * @return Total outstanding bytes
+   */
+  std::size_t Size() const;
+
+  /**
+   * @brief Move queued segments into a new in-flight batch
+   *
+   * The batch is either the memory segments up to the next file body, or the
+   * file body alone when it comes first.
+   * @return Buffers covering a memory batch (empty for a file batch), valid until EndWrite()
+   */
+  BufferSequence BeginWrite();
+
+  /**
+   * @brief Get the buffers of the in-flight batch
+   * @return Buffers returned by the last BeginWrite()
+   */
+  BufferSequence Writing() const;
+
+  /**
+   * @brief Get the file body of the in-flight batch
+   * @return The body, or nullptr if the batch is in memory
+   */
+  const ResponseBody* WritingFile() const;
+
+  /**
+   * @brief Size of the largest pinned buffer in the in-flight batch
+   * @return Bytes, or 0 if the batch has no pinned buffer
+   */
+  std::size_t LargestWritingPinned() const;
+
+  /**
+   * @brief Release the in-flight batch after the write completed
+   */
+  void EndWrite();
+
+  /**
+   * @brief End the in-flight write but keep its memory until the kernel releases it
+   *
+   * Used after sending with MSG_ZEROCOPY, where the kernel reads the pages
+   * after the send calls return.
+   * @param first Zero-copy sequence number of the batch's first send call
+   * @param last Zero-copy sequence number of the batch's last send call
+   */
+  void ParkWriting(std::uint32_t first, std::uint32_t last);
+
+  /**
+   * @brief Release parked batches once every send call they used has completed
+   * @param low First sequence number the kernel reported complete
+   * @param high Last sequence number the kernel reported complete
+   */
+  void ReleaseParked(std::uint32_t low, std::uint32_t high);
+
+  /**
+   * @brief Whether memory is held for zero-copy sends the kernel has not completed
+   * @return true if a parked batch remains
+   */
+  bool HasParked() const;
+
+  /**
+   * @brief Discard all queued, in-flight and parked data
+   */
+  void Clear();
+
+ private:
+  /**
+   * @brief Queued bytes: an owned buffer, a shared payload when shared is set,
+   *        or a response body when body.size is nonzero
+   */
+  struct Segment {
+    std::string data;                            ///< Owned bytes
+    std::shared_ptr<const std::string> shared;   ///< Shared payload written instead of data
+    std::uint64_t tag = 0;                       ///< Source of the shared payload
+    ResponseBody body;                           ///< Body written instead of data
+
+    bool IsOwned() const { return !shared && body.size == 0; }
+    bool IsFile() const { return body.size > 0 && body.data == nullptr; }
+    bool IsPinned() const { return body.size > 0 && body.data != nullptr; }
+    std::size_t Size() const;
+    boost::asio::const_buffer Buffer() const;  ///< Bytes of a memory segment
+  };
+
+  /**
+   * @brief Segments of a zero-copy write waiting for the kernel's completion
+   */
+  struct ParkedBatch {
+    std::uint32_t first = 0;        ///< Sequence number of the first send call
+    std::uint32_t last = 0;         ///< Sequence number of the last send call
+    std::uint32_t outstanding = 0;  ///< Send calls not yet reported complete
+    std::vector<Segment> segments;  ///< Memory the kernel may still read
+  };
+
+  /**
+   * @brief Return a segment's buffer to the spare list or free it
+   * @param segment Segment to recycle
+   */
+  void Recycle(Segment&& segment);
+
+  /**
+   * @brief Count the open tail segment into queued_bytes_ before a segment is added after it
+   */
+  void SealTail();
+
+  /**
+   * @brief Bytes in the open tail segment, which is not counted in queued_bytes_
+   * @return Size of the last queued segment if callers may still append to it, otherwise 0
+   */
+  std::size_t TailBytes() const;
+
+  std::vector<Segment> queued_;          ///< Segments waiting for the next write
+  std::vector<Segment> writing_;         ///< Segments of the in-flight write
+  std::vector<std::string> spare_;       ///< Cleared segments kept for reuse
+  std::deque<ParkedBatch> parked_;       ///< Zero-copy writes the kernel has not completed
+  std::vector<boost::asio::const_buffer> buffers_;  ///< Buffers of the in-flight write
+  std::size_t writing_bytes_ = 0;        ///< Bytes in the in-flight write
+  std::size_t queued_bytes_ = 0;         ///< Bytes in queued_, except the open tail segment
+  bool in_flight_ = false;               ///< Whether a write is in flight
+};
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_WRITE_QUEUE_H_
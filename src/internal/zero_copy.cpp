@@ -0,0 +1,247 @@
+#include "src/internal/zero_copy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+#define TCP_SERVER_ZERO_COPY_SEND 1
+#endif
+
+namespace tcp_server {
+namespace internal {
+
+namespace {
+
+#if defined(__linux__)
+// Largest count sendfile() transfers in one call
+constexpr std::size_t kMaxSendFileCall = 0x7ffff000;
+#endif
+
+// Buffers passed to one sendmsg() call; the rest go in the next call
+constexpr std::size_t kMaxIovecs = 64;
+
+boost::system::error_code LastError() {
+  return boost::system::error_code(errno, boost::asio::error::get_system_category());
+}
+
+}  // namespace
+
+std::size_t SendFileRange(NativeSocket socket, int fd, std::uint64_t offset, std::size_t size,
+                          boost::system::error_code& error) {
+  error.clear();
+#if defined(__linux__)
+  std::size_t sent = 0;
+  while (sent < size) {
+    off_t position = static_cast<off_t>(offset + sent);
+    const ssize_t result =
+        ::sendfile(socket, fd, &position, std::min(size - sent, kMaxSendFileCall));
+    if (result > 0) {
+      sent += static_cast<std::size_t>(result);
+    } else if (result == 0) {
+      error = boost::asio::error::eof;
+      break;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      error = boost::asio::error::would_block;
+      break;
+    } else if (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP) {
+      // Not a regular file, or a file system without sendfile() support
+      error = boost::asio::error::operation_not_supported;
+      break;
+    } else {
+      error = LastError();
+      break;
+    }
+  }
+  return sent;
+#else
+  (void)socket;
+  (void)fd;
+  (void)offset;
+  (void)size;
+  error = boost::asio::error::operation_not_supported;
+  return 0;
+#endif
+}
+
+std::size_t ReadFileAt(int fd, std::uint64_t offset, char* buffer, std::size_t size,
+                       boost::system::error_code& error) {
+  error.clear();
+#if defined(_WIN32)
+  HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  OVERLAPPED overlapped = {};
+  overlapped.Offset = static_cast<DWORD>(offset);
+  overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD read = 0;
+  const DWORD request = static_cast<DWORD>(std::min<std::size_t>(size, 1u << 30));
+  if (!::ReadFile(handle, buffer, request, &read, &overlapped)) {
+    const DWORD last_error = ::GetLastError();
+    if (last_error != ERROR_HANDLE_EOF) {
+      error = boost::system::error_code(static_cast<int>(last_error),
+                                        boost::asio::error::get_system_category());
+    }
+    return 0;
+  }
+  return read;
+#else
+  while (true) {
+    const ssize_t result = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+    if (result >= 0) {
+      return static_cast<std::size_t>(result);
+    }
+    if (errno != EINTR) {
+      error = LastError();
+      return 0;
+    }
+  }
+#endif
+}
+
+bool EnableZeroCopySend(NativeSocket socket) {
+#if defined(TCP_SERVER_ZERO_COPY_SEND)
+  const int enable = 1;
+  return ::setsockopt(socket, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0;
+#else
+  (void)socket;
+  return false;
+#endif
+}
+
+std::size_t SendBuffers(NativeSocket socket, const boost::asio::const_buffer* begin,
+                        const boost::asio::const_buffer* end, std::size_t skip, bool zero_copy,
+                        boost::system::error_code& error) {
+  error.clear();
+#if defined(_WIN32)
+  (void)socket;
+  (void)begin;
+  (void)end;
+  (void)skip;
+  (void)zero_copy;
+  error = boost::asio::error::operation_not_supported;
+  return 0;
+#else
+  iovec iovecs[kMaxIovecs];
+  std::size_t count = 0;
+  for (const boost::asio::const_buffer* buffer = begin; buffer != end && count < kMaxIovecs;
+       ++buffer) {
+    if (skip >= buffer->size()) {
+      skip -= buffer->size();
+      continue;
+    }
+    iovecs[count].iov_base =
+        const_cast<char*>(static_cast<const char*>(buffer->data()) + skip);
+    iovecs[count].iov_len = buffer->size() - skip;
+    skip = 0;
+    ++count;
+  }
+
+  msghdr message = {};
+  message.msg_iov = iovecs;
+  message.msg_iovlen = count;
+  int flags = 0;
+#if defined(MSG_NOSIGNAL)
+  flags |= MSG_NOSIGNAL;
+#endif
+#if defined(TCP_SERVER_ZERO_COPY_SEND)
+  if (zero_copy) {
+    flags |= MSG_ZEROCOPY;
+  }
+#else
+  (void)zero_copy;
+#endif
+
+  while (true) {
+    const ssize_t result = ::sendmsg(socket, &message, flags);
+    if (result >= 0) {
+      return static_cast<std::size_t>(result);
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      error = boost::asio::error::would_block;
+    } else if (errno == ENOBUFS) {
+      error = boost::asio::error::no_buffer_space;
+    } else {
+      error = LastError();
+    }
+    return 0;
+  }
+#endif
+}
+
+std::size_t ReadZeroCopyCompletions(
+    NativeSocket socket, const std::function<void(std::uint32_t, std::uint32_t)>& on_complete,
+    boost::system::error_code& error) {
+  error.clear();
+  std::size_t ranges = 0;
+#if defined(TCP_SERVER_ZERO_COPY_SEND)
+  while (true) {
+    alignas(cmsghdr) char control[128];
+    msghdr message = {};
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (::recvmsg(socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        error = LastError();
+      }
+      break;
+    }
+
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+      const bool is_error = (header->cmsg_level == IPPROTO_IP && header->cmsg_type == IP_RECVERR) ||
+                            (header->cmsg_level == IPPROTO_IPV6 &&
+                             header->cmsg_type == IPV6_RECVERR);
+      if (!is_error) {
+        continue;
+      }
+      sock_extended_err extended;
+      std::memcpy(&extended, CMSG_DATA(header), sizeof(extended));
+      if (extended.ee_errno == 0 && extended.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+        on_complete(extended.ee_info, extended.ee_data);
+        ++ranges;
+      }
+    }
+  }
+#else
+  (void)socket;
+  (void)on_complete;
+#endif
+  return ranges;
+}
+
+bool HasHungUp(NativeSocket socket) {
+#if defined(_WIN32)
+  (void)socket;
+  return false;
+#else
+  pollfd descriptor = {};
+  descriptor.fd = socket;
+  return ::poll(&descriptor, 1, 0) > 0 && (descriptor.revents & POLLHUP) != 0;
+#endif
+}
+
+}  // namespace internal
+}  // namespace tcp_server
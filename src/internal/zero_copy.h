@@ -0,0 +1,98 @@
+/**
+ * @file zero_copy.h
+ * @brief System calls that send response bodies without copying them through user space
+ */
+
+#ifndef TCP_SERVER_INTERNAL_ZERO_COPY_H_
+#define TCP_SERVER_INTERNAL_ZERO_COPY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "tcp_server/asio.h"
+
+namespace tcp_server {
+namespace internal {
+
+using NativeSocket = boost::asio::ip::tcp::socket::native_handle_type;
+
+/**
+ * @brief Send part of a file with sendfile()
+ *
+ * The bytes go from the page cache to the socket without passing through
+ * user space. Sends until the socket buffer is full.
+ * @param socket Non-blocking socket
+ * @param fd File to read from
+ * @param offset Position in the file
+ * @param size Bytes to send
+ * @param error would_block when the socket buffer is full, eof if the file
+ *              is shorter than expected, operation_not_supported where
+ *              sendfile() cannot be used for this file or platform
+ * @return Bytes sent
+ */
+std::size_t SendFileRange(NativeSocket socket, int fd, std::uint64_t offset, std::size_t size,
+                          boost::system::error_code& error);
+
+/**
+ * @brief Read part of a file without moving its file position
+ *
+ * Fallback for SendFileRange(); safe when several responses share the descriptor.
+ * @param fd File to read from
+ * @param offset Position in the file
+ * @param buffer Destination
+ * @param size Bytes to read at most
+ * @param error Error information
+ * @return Bytes read (0 at end of file)
+ */
+std::size_t ReadFileAt(int fd, std::uint64_t offset, char* buffer, std::size_t size,
+                       boost::system::error_code& error);
+
+/**
+ * @brief Allow MSG_ZEROCOPY sends on a socket (SO_ZEROCOPY)
+ * @param socket Socket
+ * @return false if the platform or kernel does not support it
+ */
+bool EnableZeroCopySend(NativeSocket socket);
+
+/**
+ * @brief Send buffers with one sendmsg() call
+ *
+ * With zero_copy, the kernel pins the pages instead of copying them and
+ * reports through the socket's error queue when it is done with them; each
+ * call that sends bytes takes the next sequence number.
+ * @param socket Non-blocking socket with EnableZeroCopySend() applied
+ * @param begin First buffer
+ * @param end One past the last buffer
+ * @param skip Bytes at the start of the buffers that were already sent
+ * @param zero_copy Whether to pass MSG_ZEROCOPY
+ * @param error would_block when the socket buffer is full, no_buffer_space
+ *              when the kernel cannot pin more pages for this socket
+ * @return Bytes sent
+ */
+std::size_t SendBuffers(NativeSocket socket, const boost::asio::const_buffer* begin,
+                        const boost::asio::const_buffer* end, std::size_t skip, bool zero_copy,
+                        boost::system::error_code& error);
+
+/**
+ * @brief Read every zero-copy completion queued on a socket's error queue
+ * @param socket Non-blocking socket
+ * @param on_complete Called with the first and last sequence number of each completed range
+ * @param error Error information (an empty queue is not an error)
+ * @return Number of completion ranges read
+ */
+std::size_t ReadZeroCopyCompletions(
+    NativeSocket socket, const std::function<void(std::uint32_t, std::uint32_t)>& on_complete,
+    boost::system::error_code& error);
+
+/**
+ * @brief Whether the peer has closed both directions of the connection
+ * @param socket Socket
+ * @return true after a hang-up; no more completions are worth waiting for
+ */
+bool HasHungUp(NativeSocket socket);
+
+}  // namespace internal
+}  // namespace tcp_server
+
+#endif  // TCP_SERVER_INTERNAL_ZERO_COPY_H_
@@ -0,0 +1,107 @@
+#include "tcp_server/latency_histogram.h"
+
+#include <cmath>
+
+namespace tcp_server {
+
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) {
+  Merge(other);
+}
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+  if (this != &other) {
+    Reset();
+    Merge(other);
+  }
+  return *this;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (std::size_t i = 0; i < kBucketCount; ++i) {
+    const std::uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+    if (count != 0) {
+      counts_[i].fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+  total_.fetch_add(other.total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+  const std::uint64_t other_min = other.min_.load(std::memory_order_relaxed);
+  if (other_min < min_.load(std::memory_order_relaxed)) {
+    min_.store(other_min, std::memory_order_relaxed);
+  }
+  const std::uint64_t other_max = other.max_.load(std::memory_order_relaxed);
+  if (other_max > max_.load(std::memory_order_relaxed)) {
+    max_.store(other_max, std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& count : counts_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  total_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  min_.store(~std::uint64_t{0}, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Count() const {
+  return total_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Sum() const {
+  return sum_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Min() const {
+  return Count() == 0 ? 0 : min_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Max() const {
+  return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Mean() const {
+  const std::uint64_t count = Count();
+  if (count == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(count);
+}
+
+std::uint64_t LatencyHistogram::Percentile(double percentile) const {
+  const std::uint64_t count = Count();
+  if (count == 0) {
+    return 0;
+  }
+
+  // Rank of the requested value, 1-based
+  double rank = std::ceil(percentile / 100.0 * static_cast<double>(count));
+  if (rank < 1.0) {
+    rank = 1.0;
+  }
+  const std::uint64_t target = static_cast<std::uint64_t>(rank);
+
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBucketCount; ++i) {
+    seen += counts_[i].load(std::memory_order_relaxed);
+    if (seen >= target) {
+      const std::uint64_t upper = BucketUpperBound(i);
+      const std::uint64_t max = Max();
+      return upper < max ? upper : max;
+    }
+  }
+  return Max();
+}
+
+std::uint64_t LatencyHistogram::BucketUpperBound(std::size_t index) {
+  if (index < 2 * kSubBucketCount) {
+    return index;
+  }
+  const std::size_t exponent = index / kSubBucketCount - 1;
+  const std::uint64_t sub_bucket = index % kSubBucketCount + kSubBucketCount;
+  return ((sub_bucket + 1) << exponent) - 1;
+}
+
+}  // namespace tcp_server
@@ -0,0 +1,103 @@
+#include "tcp_server/router.h"
+
+#include <stdexcept>
+
+#include "src/internal/command_index.h"
+#include "src/internal/rcu.h"
+
+namespace tcp_server {
+
+/**
+ * @brief Compiled route table, immutable once published
+ */
+struct Router::Table {
+  internal::CommandIndex index;                ///< Command to handler index
+  std::vector<RouteTable::Handler> handlers;   ///< Handlers in index order
+  RouteTable::Handler fallback;                ///< Handler of unknown commands
+};
+
+RouteTable& RouteTable::Add(std::string command, Handler handler) {
+  if (command.empty()) {
+    throw std::invalid_argument("Command must not be empty");
+  }
+  for (char c : command) {
+    if (static_cast<unsigned char>(c) <= 0x20) {
+      throw std::invalid_argument("Command must not contain whitespace: " + command);
+    }
+  }
+  routes_.emplace_back(std::move(command), std::move(handler));
+  return *this;
+}
+
+RouteTable& RouteTable::SetFallback(Handler handler) {
+  fallback_ = std::move(handler);
+  return *this;
+}
+
+std::size_t RouteTable::Size() const {
+  return routes_.size();
+}
+
+Router::Router() : Router(RouteTable()) {}
+
+Router::Router(RouteTable routes)
+    : rcu_(std::make_unique<internal::RcuDomain>()),
+      table_(Compile(std::move(routes)).release()) {}
+
+Router::~Router() {
+  delete table_.load();
+}
+
+void Router::Update(RouteTable routes) {
+  if (internal::RcuDomain::InReadSection()) {
+    throw std::logic_error("Router::Update must not be called from a route handler");
+  }
+  std::unique_ptr<const Table> table = Compile(std::move(routes));
+
+  std::lock_guard<std::mutex> lock(update_mutex_);
+  std::unique_ptr<const Table> retired(table_.exchange(table.release()));
+  // Dispatches that loaded the old table may still be running its handlers
+  rcu_->Synchronize();
+}
+
+bool Router::Dispatch(std::string_view request, ResponseWriter& response) const {
+  const internal::CommandLine line = internal::SplitCommand(request);
+
+  internal::RcuDomain::ReadGuard guard(*rcu_);
+  const Table* table = table_.load();
+  const std::size_t route = table->index.Find(line.command);
+  if (route != internal::CommandIndex::kNotFound) {
+    table->handlers[route](line.arguments, response);
+    return true;
+  }
+  if (table->fallback) {
+    table->fallback(line.trimmed, response);
+    return true;
+  }
+  return false;
+}
+
+std::function<void(std::string_view, ResponseWriter&)> Router::AsMessageHandler() {
+  return [this](std::string_view request, ResponseWriter& response) {
+    Dispatch(request, response);
+  };
+}
+
+std::unique_ptr<const Router::Table> Router::Compile(RouteTable routes) {
+  std::vector<std::string_view> commands;
+  commands.reserve(routes.routes_.size());
+  for (const auto& route : routes.routes_) {
+    commands.push_back(route.first);
+  }
+
+  auto table = std::make_unique<Table>();
+  table->index = internal::CommandIndex(commands);
+  table->handlers.reserve(routes.routes_.size());
+  for (auto& route : routes.routes_) {
+    table->handlers.push_back(std::move(route.second));
+  }
+  table->fallback = std::move(routes.fallback_);
+  return table;
+}
+
+}  // namespace tcp_server
@@ -0,0 +1,124 @@
+#include "tcp_server/server_metrics.h"
+
+#include <sstream>
+#include <utility>
+
+namespace tcp_server {
+
+namespace {
+
+void WriteMetric(std::ostringstream& out, const char* name, const char* type, const char* help,
+                 double value) {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << ' ' << type << '\n'
+      << name << ' ' << value << '\n';
+}
+
+// Nanosecond histogram as a Prometheus summary in seconds
+void WriteSummary(std::ostringstream& out, const char* name, const char* help,
+                  const LatencyHistogram& histogram) {
+  out << "# HELP " << name << ' ' << help << '\n'
+      << "# TYPE " << name << " summary\n";
+  const std::pair<const char*, double> quantiles[] = {
+      {"0.5", 50.0}, {"0.9", 90.0}, {"0.99", 99.0}, {"0.999", 99.9}};
+  for (const auto& [label, percentile] : quantiles) {
+    out << name << "{quantile=\"" << label << "\"} "
+        << static_cast<double>(histogram.Percentile(percentile)) / 1e9 << '\n';
+  }
+  out << name << "_sum " << static_cast<double>(histogram.Sum()) / 1e9 << '\n'
+      << name << "_count " << histogram.Count() << '\n';
+}
+
+}  // namespace
+
+std::string MetricsSnapshot::ToPrometheusText() const {
+  std::ostringstream out;
+  out.precision(17);
+
+  WriteMetric(out, "tcp_server_connections_accepted_total", "counter",
+              "Connections accepted.", static_cast<double>(connections_accepted));
+  WriteMetric(out, "tcp_server_connections_rejected_total", "counter",
+              "Connections rejected by the total or per-address connection limit.",
+              static_cast<double>(connections_rejected));
+  WriteMetric(out, "tcp_server_connections_timed_out_total", "counter",
+              "Connections closed by an idle, read or write timeout.",
+              static_cast<double>(connections_timed_out));
+  WriteMetric(out, "tcp_server_accept_pauses_total", "counter",
+              "Times accepting paused because of overload or the accept rate limit.",
+              static_cast<double>(accept_pauses));
+  WriteMetric(out, "tcp_server_connection_pool_grown_total", "counter",
+              "Connection objects added to the pools beyond the preallocated ones.",
+              static_cast<double>(connection_pool_grown));
+  WriteMetric(out, "tcp_server_messages_published_total", "counter",
+              "Published messages queued, counted per recipient.",
+              static_cast<double>(messages_published));
+  WriteMetric(out, "tcp_server_messages_dropped_total", "counter",
+              "Published messages dropped or conflated for slow subscribers.",
+              static_cast<double>(messages_dropped));
+  WriteMetric(out, "tcp_server_slow_subscribers_disconnected_total", "counter",
+              "Subscribers closed because they could not keep up.",
+              static_cast<double>(slow_subscribers_disconnected));
+  WriteMetric(out, "tcp_server_connections_active", "gauge", "Connections currently open.",
+              static_cast<double>(connections_active));
+  WriteMetric(out, "tcp_server_received_bytes_total", "counter", "Bytes received.",
+              static_cast<double>(bytes_received));
+  WriteMetric(out, "tcp_server_sent_bytes_total", "counter", "Bytes sent.",
+              static_cast<double>(bytes_sent));
+  WriteMetric(out, "tcp_server_read_operations_total", "counter", "Completed socket reads.",
+              static_cast<double>(read_operations));
+  WriteMetric(out, "tcp_server_write_operations_total", "counter",
+              "Completed socket writes (one per vectored write).",
+              static_cast<double>(write_operations));
+  WriteMetric(out, "tcp_server_handler_invocations_total", "counter",
+              "Message handler calls.", static_cast<double>(handler_invocations));
+  WriteMetric(out, "tcp_server_tls_handshakes_total", "counter", "Completed TLS handshakes.",
+              static_cast<double>(tls_handshakes));
+  WriteMetric(out, "tcp_server_tls_sessions_resumed_total", "counter",
+              "TLS handshakes that resumed an earlier session.",
+              static_cast<double>(tls_sessions_resumed));
+  WriteMetric(out, "tcp_server_tls_kernel_offloads_total", "counter",
+              "TLS connections whose sends the kernel encrypts (kTLS).",
+              static_cast<double>(tls_kernel_offloads));
+  WriteMetric(out, "tcp_server_response_cache_hits_total", "counter",
+              "Requests answered from the response cache without calling the handler.",
+              static_cast<double>(response_cache_hits));
+  WriteMetric(out, "tcp_server_response_cache_misses_total", "counter",
+              "Cacheable requests that were not cached and went to the handler.",
+              static_cast<double>(response_cache_misses));
+  WriteMetric(out, "tcp_server_response_cache_evictions_total", "counter",
+              "Responses evicted from the response cache to make room.",
+              static_cast<double>(response_cache_evictions));
+  WriteMetric(out, "tcp_server_response_cache_entries", "gauge",
+              "Responses currently in the response cache.",
+              static_cast<double>(response_cache_entries));
+  WriteMetric(out, "tcp_server_response_cache_bytes", "gauge",
+              "Bytes currently charged against the response cache budget.",
+              static_cast<double>(response_cache_bytes));
+  WriteMetric(out, "tcp_server_client_connections_opened_total", "counter",
+              "Connections opened by the client, including reconnects.",
+              static_cast<double>(client_connections_opened));
+  WriteMetric(out, "tcp_server_client_requests_total", "counter",
+              "Client requests that received a response.", static_cast<double>(client_requests));
+  WriteMetric(out, "tcp_server_client_requests_failed_total", "counter",
+              "Client requests that completed with an error.",
+              static_cast<double>(client_requests_failed));
+  WriteMetric(out, "tcp_server_client_sent_bytes_total", "counter", "Bytes sent by the client.",
+              static_cast<double>(client_bytes_sent));
+  WriteMetric(out, "tcp_server_client_received_bytes_total", "counter",
+              "Bytes received by the client.", static_cast<double>(client_bytes_received));
+
+  out << "# HELP tcp_server_errors_total Errors by category.\n"
+      << "# TYPE tcp_server_errors_total counter\n";
+  for (const auto& [category, count] : errors) {
+    out << "tcp_server_errors_total{category=\"" << category << "\"} " << count << '\n';
+  }
+
+  WriteSummary(out, "tcp_server_handler_duration_seconds", "Message handler run time.",
+               handler_time_ns);
+  WriteSummary(out, "tcp_server_client_request_duration_seconds",
+               "Client request round trip time.", client_request_time_ns);
+
+  return out.str();
+}
+
+}  // namespace tcp_server
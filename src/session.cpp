@@ -0,0 +1,98 @@
+#include "tcp_server/session.h"
+
+#include <algorithm>
+#include <string>
+
+#include "src/internal/connection.h"
+
+namespace tcp_server {
+
+using internal::ServerMetrics;
+
+Session::Session(internal::Connection& connection)
+    : connection_(connection), timer_(connection.socket_.get_executor()) {
+  // Connection::Stop() cancels a Sleep() in progress
+  connection_.session_timer_ = &timer_;
+}
+
+Session::~Session() {
+  connection_.session_timer_ = nullptr;
+}
+
+boost::asio::awaitable<std::optional<std::string_view>> Session::ReadFrame() {
+  internal::Connection& c = connection_;
+  const Framer& framer = *c.settings_->framer;
+
+  // Drop the frame returned by the previous call
+  if (consumed_ > 0) {
+    char* data = c.read_buffer_.data.get();
+    std::copy(data + consumed_, data + c.read_size_, data);
+    c.read_size_ -= consumed_;
+    consumed_ = 0;
+  }
+
+  while (true) {
+    if (c.read_size_ > 0) {
+      std::string_view payload;
+      consumed_ = framer.ExtractFrom(std::string_view(c.read_buffer_.data.get(), c.read_size_),
+                                     &payload, &c.frame_scanned_);
+      if (consumed_ > 0) {
+        co_return payload;
+      }
+    }
+
+    c.PrepareReadBuffer();
+    const std::size_t available = c.read_buffer_.size - c.read_size_;
+    boost::system::error_code error;
+    const std::size_t bytes_transferred = co_await c.socket_.async_read_some(
+        boost::asio::buffer(c.read_buffer_.data.get() + c.read_size_, available),
+        boost::asio::redirect_error(boost::asio::use_awaitable, error));
+    if (error == boost::asio::error::eof) {
+      co_return std::nullopt;
+    }
+    if (error) {
+      throw boost::system::system_error(error);
+    }
+
+    c.AdaptReadBufferSize(available, bytes_transferred);
+    c.read_size_ += bytes_transferred;
+    c.settings_->metrics->Add(ServerMetrics::kReadOperations);
+    c.settings_->metrics->Add(ServerMetrics::kBytesReceived, bytes_transferred);
+  }
+}
+
+boost::asio::awaitable<void> Session::WriteFrame(std::string_view payload) {
+  std::string frame;
+  connection_.settings_->framer->Encode(payload, &frame);
+  co_await Write(frame);
+}
+
+boost::asio::awaitable<void> Session::Write(std::string_view data) {
+  internal::Connection& c = connection_;
+  const std::size_t bytes_transferred = co_await boost::asio::async_write(
+      c.socket_, boost::asio::buffer(data.data(), data.size()), boost::asio::use_awaitable);
+  c.settings_->metrics->Add(ServerMetrics::kWriteOperations);
+  c.settings_->metrics->Add(ServerMetrics::kBytesSent, bytes_transferred);
+}
+
+boost::asio::awaitable<void> Session::Sleep(std::chrono::steady_clock::duration duration) {
+  timer_.expires_after(duration);
+  co_await timer_.async_wait(boost::asio::use_awaitable);
+  if (!connection_.socket_.is_open()) {
+    throw boost::system::system_error(boost::asio::error::operation_aborted);
+  }
+}
+
+void Session::Close() {
+  connection_.Stop();
+}
+
+Session::Executor Session::GetExecutor() const {
+  return connection_.socket_.get_executor();
+}
+
+boost::asio::ip::tcp::endpoint Session::GetRemoteEndpoint() const {
+  return connection_.GetRemoteEndpoint();
+}
+
+}  // namespace tcp_server
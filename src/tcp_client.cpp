@@ -0,0 +1,244 @@
+#include "tcp_server/tcp_client.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "src/internal/buffer_pool.h"
+#include "src/internal/client_connection.h"
+#include "src/internal/metrics.h"
+#include "src/internal/transport.h"
+#include "tcp_server/tcp_server.h"
+
+namespace tcp_server {
+
+using internal::ClientConnection;
+using internal::StreamProtocol;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// Largest read buffer kept in a standalone client's pool, as the server's default
+constexpr std::size_t kMaxPooledReadBufferSize = 64 * 1024;
+
+// Parse "address:port", "[address]:port", "host:port" or "unix:path"
+StreamProtocol::endpoint ParseEndpoint(std::string_view endpoint,
+                                       boost::asio::io_context& io_context) {
+  constexpr std::string_view kUnixPrefix = "unix:";
+  if (endpoint.substr(0, kUnixPrefix.size()) == kUnixPrefix) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    return internal::MakeLocalEndpoint(std::string(endpoint.substr(kUnixPrefix.size())));
+#else
+    throw std::invalid_argument("Unix domain sockets are not supported on this platform");
+#endif
+  }
+
+  const std::size_t colon = endpoint.rfind(':');
+  const std::string port =
+      colon == std::string_view::npos ? std::string() : std::string(endpoint.substr(colon + 1));
+  if (colon == 0 || port.empty() || port.size() > 5 ||
+      port.find_first_not_of("0123456789") != std::string::npos || std::stoul(port) == 0 ||
+      std::stoul(port) > 65535) {
+    throw std::invalid_argument("Endpoint must be address:port or unix:path: " +
+                                std::string(endpoint));
+  }
+  std::string host(endpoint.substr(0, colon));
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+
+  boost::system::error_code error;
+  const boost::asio::ip::address address = boost::asio::ip::make_address(host, error);
+  if (!error) {
+    return tcp::endpoint(address, static_cast<unsigned short>(std::stoul(port)));
+  }
+  // Host names are resolved once; the pool keeps connecting to the first address
+  tcp::resolver resolver(io_context);
+  return resolver.resolve(host, port)->endpoint();
+}
+
+}  // namespace
+
+struct TcpClient::EndpointPool {
+  StreamProtocol::endpoint endpoint;                               ///< Resolved address
+  std::vector<std::shared_ptr<ClientConnection>> connections;     ///< Persistent connections
+};
+
+TcpClient::TcpClient(const ClientOptions& options)
+    : options_(options), logger_(spdlog::default_logger()), metrics_(nullptr) {
+  own_metrics_ = std::make_unique<internal::ServerMetrics>();
+  metrics_ = own_metrics_.get();
+  Initialize();
+
+  const unsigned int thread_count = std::max(1u, options_.threads);
+  own_buffer_pool_ = std::make_unique<internal::BufferPool>(
+      options_.read_buffer_size, std::max(options_.read_buffer_size, kMaxPooledReadBufferSize));
+  own_io_context_ = std::make_unique<boost::asio::io_context>(
+      thread_count == 1 ? 1 : BOOST_ASIO_CONCURRENCY_HINT_DEFAULT);
+  work_guard_ = std::make_unique<
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(
+      own_io_context_->get_executor());
+  contexts_.push_back(internal::ClientIoContext{own_io_context_.get(), own_buffer_pool_.get()});
+
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this] {
+      metrics_->BindThread();
+      try {
+        own_io_context_->run();
+      } catch (const std::exception& e) {
+        logger_->error("Error in client thread: {}", e.what());
+      }
+    });
+  }
+}
+
+TcpClient::TcpClient(const ClientOptions& options,
+                     std::vector<internal::ClientIoContext> contexts,
+                     internal::ServerMetrics* metrics, std::shared_ptr<spdlog::logger> logger)
+    : options_(options),
+      logger_(std::move(logger)),
+      metrics_(metrics),
+      contexts_(std::move(contexts)) {
+  Initialize();
+}
+
+TcpClient::~TcpClient() {
+  if (server_ != nullptr) {
+    server_->RemoveClient(this);
+  }
+  Close();
+  if (own_io_context_) {
+    // run() returns once the closed connections have completed their requests
+    work_guard_.reset();
+    for (auto& thread : threads_) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+  }
+}
+
+void TcpClient::Initialize() {
+  if (options_.connections_per_endpoint == 0) {
+    throw std::invalid_argument("connections_per_endpoint must not be zero");
+  }
+  if (options_.max_pipeline_depth == 0) {
+    throw std::invalid_argument("max_pipeline_depth must not be zero");
+  }
+  if (options_.read_buffer_size == 0) {
+    throw std::invalid_argument("read_buffer_size must not be zero");
+  }
+  if (options_.request_timeout.count() < 0) {
+    throw std::invalid_argument("request_timeout must not be negative");
+  }
+  if (!options_.framer) {
+    options_.framer = std::make_shared<RawFramer>();
+  }
+
+  auto settings = std::make_shared<internal::ClientSettings>();
+  settings->framer = options_.framer;
+  settings->metrics = metrics_;
+  settings->logger = logger_;
+  settings->read_buffer_size = options_.read_buffer_size;
+  // Raw responses have no boundaries, so only one request may wait for its response
+  settings->max_in_flight = dynamic_cast<const RawFramer*>(options_.framer.get()) != nullptr
+                                ? 1
+                                : options_.max_pipeline_depth;
+  settings->request_timeout = options_.request_timeout;
+  settings->no_delay = options_.no_delay;
+  settings->measure_request_time = options_.measure_request_time;
+  settings_ = std::move(settings);
+}
+
+std::string TcpClient::Request(std::string_view endpoint, std::string_view request) {
+  // The response would have to be read by the thread waiting for it
+  for (const internal::ClientIoContext& context : contexts_) {
+    if (context.io_context->get_executor().running_in_this_thread()) {
+      throw std::logic_error("Request() must not be called on the client's I/O threads");
+    }
+  }
+  return AsyncRequest(endpoint, request, boost::asio::use_future).get();
+}
+
+void TcpClient::StartRequest(
+    std::string_view endpoint, std::string_view request,
+    std::function<void(const boost::system::error_code&, std::string)> callback) {
+  std::string frame;
+  settings_->framer->Encode(request, &frame);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = pools_.find(endpoint);
+  if (it == pools_.end()) {
+    // Resolving may block, so other endpoints' requests are not held up meanwhile
+    lock.unlock();
+    auto pool = std::make_unique<EndpointPool>();
+    pool->endpoint = ParseEndpoint(endpoint, *contexts_.front().io_context);
+    lock.lock();
+    it = pools_.emplace(std::string(endpoint), std::move(pool)).first;
+  }
+  if (aborted_) {
+    // The server's I/O threads have stopped, so nothing would complete the request
+    lock.unlock();
+    metrics_->Add(internal::ServerMetrics::kClientRequestsFailed);
+    callback(boost::asio::error::operation_aborted, std::string());
+    return;
+  }
+  EndpointPool& pool = *it->second;
+
+  std::shared_ptr<ClientConnection> connection;
+  for (const auto& candidate : pool.connections) {
+    if (!connection || candidate->GetOutstanding() < connection->GetOutstanding()) {
+      connection = candidate;
+    }
+  }
+  if ((!connection || connection->GetOutstanding() > 0) &&
+      pool.connections.size() < options_.connections_per_endpoint) {
+    const internal::ClientIoContext& context = contexts_[next_context_++ % contexts_.size()];
+    connection = std::make_shared<ClientConnection>(context, settings_, pool.endpoint);
+    pool.connections.push_back(connection);
+  }
+  // Counted as outstanding before the lock is released, so the next request sees the load
+  connection->Send(std::move(frame), std::move(callback));
+}
+
+void TcpClient::Abort() {
+  std::vector<std::shared_ptr<ClientConnection>> connections;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    for (const auto& [endpoint, pool] : pools_) {
+      connections.insert(connections.end(), pool->connections.begin(), pool->connections.end());
+    }
+  }
+  // Outside the lock, as the callbacks may make new requests
+  for (const auto& connection : connections) {
+    connection->Abort();
+  }
+}
+
+void TcpClient::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [endpoint, pool] : pools_) {
+    for (const auto& connection : pool->connections) {
+      connection->Close();
+    }
+  }
+}
+
+std::size_t TcpClient::GetConnectionCount() const {
+  std::size_t count = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [endpoint, pool] : pools_) {
+    for (const auto& connection : pool->connections) {
+      count += connection->IsOpen() ? 1 : 0;
+    }
+  }
+  return count;
+}
+
+MetricsSnapshot TcpClient::GetMetrics() const {
+  return metrics_->Snapshot();
+}
+
+}  // namespace tcp_server
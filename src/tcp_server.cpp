@@ -1,43 +1,407 @@
 #include "tcp_server/tcp_server.h"
 
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
 #include <thread>
 #include <stdexcept>
-#include <mutex>
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h>
+#endif
+
+#include "src/internal/admission.h"
+#include "src/internal/affinity.h"
+#include "src/internal/client_connection.h"
 #include "src/internal/connection.h"
+#include "src/internal/connection_registry.h"
+#include "src/internal/listener_handoff.h"
+#include "src/internal/logging.h"
+#include "src/internal/metrics.h"
+#include "src/internal/metrics_endpoint.h"
+#include "src/internal/response_cache.h"
+#if defined(TCP_SERVER_HAS_TLS)
+#include "src/internal/tls.h"
+#endif
+#include "src/internal/topic_registry.h"
+#include "src/internal/transport.h"
+#include "src/internal/work_stealing_pool.h"
+#include "src/internal/worker.h"
 
 namespace tcp_server {
 
+namespace {
+
+// How often a paused acceptor checks whether the overload has passed
+constexpr std::chrono::milliseconds kAcceptRetryInterval(10);
+
+// Only threads that ran a handler this recently count towards max_handler_latency
+constexpr std::chrono::seconds kHandlerLatencyWindow(1);
+
+// Resolution of the timing wheels relative to the shortest timeout
+constexpr int kTicksPerTimeout = 16;
+constexpr std::chrono::milliseconds kMinTick(1);
+constexpr std::chrono::milliseconds kMaxTick(100);
+
+/**
+ * @brief Wheel tick duration for the configured timeouts
+ * @return Tick duration, or zero if no timeout is enabled
+ */
+std::chrono::milliseconds TimeoutTick(const ServerOptions& options) {
+  std::chrono::milliseconds shortest(0);
+  for (auto timeout : {options.idle_timeout, options.read_timeout, options.write_timeout}) {
+    if (timeout.count() > 0 && (shortest.count() == 0 || timeout < shortest)) {
+      shortest = timeout;
+    }
+  }
+  if (shortest.count() == 0) {
+    return shortest;
+  }
+  return std::clamp(shortest / kTicksPerTimeout, kMinTick, kMaxTick);
+}
+
+/**
+ * @brief Convert a timeout to wheel ticks, rounding up so it never fires early
+ * @return Ticks, or zero if the timeout is disabled
+ */
+std::uint64_t TimeoutTicks(std::chrono::milliseconds timeout, std::chrono::milliseconds tick) {
+  if (timeout.count() <= 0) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>((timeout + tick - std::chrono::milliseconds(1)) / tick) + 1;
+}
+
+/**
+ * @brief Name of the reactor Boost.Asio was configured with
+ */
+constexpr const char* IoBackendName() {
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+  return "io_uring";
+#elif defined(BOOST_ASIO_HAS_IOCP)
+  return "iocp";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+  return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+  return "kqueue";
+#elif defined(BOOST_ASIO_HAS_DEV_POLL)
+  return "/dev/poll";
+#else
+  return "select";
+#endif
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+/**
+ * @brief Whether an inherited listening socket is a Unix domain socket
+ */
+bool IsLocalListener(int native_handle) {
+  try {
+    return internal::IsLocal(internal::BoundEndpoint(native_handle));
+  } catch (const boost::system::system_error&) {
+    // Left to Worker::Assign(), which reports the error
+    return false;
+  }
+}
+#endif
+
+}  // namespace
+
 TcpServer::TcpServer(unsigned short port, MessageHandler message_handler,
                    unsigned int max_connections)
+    : TcpServer(port, std::move(message_handler), [max_connections] {
+        ServerOptions options;
+        options.max_connections = max_connections;
+        return options;
+      }()) {}
+
+TcpServer::TcpServer(unsigned short port, MessageHandler message_handler,
+                   const ServerOptions& options)
+    : TcpServer(port,
+                [handler = std::move(message_handler)](std::string_view request,
+                                                       ResponseWriter& response) {
+                  response.Write(handler(std::string(request)));
+                },
+                options) {}
+
+TcpServer::TcpServer(unsigned short port, MessageViewHandler message_handler,
+                   const ServerOptions& options)
+    : TcpServer(port, options, [&message_handler] {
+        auto settings = std::make_shared<internal::ConnectionSettings>();
+        settings->message_handler = std::move(message_handler);
+        return settings;
+      }()) {}
+
+#if defined(TCP_SERVER_HAS_COROUTINES)
+TcpServer::TcpServer(unsigned short port, SessionHandler session_handler,
+                   const ServerOptions& options)
+    : TcpServer(port, options, [&session_handler] {
+        auto settings = std::make_shared<internal::ConnectionSettings>();
+        settings->session_handler = std::move(session_handler);
+        return settings;
+      }()) {}
+#endif
+
+TcpServer::TcpServer(unsigned short port, const ServerOptions& options,
+                   std::shared_ptr<internal::ConnectionSettings> settings)
     : port_(port),
-      max_connections_(max_connections),
-      message_handler_(std::move(message_handler)),
-      io_context_(std::make_unique<boost::asio::io_context>()),
+      options_(options),
+      logger_(internal::CreateServerLogger(options.async_logging, options.log_queue_size)),
+      accept_error_log_(std::make_unique<internal::LogLimiter>(options.log_rate_limit)),
+      rejection_log_(std::make_unique<internal::LogLimiter>(options.log_rate_limit)),
       running_(false),
-      work_guard_(boost::asio::make_work_guard(*io_context_)) {
+      draining_(false) {
   try {
     using tcp = boost::asio::ip::tcp;
-    
-    // Initialize acceptor
-    acceptor_ = std::make_unique<tcp::acceptor>(
-        *io_context_, tcp::endpoint(tcp::v4(), port_));
-        
-    spdlog::info("TCP server initialized on port {}", port_);
+
+    if (!options_.framer) {
+      options_.framer = std::make_shared<RawFramer>();
+    }
+    if (options_.read_buffer_size == 0 || options_.min_read_buffer_size == 0) {
+      throw std::invalid_argument("read buffer sizes must not be zero");
+    }
+    if (options_.min_read_buffer_size > options_.max_read_buffer_size) {
+      throw std::invalid_argument("min_read_buffer_size must not exceed max_read_buffer_size");
+    }
+    if (options_.write_low_watermark > options_.write_high_watermark) {
+      throw std::invalid_argument("write_low_watermark must not exceed write_high_watermark");
+    }
+    if (options_.idle_timeout.count() < 0 || options_.read_timeout.count() < 0 ||
+        options_.write_timeout.count() < 0) {
+      throw std::invalid_argument("timeouts must not be negative");
+    }
+    if (options_.handler_execution == HandlerExecution::kOffload &&
+        options_.max_pending_requests == 0) {
+      throw std::invalid_argument("max_pending_requests must not be zero");
+    }
+    for (const auto& cpus : options_.worker_cpu_sets) {
+      if (cpus.empty() || *std::min_element(cpus.begin(), cpus.end()) < 0) {
+        throw std::invalid_argument("worker_cpu_sets must contain non-empty sets of CPUs");
+      }
+    }
+    if (options_.busy_poll.count() < 0) {
+      throw std::invalid_argument("busy_poll must not be negative");
+    }
+    if (options_.socket.backlog < 0 || options_.socket.receive_buffer_size < 0 ||
+        options_.socket.send_buffer_size < 0 || options_.socket.fast_open_queue < 0 ||
+        options_.socket.defer_accept.count() < 0) {
+      throw std::invalid_argument("socket options must not be negative");
+    }
+    if (!options_.socket.listen_tcp && options_.socket.unix_socket_paths.empty()) {
+      throw std::invalid_argument("listen_tcp is false and no unix_socket_paths are given");
+    }
+    // Throws for an address that does not parse
+    listen_address_ = options_.socket.bind_address.empty()
+                          ? boost::asio::ip::address(boost::asio::ip::address_v4::any())
+                          : boost::asio::ip::make_address(options_.socket.bind_address);
+    if (!options_.tls.certificate_chain_file.empty()) {
+#if defined(TCP_SERVER_HAS_TLS)
+#if defined(TCP_SERVER_HAS_COROUTINES)
+      if (settings->session_handler) {
+        throw std::invalid_argument("TLS is not supported with session handlers");
+      }
+#endif
+      tls_context_ = std::make_unique<internal::TlsContext>(options_.tls);
+      settings->tls = tls_context_.get();
+#else
+      throw std::invalid_argument("TLS support is not built in (TCP_SERVER_ENABLE_TLS)");
+#endif
+    }
+    if (options_.response_cache.max_bytes > 0) {
+#if defined(TCP_SERVER_HAS_COROUTINES)
+      if (settings->session_handler) {
+        throw std::invalid_argument("The response cache is not supported with session handlers");
+      }
+#endif
+      if (options_.response_cache.ttl.count() < 0) {
+        throw std::invalid_argument("response_cache.ttl must not be negative");
+      }
+      response_cache_ = std::make_unique<internal::ResponseCache>(options_.response_cache);
+    }
+#if !defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (!options_.listener_handoff_path.empty()) {
+      throw std::invalid_argument("listener_handoff_path is not supported on this platform");
+    }
+    if (!options_.socket.unix_socket_paths.empty()) {
+      throw std::invalid_argument("unix_socket_paths is not supported on this platform");
+    }
+#endif
+
+    connections_ = std::make_unique<internal::ConnectionRegistry>(options_.max_connections);
+    metrics_ = std::make_unique<internal::ServerMetrics>();
+    if (options_.accept_rate_limit > 0) {
+      accept_rate_ = std::make_unique<internal::AcceptRateLimiter>(options_.accept_rate_limit,
+                                                                   options_.accept_burst);
+    }
+    if (options_.max_connections_per_ip > 0) {
+      peer_limiter_ = std::make_unique<internal::PeerLimiter>(options_.max_connections_per_ip);
+    }
+    topics_ = std::make_unique<internal::TopicRegistry>();
+    if (options_.max_handler_latency.count() > 0) {
+      options_.measure_handler_time = true;
+    }
+
+    // Handlers run on their own threads when offloaded
+    if (options_.handler_execution == HandlerExecution::kOffload && settings->message_handler) {
+      unsigned int handler_threads = options_.handler_threads;
+      if (handler_threads == 0) {
+        handler_threads = std::max(1u, std::thread::hardware_concurrency());
+      }
+      handler_pool_ = std::make_unique<internal::WorkStealingPool>(
+          handler_threads, [this] { metrics_->BindThread(); }, logger_);
+    }
+
+    settings->framer = options_.framer;
+    settings->read_buffer_size = options_.read_buffer_size;
+    settings->min_read_buffer_size =
+        std::min(options_.min_read_buffer_size, options_.read_buffer_size);
+    settings->max_read_buffer_size =
+        std::max(options_.max_read_buffer_size, options_.read_buffer_size);
+    settings->write_high_watermark = options_.write_high_watermark;
+    settings->write_low_watermark = options_.write_low_watermark;
+    settings->measure_handler_time = options_.measure_handler_time;
+    settings->registry = connections_.get();
+    settings->metrics = metrics_.get();
+    settings->logger = logger_.get();
+    settings->handler_pool = handler_pool_.get();
+    settings->peer_limiter = peer_limiter_.get();
+    settings->topics = topics_.get();
+    settings->response_cache = response_cache_.get();
+    settings->slow_subscriber_limit = options_.slow_subscriber_limit;
+    settings->slow_subscriber_policy = options_.slow_subscriber_policy;
+    settings->zero_copy_threshold = options_.zero_copy_threshold;
+    settings->socket_options = options_.socket;
+    settings->max_pending_requests = options_.max_pending_requests;
+    const std::chrono::milliseconds tick = TimeoutTick(options_);
+    if (tick.count() > 0) {
+      settings->idle_timeout_ticks = TimeoutTicks(options_.idle_timeout, tick);
+      settings->read_timeout_ticks = TimeoutTicks(options_.read_timeout, tick);
+      settings->write_timeout_ticks = TimeoutTicks(options_.write_timeout, tick);
+    }
+    connection_settings_ = std::move(settings);
+
+    if (options_.execution_mode == ExecutionMode::kContextPerThread &&
+        !internal::Worker::SupportsReusePort()) {
+      logger_->warn("SO_REUSEPORT is not available, falling back to shared io_context");
+      options_.execution_mode = ExecutionMode::kSharedContext;
+    }
+
+    // Initialize the first worker and its acceptor
+    workers_.push_back(std::make_unique<internal::Worker>(
+        0, UsesContextPerThread() ? 1 : BOOST_ASIO_CONCURRENCY_HINT_DEFAULT,
+        connection_settings_, options_.connection_pool_size));
+    // A per-thread worker allocates its connections on its own thread instead
+    if (!UsesContextPerThread()) {
+      workers_.front()->Preallocate();
+    }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    // Take over the listening sockets of a running predecessor instead of binding
+    std::unique_ptr<internal::ListenerHandoffClient> handoff;
+    std::vector<int> inherited_local;
+    if (!options_.listener_handoff_path.empty()) {
+      handoff = std::make_unique<internal::ListenerHandoffClient>(options_.listener_handoff_path);
+      if (handoff->IsConnected()) {
+        // TCP sockets go to the workers in order, Unix domain sockets to their paths
+        for (int listener : handoff->Receive()) {
+          (IsLocalListener(listener) ? inherited_local : inherited_listeners_).push_back(listener);
+        }
+        if (options_.socket.listen_tcp && !inherited_listeners_.empty()) {
+          workers_.front()->Assign(inherited_listeners_.front(), options_.socket);
+          inherited_listeners_.erase(inherited_listeners_.begin());
+        }
+        if (!UsesContextPerThread()) {
+          CloseInheritedListeners();
+        }
+      }
+    }
+#endif
+    if (options_.socket.listen_tcp) {
+      if (workers_.front()->GetListenerCount() == 0) {
+        workers_.front()->Listen(tcp::endpoint(listen_address_, port_), UsesContextPerThread(),
+                                 options_.socket);
+      }
+      // Remember the bound port so that sharded acceptors use the same one
+      port_ = internal::ToTcpEndpoint(workers_.front()->GetAcceptor(0).local_endpoint()).port();
+    } else {
+      port_ = 0;
+    }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    ListenLocal(std::move(inherited_local));
+
+    if (!options_.listener_handoff_path.empty()) {
+      // The predecessor stops accepting only once our acceptor owns the sockets
+      if (handoff->IsConnected()) {
+        handoff->Acknowledge();
+        logger_->info("Took over listening sockets from {}", options_.listener_handoff_path);
+      }
+      listener_handoff_ = std::make_unique<internal::ListenerHandoff>(
+          workers_.front()->GetIoContext(), options_.listener_handoff_path,
+          [this] {
+            std::vector<int> listeners;
+            for (auto& worker : workers_) {
+              // The other workers accept on copies of the first one's Unix domain sockets
+              const std::size_t count =
+                  worker == workers_.front() ? worker->GetListenerCount() : TcpListenerCount();
+              for (std::size_t i = 0; i < count; ++i) {
+                if (worker->GetAcceptor(i).is_open()) {
+                  listeners.push_back(worker->GetAcceptor(i).native_handle());
+                }
+              }
+            }
+            return listeners;
+          },
+          [this] {
+            for (auto& worker : workers_) {
+              worker->StopAccepting();
+            }
+            // The successor accepts on the same socket files now
+            socket_files_.clear();
+            if (options_.on_listener_handoff) {
+              options_.on_listener_handoff();
+            }
+          },
+          logger_);
+    }
+#endif
+
+    // Serve metrics from the first worker's io_context
+    if (options_.metrics_port != 0) {
+      const tcp::endpoint metrics_endpoint(boost::asio::ip::make_address(options_.metrics_address),
+                                           options_.metrics_port);
+      metrics_endpoint_ = std::make_unique<internal::MetricsEndpoint>(
+          workers_.front()->GetIoContext(), metrics_endpoint,
+          [this] { return GetMetrics().ToPrometheusText(); }, logger_);
+      logger_->info("Metrics endpoint listening on {} port {}", options_.metrics_address,
+                    options_.metrics_port);
+    }
+
+    if (options_.socket.listen_tcp) {
+      logger_->info("TCP server initialized on {} port {}", listen_address_.to_string(), port_);
+    }
+    for (const std::string& path : options_.socket.unix_socket_paths) {
+      logger_->info("TCP server initialized on Unix domain socket {}", path);
+    }
   } catch (const std::exception& e) {
-    spdlog::error("Failed to initialize TCP server: {}", e.what());
+    logger_->error("Failed to initialize TCP server: {}", e.what());
     throw std::runtime_error(std::string("Failed to initialize TCP server: ") + e.what());
   }
 }
 
 TcpServer::~TcpServer() {
   Stop();
+  CloseInheritedListeners();
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  for (const std::string& path : socket_files_) {
+    ::unlink(path.c_str());
+  }
+#endif
 }
 
 void TcpServer::Start(unsigned int thread_count) {
   if (running_) {
-    spdlog::warn("TCP server already running");
+    logger_->warn("TCP server already running");
     return;
   }
 
@@ -50,25 +414,105 @@ void TcpServer::Start(unsigned int thread_count) {
       }
     }
     
-    // Start accepting new connections
-    StartAccept();
+    // Create one sharded acceptor per additional thread
+    if (UsesContextPerThread()) {
+      using tcp = boost::asio::ip::tcp;
+      while (workers_.size() < thread_count) {
+        auto worker = std::make_unique<internal::Worker>(
+            workers_.size(), 1, connection_settings_, options_.connection_pool_size);
+        if (options_.socket.listen_tcp) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+          if (!inherited_listeners_.empty()) {
+            const int listener = inherited_listeners_.front();
+            inherited_listeners_.erase(inherited_listeners_.begin());
+            worker->Assign(listener, options_.socket);
+          }
+#endif
+          if (worker->GetListenerCount() == 0) {
+            worker->Listen(tcp::endpoint(listen_address_, port_), true, options_.socket);
+          }
+        }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+        // Unix domain sockets have no SO_REUSEPORT balancing, so every worker
+        // accepts from the same socket and whichever wakes first takes the connection
+        internal::Worker& first = *workers_.front();
+        for (std::size_t i = TcpListenerCount(); i < first.GetListenerCount(); ++i) {
+          const int listener = ::dup(first.GetAcceptor(i).native_handle());
+          if (listener < 0) {
+            throw boost::system::system_error(
+                boost::system::error_code(errno, boost::system::system_category()), "dup");
+          }
+          worker->Assign(listener, options_.socket);
+        }
+#endif
+        workers_.push_back(std::move(worker));
+      }
+    }
+    CloseInheritedListeners();
+
+    // Start accepting new connections and drive the timeouts
+    const std::chrono::milliseconds tick = TimeoutTick(options_);
+    for (auto& worker : workers_) {
+      if (options_.busy_poll.count() > 0 && !worker->SetBusyPoll(options_.busy_poll)) {
+        logger_->debug("SO_BUSY_POLL is not available, busy-polling the io_context only");
+      }
+      for (std::size_t listener = 0; listener < worker->GetListenerCount(); ++listener) {
+        StartAccept(*worker, listener);
+      }
+      if (tick.count() > 0) {
+        worker->StartTimingWheel(tick);
+      }
+    }
+    if (metrics_endpoint_) {
+      metrics_endpoint_->Start();
+    }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    if (listener_handoff_) {
+      listener_handoff_->Start();
+    }
+#endif
     
     // Launch worker threads
     threads_.clear();
     for (unsigned int i = 0; i < thread_count; ++i) {
-      threads_.emplace_back([this] {
+      internal::Worker* worker =
+          UsesContextPerThread() ? workers_[i].get() : workers_.front().get();
+      threads_.emplace_back([this, worker, i] {
+        // Pin first so that everything this thread allocates is on its NUMA node
+        if (!options_.worker_cpu_sets.empty()) {
+          const std::vector<int>& cpus =
+              options_.worker_cpu_sets[i % options_.worker_cpu_sets.size()];
+          if (internal::PinCurrentThread(cpus)) {
+            logger_->debug("Worker thread {} pinned to CPUs {} (NUMA node {})", i,
+                           internal::FormatCpuSet(cpus), internal::CurrentNumaNode());
+          } else {
+            logger_->warn("Failed to pin worker thread {} to CPUs {}", i,
+                          internal::FormatCpuSet(cpus));
+          }
+        }
+        metrics_->BindThread();
+#if defined(TCP_SERVER_HAS_TLS)
+        if (tls_context_) {
+          internal::BlockSigPipe();
+        }
+#endif
         try {
-          io_context_->run();
+          if (UsesContextPerThread()) {
+            worker->Preallocate();
+          }
+          worker->Run(options_.busy_poll);
         } catch (const std::exception& e) {
-          spdlog::error("Error in worker thread: {}", e.what());
+          logger_->error("Error in worker thread: {}", e.what());
         }
       });
     }
     
     running_ = true;
-    spdlog::info("TCP server started with {} worker threads", thread_count);
+    logger_->info("TCP server started with {} worker threads ({}, {})", thread_count,
+                 UsesContextPerThread() ? "io_context per thread" : "shared io_context",
+                 IoBackendName());
   } catch (const std::exception& e) {
-    spdlog::error("Failed to start TCP server: {}", e.what());
+    logger_->error("Failed to start TCP server: {}", e.what());
     // Cleanup if partially started
     Stop();
     throw std::runtime_error(std::string("Failed to start TCP server: ") + e.what());
@@ -80,13 +524,12 @@ void TcpServer::Stop() {
     return;
   }
 
-  spdlog::info("Stopping TCP server...");
-  
-  // Destroy work guard to allow io_context to stop
-  work_guard_.reset();
+  logger_->info("Stopping TCP server...");
   
-  // Stop io_context
-  io_context_->stop();
+  // Release work guards and stop every io_context
+  for (auto& worker : workers_) {
+    worker->Stop();
+  }
   
   // Wait for all worker threads to finish
   for (auto& thread : threads_) {
@@ -95,78 +538,348 @@ void TcpServer::Stop() {
     }
   }
   threads_.clear();
-  
-  // Close all connections
+
+  // Release the admin port; no handler runs once the threads have exited
+  if (metrics_endpoint_) {
+    metrics_endpoint_->Stop();
+  }
+
+  // Nothing would complete the requests of clients running on the workers
   {
-    std::lock_guard<std::mutex> lock(connections_mutex_);
-    for (auto& conn : connections_) {
-      conn->Stop();
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    for (TcpClient* client : clients_) {
+      client->Abort();
     }
-    connections_.clear();
   }
   
+  // Close all connections
+  connections_->ForEach([](const std::shared_ptr<internal::Connection>& connection) {
+    connection->Stop();
+  });
+  
   running_ = false;
-  spdlog::info("TCP server stopped");
+  logger_->info("TCP server stopped");
+  logger_->flush();
+}
+
+std::size_t TcpServer::Publish(std::string_view message) {
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  // Sessions write on their own and drop published messages, so none is a recipient
+  if (connection_settings_->session_handler) {
+    return 0;
+  }
+#endif
+  const auto payload = FramePublished(message);
+  std::size_t recipients = 0;
+  connections_->ForEach([&](const std::shared_ptr<internal::Connection>& connection) {
+    boost::asio::post(connection->GetSocket().get_executor(), [connection, payload] {
+      connection->Deliver(payload, internal::TopicRegistry::kBroadcastTag);
+    });
+    ++recipients;
+  });
+  return recipients;
+}
+
+std::size_t TcpServer::Publish(const std::string& topic, std::string_view message) {
+#if defined(TCP_SERVER_HAS_COROUTINES)
+  if (connection_settings_->session_handler) {
+    return 0;
+  }
+#endif
+  const internal::TopicRegistry::Snapshot snapshot = topics_->Find(topic);
+  if (!snapshot.subscribers) {
+    return 0;
+  }
+
+  const auto payload = FramePublished(message);
+  const std::uint64_t tag = snapshot.tag;
+  std::size_t recipients = 0;
+  std::vector<internal::ConnectionRegistry::Id> stale;
+  for (const internal::ConnectionRegistry::Id id : *snapshot.subscribers) {
+    auto connection = connections_->Find(id);
+    if (!connection) {
+      // Subscribed while it was closing; forget it
+      stale.push_back(id);
+      continue;
+    }
+    boost::asio::post(connection->GetSocket().get_executor(), [connection, payload, tag] {
+      connection->Deliver(payload, tag);
+    });
+    ++recipients;
+  }
+  for (const internal::ConnectionRegistry::Id id : stale) {
+    topics_->UnsubscribeAll(id);
+  }
+  return recipients;
+}
+
+bool TcpServer::Subscribe(ConnectionId connection, const std::string& topic) {
+  if (!connections_->Find(connection)) {
+    return false;
+  }
+  topics_->Subscribe(connection, topic);
+  return true;
+}
+
+void TcpServer::Unsubscribe(ConnectionId connection, const std::string& topic) {
+  topics_->Unsubscribe(connection, topic);
+}
+
+bool TcpServer::InvalidateCachedResponse(std::string_view key) {
+  return response_cache_ != nullptr && response_cache_->Erase(key);
+}
+
+void TcpServer::ClearResponseCache() {
+  if (response_cache_ != nullptr) {
+    response_cache_->Clear();
+  }
+}
+
+std::shared_ptr<const std::string> TcpServer::FramePublished(std::string_view message) const {
+  auto payload = std::make_shared<std::string>();
+  const std::size_t start = options_.framer->BeginFrame(payload.get());
+  payload->append(message.data(), message.size());
+  options_.framer->EndFrame(payload.get(), start);
+  return payload;
+}
+
+bool TcpServer::Drain(std::chrono::milliseconds timeout) {
+  if (!running_) {
+    return true;
+  }
+
+  logger_->info("Draining {} connections", connections_->Size());
+  draining_ = true;
+  for (auto& worker : workers_) {
+    worker->StopAccepting();
+  }
+  connections_->ForEach([](const std::shared_ptr<internal::Connection>& connection) {
+    boost::asio::post(connection->GetSocket().get_executor(),
+                      [connection] { connection->Drain(); });
+  });
+
+  // Connections remove themselves from the registry as they close; the last one wakes us
+  connections_->WaitUntilEmpty(std::chrono::steady_clock::now() + timeout);
+
+  const std::size_t remaining = connections_->Size();
+  if (remaining > 0) {
+    logger_->warn("Drain timed out, closing {} remaining connections", remaining);
+  }
+  Stop();
+  return remaining == 0;
 }
 
 bool TcpServer::IsRunning() const {
   return running_;
 }
 
-void TcpServer::StartAccept() {
-  if (!acceptor_ || !io_context_) {
-    spdlog::error("Acceptor or io_context is not initialized");
+unsigned short TcpServer::GetPort() const {
+  return port_;
+}
+
+std::size_t TcpServer::GetConnectionCount() const {
+  return connections_->Size();
+}
+
+MetricsSnapshot TcpServer::GetMetrics() const {
+  MetricsSnapshot snapshot = metrics_->Snapshot();
+  snapshot.connections_active = connections_->Size();
+  if (response_cache_ != nullptr) {
+    const internal::ResponseCache::Stats stats = response_cache_->GetStats();
+    snapshot.response_cache_evictions = stats.evictions;
+    snapshot.response_cache_entries = stats.entries;
+    snapshot.response_cache_bytes = stats.bytes;
+  }
+  return snapshot;
+}
+
+std::unique_ptr<TcpClient> TcpServer::CreateClient(const ClientOptions& options) {
+  if (!running_) {
+    throw std::logic_error("CreateClient() requires a running server");
+  }
+  // Only workers that have a thread running them
+  const std::size_t count = UsesContextPerThread() ? threads_.size() : 1;
+  std::vector<internal::ClientIoContext> contexts;
+  for (std::size_t i = 0; i < count; ++i) {
+    contexts.push_back(
+        internal::ClientIoContext{&workers_[i]->GetIoContext(), &workers_[i]->GetBufferPool()});
+  }
+  std::unique_ptr<TcpClient> client(
+      new TcpClient(options, std::move(contexts), metrics_.get(), logger_));
+  client->server_ = this;
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  clients_.push_back(client.get());
+  return client;
+}
+
+void TcpServer::RemoveClient(TcpClient* client) {
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
+}
+
+bool TcpServer::UsesContextPerThread() const {
+  return options_.execution_mode == ExecutionMode::kContextPerThread;
+}
+
+void TcpServer::CloseInheritedListeners() {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  if (inherited_listeners_.empty()) {
+    return;
+  }
+  // Connections queued on these sockets are lost once the predecessor closes them too
+  logger_->warn("Closing {} inherited listening sockets without a worker to accept on them",
+                inherited_listeners_.size());
+  for (int listener : inherited_listeners_) {
+    ::close(listener);
+  }
+  inherited_listeners_.clear();
+#endif
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+void TcpServer::ListenLocal(std::vector<int> inherited) {
+  internal::Worker& worker = *workers_.front();
+  for (const std::string& path : options_.socket.unix_socket_paths) {
+    const internal::StreamProtocol::endpoint endpoint = internal::MakeLocalEndpoint(path);
+    // Bound addresses of path sockets may carry a trailing zero byte, so compare descriptions
+    const std::string address = internal::DescribeEndpoint(endpoint);
+    const auto match = std::find_if(inherited.begin(), inherited.end(), [&](int listener) {
+      return internal::DescribeEndpoint(internal::BoundEndpoint(listener)) == address;
+    });
+    if (match != inherited.end()) {
+      const int listener = *match;
+      inherited.erase(match);
+      worker.Assign(listener, options_.socket);
+    } else {
+      internal::RemoveStaleSocketFile(path);
+      worker.Listen(endpoint, false, options_.socket);
+    }
+    if (path.front() != '@') {
+      socket_files_.push_back(path);
+    }
+  }
+  for (int listener : inherited) {
+    logger_->warn("Closing an inherited Unix domain socket that is not in unix_socket_paths");
+    ::close(listener);
+  }
+}
+#endif
+
+std::size_t TcpServer::TcpListenerCount() const {
+  return options_.socket.listen_tcp ? 1 : 0;
+}
+
+std::chrono::steady_clock::duration TcpServer::AcceptDelay() {
+  const std::size_t active = connections_->Size();
+  if (active >= options_.max_connections) {
+    return kAcceptRetryInterval;
+  }
+  if (handler_pool_ && options_.max_queued_requests > 0 &&
+      handler_pool_->QueuedTasks() >= options_.max_queued_requests) {
+    return kAcceptRetryInterval;
+  }
+  // Idle connections send no new samples either, so averages expire after the window
+  if (options_.max_handler_latency.count() > 0 && active > 0 &&
+      std::chrono::nanoseconds(metrics_->RecentHandlerTime(kHandlerLatencyWindow)) >
+          options_.max_handler_latency) {
+    return kAcceptRetryInterval;
+  }
+  if (accept_rate_) {
+    return accept_rate_->TryAcquire();
+  }
+  return std::chrono::steady_clock::duration::zero();
+}
+
+void TcpServer::StartAccept(internal::Worker& worker, std::size_t listener, bool resuming) {
+  if (!worker.GetAcceptor(listener).is_open()) {
+    logger_->error("Acceptor is not initialized");
+    return;
+  }
+
+  // Leave new connections in the listen backlog rather than accepting and closing them
+  const auto delay = AcceptDelay();
+  if (delay > std::chrono::steady_clock::duration::zero()) {
+    if (!resuming) {
+      logger_->debug("Server saturated, pausing accepts");
+      metrics_->Add(internal::ServerMetrics::kAcceptPauses);
+    }
+    worker.PauseAccepting(listener, delay,
+                          [this, &worker, listener] { StartAccept(worker, listener, true); });
     return;
   }
 
-  auto connection = internal::Connection::Create(*io_context_, message_handler_);
+  auto connection = worker.GetConnectionPool().Acquire();
   
-  acceptor_->async_accept(
-      connection->GetSocket(),
-      [this, connection](const boost::system::error_code& error) {
-        HandleAccept(connection, error);
+  // The peer address comes back from accept(), so logging it needs no getpeername()
+  worker.GetAcceptor(listener).async_accept(
+      connection->GetSocket(), connection->GetPeerEndpoint(),
+      [this, &worker, listener, connection](const boost::system::error_code& error) {
+        HandleAccept(worker, listener, connection, error);
       });
 }
 
-void TcpServer::HandleAccept(std::shared_ptr<internal::Connection> connection,
+void TcpServer::HandleAccept(internal::Worker& worker, std::size_t listener,
+                           std::shared_ptr<internal::Connection> connection,
                            const boost::system::error_code& error) {
+  if (error == boost::asio::error::operation_aborted &&
+      !worker.GetAcceptor(listener).is_open()) {
+    // Closed by Drain() or after a listener handoff
+    return;
+  }
+
   if (!error) {
-    spdlog::info("New connection from {}:{}",
-                connection->GetSocket().remote_endpoint().address().to_string(),
-                connection->GetSocket().remote_endpoint().port());
+    if (logger_->should_log(spdlog::level::info)) {
+      logger_->info("New connection from {}",
+                    internal::DescribeEndpoint(connection->GetPeerEndpoint()));
+    }
     
     // Add connection and start processing
-    if (AddConnection(connection)) {
+    if (!connection->AdmitPeer()) {
+      std::uint64_t suppressed = 0;
+      if (rejection_log_->Allow(&suppressed)) {
+        logger_->warn("Too many connections from {}, rejecting new connection{}",
+                      connection->GetRemoteEndpoint().address().to_string(),
+                      internal::SuppressedNote(suppressed));
+      }
+      metrics_->Add(internal::ServerMetrics::kConnectionsRejected);
+      connection->Stop();
+    } else if (connection->Register()) {
+      metrics_->Add(internal::ServerMetrics::kConnectionsAccepted);
       connection->Start();
+      if (draining_) {
+        // Accepted just before the acceptor closed: finish it like the others
+        boost::asio::post(connection->GetSocket().get_executor(),
+                          [connection] { connection->Drain(); });
+      }
     } else {
       // Reject connection if maximum connections reached
-      spdlog::warn("Maximum connections reached, rejecting new connection");
+      std::uint64_t suppressed = 0;
+      if (rejection_log_->Allow(&suppressed)) {
+        logger_->warn("Maximum connections reached, rejecting new connection{}",
+                      internal::SuppressedNote(suppressed));
+      }
+      metrics_->Add(internal::ServerMetrics::kConnectionsRejected);
       connection->Stop();
     }
   } else {
-    spdlog::error("Accept error: {}", error.message());
-  }
-  
-  // Accept next connection
-  StartAccept();
-}
+    std::uint64_t suppressed = 0;
+    if (accept_error_log_->Allow(&suppressed)) {
+      logger_->error("Accept error: {}{}", error.message(), internal::SuppressedNote(suppressed));
+    }
+    metrics_->AddError(error);
 
-bool TcpServer::AddConnection(std::shared_ptr<internal::Connection> connection) {
-  std::lock_guard<std::mutex> lock(connections_mutex_);
-  
-  // Check maximum connections
-  if (connections_.size() >= max_connections_) {
-    return false;
+    // Out of descriptors or memory: retrying at once would only spin
+    if (error == boost::asio::error::no_descriptors ||
+        error == boost::asio::error::no_buffer_space || error == boost::asio::error::no_memory) {
+      worker.PauseAccepting(listener, kAcceptRetryInterval, [this, &worker, listener] {
+        StartAccept(worker, listener, true);
+      });
+      return;
+    }
   }
   
-  // Store connection
-  connections_.insert(connection);
-  return true;
-}
-
-void TcpServer::RemoveConnection(std::shared_ptr<internal::Connection> connection) {
-  std::lock_guard<std::mutex> lock(connections_mutex_);
-  connections_.erase(connection);
+  // Accept next connection
+  StartAccept(worker, listener);
 }
 
-}  // namespace tcp_server 
\ No newline at end of file
+}  // namespace tcp_server
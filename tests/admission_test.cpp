@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+#include "src/internal/admission.h"
+
+using namespace tcp_server::internal;
+
+// Test that a full bucket allows a burst, then one token per interval
+TEST(AcceptRateLimiterTest, BurstThenRate) {
+  AcceptRateLimiter limiter(100, 5);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(AcceptRateLimiter::Clock::duration::zero(), limiter.TryAcquire()) << i;
+  }
+
+  // Empty: the wait is at most one interval
+  const auto wait = limiter.TryAcquire();
+  EXPECT_GT(wait, AcceptRateLimiter::Clock::duration::zero());
+  EXPECT_LE(wait, std::chrono::milliseconds(10));
+
+  std::this_thread::sleep_for(wait);
+  EXPECT_EQ(AcceptRateLimiter::Clock::duration::zero(), limiter.TryAcquire());
+}
+
+// Test that the burst defaults to one second's worth of tokens
+TEST(AcceptRateLimiterTest, DefaultBurst) {
+  AcceptRateLimiter limiter(20, 0);
+  int allowed = 0;
+  while (limiter.TryAcquire() == AcceptRateLimiter::Clock::duration::zero()) {
+    ++allowed;
+  }
+  EXPECT_EQ(20, allowed);
+}
+
+// Test that each address is limited on its own and released counts are reusable
+TEST(PeerLimiterTest, LimitPerAddress) {
+  PeerLimiter limiter(2);
+  const auto first = boost::asio::ip::make_address("192.0.2.1");
+  const auto second = boost::asio::ip::make_address("192.0.2.2");
+
+  EXPECT_TRUE(limiter.Acquire(first));
+  EXPECT_TRUE(limiter.Acquire(first));
+  EXPECT_FALSE(limiter.Acquire(first));
+  EXPECT_TRUE(limiter.Acquire(second));
+
+  limiter.Release(first);
+  EXPECT_TRUE(limiter.Acquire(first));
+  EXPECT_FALSE(limiter.Acquire(first));
+}
+
+// Test that an IPv4 peer and its IPv4-mapped IPv6 form share one count
+TEST(PeerLimiterTest, MappedAddressesShareCount) {
+  PeerLimiter limiter(1);
+  EXPECT_TRUE(limiter.Acquire(boost::asio::ip::make_address("127.0.0.1")));
+  EXPECT_FALSE(limiter.Acquire(boost::asio::ip::make_address("::ffff:127.0.0.1")));
+  EXPECT_TRUE(limiter.Acquire(boost::asio::ip::make_address("::1")));
+}
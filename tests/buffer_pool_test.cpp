@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+
+#include "src/internal/buffer_pool.h"
+
+using namespace tcp_server::internal;
+
+// Test that requests are rounded up to power-of-two classes within the limits
+TEST(BufferPoolTest, SizeClasses) {
+  BufferPool pool(200, 5000);
+  EXPECT_EQ(256u, pool.ClassSize(1));
+  EXPECT_EQ(256u, pool.ClassSize(256));
+  EXPECT_EQ(512u, pool.ClassSize(257));
+  EXPECT_EQ(8192u, pool.ClassSize(5000));
+
+  // Sizes beyond the largest class are still rounded, but not pooled
+  PooledBuffer large = pool.Acquire(100000);
+  EXPECT_EQ(131072u, large.size);
+  pool.Release(large);
+  EXPECT_FALSE(large);
+  EXPECT_EQ(0u, pool.IdleCount());
+}
+
+// Test that released buffers are reused by their own class only
+TEST(BufferPoolTest, ReuseByClass) {
+  BufferPool pool(256, 65536);
+  PooledBuffer small = pool.Acquire(300);
+  PooledBuffer big = pool.Acquire(40000);
+  const char* small_data = small.data.get();
+  const char* big_data = big.data.get();
+  pool.Release(small);
+  pool.Release(big);
+  EXPECT_EQ(2u, pool.IdleCount());
+
+  PooledBuffer again = pool.Acquire(512);
+  EXPECT_EQ(small_data, again.data.get());
+  PooledBuffer other = pool.Acquire(1024);
+  EXPECT_NE(big_data, other.data.get());
+  EXPECT_EQ(1024u, other.size);
+  pool.Release(again);
+  pool.Release(other);
+  pool.Release(again);
+  EXPECT_EQ(3u, pool.IdleCount());
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+#include "tcp_server/framer.h"
+
+using namespace tcp_server;
+
+// Test length-prefixed frames in both byte orders
+TEST(FramerTest, LengthPrefixRoundTrip) {
+  for (auto order : {ByteOrder::kBigEndian, ByteOrder::kLittleEndian}) {
+    for (auto width : {LengthPrefixFramer::Width::kUint16, LengthPrefixFramer::Width::kUint32}) {
+      LengthPrefixFramer framer(width, order);
+
+      std::string wire;
+      framer.Encode("ping", &wire);
+      framer.Encode("", &wire);
+      framer.Encode("hello", &wire);
+
+      std::string_view data(wire);
+      std::string_view payload;
+      std::size_t consumed = framer.Extract(data, &payload);
+      ASSERT_EQ(static_cast<std::size_t>(width) + 4, consumed);
+      EXPECT_EQ("ping", payload);
+
+      data.remove_prefix(consumed);
+      consumed = framer.Extract(data, &payload);
+      ASSERT_EQ(static_cast<std::size_t>(width), consumed);
+      EXPECT_EQ("", payload);
+
+      data.remove_prefix(consumed);
+      consumed = framer.Extract(data, &payload);
+      EXPECT_EQ("hello", payload);
+      EXPECT_EQ(data.size(), consumed);
+    }
+  }
+}
+
+// Test the wire format of the length field
+TEST(FramerTest, LengthPrefixByteOrder) {
+  std::string big;
+  LengthPrefixFramer(LengthPrefixFramer::Width::kUint16, ByteOrder::kBigEndian)
+      .Encode(std::string(258, 'x'), &big);
+  EXPECT_EQ('\x01', big[0]);
+  EXPECT_EQ('\x02', big[1]);
+
+  std::string little;
+  LengthPrefixFramer(LengthPrefixFramer::Width::kUint32, ByteOrder::kLittleEndian)
+      .Encode(std::string(258, 'x'), &little);
+  EXPECT_EQ(std::string("\x02\x01\x00\x00", 4), little.substr(0, 4));
+}
+
+// Test partial and oversized length-prefixed frames
+TEST(FramerTest, LengthPrefixPartialAndOversized) {
+  LengthPrefixFramer framer(LengthPrefixFramer::Width::kUint32, ByteOrder::kBigEndian, 16);
+  std::string_view payload;
+
+  EXPECT_EQ(0u, framer.Extract(std::string_view("\x00\x00", 2), &payload));
+  EXPECT_EQ(0u, framer.Extract(std::string_view("\x00\x00\x00\x04pi", 6), &payload));
+  EXPECT_THROW(framer.Extract(std::string_view("\x00\x00\x01\x00", 4), &payload),
+               FramingError);
+
+  std::string out;
+  EXPECT_THROW(framer.Encode(std::string(17, 'x'), &out), FramingError);
+}
+
+// Test delimiter frames
+TEST(FramerTest, Delimiter) {
+  DelimiterFramer framer("\r\n", 8);
+  std::string_view payload;
+
+  std::string_view data("ping\r\nhello\r\npar");
+  std::size_t consumed = framer.Extract(data, &payload);
+  EXPECT_EQ(6u, consumed);
+  EXPECT_EQ("ping", payload);
+  data.remove_prefix(consumed);
+
+  consumed = framer.Extract(data, &payload);
+  EXPECT_EQ(7u, consumed);
+  EXPECT_EQ("hello", payload);
+  data.remove_prefix(consumed);
+
+  EXPECT_EQ(0u, framer.Extract(data, &payload));
+  EXPECT_THROW(framer.Extract("0123456789", &payload), FramingError);
+
+  std::string out;
+  framer.Encode("pong", &out);
+  EXPECT_EQ("pong\r\n", out);
+
+  EXPECT_THROW(DelimiterFramer(""), std::invalid_argument);
+}
+
+// Test that a delimiter scan resumes after the bytes already scanned
+TEST(FramerTest, DelimiterResumesScan) {
+  DelimiterFramer framer("\r\n", 16);
+  std::string_view payload;
+  std::size_t scanned = 0;
+
+  // The delimiter is split across reads
+  std::string data = "hello\r";
+  EXPECT_EQ(0u, framer.ExtractFrom(data, &payload, &scanned));
+  EXPECT_EQ(data.size(), scanned);
+
+  data += "\nnext";
+  EXPECT_EQ(7u, framer.ExtractFrom(data, &payload, &scanned));
+  EXPECT_EQ("hello", payload);
+  EXPECT_EQ(0u, scanned);
+
+  // The limit still applies to a frame that was scanned piecewise
+  data = "0123456789";
+  EXPECT_EQ(0u, framer.ExtractFrom(data, &payload, &scanned));
+  data += "0123456789";
+  EXPECT_THROW(framer.ExtractFrom(data, &payload, &scanned), FramingError);
+
+  // Framers without a resumable scan fall back to Extract()
+  FixedSizeFramer fixed(3);
+  scanned = 0;
+  EXPECT_EQ(0u, fixed.ExtractFrom("ab", &payload, &scanned));
+  EXPECT_EQ(3u, fixed.ExtractFrom("abc", &payload, &scanned));
+  EXPECT_EQ("abc", payload);
+}
+
+// Test that frames account for bodies sent after the buffered payload
+TEST(FramerTest, FramesWithBodies) {
+  LengthPrefixFramer length_prefix(LengthPrefixFramer::Width::kUint16);
+  std::string out;
+  std::string trailer;
+  std::size_t start = length_prefix.BeginFrame(&out);
+  out += "ab";
+  length_prefix.EndFrameWithBodies(&out, start, 0x100, &trailer);
+  EXPECT_EQ(std::string("\x01\x02" "ab", 4), out);
+  EXPECT_TRUE(trailer.empty());
+  EXPECT_THROW(length_prefix.EndFrameWithBodies(&out, start, 0x10000, &trailer), FramingError);
+
+  DelimiterFramer delimiter("\r\n");
+  out.clear();
+  start = delimiter.BeginFrame(&out);
+  out += "ab";
+  delimiter.EndFrameWithBodies(&out, start, 10, &trailer);
+  EXPECT_EQ("ab", out);
+  EXPECT_EQ("\r\n", trailer);
+}
+
+// Test fixed-size frames
+TEST(FramerTest, FixedSize) {
+  FixedSizeFramer framer(3);
+  std::string_view payload;
+
+  EXPECT_EQ(3u, framer.Extract("abcdef", &payload));
+  EXPECT_EQ("abc", payload);
+  EXPECT_EQ(0u, framer.Extract("ab", &payload));
+  EXPECT_THROW(FixedSizeFramer(0), std::invalid_argument);
+}
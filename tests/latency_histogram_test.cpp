@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+
+#include "tcp_server/latency_histogram.h"
+
+using namespace tcp_server;
+
+// Test percentiles of a uniform distribution
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  for (std::uint64_t value = 1; value <= 10000; ++value) {
+    histogram.Record(value);
+  }
+
+  EXPECT_EQ(10000u, histogram.Count());
+  EXPECT_EQ(1u, histogram.Min());
+  EXPECT_EQ(10000u, histogram.Max());
+  EXPECT_DOUBLE_EQ(5000.5, histogram.Mean());
+
+  // Values are reported within the bucket precision (about 1.6%)
+  EXPECT_NEAR(5000.0, static_cast<double>(histogram.Percentile(50.0)), 5000.0 * 0.016);
+  EXPECT_NEAR(9900.0, static_cast<double>(histogram.Percentile(99.0)), 9900.0 * 0.016);
+  EXPECT_EQ(10000u, histogram.Percentile(100.0));
+}
+
+// Test that small values are exact and bucket bounds cover every value
+TEST(LatencyHistogramTest, BucketBounds) {
+  for (std::uint64_t value = 0; value < 128; ++value) {
+    EXPECT_EQ(value, LatencyHistogram::BucketUpperBound(LatencyHistogram::BucketIndex(value)));
+  }
+  for (std::uint64_t value : {128ull, 1000ull, 123456789ull, ~0ull}) {
+    const std::size_t index = LatencyHistogram::BucketIndex(value);
+    ASSERT_LT(index, LatencyHistogram::kBucketCount);
+    EXPECT_GE(LatencyHistogram::BucketUpperBound(index), value);
+  }
+}
+
+// Test merging and resetting
+TEST(LatencyHistogramTest, MergeAndReset) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.Record(10);
+  b.Record(1000);
+  b.Record(5);
+
+  a.Merge(b);
+  EXPECT_EQ(3u, a.Count());
+  EXPECT_EQ(5u, a.Min());
+  EXPECT_EQ(1000u, a.Max());
+
+  LatencyHistogram copy(a);
+  EXPECT_EQ(3u, copy.Count());
+
+  a.Reset();
+  EXPECT_EQ(0u, a.Count());
+  EXPECT_EQ(0u, a.Percentile(99.0));
+}
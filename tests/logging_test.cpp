@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <spdlog/sinks/ringbuffer_sink.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/internal/logging.h"
+
+using namespace tcp_server::internal;
+
+// Test that messages from several threads are all written after a flush
+TEST(AsyncLogSinkTest, WritesEveryMessage) {
+  auto ring = std::make_shared<spdlog::sinks::ringbuffer_sink_mt>(1000);
+  ring->set_pattern("%v");
+  spdlog::logger logger("test", std::make_shared<AsyncLogSink>(
+                                    std::vector<spdlog::sink_ptr>{ring}, 1024));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&logger, t] {
+      for (int i = 0; i < 100; ++i) {
+        logger.info("{} {}", t, i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  logger.flush();
+
+  // Each thread's messages keep their order
+  const std::vector<std::string> lines = ring->last_formatted();
+  ASSERT_EQ(400u, lines.size());
+  int next[4] = {};
+  for (const std::string& line : lines) {
+    const int t = line[0] - '0';
+    EXPECT_EQ(std::to_string(t) + " " + std::to_string(next[t]) + "\n", line);
+    ++next[t];
+  }
+}
+
+// Test that a full queue drops messages instead of blocking and reports them
+TEST(AsyncLogSinkTest, DropsWhenFull) {
+  auto ring = std::make_shared<spdlog::sinks::ringbuffer_sink_mt>(100000);
+  ring->set_pattern("%v");
+  auto sink = std::make_shared<AsyncLogSink>(std::vector<spdlog::sink_ptr>{ring}, 2);
+  spdlog::logger logger("test", sink);
+
+  for (int i = 0; i < 10000; ++i) {
+    logger.info("message {}", i);
+  }
+  logger.flush();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  const std::vector<std::string> lines = ring->last_formatted();
+  std::uint64_t written = 0;
+  bool reported = false;
+  for (const std::string& line : lines) {
+    if (line.find("log messages dropped") != std::string::npos) {
+      reported = true;
+    } else {
+      ++written;
+    }
+  }
+  EXPECT_EQ(10000u, written + sink->Dropped());
+  EXPECT_EQ(sink->Dropped() > 0, reported);
+}
+
+// Test the burst limit and the count of suppressed occurrences
+TEST(LogLimiterTest, BurstPerInterval) {
+  LogLimiter limiter(3, std::chrono::milliseconds(100));
+  std::uint64_t suppressed = 0;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(limiter.Allow(&suppressed));
+    EXPECT_EQ(0u, suppressed);
+  }
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_FALSE(limiter.Allow(&suppressed));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  EXPECT_TRUE(limiter.Allow(&suppressed));
+  EXPECT_EQ(5u, suppressed);
+  EXPECT_EQ(" (5 similar messages suppressed)", SuppressedNote(suppressed));
+  EXPECT_EQ("", SuppressedNote(0));
+
+  LogLimiter unlimited(0);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(unlimited.Allow(&suppressed));
+  }
+}
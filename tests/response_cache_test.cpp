@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "src/internal/response_cache.h"
+
+using namespace tcp_server;
+using namespace tcp_server::internal;
+
+namespace {
+
+// A single shard holding three entries of a one-byte key and a 71-byte response
+ResponseCacheOptions SmallCacheOptions() {
+  ResponseCacheOptions options;
+  options.max_bytes = 3 * (1 + 71 + ResponseCache::kEntryOverhead);
+  options.shards = 1;
+  return options;
+}
+
+// Look up a key and cache a response for it on a miss
+void Fill(ResponseCache& cache, const std::string& key, const std::string& response,
+          std::chrono::milliseconds ttl = std::chrono::milliseconds(0)) {
+  const ResponseCache::Lookup miss = cache.Find(key);
+  ASSERT_EQ(nullptr, miss.response);
+  ASSERT_TRUE(cache.Insert(miss, response, ttl));
+}
+
+}  // namespace
+
+// Test that a cached response is returned as the same shared buffer
+TEST(ResponseCacheTest, FindAfterInsert) {
+  ResponseCacheOptions options;
+  options.max_bytes = 1024 * 1024;
+  options.shards = 4;
+  ResponseCache cache(options);
+  EXPECT_EQ(4u, cache.ShardCount());
+
+  Fill(cache, "hello", "world\n");
+  const ResponseCache::Lookup first = cache.Find("hello");
+  const ResponseCache::Lookup second = cache.Find("hello");
+  ASSERT_NE(nullptr, first.response);
+  EXPECT_EQ("world\n", *first.response);
+  EXPECT_EQ(first.response, second.response);
+  EXPECT_EQ(nullptr, cache.Find("other").response);
+
+  const ResponseCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1u, stats.entries);
+  EXPECT_EQ(5 + 6 + ResponseCache::kEntryOverhead, stats.bytes);
+}
+
+// Test that the key function selects the key and can make requests uncacheable
+TEST(ResponseCacheTest, KeyFunction) {
+  ResponseCacheOptions options;
+  options.max_bytes = 1024 * 1024;
+  options.key = [](std::string_view request) {
+    return request.substr(0, 3) == "GET" ? request.substr(4) : std::string_view();
+  };
+  ResponseCache cache(options);
+
+  const ResponseCache::Lookup uncacheable = cache.Find("PUT a");
+  EXPECT_TRUE(uncacheable.key.empty());
+  EXPECT_FALSE(cache.Insert(uncacheable, "ok", std::chrono::milliseconds(0)));
+
+  Fill(cache, "GET a", "value");
+  EXPECT_EQ("a", cache.Find("GET a").key);
+  EXPECT_NE(nullptr, cache.Find("GET a").response);
+  EXPECT_TRUE(cache.Erase("a"));
+  EXPECT_EQ(nullptr, cache.Find("GET a").response);
+}
+
+// Test that the clock hand spares recently used entries
+TEST(ResponseCacheTest, ClockEviction) {
+  ResponseCache cache(SmallCacheOptions());
+  const std::string response(71, 'r');
+  Fill(cache, "a", response);
+  Fill(cache, "b", response);
+  Fill(cache, "c", response);
+  ASSERT_NE(nullptr, cache.Find("a").response);
+
+  Fill(cache, "d", response);
+  EXPECT_NE(nullptr, cache.Find("a").response);
+  EXPECT_EQ(nullptr, cache.Find("b").response);
+  EXPECT_NE(nullptr, cache.Find("c").response);
+  EXPECT_NE(nullptr, cache.Find("d").response);
+
+  const ResponseCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(3u, stats.entries);
+  EXPECT_EQ(1u, stats.evictions);
+  EXPECT_LE(stats.bytes, SmallCacheOptions().max_bytes);
+
+  // A response larger than the budget is never cached
+  const ResponseCache::Lookup miss = cache.Find("e");
+  EXPECT_FALSE(cache.Insert(miss, std::string(1024, 'r'), std::chrono::milliseconds(0)));
+  EXPECT_EQ(3u, cache.GetStats().entries);
+}
+
+// Test that entries expire after the default or their own TTL
+TEST(ResponseCacheTest, Expiry) {
+  ResponseCacheOptions options = SmallCacheOptions();
+  options.ttl = std::chrono::milliseconds(20);
+  ResponseCache cache(options);
+  EXPECT_EQ(std::chrono::milliseconds(20), cache.DefaultTtl());
+
+  Fill(cache, "a", "short", cache.DefaultTtl());
+  Fill(cache, "b", "long", std::chrono::milliseconds(10 * 1000));
+  Fill(cache, "c", "forever");
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  EXPECT_EQ(nullptr, cache.Find("a").response);
+  EXPECT_NE(nullptr, cache.Find("b").response);
+  EXPECT_NE(nullptr, cache.Find("c").response);
+  EXPECT_EQ(2u, cache.GetStats().entries);
+}
+
+// Test that a response computed across an invalidation is not cached
+TEST(ResponseCacheTest, InvalidationDropsConcurrentInsert) {
+  ResponseCache cache(SmallCacheOptions());
+
+  ResponseCache::Lookup miss = cache.Find("a");
+  EXPECT_FALSE(cache.Erase("a"));
+  EXPECT_FALSE(cache.Insert(miss, "stale", std::chrono::milliseconds(0)));
+  EXPECT_EQ(nullptr, cache.Find("a").response);
+
+  miss = cache.Find("a");
+  cache.Clear();
+  EXPECT_FALSE(cache.Insert(miss, "stale", std::chrono::milliseconds(0)));
+
+  Fill(cache, "a", "fresh");
+  Fill(cache, "b", "fresh");
+  cache.Clear();
+  EXPECT_EQ(nullptr, cache.Find("a").response);
+  EXPECT_EQ(0u, cache.GetStats().bytes);
+}
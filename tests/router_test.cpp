@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "src/internal/command_index.h"
+#include "tcp_server/router.h"
+
+using namespace tcp_server;
+using namespace tcp_server::internal;
+
+// Test that the command and arguments are split in place, for tokens of every length
+TEST(RouterTest, SplitCommand) {
+  const CommandLine line = SplitCommand(" \tget  key value \r\n");
+  EXPECT_EQ("get", line.command);
+  EXPECT_EQ("key value", line.arguments);
+  EXPECT_EQ("get  key value", line.trimmed);
+
+  EXPECT_EQ("", SplitCommand("").command);
+  EXPECT_EQ("", SplitCommand(" \r\n").command);
+  EXPECT_EQ("", SplitCommand("ping").arguments);
+
+  // Bytes above 0x7f belong to the token, so UTF-8 commands work
+  for (std::size_t length = 1; length < 40; ++length) {
+    for (char delimiter : {' ', '\t', '\n', '\x01'}) {
+      const std::string command(length, length % 2 == 0 ? 'c' : '\xe3');
+      const std::string request = command + delimiter + "argument";
+      const CommandLine split = SplitCommand(request);
+      EXPECT_EQ(command, split.command) << length;
+      EXPECT_EQ("argument", split.arguments) << length;
+      EXPECT_EQ(request.data(), split.command.data());
+    }
+  }
+}
+
+// Test that every key of a large set is found at its position and unknown keys are not
+TEST(RouterTest, CommandIndex) {
+  EXPECT_EQ(CommandIndex::kNotFound, CommandIndex().Find("get"));
+
+  std::vector<std::string> names;
+  for (int i = 0; i < 1000; ++i) {
+    names.push_back("command" + std::to_string(i));
+  }
+  const std::vector<std::string_view> keys(names.begin(), names.end());
+  const CommandIndex index(keys);
+  EXPECT_EQ(keys.size(), index.Size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(i, index.Find(keys[i]));
+  }
+  EXPECT_EQ(CommandIndex::kNotFound, index.Find("command1000"));
+  EXPECT_EQ(CommandIndex::kNotFound, index.Find("command"));
+  EXPECT_EQ(CommandIndex::kNotFound, index.Find(""));
+
+  EXPECT_THROW(CommandIndex({"get", "set", "get"}), std::invalid_argument);
+}
+
+// Test that requests reach their command's handler with the arguments, or the fallback
+TEST(RouterTest, Dispatch) {
+  RouteTable routes;
+  routes.Add("get", [](std::string_view arguments, ResponseWriter& response) {
+    response.Write("value of ");
+    response.Write(arguments);
+  });
+  routes.Add("ping", [](std::string_view, ResponseWriter& response) { response.Write("pong"); });
+  EXPECT_THROW(routes.Add("", nullptr), std::invalid_argument);
+  EXPECT_THROW(routes.Add("two words", nullptr), std::invalid_argument);
+  EXPECT_EQ(2u, routes.Size());
+
+  Router router(routes);
+  std::string output;
+  ResponseWriter writer(&output);
+  EXPECT_TRUE(router.Dispatch("get  key\r\n", writer));
+  EXPECT_EQ("value of key", output);
+
+  output.clear();
+  EXPECT_TRUE(router.Dispatch("ping", writer));
+  EXPECT_EQ("pong", output);
+  EXPECT_FALSE(router.Dispatch("set key", writer));
+
+  routes.SetFallback([](std::string_view request, ResponseWriter& response) {
+    response.Write("unknown: ");
+    response.Write(request);
+  });
+  router.Update(routes);
+  output.clear();
+  EXPECT_TRUE(router.Dispatch(" set key ", writer));
+  EXPECT_EQ("unknown: set key", output);
+
+  // A table with a duplicate is rejected and the current one stays
+  routes.Add("ping", nullptr);
+  EXPECT_THROW(router.Update(routes), std::invalid_argument);
+  output.clear();
+  EXPECT_TRUE(router.Dispatch("ping", writer));
+  EXPECT_EQ("pong", output);
+}
+
+// Test that tables are swapped under concurrent dispatches and freed once unused
+TEST(RouterTest, HotReload) {
+  auto make_routes = [](int version, const std::shared_ptr<int>& resource) {
+    RouteTable routes;
+    routes.Add("version", [version, resource](std::string_view, ResponseWriter& response) {
+      response.Write(std::to_string(version * *resource));
+    });
+    return routes;
+  };
+
+  Router router(make_routes(0, std::make_shared<int>(1)));
+  std::atomic<bool> stop{false};
+  std::atomic<int> errors{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      std::string output;
+      int last = 0;
+      while (!stop.load()) {
+        output.clear();
+        ResponseWriter writer(&output);
+        router.Dispatch("version", writer);
+        // Versions only move forward
+        const int version = std::stoi(output);
+        if (version < last) {
+          ++errors;
+        }
+        last = version;
+      }
+    });
+  }
+
+  for (int version = 1; version <= 200; ++version) {
+    auto resource = std::make_shared<int>(1);
+    const std::weak_ptr<int> previous = resource;
+    router.Update(make_routes(version, resource));
+    resource.reset();
+    router.Update(make_routes(version, std::make_shared<int>(1)));
+    // The replaced table, and the handler state it owned, are gone once Update returns
+    EXPECT_TRUE(previous.expired());
+  }
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, errors.load());
+}
+
+// Test that a handler cannot wait for its own table to be retired
+TEST(RouterTest, UpdateFromHandlerThrows) {
+  Router router;
+  RouteTable routes;
+  routes.Add("reload", [&router](std::string_view, ResponseWriter&) {
+    router.Update(RouteTable());
+  });
+  router.Update(routes);
+
+  std::string output;
+  ResponseWriter writer(&output);
+  EXPECT_THROW(router.Dispatch("reload", writer), std::logic_error);
+
+  // The read section ended with the exception, so updating from outside works
+  router.Update(RouteTable());
+  EXPECT_FALSE(router.Dispatch("reload", writer));
+}
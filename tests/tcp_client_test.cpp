@@ -0,0 +1,361 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_server/tcp_client.h"
+#include "tcp_server/tcp_server.h"
+
+using namespace tcp_server;
+
+namespace {
+
+// Options of a server whose frames the client can match
+ServerOptions FramedServerOptions() {
+  ServerOptions options;
+  options.max_connections = 64;
+  options.framer = std::make_shared<LengthPrefixFramer>();
+  return options;
+}
+
+ClientOptions FramedClientOptions() {
+  ClientOptions options;
+  options.framer = std::make_shared<LengthPrefixFramer>();
+  return options;
+}
+
+std::string Echo(const std::string& request) {
+  return "re:" + request;
+}
+
+// Start a server on an ephemeral port and return its endpoint
+std::string StartServer(std::unique_ptr<TcpServer>& server, TcpServer::MessageHandler handler,
+                        const ServerOptions& options = FramedServerOptions()) {
+  server = std::make_unique<TcpServer>(0, std::move(handler), options);
+  server->Start(2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  return "127.0.0.1:" + std::to_string(server->GetPort());
+}
+
+}  // namespace
+
+// Test that pipelined requests on one connection each get their own response
+TEST(TcpClientTest, PipelinedRequestsMatchResponses) {
+  std::unique_ptr<TcpServer> server;
+  const std::string endpoint = StartServer(server, Echo);
+
+  ClientOptions options = FramedClientOptions();
+  options.connections_per_endpoint = 1;
+  options.max_pipeline_depth = 16;
+  TcpClient client(options);
+
+  constexpr int kRequests = 1000;
+  std::atomic<int> matched{0};
+  std::atomic<int> completed{0};
+  std::uint64_t request_bytes = 0;
+  for (int i = 0; i < kRequests; ++i) {
+    const std::string request = std::to_string(i);
+    request_bytes += 4 + request.size();
+    client.AsyncRequest(endpoint, request,
+                        [&, request](const boost::system::error_code& error, std::string response) {
+                          if (!error && response == "re:" + request) {
+                            ++matched;
+                          }
+                          ++completed;
+                        });
+  }
+  for (int i = 0; i < 500 && completed.load() < kRequests; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(kRequests, matched.load());
+
+  // Every request shared the single persistent connection
+  EXPECT_EQ(1u, client.GetConnectionCount());
+  EXPECT_EQ(1u, server->GetMetrics().connections_accepted);
+  const MetricsSnapshot metrics = client.GetMetrics();
+  EXPECT_EQ(1u, metrics.client_connections_opened);
+  EXPECT_EQ(static_cast<std::uint64_t>(kRequests), metrics.client_requests);
+  EXPECT_EQ(0u, metrics.client_requests_failed);
+  EXPECT_EQ(static_cast<std::uint64_t>(kRequests), metrics.client_request_time_ns.Count());
+  // Length prefixes included; each response adds "re:"
+  EXPECT_EQ(request_bytes, metrics.client_bytes_sent);
+  EXPECT_EQ(request_bytes + 3 * kRequests, metrics.client_bytes_received);
+}
+
+// Test that concurrent requests spread over a bounded pool that later requests reuse
+TEST(TcpClientTest, PoolsConnectionsPerEndpoint) {
+  std::unique_ptr<TcpServer> server;
+  const std::string endpoint = StartServer(server, [](const std::string& request) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return Echo(request);
+  });
+
+  ClientOptions options = FramedClientOptions();
+  options.connections_per_endpoint = 3;
+  TcpClient client(options);
+
+  std::vector<std::future<std::string>> responses;
+  for (int i = 0; i < 12; ++i) {
+    responses.push_back(client.AsyncRequest(endpoint, std::to_string(i), boost::asio::use_future));
+  }
+  for (int i = 0; i < 12; ++i) {
+    EXPECT_EQ("re:" + std::to_string(i), responses[i].get());
+  }
+  EXPECT_EQ(3u, client.GetConnectionCount());
+
+  // Sequential requests need no new handshake
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ("re:again", client.Request(endpoint, "again"));
+  }
+  EXPECT_EQ(3u, server->GetMetrics().connections_accepted);
+  EXPECT_EQ(3u, client.GetMetrics().client_connections_opened);
+}
+
+// Test that the raw framing of the server's default works one request at a time
+TEST(TcpClientTest, RawFraming) {
+  std::unique_ptr<TcpServer> server;
+  const std::string endpoint = StartServer(server, Echo, ServerOptions());
+
+  ClientOptions options;
+  options.connections_per_endpoint = 1;
+  TcpClient client(options);
+  std::vector<std::future<std::string>> responses;
+  for (int i = 0; i < 20; ++i) {
+    responses.push_back(client.AsyncRequest(endpoint, std::to_string(i), boost::asio::use_future));
+  }
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ("re:" + std::to_string(i), responses[i].get());
+  }
+}
+
+// Test that file and pinned response bodies stay inside the frames a framed client reads
+TEST(TcpClientTest, ResponseBodiesInsideFrames) {
+  const std::string file_contents(3000, 'f');
+  std::FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(file_contents.size(),
+            std::fwrite(file_contents.data(), 1, file_contents.size(), file));
+  ASSERT_EQ(0, std::fflush(file));
+  const auto pinned = std::make_shared<const std::string>(20000, 'p');
+
+  const std::vector<std::shared_ptr<Framer>> framers = {
+      std::make_shared<LengthPrefixFramer>(), std::make_shared<DelimiterFramer>("\n")};
+  for (const auto& framer : framers) {
+    ServerOptions server_options;
+    server_options.framer = framer;
+    auto server = std::make_unique<TcpServer>(
+        0,
+        [&](std::string_view request, ResponseWriter& response) {
+          response.Write("re:" + std::string(request) + ":");
+          response.WritePinned(pinned->data(), pinned->size(), pinned);
+          response.WriteFile(fileno(file), 0, file_contents.size());
+        },
+        server_options);
+    server->Start(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const std::string endpoint = "127.0.0.1:" + std::to_string(server->GetPort());
+
+    ClientOptions options;
+    options.framer = framer;
+    options.connections_per_endpoint = 1;
+    TcpClient client(options);
+    std::vector<std::future<std::string>> responses;
+    for (int i = 0; i < 5; ++i) {
+      responses.push_back(
+          client.AsyncRequest(endpoint, std::to_string(i), boost::asio::use_future));
+    }
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_TRUE("re:" + std::to_string(i) + ":" + *pinned + file_contents == responses[i].get());
+    }
+  }
+  std::fclose(file);
+}
+
+// Test that failures reach the caller and the pooled connection recovers after a restart
+TEST(TcpClientTest, ErrorsAndReconnect) {
+  std::unique_ptr<TcpServer> server;
+  const std::string endpoint = StartServer(server, Echo);
+  const unsigned short port = server->GetPort();
+
+  TcpClient client(FramedClientOptions());
+  EXPECT_EQ("re:first", client.Request(endpoint, "first"));
+
+  // The server closes the pooled connection; the client notices and reconnects
+  server.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(0u, client.GetConnectionCount());
+  EXPECT_THROW(client.Request(endpoint, "refused"), boost::system::system_error);
+
+  server = std::make_unique<TcpServer>(port, Echo, FramedServerOptions());
+  server->Start(1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ("re:second", client.Request(endpoint, "second"));
+  EXPECT_EQ(2u, client.GetMetrics().client_connections_opened);
+  EXPECT_EQ(1u, client.GetMetrics().client_requests_failed);
+  EXPECT_GE(client.GetMetrics().errors.at("system"), 1u);
+
+  EXPECT_THROW(client.Request("127.0.0.1", "no port"), std::invalid_argument);
+  EXPECT_THROW(client.Request("127.0.0.1:99999", "bad port"), std::invalid_argument);
+  ClientOptions invalid;
+  invalid.connections_per_endpoint = 0;
+  EXPECT_THROW(TcpClient{invalid}, std::invalid_argument);
+}
+
+// Test that a request without a response in time fails the connection's requests
+TEST(TcpClientTest, RequestTimeout) {
+  std::unique_ptr<TcpServer> server;
+  const std::string endpoint = StartServer(server, [](const std::string& request) {
+    if (request == "slow") {
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    return Echo(request);
+  });
+
+  ClientOptions options = FramedClientOptions();
+  options.connections_per_endpoint = 1;
+  options.request_timeout = std::chrono::milliseconds(100);
+  TcpClient client(options);
+
+  auto slow = client.AsyncRequest(endpoint, "slow", boost::asio::use_future);
+  auto queued = client.AsyncRequest(endpoint, "queued", boost::asio::use_future);
+  try {
+    slow.get();
+    FAIL() << "Expected a timeout";
+  } catch (const boost::system::system_error& error) {
+    EXPECT_EQ(boost::asio::error::timed_out, error.code());
+  }
+  EXPECT_THROW(queued.get(), boost::system::system_error);
+
+  // The next request opens a fresh connection
+  EXPECT_EQ("re:fast", client.Request(endpoint, "fast"));
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+// Test that requests reach a server listening on a Unix domain socket
+TEST(TcpClientTest, UnixDomainSocket) {
+  ServerOptions server_options = FramedServerOptions();
+  server_options.socket.listen_tcp = false;
+  server_options.socket.unix_socket_paths = {"@tcp_server_client_test_" +
+                                             std::to_string(::getpid())};
+  std::unique_ptr<TcpServer> server;
+  StartServer(server, Echo, server_options);
+
+  TcpClient client(FramedClientOptions());
+  const std::string endpoint = "unix:" + server_options.socket.unix_socket_paths.front();
+  EXPECT_EQ("re:local", client.Request(endpoint, "local"));
+  EXPECT_EQ(1u, client.GetConnectionCount());
+}
+#endif
+
+// Test that a client created by a server runs on its threads and counts in its metrics
+TEST(TcpClientTest, CreateClientSharesServerMetrics) {
+  std::unique_ptr<TcpServer> backend;
+  const std::string endpoint = StartServer(backend, Echo);
+
+  // A front server that forwards every request to the backend
+  auto front = std::make_unique<TcpServer>(0, Echo, FramedServerOptions());
+  EXPECT_THROW(front->CreateClient(FramedClientOptions()), std::logic_error);
+  front->Start(2);
+  std::unique_ptr<TcpClient> client = front->CreateClient(FramedClientOptions());
+
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ("re:" + std::to_string(i), client->Request(endpoint, std::to_string(i)));
+  }
+  const MetricsSnapshot metrics = front->GetMetrics();
+  EXPECT_EQ(20u, metrics.client_requests);
+  EXPECT_EQ(1u, metrics.client_connections_opened);
+  // 20 length prefixes, "re:" and the numbers 0 to 19
+  EXPECT_EQ(20u * 7 + 30, metrics.client_bytes_received);
+  EXPECT_NE(std::string::npos,
+            metrics.ToPrometheusText().find("tcp_server_client_requests_total 20\n"));
+  client.reset();
+}
+
+// Test that stopping the server fails its client's requests instead of leaving them waiting
+TEST(TcpClientTest, CreateClientFailsRequestsOnStop) {
+  std::unique_ptr<TcpServer> backend;
+  const std::string endpoint = StartServer(backend, [](const std::string& request) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    return Echo(request);
+  });
+
+  auto front = std::make_unique<TcpServer>(0, Echo, FramedServerOptions());
+  front->Start(2);
+  std::unique_ptr<TcpClient> client = front->CreateClient(FramedClientOptions());
+
+  auto pending = client->AsyncRequest(endpoint, "slow", boost::asio::use_future);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  front->Stop();
+  ASSERT_EQ(std::future_status::ready, pending.wait_for(std::chrono::seconds(0)));
+  try {
+    pending.get();
+    FAIL() << "Expected the request to be aborted";
+  } catch (const boost::system::system_error& error) {
+    EXPECT_EQ(boost::asio::error::operation_aborted, error.code());
+  }
+
+  // Later requests fail at once rather than block
+  EXPECT_THROW(client->Request(endpoint, "after stop"), boost::system::system_error);
+  client.reset();
+}
+
+// Test that a blocking request from a message handler is refused instead of deadlocking
+TEST(TcpClientTest, RequestOnWorkerThreadIsRefused) {
+  std::unique_ptr<TcpServer> backend;
+  const std::string endpoint = StartServer(backend, Echo);
+
+  std::atomic<TcpClient*> forwarder{nullptr};
+  std::unique_ptr<TcpServer> front;
+  const std::string front_endpoint = StartServer(
+      front,
+      [&](const std::string& request) -> std::string {
+        try {
+          return forwarder.load()->Request(endpoint, request);
+        } catch (const std::logic_error&) {
+          return "refused";
+        }
+      },
+      FramedServerOptions());
+  std::unique_ptr<TcpClient> client = front->CreateClient(FramedClientOptions());
+  forwarder = client.get();
+
+  TcpClient caller(FramedClientOptions());
+  EXPECT_EQ("refused", caller.Request(front_endpoint, "hello"));
+  // The same client works from other threads
+  EXPECT_EQ("re:hello", client->Request(endpoint, "hello"));
+  client.reset();
+}
+
+#if defined(TCP_SERVER_HAS_COROUTINES)
+// Test that a coroutine awaits responses without blocking its thread
+TEST(TcpClientTest, Coroutine) {
+  std::unique_ptr<TcpServer> server;
+  const std::string endpoint = StartServer(server, Echo);
+  TcpClient client(FramedClientOptions());
+
+  boost::asio::io_context io_context;
+  std::vector<std::string> responses;
+  boost::asio::co_spawn(
+      io_context,
+      [&]() -> boost::asio::awaitable<void> {
+        for (int i = 0; i < 5; ++i) {
+          responses.push_back(
+              co_await client.AsyncRequest(endpoint, std::to_string(i), boost::asio::use_awaitable));
+        }
+      },
+      boost::asio::detached);
+  io_context.run();
+
+  ASSERT_EQ(5u, responses.size());
+  EXPECT_EQ("re:4", responses.back());
+}
+#endif
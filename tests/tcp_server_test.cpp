@@ -1,10 +1,22 @@
 #include <gtest/gtest.h>
-#include <boost/asio.hpp>
 #include <thread>
 #include <string>
 #include <future>
 #include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
 
+#if defined(TCP_SERVER_HAS_TLS)
+#include <boost/asio/ssl.hpp>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#endif
+
+#include "tcp_server/asio.h"
+#include "tcp_server/router.h"
 #include "tcp_server/tcp_server.h"
 
 using namespace tcp_server;
@@ -14,7 +26,12 @@ class TcpServerTest : public ::testing::Test {
  protected:
   void SetUp() override {
     // Create test server
-    server_ = std::make_unique<TcpServer>(test_port_, [](const std::string& message) {
+    server_ = std::make_unique<TcpServer>(test_port_, TestHandler());
+  }
+
+  // Message handler shared by all test servers
+  static TcpServer::MessageHandler TestHandler() {
+    return [](const std::string& message) -> std::string {
       if (message == "ping") {
         return "pong";
       } else if (message == "hello") {
@@ -22,7 +39,7 @@ class TcpServerTest : public ::testing::Test {
       } else {
         return "unknown command";
       }
-    });
+    };
   }
 
   void TearDown() override {
@@ -55,6 +72,28 @@ class TcpServerTest : public ::testing::Test {
     }
   }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  // Client function for Unix domain sockets; "@name" is an abstract name
+  std::string SendLocalMessage(const std::string& path, const std::string& message) {
+    try {
+      using boost::asio::local::stream_protocol;
+      boost::asio::io_context io_context;
+      stream_protocol::socket socket(io_context);
+      std::string name = path;
+      if (name.front() == '@') {
+        name.front() = '\0';
+      }
+      socket.connect(stream_protocol::endpoint(name));
+      boost::asio::write(socket, boost::asio::buffer(message));
+      std::vector<char> reply(1024);
+      const std::size_t reply_length = socket.read_some(boost::asio::buffer(reply));
+      return std::string(reply.data(), reply_length);
+    } catch (std::exception& e) {
+      return std::string("ERROR: ") + e.what();
+    }
+  }
+#endif
+
   const unsigned short test_port_ = 12345;
   std::unique_ptr<TcpServer> server_;
 };
@@ -117,6 +156,1298 @@ TEST_F(TcpServerTest, MultipleConnections) {
   }
 }
 
+// Test io_context-per-thread mode with sharded acceptors
+TEST_F(TcpServerTest, ContextPerThreadMode) {
+  // Recreate server with one io_context and acceptor per thread
+  server_.reset();
+  ServerOptions options;
+  options.execution_mode = ExecutionMode::kContextPerThread;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(4);
+  ASSERT_TRUE(server_->IsRunning());
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Connections are spread over the acceptors by the kernel
+  constexpr int client_count = 8;
+  std::vector<std::future<std::string>> futures;
+
+  for (int i = 0; i < client_count; ++i) {
+    futures.push_back(std::async(std::launch::async, [this]() {
+      return SendMessage("hello");
+    }));
+  }
+
+  for (auto& f : futures) {
+    EXPECT_EQ("world", f.get());
+  }
+
+  server_->Stop();
+  ASSERT_FALSE(server_->IsRunning());
+}
+
+// Test pinned, busy-polling workers that allocate their connections on their own thread
+TEST_F(TcpServerTest, PinnedBusyPollWorkers) {
+  server_.reset();
+  ServerOptions options;
+  options.execution_mode = ExecutionMode::kContextPerThread;
+  options.worker_cpu_sets = {{0}};
+  options.busy_poll = std::chrono::microseconds(50);
+  options.connection_pool_size = 4;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(2);
+  ASSERT_TRUE(server_->IsRunning());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ("world", SendMessage("hello"));
+  }
+
+  server_->Stop();
+  ASSERT_FALSE(server_->IsRunning());
+
+  ServerOptions invalid;
+  invalid.worker_cpu_sets = {{}};
+  EXPECT_THROW(TcpServer(test_port_, TestHandler(), invalid), std::runtime_error);
+}
+
+// Test a dual-stack listener with tuned socket options
+TEST_F(TcpServerTest, SocketOptions) {
+  server_.reset();
+  ServerOptions options;
+  options.socket.bind_address = "::";
+  options.socket.backlog = 16;
+  options.socket.receive_buffer_size = 64 * 1024;
+  options.socket.send_buffer_size = 64 * 1024;
+  options.socket.defer_accept = std::chrono::seconds(1);
+  options.socket.fast_open_queue = 16;
+  options.socket.quick_ack = true;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+  ASSERT_TRUE(server_->IsRunning());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // IPv4 clients reach the IPv6 listener through mapped addresses
+  EXPECT_EQ("world", SendMessage("hello"));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("::1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("hello")));
+  std::vector<char> reply(1024);
+  const std::size_t length = socket.read_some(boost::asio::buffer(reply));
+  EXPECT_EQ("world", std::string(reply.data(), length));
+  socket.close();
+
+  server_->Stop();
+  ASSERT_FALSE(server_->IsRunning());
+
+  ServerOptions invalid;
+  invalid.socket.bind_address = "not an address";
+  EXPECT_THROW(TcpServer(test_port_, TestHandler(), invalid), std::runtime_error);
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+// Test one server listening on TCP, a Unix domain socket file and an abstract name together
+TEST_F(TcpServerTest, UnixDomainSocket) {
+  const std::string path = "/tmp/tcp_server_test.sock";
+#if defined(__linux__)
+  const std::string abstract_name = "@tcp_server_test";
+#endif
+
+  // A socket file left behind by a process that exited is replaced
+  std::remove(path.c_str());
+  {
+    boost::asio::io_context io_context;
+    boost::asio::local::stream_protocol::acceptor stale(
+        io_context, boost::asio::local::stream_protocol::endpoint(path));
+  }
+
+  for (ExecutionMode mode : {ExecutionMode::kSharedContext, ExecutionMode::kContextPerThread}) {
+    server_.reset();
+    ServerOptions options;
+    options.execution_mode = mode;
+    options.max_connections = 64;
+    options.max_connections_per_ip = 1;
+    options.socket.unix_socket_paths = {path};
+#if defined(__linux__)
+    options.socket.unix_socket_paths.push_back(abstract_name);
+#endif
+    server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+    server_->Start(2);
+    ASSERT_TRUE(server_->IsRunning());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_EQ("world", SendMessage("hello"));
+    // Local peers have no address to count against max_connections_per_ip
+    std::vector<std::future<std::string>> futures;
+    for (int i = 0; i < 8; ++i) {
+      futures.push_back(std::async(std::launch::async, [this, &path] {
+        return SendLocalMessage(path, "ping");
+      }));
+    }
+    for (auto& f : futures) {
+      EXPECT_EQ("pong", f.get());
+    }
+#if defined(__linux__)
+    EXPECT_EQ("world", SendLocalMessage(abstract_name, "hello"));
+#endif
+    EXPECT_EQ(0u, server_->GetMetrics().connections_rejected);
+
+    server_->Stop();
+  }
+
+  // The socket file is removed with the server
+  server_.reset();
+  EXPECT_NE(0, std::remove(path.c_str()));
+}
+
+// Test a server that listens on a Unix domain socket only
+TEST_F(TcpServerTest, UnixDomainSocketOnly) {
+  server_.reset();
+  const std::string path = "/tmp/tcp_server_test_only.sock";
+  ServerOptions options;
+  options.socket.listen_tcp = false;
+  options.socket.unix_socket_paths = {path};
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  EXPECT_EQ(0, server_->GetPort());
+  server_->Start(1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  EXPECT_EQ("pong", SendLocalMessage(path, "ping"));
+  EXPECT_EQ(0, SendMessage("ping").rfind("ERROR", 0));
+
+  // A path that is still accepted on is in use
+  ServerOptions same_path;
+  same_path.socket.listen_tcp = false;
+  same_path.socket.unix_socket_paths = {path};
+  EXPECT_THROW(TcpServer(test_port_, TestHandler(), same_path), std::runtime_error);
+  EXPECT_EQ("pong", SendLocalMessage(path, "ping"));
+  server_->Stop();
+
+  ServerOptions nothing;
+  nothing.socket.listen_tcp = false;
+  EXPECT_THROW(TcpServer(test_port_, TestHandler(), nothing), std::runtime_error);
+  ServerOptions too_long;
+  too_long.socket.unix_socket_paths = {"/tmp/" + std::string(200, 'x')};
+  EXPECT_THROW(TcpServer(test_port_, TestHandler(), too_long), std::runtime_error);
+}
+#endif
+
+// Test that several frames arriving in one segment are all answered
+TEST_F(TcpServerTest, LengthPrefixedPipelining) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<LengthPrefixFramer>();
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+
+  // Three requests in one write, the last one split across two writes
+  std::string requests;
+  options.framer->Encode("ping", &requests);
+  options.framer->Encode("hello", &requests);
+  options.framer->Encode("ping", &requests);
+  boost::asio::write(socket, boost::asio::buffer(requests.data(), requests.size() - 2));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  boost::asio::write(socket, boost::asio::buffer(requests.data() + requests.size() - 2, 2));
+
+  std::string expected;
+  options.framer->Encode("pong", &expected);
+  options.framer->Encode("world", &expected);
+  options.framer->Encode("pong", &expected);
+
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ(expected, reply);
+}
+
+// Test the zero-copy handler that writes straight into the output buffer
+TEST_F(TcpServerTest, ViewHandler) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        response.Write("echo:");
+        response.Write(request);
+        EXPECT_EQ(5 + request.size(), response.Size());
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("a\nbc\n")));
+
+  const std::string expected = "echo:a\necho:bc\n";
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ(expected, reply);
+}
+
+// Test that a frame and its delimiter arriving over several reads are found once complete
+TEST_F(TcpServerTest, DelimiterSplitAcrossReads) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\r\n");
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        response.Write("echo:");
+        response.Write(request);
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  socket.set_option(tcp::no_delay(true));
+  for (const char* part : {"hel", "lo\r", "\nwor", "ld", "\r", "\n"}) {
+    boost::asio::write(socket, boost::asio::buffer(std::string(part)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  const std::string expected = "echo:hello\r\necho:world\r\n";
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ(expected, reply);
+}
+
+// Test that file bodies are sent in order inside their responses' frames
+TEST_F(TcpServerTest, FileResponseBody) {
+  std::string contents(3 * 1024 * 1024, '\0');
+  for (std::size_t i = 0; i < contents.size(); ++i) {
+    contents[i] = static_cast<char>('a' + i % 26);
+  }
+  std::FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(contents.size(), std::fwrite(contents.data(), 1, contents.size(), file));
+  ASSERT_EQ(0, std::fflush(file));
+  std::atomic<int> owners{0};
+
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [&](std::string_view request, ResponseWriter& response) {
+        const std::uint64_t offset = request == "head" ? 0 : 100;
+        response.Write(std::string(request));
+        ++owners;
+        response.WriteFile(fileno(file), offset, 1024 * 1024,
+                           std::shared_ptr<const void>(nullptr, [&](const void*) { --owners; }));
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("head\ntail\n")));
+
+  const std::string expected = "head" + contents.substr(0, 1024 * 1024) + "\ntail" +
+                               contents.substr(100, 1024 * 1024) + "\n";
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_TRUE(expected == reply);
+
+  // Owners are released once their bodies are sent
+  for (int i = 0; i < 100 && owners != 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(0, owners);
+  server_->Stop();
+  std::fclose(file);
+}
+
+// Test that pinned bodies from offloaded handlers are sent intact and released afterwards
+TEST_F(TcpServerTest, PinnedResponseBody) {
+  std::string contents(1024 * 1024, '\0');
+  for (std::size_t i = 0; i < contents.size(); ++i) {
+    contents[i] = static_cast<char>('A' + i % 26);
+  }
+  std::weak_ptr<const std::string> last_body;
+
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  options.handler_execution = HandlerExecution::kOffload;
+  options.handler_threads = 2;
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [&](std::string_view request, ResponseWriter& response) {
+        auto body = std::make_shared<const std::string>(contents);
+        last_body = body;
+        response.Write(std::string(request));
+        response.WritePinned(body->data(), body->size(), body);
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("1\n2\n3\n")));
+
+  const std::string expected = "1" + contents + "\n2" + contents + "\n3" + contents + "\n";
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_TRUE(expected == reply);
+
+  // With MSG_ZEROCOPY the body is released when the kernel reports completion
+  for (int i = 0; i < 100 && !last_body.expired(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(last_body.expired());
+}
+
+#if defined(TCP_SERVER_HAS_TLS)
+// Write a self-signed certificate for localhost and its key as PEM files
+static void WriteSelfSignedCertificate(const std::string& certificate_file,
+                                       const std::string& key_file) {
+  EVP_PKEY* key = EVP_EC_gen("prime256v1");
+  X509* certificate = X509_new();
+  ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+  X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+  X509_gmtime_adj(X509_getm_notAfter(certificate), 60 * 60);
+  X509_set_pubkey(certificate, key);
+  X509_NAME* name = X509_get_subject_name(certificate);
+  X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                             reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+  X509_set_issuer_name(certificate, name);
+  X509_sign(certificate, key, EVP_sha256());
+
+  std::FILE* file = std::fopen(certificate_file.c_str(), "w");
+  PEM_write_X509(file, certificate);
+  std::fclose(file);
+  file = std::fopen(key_file.c_str(), "w");
+  PEM_write_PrivateKey(file, key, nullptr, nullptr, 0, nullptr, nullptr);
+  std::fclose(file);
+  X509_free(certificate);
+  EVP_PKEY_free(key);
+}
+
+static ServerOptions TlsServerOptions() {
+  ServerOptions options;
+  options.tls.certificate_chain_file = testing::TempDir() + "tcp_server_test_cert.pem";
+  options.tls.private_key_file = testing::TempDir() + "tcp_server_test_key.pem";
+  WriteSelfSignedCertificate(options.tls.certificate_chain_file, options.tls.private_key_file);
+  return options;
+}
+
+// Test TLS request/response and that a reconnecting client resumes its session
+TEST_F(TcpServerTest, TlsResumption) {
+  server_.reset();
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), TlsServerOptions());
+  server_->Start(2);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  boost::asio::ssl::context context(boost::asio::ssl::context::tls_client);
+  context.set_verify_mode(boost::asio::ssl::verify_none);
+  SSL_SESSION* session = nullptr;
+  for (int i = 0; i < 2; ++i) {
+    boost::asio::ssl::stream<tcp::socket> stream(io_context, context);
+    stream.next_layer().connect(
+        tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+    if (session != nullptr) {
+      SSL_set_session(stream.native_handle(), session);
+    }
+    stream.handshake(boost::asio::ssl::stream_base::client);
+    EXPECT_EQ(i == 1, SSL_session_reused(stream.native_handle()) == 1);
+
+    boost::asio::write(stream, boost::asio::buffer(std::string("hello")));
+    std::vector<char> reply(1024);
+    const std::size_t length = stream.read_some(boost::asio::buffer(reply));
+    EXPECT_EQ("world", std::string(reply.data(), length));
+
+    // TLS 1.3 tickets arrive after the handshake, so take the session after a read
+    if (session == nullptr) {
+      session = SSL_get1_session(stream.native_handle());
+    }
+    boost::system::error_code ec;
+    stream.shutdown(ec);
+  }
+  SSL_SESSION_free(session);
+
+  const MetricsSnapshot metrics = server_->GetMetrics();
+  EXPECT_EQ(2u, metrics.tls_handshakes);
+  EXPECT_EQ(1u, metrics.tls_sessions_resumed);
+  server_->Stop();
+}
+
+// Test that file bodies are encrypted when the kernel does not do it
+TEST_F(TcpServerTest, TlsFileResponseBody) {
+  std::string contents(512 * 1024, '\0');
+  for (std::size_t i = 0; i < contents.size(); ++i) {
+    contents[i] = static_cast<char>('a' + i % 26);
+  }
+  std::FILE* file = std::tmpfile();
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(contents.size(), std::fwrite(contents.data(), 1, contents.size(), file));
+  ASSERT_EQ(0, std::fflush(file));
+
+  server_.reset();
+  ServerOptions options = TlsServerOptions();
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [&](std::string_view request, ResponseWriter& response) {
+        response.Write(std::string(request));
+        response.WriteFile(fileno(file), request == "head" ? 0 : 100, 256 * 1024);
+      },
+      options);
+  server_->Start(1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  boost::asio::ssl::context context(boost::asio::ssl::context::tls_client);
+  context.set_verify_mode(boost::asio::ssl::verify_none);
+  boost::asio::ssl::stream<tcp::socket> stream(io_context, context);
+  stream.next_layer().connect(
+      tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  stream.handshake(boost::asio::ssl::stream_base::client);
+  boost::asio::write(stream, boost::asio::buffer(std::string("head\ntail\n")));
+
+  const std::string expected = "head" + contents.substr(0, 256 * 1024) + "\ntail" +
+                               contents.substr(100, 256 * 1024) + "\n";
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(stream, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_TRUE(expected == reply);
+
+  server_->Stop();
+  std::fclose(file);
+}
+#endif
+
+// Test that pipelined responses stay in order while reads are paused by the watermarks
+TEST_F(TcpServerTest, WriteQueueBackpressure) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<LengthPrefixFramer>();
+  options.write_high_watermark = 4096;
+  options.write_low_watermark = 1024;
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        response.Write(std::string(1000, request.front()));
+      },
+      options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+
+  // Send every request before reading any response
+  constexpr int request_count = 200;
+  std::string requests;
+  for (int i = 0; i < request_count; ++i) {
+    options.framer->Encode(std::string(1, static_cast<char>('a' + i % 26)), &requests);
+  }
+  boost::asio::write(socket, boost::asio::buffer(requests));
+
+  for (int i = 0; i < request_count; ++i) {
+    std::string reply(4 + 1000, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+    ASSERT_EQ(std::string(1000, static_cast<char>('a' + i % 26)), reply.substr(4));
+  }
+}
+
+// Test that connections beyond the preallocated pool are served from a pool that grows
+TEST_F(TcpServerTest, ConnectionPoolOverflow) {
+  server_.reset();
+  ServerOptions options;
+  options.connection_pool_size = 1;
+  options.read_buffer_size = 16;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  for (int i = 0; i < 40; ++i) {
+    EXPECT_EQ("pong", SendMessage("ping"));
+  }
+
+  // The pool grew past its single preallocated connection and reuses what it added
+  const MetricsSnapshot metrics = server_->GetMetrics();
+  EXPECT_GT(metrics.connection_pool_grown, 0u);
+  EXPECT_LT(metrics.connection_pool_grown, 40u);
+}
+
+// Test that closed connections give their slot back
+TEST_F(TcpServerTest, ClosedConnectionsAreRemoved) {
+  server_.reset();
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), 2);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Far more sequential connections than the limit
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ("pong", SendMessage("ping"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(0u, server_->GetConnectionCount());
+}
+
+// Test that a saturated server leaves new connections in the backlog instead of closing them
+TEST_F(TcpServerTest, SaturatedAcceptorPauses) {
+  server_.reset();
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), 1);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket first(io_context);
+  first.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(first, boost::asio::buffer(std::string("ping")));
+  std::string reply(4, '\0');
+  boost::asio::read(first, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ("pong", reply);
+
+  // The second client is held in the backlog while the first one is open
+  auto second = std::async(std::launch::async, [this] { return SendMessage("ping"); });
+  EXPECT_EQ(std::future_status::timeout, second.wait_for(std::chrono::milliseconds(200)));
+
+  first.close();
+  ASSERT_EQ(std::future_status::ready, second.wait_for(std::chrono::seconds(2)));
+  EXPECT_EQ("pong", second.get());
+
+  const MetricsSnapshot metrics = server_->GetMetrics();
+  EXPECT_EQ(0u, metrics.connections_rejected);
+  EXPECT_GE(metrics.accept_pauses, 1u);
+}
+
+// Test that a slow request on a connection that then goes idle does not hold the acceptor
+TEST_F(TcpServerTest, HandlerLatencyPauseExpires) {
+  server_.reset();
+  ServerOptions options;
+  options.max_handler_latency = std::chrono::milliseconds(50);
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        if (request == "slow") {
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        response.Write("pong");
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // One slow request, then the connection stays open without sending anything
+  boost::asio::io_context io_context;
+  tcp::socket idle(io_context);
+  idle.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(idle, boost::asio::buffer(std::string("slow")));
+  std::string reply(4, '\0');
+  boost::asio::read(idle, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ("pong", reply);
+
+  // The accept already posted before the slow request goes through; the acceptor pauses
+  // after it, and the stale average expires while the idle connection stays open
+  for (int i = 0; i < 2; ++i) {
+    auto next = std::async(std::launch::async, [this] { return SendMessage("ping"); });
+    ASSERT_EQ(std::future_status::ready, next.wait_for(std::chrono::seconds(5)));
+    EXPECT_EQ("pong", next.get());
+  }
+  EXPECT_GE(server_->GetMetrics().accept_pauses, 1u);
+}
+
+// Test that connections above the per-address limit are closed
+TEST_F(TcpServerTest, ConnectionsPerIpLimit) {
+  server_.reset();
+  ServerOptions options;
+  options.max_connections_per_ip = 1;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket first(io_context);
+  first.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  tcp::socket second(io_context);
+  second.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+
+  char byte;
+  boost::system::error_code ec;
+  second.read_some(boost::asio::buffer(&byte, 1), ec);
+  EXPECT_EQ(boost::asio::error::eof, ec);
+  EXPECT_EQ(1u, server_->GetMetrics().connections_rejected);
+
+  // The first connection still works, and closing it frees the address
+  boost::asio::write(first, boost::asio::buffer(std::string("ping")));
+  std::string reply(4, '\0');
+  boost::asio::read(first, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ("pong", reply);
+  first.close();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ("pong", SendMessage("ping"));
+}
+
+// Test metrics counters and the Prometheus endpoint
+TEST_F(TcpServerTest, Metrics) {
+  server_.reset();
+  ServerOptions options;
+  options.metrics_port = 12346;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ("pong", SendMessage("ping"));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  const MetricsSnapshot metrics = server_->GetMetrics();
+  EXPECT_EQ(3u, metrics.connections_accepted);
+  EXPECT_EQ(0u, metrics.connections_rejected);
+  EXPECT_EQ(0u, metrics.connections_active);
+  EXPECT_EQ(12u, metrics.bytes_received);
+  EXPECT_EQ(12u, metrics.bytes_sent);
+  EXPECT_EQ(3u, metrics.handler_invocations);
+  EXPECT_EQ(3u, metrics.handler_time_ns.Count());
+  EXPECT_TRUE(metrics.errors.empty());
+
+  // Scrape the admin port
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 12346));
+  boost::asio::write(socket, boost::asio::buffer(std::string("GET /metrics HTTP/1.0\r\n\r\n")));
+  std::string response;
+  boost::system::error_code ec;
+  boost::asio::read(socket, boost::asio::dynamic_buffer(response), ec);
+
+  EXPECT_EQ(0u, response.find("HTTP/1.0 200 OK"));
+  EXPECT_NE(std::string::npos, response.find("tcp_server_connections_accepted_total 3\n"));
+  EXPECT_NE(std::string::npos, response.find("tcp_server_handler_duration_seconds_count 3\n"));
+
+  // Only the metrics path is served
+  tcp::socket other(io_context);
+  other.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 12346));
+  boost::asio::write(other, boost::asio::buffer(std::string("GET / HTTP/1.0\r\n\r\n")));
+  response.clear();
+  boost::asio::read(other, boost::asio::dynamic_buffer(response), ec);
+  EXPECT_EQ(0u, response.find("HTTP/1.0 404 Not Found"));
+
+  // Stop() releases the admin port
+  server_->Stop();
+  tcp::socket after_stop(io_context);
+  after_stop.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 12346), ec);
+  EXPECT_TRUE(ec);
+}
+
+// Test that an offloaded slow handler neither blocks other connections nor reorders responses
+TEST_F(TcpServerTest, OffloadedHandlers) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  options.handler_execution = HandlerExecution::kOffload;
+  options.handler_threads = 2;
+  options.max_pending_requests = 2;
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        if (request == "slow") {
+          std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+        response.Write(request);
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket slow_socket(io_context);
+  slow_socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(slow_socket, boost::asio::buffer(std::string("slow\n1\n2\n3\n4\n5\n")));
+
+  // The single I/O thread keeps serving other clients meanwhile
+  const auto start = std::chrono::steady_clock::now();
+  tcp::socket fast_socket(io_context);
+  fast_socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(fast_socket, boost::asio::buffer(std::string("fast\n")));
+  std::string fast_reply(5, '\0');
+  boost::asio::read(fast_socket, boost::asio::buffer(&fast_reply[0], fast_reply.size()));
+  EXPECT_EQ("fast\n", fast_reply);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(250));
+
+  const std::string expected = "slow\n1\n2\n3\n4\n5\n";
+  std::string slow_reply(expected.size(), '\0');
+  boost::asio::read(slow_socket, boost::asio::buffer(&slow_reply[0], slow_reply.size()));
+  EXPECT_EQ(expected, slow_reply);
+}
+
+// Test that repeated requests are answered from the response cache until invalidated
+TEST_F(TcpServerTest, ResponseCache) {
+  const std::string big(4000, 'x');
+  for (HandlerExecution execution : {HandlerExecution::kInline, HandlerExecution::kOffload}) {
+    server_.reset();
+    std::atomic<int> calls{0};
+    ServerOptions options;
+    options.framer = std::make_shared<DelimiterFramer>("\n", 8 * 1024);
+    options.handler_execution = execution;
+    options.handler_threads = 2;
+    options.response_cache.max_bytes = 1024 * 1024;
+    options.response_cache.key = [](std::string_view request) {
+      return request == "random" ? std::string_view() : request;
+    };
+    server_ = std::make_unique<TcpServer>(
+        test_port_,
+        [&calls, &big](std::string_view request, ResponseWriter& response) {
+          const int call = ++calls;
+          if (request == "big") {
+            response.Write(big);
+          } else if (request == "error") {
+            response.DisableCache();
+            response.Write("error:" + std::to_string(call));
+          } else {
+            response.Write(std::string(request) + ":" + std::to_string(call));
+          }
+        },
+        options);
+    server_->Start(1);
+
+    // Wait a bit for the server to start
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    boost::asio::io_context io_context;
+    tcp::socket socket(io_context);
+    socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+    boost::asio::write(socket, boost::asio::buffer(std::string(
+        "hello\nhello\nbig\nbig\nerror\nerror\nrandom\nrandom\nhello\n")));
+
+    // Responses stay in request order whether they come from the cache or the handler
+    const std::string expected = "hello:1\nhello:1\n" + big + "\n" + big + "\n" +
+                                 "error:3\nerror:4\nrandom:5\nrandom:6\nhello:1\n";
+    std::string reply(expected.size(), '\0');
+    boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+    EXPECT_EQ(expected, reply);
+
+    MetricsSnapshot metrics = server_->GetMetrics();
+    EXPECT_EQ(3u, metrics.response_cache_hits);
+    EXPECT_EQ(4u, metrics.response_cache_misses);
+    EXPECT_EQ(6u, metrics.handler_invocations);
+    EXPECT_EQ(2u, metrics.response_cache_entries);
+    EXPECT_GT(metrics.response_cache_bytes, big.size());
+
+    // Invalidation makes the next request go to the handler again
+    EXPECT_TRUE(server_->InvalidateCachedResponse("hello"));
+    EXPECT_FALSE(server_->InvalidateCachedResponse("hello"));
+    boost::asio::write(socket, boost::asio::buffer(std::string("hello\nhello\n")));
+    std::string refreshed(16, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&refreshed[0], refreshed.size()));
+    EXPECT_EQ("hello:7\nhello:7\n", refreshed);
+
+    server_->ClearResponseCache();
+    EXPECT_EQ(0u, server_->GetMetrics().response_cache_entries);
+    socket.close();
+  }
+}
+
+// Test that a router serves as the message handler and can be reloaded while running
+TEST_F(TcpServerTest, Router) {
+  server_.reset();
+  RouteTable routes;
+  routes.Add("hello", [](std::string_view, ResponseWriter& response) { response.Write("world"); });
+  routes.Add("echo", [](std::string_view arguments, ResponseWriter& response) {
+    response.Write(arguments);
+  });
+  Router router(routes);
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  server_ = std::make_unique<TcpServer>(test_port_, router.AsMessageHandler(), options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("hello\r\necho a b\nnone\n")));
+  // Unknown commands without a fallback get an empty response
+  std::string reply(11, '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ("world\na b\n\n", reply);
+
+  routes.SetFallback([](std::string_view, ResponseWriter& response) { response.Write("?"); });
+  router.Update(routes);
+  boost::asio::write(socket, boost::asio::buffer(std::string("none\n")));
+  std::string fallback(2, '\0');
+  boost::asio::read(socket, boost::asio::buffer(&fallback[0], fallback.size()));
+  EXPECT_EQ("?\n", fallback);
+
+  server_->Stop();
+}
+
+// Test that the read buffer grows for bulk transfers
+TEST_F(TcpServerTest, AdaptiveReadBuffer) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<LengthPrefixFramer>();
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        response.Write(std::to_string(request.size()));
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+
+  // 1 MB would take 1024 reads with a fixed 1 KB buffer
+  const std::string payload(256 * 1024, 'x');
+  std::string requests;
+  std::string expected;
+  for (int i = 0; i < 4; ++i) {
+    options.framer->Encode(payload, &requests);
+    options.framer->Encode(std::to_string(payload.size()), &expected);
+  }
+  boost::asio::write(socket, boost::asio::buffer(requests));
+
+  std::string reply(expected.size(), '\0');
+  boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+  EXPECT_EQ(expected, reply);
+  EXPECT_LT(server_->GetMetrics().read_operations, 256u);
+}
+
+// Test that an idle connection is closed by the server
+TEST_F(TcpServerTest, IdleTimeout) {
+  server_.reset();
+  ServerOptions options;
+  options.idle_timeout = std::chrono::milliseconds(200);
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Activity keeps the connection open
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  for (int i = 0; i < 3; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    boost::asio::write(socket, boost::asio::buffer(std::string("ping")));
+    std::string reply(4, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&reply[0], reply.size()));
+    EXPECT_EQ("pong", reply);
+  }
+
+  // Silence closes it
+  const auto start = std::chrono::steady_clock::now();
+  char byte;
+  boost::system::error_code ec;
+  socket.read_some(boost::asio::buffer(&byte, 1), ec);
+  EXPECT_EQ(boost::asio::error::eof, ec);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+  EXPECT_EQ(1u, server_->GetMetrics().connections_timed_out);
+}
+
+// Test that a frame left incomplete is closed by the read timeout
+TEST_F(TcpServerTest, ReadTimeout) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  options.read_timeout = std::chrono::milliseconds(200);
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("ping\npi")));
+
+  std::string reply;
+  boost::system::error_code ec;
+  boost::asio::read(socket, boost::asio::dynamic_buffer(reply), ec);
+  EXPECT_EQ(boost::asio::error::eof, ec);
+  EXPECT_EQ("pong\n", reply);
+  EXPECT_EQ(1u, server_->GetMetrics().connections_timed_out);
+}
+
+// Test publishing to every connection and to the subscribers of a topic
+TEST_F(TcpServerTest, PublishSubscribe) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [this](std::string_view request, ResponseWriter& response) {
+        // "sub <topic>" subscribes the sending connection
+        EXPECT_TRUE(server_->Subscribe(response.GetConnectionId(),
+                                       std::string(request.substr(4))));
+        response.Write("ok");
+      },
+      options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  auto connect = [&](const std::string& topic) {
+    auto socket = std::make_unique<tcp::socket>(io_context);
+    socket->connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+    boost::asio::write(*socket, boost::asio::buffer("sub " + topic + "\n"));
+    std::string reply(3, '\0');
+    boost::asio::read(*socket, boost::asio::buffer(&reply[0], reply.size()));
+    EXPECT_EQ("ok\n", reply);
+    return socket;
+  };
+  auto read_exactly = [](tcp::socket& socket, std::size_t size) {
+    std::string data(size, '\0');
+    boost::asio::read(socket, boost::asio::buffer(&data[0], data.size()));
+    return data;
+  };
+  auto prices = connect("prices");
+  auto news = connect("news");
+
+  EXPECT_EQ(1u, server_->Publish("prices", "tick"));
+  EXPECT_EQ(0u, server_->Publish("weather", "rain"));
+  EXPECT_EQ(2u, server_->Publish("everyone"));
+  EXPECT_EQ("tick\neveryone\n", read_exactly(*prices, 14));
+  EXPECT_EQ("everyone\n", read_exactly(*news, 9));
+
+  // Closing a subscriber removes its subscriptions
+  prices->close();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(0u, server_->Publish("prices", "tick"));
+  EXPECT_EQ(3u, server_->GetMetrics().messages_published);
+}
+
+// Test that a subscriber that does not read only gets the latest message once it catches up
+TEST_F(TcpServerTest, ConflateSlowSubscriber) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  options.slow_subscriber_limit = 64 * 1024;
+  options.slow_subscriber_policy = SlowSubscriberPolicy::kConflate;
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [this](std::string_view, ResponseWriter& response) {
+        server_->Subscribe(response.GetConnectionId(), "prices");
+        response.Write("ok");
+      },
+      options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("sub\n")));
+  std::string reply;
+  boost::asio::read_until(socket, boost::asio::dynamic_buffer(reply), '\n');
+
+  // Far more than the socket buffers hold while the client is not reading
+  const std::string padding(16 * 1024, 'x');
+  constexpr int kMessages = 2000;
+  for (int i = 0; i < kMessages; ++i) {
+    server_->Publish("prices", std::to_string(i) + padding);
+  }
+  const std::string last = std::to_string(kMessages - 1) + padding + "\n";
+
+  // Lines arrive in order and the stream ends with the latest message
+  std::string buffer;
+  std::string line;
+  std::size_t lines = 0;
+  while (line != last) {
+    const std::size_t length =
+        boost::asio::read_until(socket, boost::asio::dynamic_buffer(buffer), '\n');
+    line = buffer.substr(0, length);
+    buffer.erase(0, length);
+    ++lines;
+  }
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_LT(lines, static_cast<std::size_t>(kMessages));
+  EXPECT_GT(server_->GetMetrics().messages_dropped, 0u);
+}
+
+// Test that a subscriber that does not read is closed under the disconnect policy
+TEST_F(TcpServerTest, DisconnectSlowSubscriber) {
+  server_.reset();
+  ServerOptions options;
+  options.slow_subscriber_limit = 64 * 1024;
+  options.slow_subscriber_policy = SlowSubscriberPolicy::kDisconnect;
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  const std::string message(16 * 1024, 'x');
+  for (int i = 0; i < 2000 && server_->GetConnectionCount() > 0; ++i) {
+    server_->Publish(message);
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(0u, server_->GetConnectionCount());
+  EXPECT_EQ(1u, server_->GetMetrics().slow_subscribers_disconnected);
+}
+
+// Test that draining closes idle connections at once and finishes requests in progress
+TEST_F(TcpServerTest, Drain) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  options.handler_execution = HandlerExecution::kOffload;
+  options.handler_threads = 1;
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](std::string_view request, ResponseWriter& response) {
+        if (request == "slow") {
+          std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        }
+        response.Write(request);
+      },
+      options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket idle_socket(io_context);
+  idle_socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  tcp::socket busy_socket(io_context);
+  busy_socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(busy_socket, boost::asio::buffer(std::string("slow\n")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  auto drained = std::async(std::launch::async, [this] {
+    return server_->Drain(std::chrono::seconds(5));
+  });
+
+  // The idle connection closes without waiting for the slow request
+  const auto start = std::chrono::steady_clock::now();
+  char byte;
+  boost::system::error_code ec;
+  idle_socket.read_some(boost::asio::buffer(&byte, 1), ec);
+  EXPECT_EQ(boost::asio::error::eof, ec);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+
+  // The busy one gets its response, then closes
+  std::string reply;
+  boost::asio::read(busy_socket, boost::asio::dynamic_buffer(reply), ec);
+  EXPECT_EQ(boost::asio::error::eof, ec);
+  EXPECT_EQ("slow\n", reply);
+
+  EXPECT_TRUE(drained.get());
+  EXPECT_FALSE(server_->IsRunning());
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+// Test that a second server takes over the listening socket of a running one
+TEST_F(TcpServerTest, ListenerHandoff) {
+  server_.reset();
+  const std::string path = "/tmp/tcp_server_test_handoff.sock";
+  std::promise<void> handed_off;
+  ServerOptions options;
+  options.listener_handoff_path = path;
+  options.on_listener_handoff = [&handed_off] { handed_off.set_value(); };
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ("pong", SendMessage("ping"));
+
+  // The successor binds nothing, so it would fail without the handoff
+  ServerOptions successor_options;
+  successor_options.listener_handoff_path = path;
+  TcpServer successor(test_port_,
+                      [](const std::string& message) -> std::string { return "new " + message; },
+                      successor_options);
+  EXPECT_EQ(test_port_, successor.GetPort());
+  ASSERT_EQ(std::future_status::ready,
+            handed_off.get_future().wait_for(std::chrono::seconds(5)));
+  successor.Start(1);
+
+  EXPECT_EQ("new ping", SendMessage("ping"));
+  EXPECT_TRUE(server_->Drain(std::chrono::seconds(1)));
+  EXPECT_EQ("new ping", SendMessage("ping"));
+  successor.Stop();
+}
+
+// Test that Unix domain sockets are handed over by path and their files stay for the successor
+TEST_F(TcpServerTest, ListenerHandoffUnixDomainSocket) {
+  server_.reset();
+  const std::string path = "/tmp/tcp_server_test_handoff_local.sock";
+  std::promise<void> handed_off;
+  ServerOptions options;
+  options.execution_mode = ExecutionMode::kContextPerThread;
+  options.listener_handoff_path = "/tmp/tcp_server_test_handoff.sock";
+  options.socket.unix_socket_paths = {path};
+  options.on_listener_handoff = [&handed_off] { handed_off.set_value(); };
+  server_ = std::make_unique<TcpServer>(test_port_, TestHandler(), options);
+  server_->Start(2);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ("pong", SendLocalMessage(path, "ping"));
+
+  // Binding the path again would fail while the predecessor accepts on it
+  ServerOptions successor_options = options;
+  successor_options.on_listener_handoff = nullptr;
+  TcpServer successor(test_port_,
+                      [](const std::string& message) -> std::string { return "new " + message; },
+                      successor_options);
+  ASSERT_EQ(std::future_status::ready,
+            handed_off.get_future().wait_for(std::chrono::seconds(5)));
+  successor.Start(2);
+
+  EXPECT_TRUE(server_->Drain(std::chrono::seconds(1)));
+  server_.reset();
+  EXPECT_EQ("new ping", SendLocalMessage(path, "ping"));
+  EXPECT_EQ("new ping", SendMessage("ping"));
+  successor.Stop();
+}
+#endif
+
+#if defined(TCP_SERVER_HAS_COROUTINES)
+// Test a coroutine session that sends several replies per request and waits on a timer
+TEST_F(TcpServerTest, CoroutineSession) {
+  server_.reset();
+  ServerOptions options;
+  options.framer = std::make_shared<DelimiterFramer>("\n");
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [](Session& session) -> boost::asio::awaitable<void> {
+        while (auto request = co_await session.ReadFrame()) {
+          const std::string copy(*request);
+          co_await session.WriteFrame("begin " + copy);
+          co_await session.Sleep(std::chrono::milliseconds(10));
+          co_await session.Write("end " + copy + "\n");
+        }
+      },
+      options);
+  server_->Start(2);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  boost::asio::write(socket, boost::asio::buffer(std::string("a\nb\n")));
+
+  // Sessions do not receive published messages, so they are not counted as recipients
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(1u, server_->GetConnectionCount());
+  EXPECT_EQ(0u, server_->Publish("news"));
+  socket.shutdown(tcp::socket::shutdown_send);
+
+  // The session ends at EOF and the server closes the connection
+  std::string reply;
+  boost::system::error_code ec;
+  boost::asio::read(socket, boost::asio::dynamic_buffer(reply), ec);
+  EXPECT_EQ(boost::asio::error::eof, ec);
+  EXPECT_EQ("begin a\nend a\nbegin b\nend b\n", reply);
+}
+
+// Test that stopping the connection wakes a session from Sleep()
+TEST_F(TcpServerTest, CoroutineSessionSleepInterrupted) {
+  server_.reset();
+  auto interrupted = std::make_shared<std::atomic<bool>>(false);
+  server_ = std::make_unique<TcpServer>(
+      test_port_,
+      [interrupted](Session& session) -> boost::asio::awaitable<void> {
+        // Another coroutine on the connection's executor closes it
+        boost::asio::co_spawn(
+            session.GetExecutor(),
+            [&session]() -> boost::asio::awaitable<void> {
+              boost::asio::steady_timer timer(session.GetExecutor(),
+                                              std::chrono::milliseconds(50));
+              co_await timer.async_wait(boost::asio::use_awaitable);
+              session.Close();
+            },
+            boost::asio::detached);
+        try {
+          co_await session.Sleep(std::chrono::seconds(30));
+        } catch (const boost::system::system_error&) {
+          *interrupted = true;
+          throw;
+        }
+      },
+      ServerOptions());
+  server_->Start(1);
+
+  // Wait a bit for the server to start
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  boost::asio::io_context io_context;
+  tcp::socket socket(io_context);
+  socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), test_port_));
+  for (int i = 0; i < 100 && !*interrupted; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(*interrupted);
+}
+#endif
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
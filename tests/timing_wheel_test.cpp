@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "src/internal/timing_wheel.h"
+
+using namespace tcp_server::internal;
+
+namespace {
+
+// Timer that records the tick it fired at
+struct TestTimer {
+  TimingWheel* wheel = nullptr;
+  TimerNode node;
+  std::vector<std::uint64_t> fired;
+
+  explicit TestTimer(TimingWheel* timing_wheel) : wheel(timing_wheel) {
+    node.on_expire = [](void* context) {
+      auto* timer = static_cast<TestTimer*>(context);
+      timer->fired.push_back(timer->wheel->Now());
+    };
+    node.context = this;
+  }
+};
+
+}  // namespace
+
+// Test that timers in every level fire exactly at their expiry tick
+TEST(TimingWheelTest, FiresAtExpiry) {
+  TimingWheel wheel;
+  std::vector<std::uint64_t> expiries = {1, 255, 256, 257, 1000, 65535, 65536, 70000, 16777300};
+  std::vector<std::unique_ptr<TestTimer>> timers;
+  for (std::uint64_t expiry : expiries) {
+    timers.push_back(std::make_unique<TestTimer>(&wheel));
+    wheel.Schedule(&timers.back()->node, expiry);
+  }
+
+  EXPECT_EQ(expiries.size(), wheel.Advance(expiries.back()));
+  for (std::size_t i = 0; i < expiries.size(); ++i) {
+    ASSERT_EQ(1u, timers[i]->fired.size());
+    EXPECT_EQ(expiries[i], timers[i]->fired[0]);
+    EXPECT_FALSE(timers[i]->node.IsLinked());
+  }
+}
+
+// Test that scheduling relative to a later time cascades correctly
+TEST(TimingWheelTest, ScheduleAfterAdvance) {
+  TimingWheel wheel;
+  wheel.Advance(300);
+  TestTimer timer(&wheel);
+  wheel.Schedule(&timer.node, 300 + 65535);
+
+  wheel.Advance(300 + 65534);
+  EXPECT_TRUE(timer.fired.empty());
+  wheel.Advance(300 + 65535);
+  ASSERT_EQ(1u, timer.fired.size());
+  EXPECT_EQ(300u + 65535u, timer.fired[0]);
+}
+
+// Test cancelling and rescheduling
+TEST(TimingWheelTest, CancelAndReschedule) {
+  TimingWheel wheel;
+  TestTimer cancelled(&wheel);
+  TestTimer moved(&wheel);
+  wheel.Schedule(&cancelled.node, 10);
+  wheel.Schedule(&moved.node, 10);
+  wheel.Cancel(&cancelled.node);
+  wheel.Cancel(&cancelled.node);
+  wheel.Schedule(&moved.node, 500);
+
+  EXPECT_EQ(0u, wheel.Advance(499));
+  EXPECT_EQ(1u, wheel.Advance(600));
+  EXPECT_TRUE(cancelled.fired.empty());
+  ASSERT_EQ(1u, moved.fired.size());
+  EXPECT_EQ(500u, moved.fired[0]);
+}
+
+// Test that an expiry in the past fires on the next tick
+TEST(TimingWheelTest, PastExpiry) {
+  TimingWheel wheel;
+  wheel.Advance(100);
+  TestTimer timer(&wheel);
+  wheel.Schedule(&timer.node, 50);
+
+  EXPECT_EQ(1u, wheel.Advance(101));
+  ASSERT_EQ(1u, timer.fired.size());
+  EXPECT_EQ(101u, timer.fired[0]);
+}
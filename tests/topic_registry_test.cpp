@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+
+#include "src/internal/topic_registry.h"
+
+using namespace tcp_server::internal;
+
+// Test that subscribers are listed per topic and removed again
+TEST(TopicRegistryTest, SubscribeAndUnsubscribe) {
+  TopicRegistry topics;
+  EXPECT_EQ(nullptr, topics.Find("prices").subscribers);
+
+  EXPECT_TRUE(topics.Subscribe(1, "prices"));
+  EXPECT_TRUE(topics.Subscribe(2, "prices"));
+  EXPECT_FALSE(topics.Subscribe(2, "prices"));
+  EXPECT_TRUE(topics.Subscribe(2, "news"));
+  EXPECT_EQ((TopicRegistry::SubscriberList{1, 2}), *topics.Find("prices").subscribers);
+  EXPECT_EQ((TopicRegistry::SubscriberList{2}), *topics.Find("news").subscribers);
+
+  EXPECT_TRUE(topics.Unsubscribe(1, "prices"));
+  EXPECT_FALSE(topics.Unsubscribe(1, "prices"));
+  EXPECT_EQ((TopicRegistry::SubscriberList{2}), *topics.Find("prices").subscribers);
+
+  topics.UnsubscribeAll(2);
+  EXPECT_EQ(nullptr, topics.Find("prices").subscribers);
+  EXPECT_EQ(nullptr, topics.Find("news").subscribers);
+}
+
+// Test that a snapshot taken for a publish is not changed by later subscriptions
+TEST(TopicRegistryTest, SnapshotIsImmutable) {
+  TopicRegistry topics;
+  topics.Subscribe(1, "prices");
+  const TopicRegistry::Snapshot snapshot = topics.Find("prices");
+
+  topics.Subscribe(2, "prices");
+  topics.Unsubscribe(1, "prices");
+  EXPECT_EQ((TopicRegistry::SubscriberList{1}), *snapshot.subscribers);
+  EXPECT_EQ((TopicRegistry::SubscriberList{2}), *topics.Find("prices").subscribers);
+}
+
+// Test that topic tags are unique, even when a topic is recreated
+TEST(TopicRegistryTest, TagsAreNotReused) {
+  TopicRegistry topics;
+  topics.Subscribe(1, "a");
+  topics.Subscribe(1, "b");
+  const std::uint64_t a = topics.Find("a").tag;
+  const std::uint64_t b = topics.Find("b").tag;
+  EXPECT_NE(a, b);
+  EXPECT_NE(TopicRegistry::kBroadcastTag, a);
+
+  topics.UnsubscribeAll(1);
+  topics.Subscribe(1, "a");
+  EXPECT_NE(a, topics.Find("a").tag);
+  EXPECT_NE(b, topics.Find("a").tag);
+}
+
+// Test that a batch of changes is visible to the next Find()
+TEST(TopicRegistryTest, ManySubscribers) {
+  TopicRegistry topics;
+  constexpr ConnectionRegistry::Id kCount = 10000;
+  for (ConnectionRegistry::Id id = 1; id <= kCount; ++id) {
+    EXPECT_TRUE(topics.Subscribe(id, "prices"));
+  }
+  EXPECT_EQ(kCount, topics.Find("prices").subscribers->size());
+
+  for (ConnectionRegistry::Id id = 1; id <= kCount; id += 2) {
+    EXPECT_TRUE(topics.Unsubscribe(id, "prices"));
+  }
+  TopicRegistry::SubscriberList remaining = *topics.Find("prices").subscribers;
+  std::sort(remaining.begin(), remaining.end());
+  ASSERT_EQ(kCount / 2, remaining.size());
+  for (std::size_t i = 0; i < remaining.size(); ++i) {
+    EXPECT_EQ(2 * (i + 1), remaining[i]);
+  }
+
+  for (ConnectionRegistry::Id id = 2; id <= kCount; id += 2) {
+    topics.UnsubscribeAll(id);
+  }
+  EXPECT_EQ(nullptr, topics.Find("prices").subscribers);
+}